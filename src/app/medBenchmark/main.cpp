@@ -0,0 +1,176 @@
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#include <medBenchmarkData.h>
+#include <medBenchmarkRunner.h>
+#include <medBenchmarkSuites.h>
+
+#include <medCore.h>
+#include <medPluginManager.h>
+
+#include <dtkLog>
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <iostream>
+
+namespace
+{
+
+bool parseSize(const QString& text, int size[3])
+{
+    const QStringList values = text.split(QRegularExpression("[,x]"), QString::SkipEmptyParts);
+    if (values.size() != 1 && values.size() != 3)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < 3; ++i)
+    {
+        bool ok = false;
+        size[i] = values.value(values.size() == 1 ? 0 : i).toInt(&ok);
+        if (!ok || size[i] <= 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    // The importer renders thumbnails, so a GUI application is needed even without windows
+    QApplication application(argc, argv);
+    application.setApplicationName("medInria");
+    application.setApplicationVersion(MEDINRIA_VERSION);
+    application.setOrganizationName("inria");
+    application.setOrganizationDomain("fr");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times the medInria processes, readers, writers, import and view conversion "
+                                     "on synthetic data, and writes the results as JSON.");
+    parser.addHelpOption();
+
+    QCommandLineOption sizeOption("size", "Volume size, as N or X,Y,Z.", "size", "128");
+    QCommandLineOption meshOption("mesh-resolution", "Resolution of the synthetic sphere mesh.", "resolution", "256");
+    QCommandLineOption repeatOption("repeat", "Timed iterations of each case.", "count", "3");
+    QCommandLineOption filterOption("filter", "Regular expression on category/name of the cases to run.", "regexp", ".*");
+    QCommandLineOption suitesOption("suites", "Comma separated suites among processes, io, import, conversion.",
+                                    "suites", "processes,io,import,conversion");
+    QCommandLineOption outputOption("output", "JSON file to write, standard output by default.", "file");
+    QCommandLineOption workOption("work-dir", "Directory for the generated files, a temporary one by default.", "directory");
+    QCommandLineOption pluginsOption("plugins", "Directory of the process plugins.", "directory");
+    parser.addOptions({ sizeOption, meshOption, repeatOption, filterOption, suitesOption, outputOption, workOption, pluginsOption });
+    parser.process(application);
+
+    medBenchmarkContext context;
+    if (!parseSize(parser.value(sizeOption), context.size))
+    {
+        std::cerr << "Invalid size: " << qPrintable(parser.value(sizeOption)) << std::endl;
+        return 1;
+    }
+
+    const QRegularExpression filter(parser.value(filterOption));
+    if (!filter.isValid())
+    {
+        std::cerr << "Invalid filter: " << qPrintable(filter.errorString()) << std::endl;
+        return 1;
+    }
+
+    QTemporaryDir temporaryDirectory;
+    context.workDirectory = parser.isSet(workOption) ? parser.value(workOption) : temporaryDirectory.path();
+    QDir().mkpath(context.workDirectory);
+
+    // Legacy plugins bring the data types, readers and writers, the others the processes
+    medPluginManager::instance()->initialize();
+
+    QString pluginsPath = parser.value(pluginsOption);
+    if (pluginsPath.isEmpty())
+    {
+        pluginsPath = qgetenv("MEDINRIA_PLUGINS_DIR");
+    }
+    if (pluginsPath.isEmpty())
+    {
+        pluginsPath = QDir(application.applicationDirPath() + "/plugins").absolutePath();
+    }
+    medCore::pluginManager::initialize(pluginsPath);
+
+    const QStringList suites = parser.value(suitesOption).split(',', QString::SkipEmptyParts);
+
+    context.volume = medBenchmarkData::createVolume("itkDataImageShort3", context.size);
+    context.floatVolume = medBenchmarkData::createVolume("itkDataImageFloat3", context.size);
+    context.mask = medBenchmarkData::createMask(context.size);
+    context.mesh = medBenchmarkData::createMesh(parser.value(meshOption).toInt());
+    if (!context.volume || !context.floatVolume || !context.mask)
+    {
+        std::cerr << "The itkDataImage plugin is needed to create the synthetic volumes." << std::endl;
+        return 1;
+    }
+    if (suites.contains("io") || suites.contains("import"))
+    {
+        context.dicomFiles = medBenchmarkData::writeDicomSeries(QDir(context.workDirectory).filePath("dicom"), context.size);
+    }
+
+    medBenchmarkRunner runner(parser.value(repeatOption).toInt(), filter);
+
+    if (suites.contains("processes"))
+    {
+        medBenchmarkSuites::processes(runner, context);
+    }
+    if (suites.contains("io") || suites.contains("import"))
+    {
+        // Import reuses the files written by the writer benchmarks
+        medBenchmarkSuites::readersWriters(runner, context);
+    }
+    if (suites.contains("import"))
+    {
+        medBenchmarkSuites::import(runner, context);
+    }
+    if (suites.contains("conversion"))
+    {
+        medBenchmarkSuites::conversion(runner, context);
+    }
+
+    QJsonObject parameters;
+    parameters["size"] = QJsonArray({ context.size[0], context.size[1], context.size[2] });
+    parameters["meshResolution"] = parser.value(meshOption).toInt();
+    parameters["repeat"] = parser.value(repeatOption).toInt();
+    parameters["filter"] = filter.pattern();
+    parameters["suites"] = QJsonArray::fromStringList(suites);
+
+    const QByteArray json = runner.report(parameters).toJson();
+    if (parser.isSet(outputOption))
+    {
+        QFile output(parser.value(outputOption));
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            std::cerr << "Cannot write " << qPrintable(output.fileName()) << std::endl;
+            return 1;
+        }
+        output.write(json);
+    }
+    else
+    {
+        std::cout << json.constData();
+    }
+
+    medPluginManager::instance()->uninitialize();
+    return 0;
+}
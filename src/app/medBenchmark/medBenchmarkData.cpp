@@ -0,0 +1,234 @@
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#include <medBenchmarkData.h>
+
+#include <medAbstractDataFactory.h>
+#include <medAbstractImageData.h>
+
+#include <itkGDCMImageIO.h>
+#include <itkImage.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkImageSeriesWriter.h>
+#include <itkMetaDataObject.h>
+
+#include <gdcmUIDGenerator.h>
+
+#include <vtkMetaSurfaceMesh.h>
+#include <vtkSmartPointer.h>
+#include <vtkSphereSource.h>
+
+#include <QDir>
+
+#include <dtkLog>
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+
+template <class PixelType>
+typename itk::Image<PixelType, 3>::Pointer createImage(const int size[3])
+{
+    typedef itk::Image<PixelType, 3> ImageType;
+
+    typename ImageType::SizeType imageSize;
+    typename ImageType::SpacingType spacing;
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        imageSize[i] = static_cast<itk::SizeValueType>(size[i]);
+        spacing[i] = 1.0;
+    }
+
+    typename ImageType::Pointer image = ImageType::New();
+    image->SetRegions(typename ImageType::RegionType(imageSize));
+    image->SetSpacing(spacing);
+    image->Allocate();
+
+    // Blobs of a few voxels wide plus a cheap integer hash as noise, within [0, 1000]
+    const double frequency = 2.0 * M_PI / 32.0;
+    itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetLargestPossibleRegion());
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+        const typename ImageType::IndexType index = it.GetIndex();
+        const double smooth = std::sin(index[0] * frequency) * std::sin(index[1] * frequency) * std::sin(index[2] * frequency);
+
+        unsigned int hash = static_cast<unsigned int>(index[0] * 73856093u ^ index[1] * 19349663u ^ index[2] * 83492791u);
+        hash = (hash ^ (hash >> 13)) * 1274126177u;
+        const double noise = (hash & 0xffff) / 65535.0;
+
+        it.Set(static_cast<PixelType>(450.0 + 400.0 * smooth + 100.0 * noise));
+    }
+
+    return image;
+}
+
+template <class PixelType>
+medAbstractImageData* wrapImage(const QString& identifier, const int size[3])
+{
+    medAbstractImageData* data = qobject_cast<medAbstractImageData*>(medAbstractDataFactory::instance()->create(identifier));
+    if (data)
+    {
+        typename itk::Image<PixelType, 3>::Pointer image = createImage<PixelType>(size);
+        data->setData(image);
+    }
+    return data;
+}
+
+}
+
+namespace medBenchmarkData
+{
+
+medAbstractImageData* createVolume(const QString& identifier, const int size[3])
+{
+    if      (identifier == "itkDataImageChar3")   return wrapImage<char>(identifier, size);
+    else if (identifier == "itkDataImageUChar3")  return wrapImage<unsigned char>(identifier, size);
+    else if (identifier == "itkDataImageShort3")  return wrapImage<short>(identifier, size);
+    else if (identifier == "itkDataImageUShort3") return wrapImage<unsigned short>(identifier, size);
+    else if (identifier == "itkDataImageInt3")    return wrapImage<int>(identifier, size);
+    else if (identifier == "itkDataImageUInt3")   return wrapImage<unsigned int>(identifier, size);
+    else if (identifier == "itkDataImageFloat3")  return wrapImage<float>(identifier, size);
+    else if (identifier == "itkDataImageDouble3") return wrapImage<double>(identifier, size);
+    return nullptr;
+}
+
+medAbstractImageData* createMask(const int size[3])
+{
+    typedef itk::Image<unsigned char, 3> MaskType;
+
+    medAbstractImageData* data = qobject_cast<medAbstractImageData*>(medAbstractDataFactory::instance()->create("itkDataImageUChar3"));
+    if (!data)
+    {
+        return nullptr;
+    }
+
+    MaskType::Pointer mask = createImage<unsigned char>(size);
+    itk::ImageRegionIteratorWithIndex<MaskType> it(mask, mask->GetLargestPossibleRegion());
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+        double distance = 0.0;
+        for (unsigned int i = 0; i < 3; ++i)
+        {
+            const double centered = (it.GetIndex()[i] + 0.5 - 0.5 * size[i]) / (0.25 * size[i]);
+            distance += centered * centered;
+        }
+        it.Set(distance <= 1.0 ? 1 : 0);
+    }
+
+    data->setData(mask);
+    return data;
+}
+
+QStringList writeDicomSeries(const QString& directory, const int size[3])
+{
+    typedef itk::Image<short, 3> ImageType;
+    typedef itk::Image<short, 2> SliceType;
+
+    QStringList paths;
+    QDir().mkpath(directory);
+
+    ImageType::Pointer image = createImage<short>(size);
+
+    gdcm::UIDGenerator uidGenerator;
+    const std::string studyUID = uidGenerator.Generate();
+    const std::string seriesUID = uidGenerator.Generate();
+    const std::string frameOfReferenceUID = uidGenerator.Generate();
+
+    itk::GDCMImageIO::Pointer io = itk::GDCMImageIO::New();
+    io->KeepOriginalUIDOn();
+
+    std::vector<std::string> fileNames;
+    std::vector<itk::MetaDataDictionary> dictionaries(size[2]);
+    itk::ImageSeriesWriter<ImageType, SliceType>::DictionaryArrayType dictionaryArray;
+
+    for (int slice = 0; slice < size[2]; ++slice)
+    {
+        const QString path = QDir(directory).filePath(QString("slice%1.dcm").arg(slice, 4, 10, QChar('0')));
+        paths << path;
+        fileNames.push_back(path.toStdString());
+
+        itk::MetaDataDictionary& dictionary = dictionaries[slice];
+        itk::EncapsulateMetaData<std::string>(dictionary, "0008|0016", "1.2.840.10008.5.1.4.1.1.4"); // MR image storage
+        itk::EncapsulateMetaData<std::string>(dictionary, "0008|0018", uidGenerator.Generate());
+        itk::EncapsulateMetaData<std::string>(dictionary, "0008|0060", "MR");
+        itk::EncapsulateMetaData<std::string>(dictionary, "0008|103e", "medBenchmark series");
+        itk::EncapsulateMetaData<std::string>(dictionary, "0010|0010", "Benchmark^Synthetic");
+        itk::EncapsulateMetaData<std::string>(dictionary, "0010|0020", "medBenchmark");
+        itk::EncapsulateMetaData<std::string>(dictionary, "0020|000d", studyUID);
+        itk::EncapsulateMetaData<std::string>(dictionary, "0020|000e", seriesUID);
+        itk::EncapsulateMetaData<std::string>(dictionary, "0020|0052", frameOfReferenceUID);
+        itk::EncapsulateMetaData<std::string>(dictionary, "0020|0011", "1");
+        itk::EncapsulateMetaData<std::string>(dictionary, "0020|0013", std::to_string(slice + 1));
+        itk::EncapsulateMetaData<std::string>(dictionary, "0020|0032", "0\\0\\" + std::to_string(slice));
+        itk::EncapsulateMetaData<std::string>(dictionary, "0020|0037", "1\\0\\0\\0\\1\\0");
+        itk::EncapsulateMetaData<std::string>(dictionary, "0020|1041", std::to_string(slice));
+        itk::EncapsulateMetaData<std::string>(dictionary, "0018|0050", "1");
+        itk::EncapsulateMetaData<std::string>(dictionary, "0028|0030", "1\\1");
+        dictionaryArray.push_back(&dictionary);
+    }
+
+    itk::ImageSeriesWriter<ImageType, SliceType>::Pointer writer = itk::ImageSeriesWriter<ImageType, SliceType>::New();
+    writer->SetInput(image);
+    writer->SetImageIO(io);
+    writer->SetFileNames(fileNames);
+    writer->SetMetaDataDictionaryArray(&dictionaryArray);
+
+    try
+    {
+        writer->Update();
+    }
+    catch (itk::ExceptionObject& e)
+    {
+        dtkWarn() << "medBenchmark: cannot write the DICOM series:" << e.GetDescription();
+        return QStringList();
+    }
+
+    return paths;
+}
+
+medAbstractData* createMesh(int resolution)
+{
+    medAbstractData* data = medAbstractDataFactory::instance()->create("vtkDataMesh");
+    if (!data)
+    {
+        return nullptr;
+    }
+
+    vtkSmartPointer<vtkSphereSource> sphere = vtkSmartPointer<vtkSphereSource>::New();
+    sphere->SetRadius(50.0);
+    sphere->SetThetaResolution(resolution);
+    sphere->SetPhiResolution(resolution);
+    sphere->Update();
+
+    vtkMetaSurfaceMesh* mesh = vtkMetaSurfaceMesh::New();
+    mesh->SetDataSet(sphere->GetOutput());
+    data->setData(mesh);
+    mesh->Delete();
+
+    return data;
+}
+
+qint64 volumeBytes(const QString& identifier, const int size[3])
+{
+    qint64 pixelSize = 1;
+    if      (identifier.contains("Short"))  pixelSize = 2;
+    else if (identifier.contains("Int"))    pixelSize = 4;
+    else if (identifier.contains("Float"))  pixelSize = 4;
+    else if (identifier.contains("Double")) pixelSize = 8;
+
+    return pixelSize * size[0] * size[1] * size[2];
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#include <QString>
+#include <QStringList>
+
+class medAbstractData;
+class medAbstractImageData;
+
+/**
+ * Synthetic data for the benchmarks. The content is deterministic, smooth with some noise,
+ * so that filters and compressed writers do realistic work and runs can be compared.
+ */
+namespace medBenchmarkData
+{
+    //! Volume of the given itkDataImage identifier, only scalar 3D types are handled
+    medAbstractImageData* createVolume(const QString& identifier, const int size[3]);
+
+    //! Unsigned char mask of a centered ellipsoid filling half of each axis
+    medAbstractImageData* createMask(const int size[3]);
+
+    //! Writes a short volume as a DICOM MR series of size[2] files in directory, returns the file paths
+    QStringList writeDicomSeries(const QString& directory, const int size[3]);
+
+    //! vtkDataMesh of a sphere with resolution x resolution facets
+    medAbstractData* createMesh(int resolution);
+
+    //! Bytes of a volume of this identifier and size
+    qint64 volumeBytes(const QString& identifier, const int size[3]);
+}
@@ -0,0 +1,159 @@
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#include <medBenchmarkRunner.h>
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QSysInfo>
+#include <QThread>
+
+#include <dtkLog>
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+medBenchmarkRunner::medBenchmarkRunner(int repeat, const QRegularExpression& filter)
+    : m_repeat(std::max(1, repeat)), m_filter(filter)
+{
+}
+
+bool medBenchmarkRunner::isSelected(const QString& category, const QString& name) const
+{
+    return m_filter.match(category + "/" + name).hasMatch();
+}
+
+void medBenchmarkRunner::run(const QString& category, const QString& name, qint64 bytes, qint64 items,
+                             const std::function<void()>& setup, const std::function<bool()>& body)
+{
+    if (!isSelected(category, name))
+    {
+        return;
+    }
+
+    dtkInfo() << "benchmark" << category + "/" + name;
+
+    const qint64 peakBefore = peakResidentSetSize();
+    std::vector<double> seconds;
+    bool success = true;
+
+    for (int i = 0; i < m_repeat && success; ++i)
+    {
+        if (setup)
+        {
+            setup();
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        success = body();
+        seconds.push_back(timer.nsecsElapsed() * 1e-9);
+    }
+
+    const qint64 peakAfter = peakResidentSetSize();
+
+    QJsonObject result;
+    result["category"] = category;
+    result["name"] = name;
+    result["status"] = success ? "ok" : "failed";
+    result["iterations"] = static_cast<int>(seconds.size());
+
+    if (success)
+    {
+        std::sort(seconds.begin(), seconds.end());
+        const double mean = std::accumulate(seconds.begin(), seconds.end(), 0.0) / seconds.size();
+        const double median = seconds.size() % 2 ? seconds[seconds.size() / 2]
+                                                 : 0.5 * (seconds[seconds.size() / 2 - 1] + seconds[seconds.size() / 2]);
+
+        QJsonObject time;
+        time["min"] = seconds.front();
+        time["median"] = median;
+        time["mean"] = mean;
+        time["max"] = seconds.back();
+        result["seconds"] = time;
+
+        // Throughput of the median iteration, which is less sensitive to a cold first run
+        if (median > 0)
+        {
+            result["megabytesPerSecond"] = bytes / (1024.0 * 1024.0) / median;
+            result["itemsPerSecond"] = items / median;
+        }
+    }
+
+    result["bytes"] = bytes;
+    result["items"] = items;
+    result["peakRssKiB"] = peakAfter;
+    result["peakRssGrowthKiB"] = peakAfter - peakBefore;
+
+    m_results.append(result);
+}
+
+void medBenchmarkRunner::skip(const QString& category, const QString& name, const QString& reason)
+{
+    if (!isSelected(category, name))
+    {
+        return;
+    }
+
+    QJsonObject result;
+    result["category"] = category;
+    result["name"] = name;
+    result["status"] = "skipped";
+    result["reason"] = reason;
+    m_results.append(result);
+}
+
+QJsonDocument medBenchmarkRunner::report(const QJsonObject& parameters) const
+{
+    QJsonObject root;
+    root["version"] = QString(MEDINRIA_VERSION);
+    root["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    root["host"] = QSysInfo::machineHostName();
+    root["os"] = QSysInfo::prettyProductName();
+    root["cpu"] = QSysInfo::currentCpuArchitecture();
+    root["threads"] = QThread::idealThreadCount();
+    root["parameters"] = parameters;
+    root["results"] = m_results;
+    return QJsonDocument(root);
+}
+
+qint64 medBenchmarkRunner::peakResidentSetSize()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return static_cast<qint64>(counters.PeakWorkingSetSize / 1024);
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+#if defined(Q_OS_MAC)
+    return static_cast<qint64>(usage.ru_maxrss / 1024); // bytes on macOS
+#else
+    return static_cast<qint64>(usage.ru_maxrss);        // KiB on Linux
+#endif
+#endif
+}
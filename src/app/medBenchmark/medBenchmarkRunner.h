@@ -0,0 +1,52 @@
+#pragma once
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QString>
+
+#include <functional>
+
+/**
+ * Times benchmark cases and collects their results as JSON.
+ *
+ * Each case runs repeat times: setup is called before every iteration and is not timed, body
+ * is timed and returns false when it failed. Throughput is derived from the bytes and items
+ * handled by one iteration. Memory is reported as the peak resident set size of the process,
+ * which only grows, so the growth attributed to a case is the one seen while it ran.
+ */
+class medBenchmarkRunner
+{
+public:
+    medBenchmarkRunner(int repeat, const QRegularExpression& filter);
+
+    //! Whether category/name is selected by the filter
+    bool isSelected(const QString& category, const QString& name) const;
+
+    void run(const QString& category, const QString& name, qint64 bytes, qint64 items,
+             const std::function<void()>& setup, const std::function<bool()>& body);
+    void skip(const QString& category, const QString& name, const QString& reason);
+
+    QJsonDocument report(const QJsonObject& parameters) const;
+
+    //! Peak resident set size of the process in KiB, 0 if unknown on this platform
+    static qint64 peakResidentSetSize();
+
+private:
+    int m_repeat;
+    QRegularExpression m_filter;
+    QJsonArray m_results;
+};
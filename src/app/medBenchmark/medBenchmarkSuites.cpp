@@ -0,0 +1,303 @@
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#include <medBenchmarkSuites.h>
+
+#include <medBenchmarkData.h>
+#include <medBenchmarkRunner.h>
+
+#include <medAbstractDataFactory.h>
+#include <medCore.h>
+#include <medDatabaseNonPersistentImporter.h>
+#include <medIntParameter.h>
+#include <vtkItkConversion.h>
+
+#include <dtkCoreSupport/dtkAbstractDataReader.h>
+#include <dtkCoreSupport/dtkAbstractDataWriter.h>
+
+#include <vtkAlgorithm.h>
+#include <vtkAlgorithmOutput.h>
+#include <vtkDataSet.h>
+#include <vtkMatrix4x4.h>
+#include <vtkMetaDataSet.h>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QUuid>
+
+namespace
+{
+
+qint64 voxelCount(const medBenchmarkContext& context)
+{
+    return static_cast<qint64>(context.size[0]) * context.size[1] * context.size[2];
+}
+
+qint64 filesSize(const QStringList& paths)
+{
+    qint64 size = 0;
+    for (const QString& path : paths)
+    {
+        size += QFileInfo(path).size();
+    }
+    return size;
+}
+
+vtkDataSet* meshDataSet(medAbstractData* mesh)
+{
+    vtkMetaDataSet* metaDataSet = mesh ? vtkMetaDataSet::SafeDownCast(static_cast<vtkObject*>(mesh->data())) : nullptr;
+    return metaDataSet ? metaDataSet->GetDataSet() : nullptr;
+}
+
+//! Times every process of factory, created anew and given its inputs outside of the timing
+template <class Factory, class SetInputs>
+void benchmarkFactory(medBenchmarkRunner& runner, const QString& category, Factory& factory,
+                      qint64 bytes, qint64 voxels, SetInputs setInputs)
+{
+    for (const QString& key : factory.keys())
+    {
+        if (!runner.isSelected(category, key))
+        {
+            continue;
+        }
+
+        decltype(factory.create(key)) process = nullptr;
+
+        runner.run(category, key, bytes, voxels,
+                   [&]()
+                   {
+                       delete process;
+                       process = factory.create(key);
+                       if (process)
+                       {
+                           setInputs(process);
+                       }
+                   },
+                   [&]()
+                   {
+                       return process && process->run() == medAbstractJob::MED_JOB_EXIT_SUCCESS;
+                   });
+
+        delete process;
+    }
+}
+
+void benchmarkWriters(medBenchmarkRunner& runner, medBenchmarkContext& context, medAbstractData* data,
+                      qint64 bytes, qint64 items)
+{
+    if (!data)
+    {
+        return;
+    }
+
+    medAbstractDataFactory* factory = medAbstractDataFactory::instance();
+    for (const QString& writerName : factory->writers())
+    {
+        dtkSmartPointer<dtkAbstractDataWriter> writer = factory->writerSmartPointer(writerName);
+        if (!writer || !writer->handled().contains(data->identifier()) || writer->supportedFileExtensions().isEmpty())
+        {
+            continue;
+        }
+
+        const QString name = writerName + " " + data->identifier();
+        const QString path = QDir(context.workDirectory).filePath(writerName + writer->supportedFileExtensions().first());
+        if (!writer->canWrite(path))
+        {
+            runner.skip("write", name, "cannot write " + path);
+            continue;
+        }
+
+        writer->setData(data);
+        runner.run("write", name, bytes, items,
+                   [&]() { QFile::remove(path); },
+                   [&]() { return writer->write(path); });
+
+        if (QFileInfo(path).size() > 0)
+        {
+            context.writtenFiles.insert(path, items);
+        }
+    }
+}
+
+void benchmarkReaders(medBenchmarkRunner& runner, const QString& name, const QStringList& paths, qint64 items)
+{
+    medAbstractDataFactory* factory = medAbstractDataFactory::instance();
+    const qint64 bytes = filesSize(paths);
+
+    for (const QString& readerName : factory->readers())
+    {
+        dtkSmartPointer<dtkAbstractDataReader> reader = factory->readerSmartPointer(readerName);
+        if (!reader || !(paths.size() == 1 ? reader->canRead(paths.first()) : reader->canRead(paths)))
+        {
+            continue;
+        }
+
+        runner.run("read", readerName + " " + name, bytes, items, nullptr,
+                   [&]() { return paths.size() == 1 ? reader->read(paths.first()) : reader->read(paths); });
+    }
+}
+
+bool importPath(const QString& path)
+{
+    medDatabaseNonPersistentImporter importer(path, QUuid::createUuid());
+
+    bool success = false;
+    QObject::connect(&importer, &medJobItemL::success, [&success](QObject*) { success = true; });
+    importer.run();
+
+    return success;
+}
+
+}
+
+namespace medBenchmarkSuites
+{
+
+void processes(medBenchmarkRunner& runner, medBenchmarkContext& context)
+{
+    medAbstractImageData* volume = context.volume;
+    medAbstractImageData* floatVolume = context.floatVolume;
+    medAbstractImageData* mask = context.mask;
+
+    const qint64 voxels = voxelCount(context);
+    const qint64 bytes = medBenchmarkData::volumeBytes(volume->identifier(), context.size);
+    const qint64 bothBytes = bytes + medBenchmarkData::volumeBytes(floatVolume->identifier(), context.size);
+
+    auto setOperands = [=](medAbstractArithmeticOperationProcess* process)
+    {
+        process->setInput1(volume);
+        process->setInput2(floatVolume);
+    };
+    benchmarkFactory(runner, "arithmetic", medCore::arithmeticOperation::addImage::pluginFactory(), bothBytes, voxels, setOperands);
+    benchmarkFactory(runner, "arithmetic", medCore::arithmeticOperation::subtractImage::pluginFactory(), bothBytes, voxels, setOperands);
+    benchmarkFactory(runner, "arithmetic", medCore::arithmeticOperation::multiplyImage::pluginFactory(), bothBytes, voxels, setOperands);
+    benchmarkFactory(runner, "arithmetic", medCore::arithmeticOperation::divideImage::pluginFactory(), bothBytes, voxels, setOperands);
+
+    auto setStructure = [=](medAbstractMorphomathOperationProcess* process)
+    {
+        process->setInput(volume);
+        process->kernelRadius()->setValue(1);
+    };
+    benchmarkFactory(runner, "morphomath", medCore::morphomathOperation::erodeImage::pluginFactory(), bytes, voxels, setStructure);
+    benchmarkFactory(runner, "morphomath", medCore::morphomathOperation::dilateImage::pluginFactory(), bytes, voxels, setStructure);
+    benchmarkFactory(runner, "morphomath", medCore::morphomathOperation::openingImage::pluginFactory(), bytes, voxels, setStructure);
+    benchmarkFactory(runner, "morphomath", medCore::morphomathOperation::closingImage::pluginFactory(), bytes, voxels, setStructure);
+
+    // Single filters run with their default parameters
+    auto setInput = [=](medAbstractSingleFilterOperationProcess* process)
+    {
+        process->setInput(volume);
+    };
+    benchmarkFactory(runner, "singleFilter", medCore::singleFilterOperation::addFilter::pluginFactory(), bytes, voxels, setInput);
+    benchmarkFactory(runner, "singleFilter", medCore::singleFilterOperation::subtractFilter::pluginFactory(), bytes, voxels, setInput);
+    benchmarkFactory(runner, "singleFilter", medCore::singleFilterOperation::multiplyFilter::pluginFactory(), bytes, voxels, setInput);
+    benchmarkFactory(runner, "singleFilter", medCore::singleFilterOperation::divideFilter::pluginFactory(), bytes, voxels, setInput);
+    benchmarkFactory(runner, "singleFilter", medCore::singleFilterOperation::gaussianFilter::pluginFactory(), bytes, voxels, setInput);
+    benchmarkFactory(runner, "singleFilter", medCore::singleFilterOperation::medianFilter::pluginFactory(), bytes, voxels, setInput);
+    benchmarkFactory(runner, "singleFilter", medCore::singleFilterOperation::invertFilter::pluginFactory(), bytes, voxels, setInput);
+    benchmarkFactory(runner, "singleFilter", medCore::singleFilterOperation::normalizeFilter::pluginFactory(), bytes, voxels, setInput);
+    benchmarkFactory(runner, "singleFilter", medCore::singleFilterOperation::shrinkFilter::pluginFactory(), bytes, voxels, setInput);
+    benchmarkFactory(runner, "singleFilter", medCore::singleFilterOperation::windowingFilter::pluginFactory(), bytes, voxels, setInput);
+
+    benchmarkFactory(runner, "maskImage", medCore::maskImage::pluginFactory(), bytes + voxels, voxels,
+                     [=](medAbstractMaskImageProcess* process)
+                     {
+                         process->setInput(volume);
+                         process->setMask(mask);
+                     });
+
+    benchmarkFactory(runner, "biasCorrection", medCore::singleFilterOperation::biasCorrection::pluginFactory(), bytes, voxels, setInput);
+}
+
+void readersWriters(medBenchmarkRunner& runner, medBenchmarkContext& context)
+{
+    const qint64 voxels = voxelCount(context);
+    benchmarkWriters(runner, context, context.volume,
+                     medBenchmarkData::volumeBytes(context.volume->identifier(), context.size), voxels);
+    benchmarkWriters(runner, context, context.floatVolume,
+                     medBenchmarkData::volumeBytes(context.floatVolume->identifier(), context.size), voxels);
+
+    if (vtkDataSet* mesh = meshDataSet(context.mesh))
+    {
+        benchmarkWriters(runner, context, context.mesh, mesh->GetActualMemorySize() * 1024, mesh->GetNumberOfCells());
+    }
+
+    for (auto it = context.writtenFiles.cbegin(); it != context.writtenFiles.cend(); ++it)
+    {
+        benchmarkReaders(runner, QFileInfo(it.key()).fileName(), QStringList() << it.key(), it.value());
+    }
+
+    if (!context.dicomFiles.isEmpty())
+    {
+        benchmarkReaders(runner, "DICOM series", context.dicomFiles, voxels);
+    }
+}
+
+void import(medBenchmarkRunner& runner, medBenchmarkContext& context)
+{
+    const qint64 voxels = voxelCount(context);
+
+    if (!context.dicomFiles.isEmpty())
+    {
+        const QString directory = QFileInfo(context.dicomFiles.first()).absolutePath();
+        runner.run("import", "DICOM series", filesSize(context.dicomFiles), voxels, nullptr,
+                   [&]() { return importPath(directory); });
+    }
+
+    for (auto it = context.writtenFiles.cbegin(); it != context.writtenFiles.cend(); ++it)
+    {
+        const QString path = it.key();
+        runner.run("import", QFileInfo(path).fileName(), QFileInfo(path).size(), it.value(), nullptr,
+                   [&]() { return importPath(path); });
+    }
+}
+
+void conversion(medBenchmarkRunner& runner, medBenchmarkContext& context)
+{
+    const qint64 voxels = voxelCount(context);
+
+    for (medAbstractImageData* image : { context.volume.data(), context.floatVolume.data() })
+    {
+        const qint64 bytes = medBenchmarkData::volumeBytes(image->identifier(), context.size);
+
+        runner.run("conversion", "vtkItkConversion " + image->identifier(), bytes, voxels, nullptr, [&]()
+        {
+            vtkItkConversionInterface* converter = vtkItkConversionInterface::createInstance(image);
+            if (!converter)
+            {
+                return false;
+            }
+
+            vtkAlgorithmOutput* output = nullptr;
+            vtkMatrix4x4* matrix = nullptr;
+            itk::DataObject::Pointer itkImage = static_cast<itk::DataObject*>(image->data());
+
+            bool success = converter->SetITKInput(itkImage) && converter->GetConversion(output, matrix);
+            if (success)
+            {
+                // What a view does next: pull the VTK image and ask for its range
+                output->GetProducer()->Update();
+                success = converter->getCurrentScalarRange() != nullptr;
+            }
+
+            if (matrix)
+            {
+                matrix->Delete();
+            }
+            delete converter;
+            return success;
+        });
+    }
+}
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#include <dtkCoreSupport/dtkSmartPointer.h>
+
+#include <medAbstractData.h>
+#include <medAbstractImageData.h>
+
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+class medBenchmarkRunner;
+
+//! Data shared by the benchmark suites
+struct medBenchmarkContext
+{
+    int size[3];
+    QString workDirectory;
+
+    dtkSmartPointer<medAbstractImageData> volume;      // short, what scanners mostly produce
+    dtkSmartPointer<medAbstractImageData> floatVolume; // second operand and float code paths
+    dtkSmartPointer<medAbstractImageData> mask;
+    dtkSmartPointer<medAbstractData> mesh;
+    QStringList dicomFiles;
+
+    QMap<QString, qint64> writtenFiles; // path and item count, filled by the writer benchmarks for the reader ones
+};
+
+namespace medBenchmarkSuites
+{
+    //! arithmetic, morphomath, single filter, mask image and bias correction processes of the loaded plugins
+    void processes(medBenchmarkRunner& runner, medBenchmarkContext& context);
+
+    //! Every legacy writer handling the synthetic data, then every reader of the written files and of the DICOM series
+    void readersWriters(medBenchmarkRunner& runner, medBenchmarkContext& context);
+
+    //! medDatabaseNonPersistentImporter on the DICOM series and on the written files
+    void import(medBenchmarkRunner& runner, medBenchmarkContext& context);
+
+    //! vtkItkConversion setup as done when an image is added to a view
+    void conversion(medBenchmarkRunner& runner, medBenchmarkContext& context);
+}
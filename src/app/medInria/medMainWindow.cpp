@@ -13,6 +13,7 @@
 
 #include <dtkComposerWidget.h>
 
+#include <medAbstractJob.h>
 #include <medBrowserArea.h>
 #include <medComposerArea.h>
 #include <medDatabaseController.h>
@@ -20,6 +21,7 @@
 #include <medDataManager.h>
 #include <medEmptyDbWarning.h>
 #include <medHomepageArea.h>
+#include <medJobManager.h>
 #include <medJobManagerL.h>
 #include <medLogger.h>
 #include <medMainWindow.h>
@@ -830,7 +832,9 @@ void medMainWindow::closeEvent(QCloseEvent *event)
 
     dtkInfo() << "### Application is closing...";
 
-    if ( QThreadPool::globalInstance()->activeThreadCount() > 0 )
+    // Legacy jobs run in the global pool, the others in the job manager's
+    if ( QThreadPool::globalInstance()->activeThreadCount() > 0 ||
+         medJobManager::instance()->activeJobCount() > 0 )
     {
         int res = QMessageBox::information(this,
                                            tr("System message"),
@@ -846,13 +850,18 @@ void medMainWindow::closeEvent(QCloseEvent *event)
             // send cancel request to all running jobs, then wait for them
             // Note: most Jobs don't have the cancel method implemented, so this will be effectively the same as waitfordone.
             medJobManagerL::instance()->dispatchGlobalCancelEvent();
-            QThreadPool::globalInstance()->waitForDone();
-        }
-        else
-        {
-            // just hide the window and wait
-            QThreadPool::globalInstance()->waitForDone();
+            for (medAbstractJob *job : medJobManager::instance()->jobs())
+            {
+                if (!medJobManager::instance()->cancelQueuedJob(job) && job->isRunning())
+                {
+                    job->cancel();
+                }
+            }
         }
+
+        // wait for all the jobs, cancelled or not
+        QThreadPool::globalInstance()->waitForDone();
+        medJobManager::instance()->waitForDone();
     }
 
     if(this->saveModifiedAndOrValidateClosing() != QDialog::Accepted)
@@ -12,64 +12,23 @@
 =========================================================================*/
 
 #include <medDataReaderWriter.h>
-#include <medAbstractDataFactory.h>
-#include <QFileInfo>
+#include <medDataReaderWriterIndex.h>
 
 medDataReaderWriter::Reader medDataReaderWriter::reader(const QString& path) {
-    QList<QString> readers = medAbstractDataFactory::instance()->readers();
-
-    if (readers.size()==0)
-    {
-        return Reader();
-    }
-
-    const QFileInfo& fi(path);
-    const QString&   filename = fi.filePath();
-
-    //  Store the last reader.
-
-    static Reader dreader;
-
-    if (!dreader.isNull() && dreader->canRead(filename))
-        return dreader;
-
-    for (int i=0;i<readers.size();++i) {
-        dreader = medAbstractDataFactory::instance()->readerSmartPointer(readers[i]);
-        if (dreader->canRead(filename)) {
-            dreader->enableDeferredDeletion(false);
-            return dreader;
-        }
-    }
-    return dreader = Reader();
+    return medDataReaderWriterIndex::instance()->reader(QStringList() << path);
 }
 
 medDataReaderWriter::Writer medDataReaderWriter::writer(const QString& path,const medAbstractData* data) {
-
-    if (!data)
-        return Writer();
-
-    QList<QString> writers = medAbstractDataFactory::instance()->writers();
-
-    static Writer dwriter;
-
-    if (!dwriter.isNull() && dwriter->handled().contains(data->identifier()) && dwriter->canWrite(path))
-        return dwriter;
-
-    for (int i=0;i<writers.size();++i) {
-        dwriter = medAbstractDataFactory::instance()->writerSmartPointer(writers[i]);
-        if (dwriter->handled().contains(data->identifier()) && dwriter->canWrite(path)) {
-            dwriter->enableDeferredDeletion(false);
-            return dwriter;
-        }
-    }
-    return dwriter = Writer();
+    return medDataReaderWriterIndex::instance()->writer(path,data);
 }
 
 medAbstractData *medDataReaderWriter::read(const QString& path) {
     Reader dreader = reader(path);
     if (!dreader.isNull()) {
         dreader->read(path);
-        return dynamic_cast<medAbstractData*>(dreader->data());
+        medAbstractData *data = dynamic_cast<medAbstractData*>(dreader->data());
+        medDataReaderWriterIndex::instance()->release(dreader);
+        return data;
     }
     return nullptr;
 }
@@ -79,6 +38,7 @@ bool medDataReaderWriter::write(const QString& path,medAbstractData* data) {
     if (!dwriter.isNull()) {
         dwriter->setData(data);
         dwriter->write(path);
+        medDataReaderWriterIndex::instance()->release(dwriter);
         return true;
     }
     return false;
@@ -0,0 +1,370 @@
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#include <medDataReaderWriterIndex.h>
+
+#include <medAbstractData.h>
+#include <medAbstractDataFactory.h>
+#include <medPluginManager.h>
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QThread>
+
+class medDataReaderWriterIndexPrivate
+{
+public:
+    QMutex mutex;
+    bool built = false;
+    int poolSize = 1;
+
+    QStringList readers;                            // in registration order
+    QHash<QString, QSet<QString> > refusingReaders; // what refused a file of this signature
+
+    QStringList writers;
+    QHash<QString, QStringList> writersByIdentifier; // in registration order
+    QHash<QString, QStringList> writerExtensions;
+    QHash<QString, QString> writerByKey;             // identifier and extension
+
+    QHash<QString, QList<dtkSmartPointer<dtkAbstractDataReader> > > idleReaders;
+    QHash<QString, QList<dtkSmartPointer<dtkAbstractDataWriter> > > idleWriters;
+
+    void ensureBuilt();
+    dtkSmartPointer<dtkAbstractDataReader> takeReader(const QString& name);
+    dtkSmartPointer<dtkAbstractDataWriter> takeWriter(const QString& name);
+};
+
+namespace
+{
+
+//! Lower case extension, ignored when it has no letter, as in DICOM files named after their UID
+QString extensionOf(const QString& path)
+{
+    const QString extension = QFileInfo(path).completeSuffix().toLower();
+    for (const QChar& c : extension)
+    {
+        if (c.isLetter())
+        {
+            return extension;
+        }
+    }
+    return QString();
+}
+
+//! Signatures kept before the refusals are forgotten
+const int maxSignatureCount = 4096;
+
+/**
+ * Extension and header bytes, where readers find the dimension or the number of components
+ * they refuse files for, so the magic bytes are not enough. Empty for DICOM files, whose first
+ * bytes are a preamble and readers look further.
+ */
+QString signatureOf(const QString& path, const QString& extension)
+{
+    QByteArray header;
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly))
+    {
+        header = file.read(132);
+    }
+
+    if (header.isEmpty() || (header.size() == 132 && header.endsWith("DICM")))
+    {
+        return QString();
+    }
+    return extension + '|' + QString::fromLatin1(QCryptographicHash::hash(header, QCryptographicHash::Md5).toHex());
+}
+
+}
+
+medDataReaderWriterIndex *medDataReaderWriterIndex::instance()
+{
+    static medDataReaderWriterIndex *s_instance = new medDataReaderWriterIndex;
+    return s_instance;
+}
+
+medDataReaderWriterIndex::medDataReaderWriterIndex()
+    : d(new medDataReaderWriterIndexPrivate)
+{
+    d->poolSize = qMax(1, QThread::idealThreadCount());
+
+    // It may be first used by an importer thread, the rebuild signal is handled in the main one
+    if (QCoreApplication::instance())
+    {
+        moveToThread(QCoreApplication::instance()->thread());
+    }
+    connect(medPluginManager::instance(), SIGNAL(allPluginsLoaded()), this, SLOT(rebuild()));
+}
+
+medDataReaderWriterIndex::~medDataReaderWriterIndex()
+{
+    delete d;
+    d = nullptr;
+}
+
+void medDataReaderWriterIndex::rebuild()
+{
+    medAbstractDataFactory *factory = medAbstractDataFactory::instance();
+    QMutexLocker locker(&d->mutex);
+
+    d->readers = factory->readers();
+    d->refusingReaders.clear();
+    d->idleReaders.clear();
+
+    d->writers = factory->writers();
+    d->writersByIdentifier.clear();
+    d->writerExtensions.clear();
+    d->writerByKey.clear();
+    d->idleWriters.clear();
+
+    // The instance created to index a writer is the first one of its pool
+    for (const QString& name : d->writers)
+    {
+        dtkSmartPointer<dtkAbstractDataWriter> writer = factory->writerSmartPointer(name);
+        if (!writer)
+        {
+            continue;
+        }
+        writer->enableDeferredDeletion(false);
+
+        for (const QString& identifier : writer->handled())
+        {
+            d->writersByIdentifier[identifier] << name;
+        }
+        d->writerExtensions[name] = writer->supportedFileExtensions();
+        d->idleWriters[name] << writer;
+    }
+
+    d->built = true;
+}
+
+void medDataReaderWriterIndexPrivate::ensureBuilt()
+{
+    medAbstractDataFactory *factory = medAbstractDataFactory::instance();
+    bool upToDate;
+    {
+        QMutexLocker locker(&mutex);
+        upToDate = built && readers.size() == factory->readers().size() && writers.size() == factory->writers().size();
+    }
+    if (!upToDate)
+    {
+        medDataReaderWriterIndex::instance()->rebuild();
+    }
+}
+
+dtkSmartPointer<dtkAbstractDataReader> medDataReaderWriterIndexPrivate::takeReader(const QString& name)
+{
+    QMutexLocker locker(&mutex);
+
+    QList<dtkSmartPointer<dtkAbstractDataReader> >& idle = idleReaders[name];
+    if (!idle.isEmpty())
+    {
+        return idle.takeLast();
+    }
+
+    dtkSmartPointer<dtkAbstractDataReader> reader = medAbstractDataFactory::instance()->readerSmartPointer(name);
+    if (reader)
+    {
+        reader->enableDeferredDeletion(false);
+    }
+    return reader;
+}
+
+dtkSmartPointer<dtkAbstractDataWriter> medDataReaderWriterIndexPrivate::takeWriter(const QString& name)
+{
+    QMutexLocker locker(&mutex);
+
+    QList<dtkSmartPointer<dtkAbstractDataWriter> >& idle = idleWriters[name];
+    if (!idle.isEmpty())
+    {
+        return idle.takeLast();
+    }
+
+    dtkSmartPointer<dtkAbstractDataWriter> writer = medAbstractDataFactory::instance()->writerSmartPointer(name);
+    if (writer)
+    {
+        writer->enableDeferredDeletion(false);
+    }
+    return writer;
+}
+
+dtkSmartPointer<dtkAbstractDataReader> medDataReaderWriterIndex::reader(const QStringList& paths)
+{
+    if (paths.isEmpty())
+    {
+        return nullptr;
+    }
+    d->ensureBuilt();
+
+    // A series may be refused for any of its files, only single files are learned from
+    QString signature;
+    if (paths.size() == 1)
+    {
+        signature = signatureOf(paths.first(), extensionOf(paths.first()));
+    }
+
+    QStringList candidates;
+    QSet<QString> refusing;
+    {
+        QMutexLocker locker(&d->mutex);
+        candidates = d->readers;
+        if (!signature.isEmpty())
+        {
+            refusing = d->refusingReaders.value(signature);
+        }
+    }
+
+    for (const QString& name : candidates)
+    {
+        if (refusing.contains(name))
+        {
+            continue;
+        }
+
+        dtkSmartPointer<dtkAbstractDataReader> reader = d->takeReader(name);
+        if (!reader)
+        {
+            continue;
+        }
+
+        if (reader->canRead(paths))
+        {
+            return reader;
+        }
+
+        release(reader);
+
+        if (!signature.isEmpty())
+        {
+            QMutexLocker locker(&d->mutex);
+            if (d->refusingReaders.size() >= maxSignatureCount && !d->refusingReaders.contains(signature))
+            {
+                d->refusingReaders.clear();
+            }
+            d->refusingReaders[signature] << name;
+        }
+    }
+
+    return nullptr;
+}
+
+dtkSmartPointer<dtkAbstractDataWriter> medDataReaderWriterIndex::writer(const QString& path, const medAbstractData *data)
+{
+    if (!data)
+    {
+        return nullptr;
+    }
+    d->ensureBuilt();
+
+    const QString identifier = data->identifier();
+    const QString extension = QFileInfo(path).completeSuffix().toLower();
+    const QString key = identifier + '|' + extension;
+
+    // The writers whose extensions match the path are tried first
+    QStringList candidates;
+    {
+        QMutexLocker locker(&d->mutex);
+        candidates << d->writerByKey.value(key);
+        const QStringList handling = d->writersByIdentifier.value(identifier);
+        for (const QString& name : handling)
+        {
+            for (const QString& writerExtension : d->writerExtensions.value(name))
+            {
+                if (!extension.isEmpty() && writerExtension.toLower().endsWith(extension))
+                {
+                    candidates << name;
+                }
+            }
+        }
+        candidates << handling;
+    }
+    candidates.removeAll(QString());
+    candidates.removeDuplicates();
+
+    for (const QString& name : candidates)
+    {
+        dtkSmartPointer<dtkAbstractDataWriter> writer = d->takeWriter(name);
+        if (!writer)
+        {
+            continue;
+        }
+
+        writer->setData(const_cast<medAbstractData *>(data));
+        if (writer->handled().contains(identifier) && writer->canWrite(path))
+        {
+            QMutexLocker locker(&d->mutex);
+            d->writerByKey[key] = name;
+            return writer;
+        }
+
+        release(writer);
+    }
+
+    return nullptr;
+}
+
+QString medDataReaderWriterIndex::writerExtension(const QString& identifier)
+{
+    d->ensureBuilt();
+
+    QMutexLocker locker(&d->mutex);
+    for (const QString& name : d->writersByIdentifier.value(identifier))
+    {
+        const QStringList& extensions = d->writerExtensions[name];
+        if (!extensions.isEmpty())
+        {
+            return extensions.first();
+        }
+    }
+    return QString();
+}
+
+void medDataReaderWriterIndex::release(dtkSmartPointer<dtkAbstractDataReader> reader)
+{
+    if (!reader)
+    {
+        return;
+    }
+
+    // Some readers fill the data they already have, which belongs to the caller now
+    reader->setData(nullptr);
+
+    QMutexLocker locker(&d->mutex);
+    const QString name = reader->identifier();
+    if (d->readers.contains(name) && d->idleReaders[name].size() < d->poolSize)
+    {
+        d->idleReaders[name] << reader;
+    }
+}
+
+void medDataReaderWriterIndex::release(dtkSmartPointer<dtkAbstractDataWriter> writer)
+{
+    if (!writer)
+    {
+        return;
+    }
+
+    writer->setData(nullptr);
+
+    QMutexLocker locker(&d->mutex);
+    const QString name = writer->identifier();
+    if (d->writers.contains(name) && d->idleWriters[name].size() < d->poolSize)
+    {
+        d->idleWriters[name] << writer;
+    }
+}
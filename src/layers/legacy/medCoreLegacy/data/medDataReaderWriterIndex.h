@@ -0,0 +1,71 @@
+#pragma once
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#include <QObject>
+#include <QStringList>
+
+#include <dtkCoreSupport/dtkAbstractDataReader.h>
+#include <dtkCoreSupport/dtkAbstractDataWriter.h>
+#include <dtkCoreSupport/dtkSmartPointer.h>
+
+#include <medCoreLegacyExport.h>
+
+class medAbstractData;
+class medDataReaderWriterIndexPrivate;
+
+/**
+ * @class medDataReaderWriterIndex
+ * @brief Finds the reader or writer of a file without probing every plugin each time.
+ *
+ * Readers are always probed in the order they were registered, so that the reader of a file
+ * does not depend on what was read before. Readers do not tell which files they read, so the
+ * index learns which ones refused a file of a given signature (extension and header bytes) and
+ * does not probe them again for the next files with the same signature. Writers are indexed by
+ * the data identifiers they handle and their extensions.
+ *
+ * Reader and writer instances are pooled: give them back with release() once the read or
+ * written data was taken, so that the next file does not create them again. A released
+ * instance is detached from its data. The index is rebuilt when all plugins are loaded.
+ * All methods are thread safe.
+ */
+class MEDCORELEGACY_EXPORT medDataReaderWriterIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    static medDataReaderWriterIndex *instance();
+
+    //! A reader able to read paths (a single file or a series), nullptr if none
+    dtkSmartPointer<dtkAbstractDataReader> reader(const QStringList& paths);
+
+    //! A writer handling data that can write path, nullptr if none
+    dtkSmartPointer<dtkAbstractDataWriter> writer(const QString& path, const medAbstractData *data);
+
+    //! Extension of the first writer handling the data identifier, empty if none
+    QString writerExtension(const QString& identifier);
+
+    void release(dtkSmartPointer<dtkAbstractDataReader> reader);
+    void release(dtkSmartPointer<dtkAbstractDataWriter> writer);
+
+public slots:
+    //! Forgets what was learned and indexes the registered readers and writers again
+    void rebuild();
+
+protected:
+    medDataReaderWriterIndex();
+    ~medDataReaderWriterIndex() override;
+
+private:
+    medDataReaderWriterIndexPrivate *d;
+};
@@ -14,15 +14,68 @@
 #include <dtkCoreSupport/dtkAbstractDataReader.h>
 #include <dtkCoreSupport/dtkAbstractDataWriter.h>
 
+#include <QtConcurrent>
+
 #include <medAbstractData.h>
 #include <medAbstractDatabaseImporter.h>
 #include <medAbstractDataFactory.h>
 #include <medAbstractImageData.h>
 #include <medDatabaseController.h>
+#include <medDataReaderWriterIndex.h>
 #include <medGlobalDefs.h>
 #include <medMetaDataKeys.h>
+#include <medSettingsManager.h>
 #include <medStorage.h>
 
+/**
+* A volume going through the reading, writing and database population stages of the import.
+**/
+struct medImportedVolume
+{
+    enum Status
+    {
+        EndOfStream, // no more volumes after this one
+        Read,
+        ReadFailed,
+        WriteFailed
+    };
+
+    QString aggregatedFileName;
+    QStringList filesPaths;
+    QString patientID;
+    QString seriesID;
+    dtkSmartPointer<medAbstractData> data;
+    Status status = EndOfStream;
+};
+
+/**
+* Queue handing volumes over from one import stage to the next one.
+* It is not bounded itself, the importer limits the number of volumes in flight.
+**/
+class medImportedVolumeQueue
+{
+public:
+    void push ( const medImportedVolume& volume )
+    {
+        QMutexLocker locker ( &mutex );
+        volumes.enqueue ( volume );
+        notEmpty.wakeOne();
+    }
+
+    medImportedVolume pop()
+    {
+        QMutexLocker locker ( &mutex );
+        while ( volumes.isEmpty() )
+            notEmpty.wait ( &mutex );
+        return volumes.dequeue();
+    }
+
+private:
+    QMutex mutex;
+    QWaitCondition notEmpty;
+    QQueue<medImportedVolume> volumes;
+};
+
 class medAbstractDatabaseImporterPrivate
 {
 public:
@@ -141,8 +194,6 @@ void medAbstractDatabaseImporter::internalRun ( void )
 
 void medAbstractDatabaseImporter::importFile ( void )
 {
-    QMutexLocker locker ( &d->mutex );
-
     /* The idea of this algorithm can be summarized in 3 steps:
      * 1. Get a list of all the files that will (try to) be imported or indexed
      * 2. Filter files that cannot be read, or won't be possible to write afterwards, or are already in the db
@@ -190,23 +241,36 @@ void medAbstractDatabaseImporter::importFile ( void )
     bool atLeastOneImportSucceeded = false;
     bool atLeastOneImportError = false;
 
-    for( QString file: fileList )
+    if ( medAbstractDataFactory::instance()->readers().isEmpty() )
+    {
+        emit showError (tr ( "No reader plugin" ), 5000 );
+        emit dataImported(medDataIndex(), d->uuid);
+        emit failure ( this );
+        return;
+    }
+
+    // 2.1) Try reading file information, just the header not the whole file.
+    // Headers are independent from each other and from the database, so they
+    // are scanned in parallel, outside of the importers lock. The results keep
+    // the order of fileList, grouping by patient/series/volume is done after.
+    QVector<medImporterHeaderScan> headerScans = scanHeaders ( fileList );
+
+    QMutexLocker locker ( &d->mutex );
+
+    for( medImporterHeaderScan& headerScan : headerScans )
     {
         if ( d->isCancelled ) // check if user canceled the process
             break;
 
-        emit progress ( this, ( ( qreal ) currentFileNumber/ ( qreal ) fileList.count() ) * 50.0 ); //TODO: reading and filtering represents 50% of the importing process?
+        emit progress ( this, ( ( qreal ) currentFileNumber/ ( qreal ) fileList.count() ) * 25.0 + 25.0 ); //TODO: reading and filtering represents 50% of the importing process?
 
         currentFileNumber++;
 
-        QFileInfo fileInfo ( file );
-        if (fileInfo.size() != 0)
+        QFileInfo fileInfo ( headerScan.filePath );
+        if ( !headerScan.isEmpty )
         {
-            dtkSmartPointer<medAbstractData> medData;
-
-            // 2.1) Try reading file information, just the header not the whole file
-            bool readOnlyImageInformation = true;
-            medData = tryReadImages ( QStringList ( fileInfo.filePath() ), readOnlyImageInformation );
+            dtkSmartPointer<medAbstractData> medData = headerScan.data;
+            headerScan.data = nullptr; // only one header is kept alive from now on
 
             if ( !medData )
             {
@@ -327,84 +391,153 @@ void medAbstractDatabaseImporter::importFile ( void )
 
     medDataIndex index; //stores the last volume's index to be emitted on success
 
-    // final loop: re-read, re-populate and write to db
-    for ( ; it != imagesGroupedByVolume.end(); it++ )
+    // final stage: re-read, re-populate and write to db.
+    // It is pipelined over three threads: while this thread populates the database
+    // with volume N-1, volume N is written and volume N+1 is read. Every stage
+    // handles the volumes in the order of imagesGroupedByVolume, and the number
+    // of volumes held in memory is capped by the in flight semaphore.
+    QList<medImportedVolume> volumes;
+    for ( ; it != imagesGroupedByVolume.end(); it++, itPat++, itSer++ )
     {
-        emit progress ( this, ( ( qreal ) currentImageIndex/ ( qreal ) imagesCount ) * 50.0 + 50.0 ); // 50? I do not think that reading all the headers is half the job...
+        medImportedVolume volume;
+        volume.aggregatedFileName = it.key(); // note that this file might be aggregating more than one input files
+        volume.filesPaths = it.value();       // input files being aggregated, might be only one or many
+        volume.patientID = itPat.value();
+        volume.seriesID = itSer.value();
+        volumes << volume;
+    }
 
-        currentImageIndex++;
+    int volumesInFlightCount = medSettingsManager::instance()->value ( "database", "import_volumes_in_flight", 3 ).toInt();
+    QSemaphore volumesInFlight ( qMax ( 1, volumesInFlightCount ) );
+    QMutex databaseMutex; // the reading stage may query the database to fill missing metadata
+    medImportedVolumeQueue volumesToWrite;
+    medImportedVolumeQueue volumesToPopulate;
+    QThread *importerThread = QThread::currentThread();
 
-        QString aggregatedFileName = it.key(); // note that this file might be aggregating more than one input files
-        QStringList filesPaths = it.value();   // input files being aggregated, might be only one or many
-        patientID = itPat.value();
-        QString seriesID = itSer.value();
+    QThreadPool stagesPool; // not the global pool, which might be full of importers waiting for the mutex
+    stagesPool.setMaxThreadCount ( 2 );
 
-        dtkSmartPointer<medAbstractData> imagemedData;
+    QFuture<void> readStage = QtConcurrent::run ( &stagesPool, [&] ()
+    {
+        for ( medImportedVolume volume : volumes )
+        {
+            volumesInFlight.acquire();
 
-        // 3.2) Try to read the whole image, not just the header
-        bool readOnlyImageInformation = false;
-        imagemedData = tryReadImages ( filesPaths, readOnlyImageInformation );
+            // 3.2) Try to read the whole image, not just the header
+            bool readOnlyImageInformation = false;
+            volume.data = tryReadImages ( volume.filesPaths, readOnlyImageInformation );
+
+            if ( !volume.data )
+            {
+                // the import stops at the first volume which cannot be read
+                volume.status = medImportedVolume::ReadFailed;
+                volumesToWrite.push ( volume );
+                break;
+            }
+            volume.data->moveToThread ( importerThread );
 
-        if ( imagemedData )
-        {
             // 3.3) a) re-populate missing metadata
             // as files might be aggregated we use the aggregated file name as SeriesDescription (if not provided, of course)
-            QFileInfo imagefileInfo ( filesPaths[0] );
-            populateMissingMetadata ( imagemedData, med::smartBaseName(imagefileInfo.fileName()) );
-            imagemedData->setMetaData ( medMetaDataKeys::PatientID.key(), QStringList() << patientID );
-            imagemedData->setMetaData ( medMetaDataKeys::SeriesID.key(), QStringList() << seriesID );
+            QFileInfo imagefileInfo ( volume.filesPaths[0] );
+            {
+                QMutexLocker databaseLocker ( &databaseMutex );
+                populateMissingMetadata ( volume.data, med::smartBaseName(imagefileInfo.fileName()) );
+            }
+            volume.data->setMetaData ( medMetaDataKeys::PatientID.key(), QStringList() << volume.patientID );
+            volume.data->setMetaData ( medMetaDataKeys::SeriesID.key(), QStringList() << volume.seriesID );
 
             // 3.3) b) now we are able to add some more metadata
-            addAdditionalMetaData ( imagemedData, aggregatedFileName, filesPaths );
+            addAdditionalMetaData ( volume.data, volume.aggregatedFileName, volume.filesPaths );
+
+            volume.status = medImportedVolume::Read;
+            volumesToWrite.push ( volume );
         }
-        else
+
+        volumesToWrite.push ( medImportedVolume() );
+    });
+
+    QFuture<void> writeStage = QtConcurrent::run ( &stagesPool, [&] ()
+    {
+        forever
         {
+            medImportedVolume volume = volumesToWrite.pop();
+
+            if ( volume.status == medImportedVolume::Read && !d->indexWithoutImporting )
+            {
+                // create location to store file
+                QFileInfo fileInfo ( medStorage::dataLocation() + volume.aggregatedFileName );
+                if ( !fileInfo.dir().exists() && !medStorage::mkpath ( fileInfo.dir().path() ) )
+                {
+                    qDebug() << "Cannot create directory: " << fileInfo.dir().path();
+                    volume.status = medImportedVolume::WriteFailed;
+                }
+                // now writing file
+                else if ( !tryWriteImage ( fileInfo.filePath(), volume.data ) )
+                {
+                    emit showError (tr ( "Could not save data file: " ) + volume.filesPaths[0], 5000 );
+                    volume.status = medImportedVolume::WriteFailed;
+                }
+            }
+
+            volumesToPopulate.push ( volume );
+
+            if ( volume.status == medImportedVolume::EndOfStream )
+                break;
+        }
+    });
+
+    forever
+    {
+        medImportedVolume volume = volumesToPopulate.pop();
+
+        if ( volume.status == medImportedVolume::EndOfStream )
+            break;
+
+        emit progress ( this, ( ( qreal ) currentImageIndex/ ( qreal ) imagesCount ) * 50.0 + 50.0 ); // 50? I do not think that reading all the headers is half the job...
+
+        currentImageIndex++;
+
+        if ( volume.status == medImportedVolume::ReadFailed )
+        {
+            readStage.waitForFinished();
+            writeStage.waitForFinished();
+
             qWarning() << "Could not repopulate data!";
-            emit showError (tr ( "Could not read data: " ) + filesPaths[0], 5000 );
+            emit showError (tr ( "Could not read data: " ) + volume.filesPaths[0], 5000 );
             emit dataImported(medDataIndex(), d->uuid);
             emit failure(this);
             return;
         }
 
-        if ( !d->indexWithoutImporting )
+        if ( volume.status == medImportedVolume::Read )
         {
-            // create location to store file
-            QFileInfo fileInfo ( medStorage::dataLocation() + aggregatedFileName );
-            if ( !fileInfo.dir().exists() && !medStorage::mkpath ( fileInfo.dir().path() ) )
+            atLeastOneImportSucceeded = true;
+
+            // and finally we populate the database
+            QFileInfo aggregatedFileNameFileInfo ( volume.aggregatedFileName );
+            QString pathToStoreThumbnails = aggregatedFileNameFileInfo.dir().path() + "/" + aggregatedFileNameFileInfo.completeBaseName() + "/";
             {
-                qDebug() << "Cannot create directory: " << fileInfo.dir().path();
-                continue;
+                QMutexLocker databaseLocker ( &databaseMutex );
+                index = this->populateDatabaseAndGenerateThumbnails ( volume.data, pathToStoreThumbnails );
             }
 
-            // now writing file
-            bool writeSuccess = tryWriteImage ( fileInfo.filePath(), imagemedData );
-
-            if ( !writeSuccess )
+            if(!d->uuid.isNull())
             {
-                emit showError (tr ( "Could not save data file: " ) + filesPaths[0], 5000 );
-                continue;
+                emit dataImported(index, d->uuid);
+            }
+            else
+            {
+                emit dataImported(index);
             }
-        }
-        atLeastOneImportSucceeded = true;
-
-        // and finally we populate the database
-        QFileInfo aggregatedFileNameFileInfo ( aggregatedFileName );
-        QString pathToStoreThumbnails = aggregatedFileNameFileInfo.dir().path() + "/" + aggregatedFileNameFileInfo.completeBaseName() + "/";
-        index = this->populateDatabaseAndGenerateThumbnails ( imagemedData, pathToStoreThumbnails );
-
-        if(!d->uuid.isNull())
-        {
-            emit dataImported(index, d->uuid);
-        }
-        else
-        {
-            emit dataImported(index);
         }
 
-        itPat++;
-        itSer++;
+        volume.data = nullptr;
+        volumesInFlight.release();
     } // end of the final loop
 
+    readStage.waitForFinished();
+    writeStage.waitForFinished();
+
     if ( ! atLeastOneImportSucceeded) {
         emit progress ( this,100 );
         emit dataImported(medDataIndex(), d->uuid);
@@ -705,28 +838,14 @@ QString medAbstractDatabaseImporter::generateThumbnail ( medAbstractData* medDat
 **/
 dtkSmartPointer<dtkAbstractDataReader> medAbstractDatabaseImporter::getSuitableReader ( QStringList filename )
 {
-    QList<QString> readers = medAbstractDataFactory::instance()->readers();
-
-    if ( readers.size() ==0 )
+    if ( medAbstractDataFactory::instance()->readers().isEmpty() )
     {
         emit showError (tr ( "No reader plugin" ), 5000 );
         emit failure ( this );
         return nullptr;
     }
 
-    dtkSmartPointer<dtkAbstractDataReader> dataReader;
-    for (int i=0; i<readers.size(); i++)
-    {
-        dataReader = medAbstractDataFactory::instance()->readerSmartPointer(readers[i]);
-        dataReader->enableDeferredDeletion(false);
-
-        if (dataReader->canRead(filename))
-        {
-            return dataReader;
-        }
-    }
-
-    return nullptr;
+    return medDataReaderWriterIndex::instance()->reader ( filename );
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -738,23 +857,7 @@ dtkSmartPointer<dtkAbstractDataReader> medAbstractDatabaseImporter::getSuitableR
 **/
 dtkSmartPointer<dtkAbstractDataWriter> medAbstractDatabaseImporter::getSuitableWriter(QString filename,medAbstractData* medData)
 {
-    if ( !medData )
-        return nullptr;
-
-    QList<QString> writers = medAbstractDataFactory::instance()->writers();
-    dtkSmartPointer<dtkAbstractDataWriter> dataWriter;
-    for ( int i=0; i<writers.size(); i++ )
-    {
-        dataWriter = medAbstractDataFactory::instance()->writerSmartPointer ( writers[i] );
-        dataWriter->setData(medData);
-
-        if (dataWriter->handled().contains(medData->identifier()) &&
-             dataWriter->canWrite( filename ) ) {
-            dataWriter->enableDeferredDeletion(false);
-            return dataWriter;
-        }
-    }
-    return nullptr;
+    return medDataReaderWriterIndex::instance()->writer ( filename, medData );
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -786,6 +889,48 @@ QStringList medAbstractDatabaseImporter::getAllFilesToBeProcessed ( QString file
     return fileList;
 }
 
+//-----------------------------------------------------------------------------------------------------------
+/**
+* Reads the header of every file of fileList, spreading the files over the global thread pool.
+* Each file gets its own reader, so no state is shared between workers. The database is not
+* accessed here: filling missing metadata and grouping by volume is left to the caller.
+* @param fileList - the files to scan, as returned by getAllFilesToBeProcessed
+* @return one @medImporterHeaderScan per input file, in the order of fileList
+**/
+QVector<medImporterHeaderScan> medAbstractDatabaseImporter::scanHeaders ( const QStringList& fileList )
+{
+    QVector<medImporterHeaderScan> headerScans;
+    headerScans.reserve ( fileList.size() );
+    for ( const QString& file : fileList )
+    {
+        medImporterHeaderScan headerScan;
+        headerScan.filePath = file;
+        headerScans << headerScan;
+    }
+
+    QAtomicInt scannedFiles ( 0 );
+    const int fileCount = fileList.size();
+
+    QtConcurrent::blockingMap ( headerScans, [this, &scannedFiles, fileCount] ( medImporterHeaderScan& headerScan )
+    {
+        if ( d->isCancelled )
+            return;
+
+        QFileInfo fileInfo ( headerScan.filePath );
+        headerScan.isEmpty = ( fileInfo.size() == 0 );
+        if ( !headerScan.isEmpty )
+        {
+            bool readOnlyImageInformation = true;
+            headerScan.data = tryReadImages ( QStringList ( fileInfo.filePath() ), readOnlyImageInformation );
+        }
+
+        int scanned = scannedFiles.fetchAndAddRelaxed ( 1 ) + 1;
+        emit progress ( this, ( ( qreal ) scanned/ ( qreal ) fileCount ) * 25.0 );
+    });
+
+    return headerScans;
+}
+
 //-----------------------------------------------------------------------------------------------------------
 /**
 * Tries to read the file/s indicated by filesPath.
@@ -817,6 +962,8 @@ medAbstractData* medAbstractDatabaseImporter::tryReadImages ( const QStringList&
         {
             medData = dynamic_cast<medAbstractData*>(dataReader->data());
         }
+
+        medDataReaderWriterIndex::instance()->release ( dataReader );
     }
 
     return medData;
@@ -867,27 +1014,9 @@ QString medAbstractDatabaseImporter::determineFutureImageFileName ( const medAbs
 QString medAbstractDatabaseImporter::determineFutureImageExtensionByDataType ( const medAbstractData* medData )
 {
     QString identifier = medData->identifier();
-    QString extension = "";
-
-    QList<QString> writers = medAbstractDataFactory::instance()->writers();
-
-    dtkSmartPointer<dtkAbstractDataWriter> dataWriter;
 
     // first let's try to retrieve extension for writer information
-    for ( int i=0; i<writers.size(); i++ )
-    {
-        dataWriter = medAbstractDataFactory::instance()->writerSmartPointer ( writers[i] );
-
-        if (dataWriter->handled().contains(medData->identifier()) )
-        {
-            QStringList extensions = dataWriter->supportedFileExtensions();
-            if(!extensions.isEmpty())
-            {
-                extension = extensions[0];
-                break;
-            }
-        }
-    }
+    QString extension = medDataReaderWriterIndex::instance()->writerExtension ( identifier );
 
     // and if it fails, let's do it manually
     // but this could be avoided by updating writers implementation (supportedFileExtensions)
@@ -922,14 +1051,17 @@ QString medAbstractDatabaseImporter::determineFutureImageExtensionByDataType ( c
 **/
 bool medAbstractDatabaseImporter::tryWriteImage ( QString filePath, medAbstractData* imData )
 {
+    bool writeSuccessful = false;
+
     dtkSmartPointer<dtkAbstractDataWriter> dataWriter = getSuitableWriter ( filePath, imData );
     if ( dataWriter )
     {
         dataWriter->setData ( imData );
-        if ( dataWriter->write ( filePath ) )
-            return true;
+        writeSuccessful = dataWriter->write ( filePath );
+
+        medDataReaderWriterIndex::instance()->release ( dataWriter );
     }
-    return false;
+    return writeSuccessful;
 }
 
 //-----------------------------------------------------------------------------------------------------------
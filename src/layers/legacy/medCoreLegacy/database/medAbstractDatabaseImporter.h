@@ -25,6 +25,16 @@
 class medAbstractDatabaseImporterPrivate;
 class medAbstractData;
 
+/**
+* @brief Result of the header scan of a single file, see medAbstractDatabaseImporter::scanHeaders.
+**/
+struct medImporterHeaderScan
+{
+    QString filePath;
+    bool isEmpty = false;
+    dtkSmartPointer<medAbstractData> data; // header-only data, nullptr if the file could not be read
+};
+
 /**
 * @class medAbstractDatabaseImporter
 * @brief Base class for database importers.
@@ -81,6 +91,7 @@ protected:
     dtkSmartPointer<dtkAbstractDataWriter> getSuitableWriter ( QString filename, medAbstractData* medData );
 
     QStringList getAllFilesToBeProcessed ( QString fileOrDirectory );
+    QVector<medImporterHeaderScan> scanHeaders ( const QStringList& fileList );
 
     medAbstractData *tryReadImages ( const QStringList& filesPath,const bool readOnlyImageInformation );
     bool tryWriteImage ( QString filePath, medAbstractData* medData );
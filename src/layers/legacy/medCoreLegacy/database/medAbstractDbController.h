@@ -40,6 +40,45 @@ public:
     virtual QString metaData(const medDataIndex& index,const QString& key) const = 0;
     QString metaData(const medDataIndex& index,const medMetaDataKeys::Key& md) const { return metaData(index,md.key()); }
     virtual bool setMetaData(const medDataIndex& index, const QString& key, const QString& value) = 0;
+
+    /**
+     * Children of parent (the patients if parent is not valid) along with their metadata values,
+     * in the order of keys. Null keys give empty values.
+     * This default implementation queries each child and key, controllers can load them in bulk.
+     */
+    virtual QList<QPair<medDataIndex, QStringList> > childrenMetaData(const medDataIndex& parent, const QStringList& keys) const
+    {
+        QList<medDataIndex> children;
+        if (parent.isValidForStudy())
+            children = series(parent);
+        else if (parent.isValidForPatient())
+            children = studies(parent);
+        else
+            children = patients();
+
+        QList<QPair<medDataIndex, QStringList> > ret;
+        for (const medDataIndex& child : children)
+        {
+            QStringList values;
+            for (const QString& key : keys)
+                values << (key.isNull() ? QString() : metaData(child, key));
+            ret << qMakePair(child, values);
+        }
+        return ret;
+    }
+
+    /**
+     * Sets values[i] as the metadata keys[i] of indexes[i], for all i.
+     * This default implementation writes them one by one, controllers can write them in bulk.
+     */
+    virtual bool setMetaData(const QList<medDataIndex>& indexes, const QStringList& keys, const QStringList& values)
+    {
+        bool success = (indexes.size() == keys.size()) && (keys.size() == values.size());
+        for (int i = 0; success && i < indexes.size(); ++i)
+            success = setMetaData(indexes[i], keys[i], values[i]);
+        return success;
+    }
+
     virtual bool isPersistent() const = 0;
 
 signals:
@@ -17,6 +17,7 @@
 #include <medDatabaseController.h>
 #include <medDatabaseNonPersistentController.h>
 #include <medDataManager.h>
+#include <medDataReaderWriterIndex.h>
 #include <medGlobalDefs.h>
 #include <medJobManagerL.h>
 #include <medMessageController.h>
@@ -442,6 +443,53 @@ bool medDataManager::setMetadata(const medDataIndex& index, const QString& key,
     return false;
 }
 
+/**
+ * Set several metadata at once, values[i] being the metadata keys[i] of indexes[i].
+ * Each data source writes its part in bulk.
+ */
+bool medDataManager::setMetadata(const QList<medDataIndex>& indexes, const QStringList& keys, const QStringList& values)
+{
+    Q_D(medDataManager);
+    if ((indexes.size() != keys.size()) || (keys.size() != values.size()))
+    {
+        return false;
+    }
+
+    QMap<int, QList<int> > positionsBySource;
+    for (int i = 0; i < indexes.size(); ++i)
+    {
+        positionsBySource[indexes[i].dataSourceId()] << i;
+    }
+
+    bool success = true;
+    for (auto it = positionsBySource.constBegin(); it != positionsBySource.constEnd(); ++it)
+    {
+        medAbstractDbController * dbc = d->controllerForDataSource(it.key());
+        QList<medDataIndex> sourceIndexes;
+        QStringList sourceKeys, sourceValues;
+        for (int i : it.value())
+        {
+            sourceIndexes << indexes[i];
+            sourceKeys << keys[i];
+            sourceValues << values[i];
+        }
+
+        if ((dbc != nullptr) && (dbc->setMetaData(sourceIndexes, sourceKeys, sourceValues)))
+        {
+            for (int i : it.value())
+            {
+                emit metadataModified(indexes[i], keys[i], values[i]);
+            }
+        }
+        else
+        {
+            success = false;
+        }
+    }
+
+    return success;
+}
+
 void medDataManager::removeData(const medDataIndex& index)
 {
     Q_D(medDataManager);
@@ -500,6 +548,9 @@ void medDataManager::setWriterPriorities()
     }
 
     medAbstractDataFactory::instance()->setWriterPriorities(writerPriorites);
+
+    // The writers are indexed in priority order
+    medDataReaderWriterIndex::instance()->rebuild();
 }
 
 medDataManager::medDataManager() : d_ptr(new medDataManagerPrivate(this))
@@ -47,6 +47,7 @@ public:
 
     QString getMetaData(const medDataIndex& index, const QString& key);
     bool setMetadata(const medDataIndex& index, const QString& key, const QString& value);
+    bool setMetadata(const QList<medDataIndex>& indexes, const QStringList& keys, const QStringList& values);
 
     void removeData(const medDataIndex& index);
 
@@ -20,6 +20,8 @@
 #include <medJobManagerL.h>
 #include <medMessageController.h>
 
+#include <QThread>
+
 class medDatabaseControllerPrivate
 {
 public:
@@ -35,6 +37,10 @@ public:
     typedef QHash< QString , TableEntryList > MetaDataMap;
 
     MetaDataMap metaDataLookup;
+
+    // Prepared queries of the connection, by query string
+    QHash<QString, QSqlQuery> preparedQueries;
+
     // Reusable table names.
     static const QString T_series ;
     static const QString T_study ;
@@ -165,7 +171,8 @@ bool medDatabaseController::createConnection(void)
     if(    !createPatientTable()
         || !createStudyTable()
         || !createSeriesTable()
-        || !updateFromNoVersionToVersion1())
+        || !updateFromNoVersionToVersion1()
+        || !updateFromVersion1ToVersion2())
     {
         return false;
     }
@@ -186,6 +193,7 @@ bool medDatabaseController::createConnection(void)
 
 bool medDatabaseController::closeConnection(void)
 {
+    d->preparedQueries.clear();
     m_database.close();
     QSqlDatabase::removeDatabase("QSQLITE");
     d->isConnected = false;
@@ -203,10 +211,9 @@ medDataIndex medDatabaseController::indexForPatient(int id)
 */
 medDataIndex medDatabaseController::indexForPatient (const QString &patientName)
 {
-    QSqlQuery query(m_database);
+    QSqlQuery query = preparedQuery("SELECT id FROM patient WHERE name = :name");
     QVariant patientId = -1;
 
-    query.prepare("SELECT id FROM patient WHERE name = :name");
     query.bindValue(":name", patientName);
 
     if(!EXEC_QUERY(query))
@@ -216,6 +223,7 @@ medDataIndex medDatabaseController::indexForPatient (const QString &patientName)
 
     if(query.first()) {
         patientId = query.value(0);
+        query.finish();
         return medDataIndex::makePatientIndex(this->dataSourceId(), patientId.toInt());
     }
 
@@ -224,11 +232,10 @@ medDataIndex medDatabaseController::indexForPatient (const QString &patientName)
 
 medDataIndex medDatabaseController::indexForStudy(int id)
 {
-    QSqlQuery query(m_database);
+    QSqlQuery query = preparedQuery("SELECT patient FROM study WHERE id = :id");
 
     QVariant patientId = -1;
 
-    query.prepare("SELECT patient FROM study WHERE id = :id");
     query.bindValue(":id", id);
 
     if(!EXEC_QUERY(query))
@@ -238,6 +245,7 @@ medDataIndex medDatabaseController::indexForStudy(int id)
 
     if(query.first())
         patientId = query.value(0);
+    query.finish();
 
     return medDataIndex::makeStudyIndex(this->dataSourceId(), patientId.toInt(), id);
 }
@@ -248,12 +256,11 @@ medDataIndex medDatabaseController::indexForStudy(const QString &patientName, co
     if (!index.isValid())
         return index;
 
-    QSqlQuery query(m_database);
+    QSqlQuery query = preparedQuery("SELECT id FROM study WHERE patient = :id AND name = :name");
 
     QVariant patientId = index.patientId();
     QVariant studyId   = -1;
 
-    query.prepare("SELECT id FROM study WHERE patient = :id AND name = :name");
     query.bindValue(":id",   patientId);
     query.bindValue(":name", studyName);
 
@@ -264,6 +271,7 @@ medDataIndex medDatabaseController::indexForStudy(const QString &patientName, co
 
     if(query.first()) {
         studyId = query.value(0);
+        query.finish();
         index.setStudyId(studyId.toInt());
         return index;
     }
@@ -273,12 +281,11 @@ medDataIndex medDatabaseController::indexForStudy(const QString &patientName, co
 
 medDataIndex medDatabaseController::indexForSeries(int id)
 {
-    QSqlQuery query(m_database);
+    QSqlQuery query = preparedQuery("SELECT study FROM series WHERE id = :id");
 
     QVariant patientId = -1;
     QVariant   studyId = -1;
 
-    query.prepare("SELECT study FROM series WHERE id = :id");
     query.bindValue(":id", id);
 
     if(!EXEC_QUERY(query))
@@ -288,8 +295,9 @@ medDataIndex medDatabaseController::indexForSeries(int id)
 
     if(query.first())
         studyId = query.value(0);
+    query.finish();
 
-    query.prepare("SELECT patient FROM study WHERE id = :id");
+    query = preparedQuery("SELECT patient FROM study WHERE id = :id");
     query.bindValue(":id", studyId);
 
     if(!EXEC_QUERY(query))
@@ -299,6 +307,7 @@ medDataIndex medDatabaseController::indexForSeries(int id)
 
     if(query.first())
         patientId = query.value(0);
+    query.finish();
 
     return medDataIndex::makeSeriesIndex(this->dataSourceId(), patientId.toInt(), studyId.toInt(), id);
 }
@@ -310,11 +319,10 @@ medDataIndex medDatabaseController::indexForSeries(const QString &patientName, c
     if (!index.isValid())
         return index;
 
-    QSqlQuery query(m_database);
+    QSqlQuery query = preparedQuery("SELECT id FROM series WHERE study = :id AND name = :name");
 
     QVariant studyId   = index.studyId();
 
-    query.prepare("SELECT id FROM series WHERE study = :id AND name = :name");
     query.bindValue(":id",   studyId);
     query.bindValue(":name", seriesName);
 
@@ -325,6 +333,7 @@ medDataIndex medDatabaseController::indexForSeries(const QString &patientName, c
 
     if(query.first()) {
         QVariant seriesId = query.value(0);
+        query.finish();
         index.setSeriesId(seriesId.toInt());
         return index;
     }
@@ -517,6 +526,12 @@ bool medDatabaseController::updateFromNoVersionToVersion1()
         return false;
     }
 
+    // Already upgraded, this must not set the version back to 1
+    if (q.value(0).toInt() >= 1)
+    {
+        return true;
+    }
+
     if ( ! q.exec("BEGIN EXCLUSIVE TRANSACTION"))
     {
         qWarning("medDatabaseController: Could not begin transaction.");
@@ -600,6 +615,70 @@ bool medDatabaseController::updateFromNoVersionToVersion1()
     return true;
 }
 
+bool medDatabaseController::updateFromVersion1ToVersion2()
+{
+    // Updates the DB schema from version 1 to version 2:
+    // - Indexes on the columns used to find the children of an item and by the
+    //   importer to find existing items, which otherwise scan the whole tables
+    // As for version 1, this is done in a transaction.
+
+    QSqlQuery q(this->database());
+
+    if ( ! (q.exec("PRAGMA user_version") && q.first()))
+    {
+        qWarning("medDatabaseController: Testing DB version for upgrade failed.");
+        qDebug() << q.lastError();
+        return false;
+    }
+
+    if (q.value(0).toInt() >= 2)
+    {
+        return true;
+    }
+
+    if ( ! q.exec("BEGIN EXCLUSIVE TRANSACTION"))
+    {
+        qWarning("medDatabaseController: Could not begin transaction.");
+        qDebug() << q.lastError();
+        return false;
+    }
+
+    const QStringList indexes = QStringList()
+            << "CREATE INDEX IF NOT EXISTS study_patient ON study (patient)"
+            << "CREATE INDEX IF NOT EXISTS series_study ON series (study)"
+            << "CREATE INDEX IF NOT EXISTS series_uid ON series (uid)"
+            << "CREATE INDEX IF NOT EXISTS patient_patientId ON patient (patientId)"
+            << "CREATE INDEX IF NOT EXISTS patient_name ON patient (name)";
+
+    for (const QString& index : indexes)
+    {
+        if ( ! q.exec(index))
+        {
+            qWarning() << "medDatabaseController: Could not create index:" << index;
+            qDebug() << q.lastError();
+            q.exec("ROLLBACK TRANSACTION");
+            return false;
+        }
+    }
+
+    // finally, update DB version
+    if ( ! q.exec("PRAGMA user_version = 2"))
+    {
+        qWarning("medDatabaseController: updating DB version to 2 after upgrade failed.");
+        qDebug() << q.lastError();
+        q.exec("ROLLBACK TRANSACTION");
+        return false;
+    }
+
+    if ( ! q.exec("END TRANSACTION"))
+    {
+        qWarning("medDatabaseController: Could not end transaction.");
+        qDebug() << q.lastError();
+        return false;
+    }
+    return true;
+}
+
 /**
 * Change the storage location of the database by copy, verify, delete
 * @param QString newLocation path of new storage location, must be empty
@@ -743,8 +822,6 @@ QString medDatabaseController::metaData(const medDataIndex& index,const QString&
     typedef medDatabaseControllerPrivate::MetaDataMap MetaDataMap;
     typedef medDatabaseControllerPrivate::TableEntryList TableEntryList;
 
-    QSqlQuery query(this->database());
-
     // Attempt to translate the desired metadata into a table / column entry.
     MetaDataMap::const_iterator it(d->metaDataLookup.find(key));
     if (it == d->metaDataLookup.end() )
@@ -777,12 +854,17 @@ QString medDatabaseController::metaData(const medDataIndex& index,const QString&
         }
         if ( id != -1 )
         {
-            query.prepare("SELECT " + columnName + " FROM " + tableName + " WHERE id = :id");
+            QSqlQuery query = preparedQuery("SELECT " + columnName + " FROM " + tableName + " WHERE id = :id");
             query.bindValue(":id", id);
             EXEC_QUERY(query);
-            if ( query.next() )
+            bool found = query.next();
+            if ( found )
             {
                 ret = query.value(0).toString();
+            }
+            query.finish();
+            if ( found )
+            {
                 break;
             }
         }
@@ -794,14 +876,128 @@ QString medDatabaseController::metaData(const medDataIndex& index,const QString&
     return ret;
 }
 
+/**
+ * Get metadata of all the children of an item with a single query on their table.
+ * Keys stored in a parent table are still read item by item.
+ */
+QList<QPair<medDataIndex, QStringList> > medDatabaseController::childrenMetaData(const medDataIndex& parent, const QStringList& keys) const
+{
+    typedef medDatabaseControllerPrivate::MetaDataMap MetaDataMap;
+    typedef medDatabaseControllerPrivate::TableEntry TableEntry;
+
+    QString tableName = d->T_patient;
+    QString parentColumn;
+    int parentId = -1;
+    if ( parent.isValidForStudy() )
+    {
+        tableName = d->T_series;
+        parentColumn = "study";
+        parentId = parent.studyId();
+    }
+    else if ( parent.isValidForPatient() )
+    {
+        tableName = d->T_study;
+        parentColumn = "patient";
+        parentId = parent.patientId();
+    }
+
+    // Columns of the children table for each key, the first table entry valid for the
+    // children index is the one metaData() would read.
+    QStringList columns;
+    QList<int> columnOfKey;
+    QList<bool> isPathKey;
+    for ( const QString& key : keys )
+    {
+        int column = -1;
+        bool isPath = false;
+        MetaDataMap::const_iterator it(d->metaDataLookup.find(key));
+        if ( !key.isNull() && it != d->metaDataLookup.end() )
+        {
+            for ( const TableEntry& entry : it.value() )
+            {
+                bool validForChildren = (entry.table == d->T_patient)
+                        || (entry.table == d->T_study && tableName != d->T_patient)
+                        || (entry.table == d->T_series && tableName == d->T_series);
+                if ( validForChildren )
+                {
+                    if ( entry.table == tableName )
+                    {
+                        column = columns.size() + 1;
+                        columns << entry.column;
+                        isPath = entry.isPath;
+                    }
+                    else
+                    {
+                        column = -2; // stored in a parent table
+                    }
+                    break;
+                }
+            }
+        }
+        columnOfKey << column;
+        isPathKey << isPath;
+    }
+
+    QString queryString = "SELECT " + QStringList(QStringList("id") + columns).join(", ") + " FROM " + tableName;
+    if ( parentId != -1 )
+    {
+        queryString += " WHERE " + parentColumn + " = :parentId";
+    }
+
+    QSqlQuery query(this->database());
+    query.setForwardOnly(true);
+    query.prepare(queryString);
+    if ( parentId != -1 )
+    {
+        query.bindValue(":parentId", parentId);
+    }
+    EXEC_QUERY(query);
+
+    QList<QPair<medDataIndex, QStringList> > ret;
+    while( query.next() )
+    {
+        int id = query.value(0).toInt();
+        medDataIndex index;
+        if ( tableName == d->T_series )
+        {
+            index = medDataIndex::makeSeriesIndex(this->dataSourceId(), parent.patientId(), parent.studyId(), id);
+        }
+        else if ( tableName == d->T_study )
+        {
+            index = medDataIndex::makeStudyIndex(this->dataSourceId(), parent.patientId(), id);
+        }
+        else
+        {
+            index = medDataIndex::makePatientIndex(this->dataSourceId(), id);
+        }
+
+        QStringList values;
+        for ( int i = 0; i < keys.size(); ++i )
+        {
+            QString value;
+            if ( columnOfKey[i] > 0 )
+            {
+                value = query.value(columnOfKey[i]).toString();
+                if ( !value.isEmpty() && isPathKey[i] )
+                    value = medStorage::dataLocation() + value;
+            }
+            else if ( columnOfKey[i] == -2 )
+            {
+                value = metaData(index, keys[i]);
+            }
+            values << value;
+        }
+        ret << qMakePair(index, values);
+    }
+    return ret;
+}
+
 /** Set metadata for specific item. Return true on success, false otherwise. */
 bool medDatabaseController::setMetaData( const medDataIndex& index, const QString& key, const QString& value )
 {
     typedef medDatabaseControllerPrivate::MetaDataMap MetaDataMap;
     typedef medDatabaseControllerPrivate::TableEntryList TableEntryList;
 
-    QSqlQuery query(this->database());
-
     // Attempt to translate the desired metadata into a table / column entry.
     MetaDataMap::const_iterator it(d->metaDataLookup.find(key));
     if (it == d->metaDataLookup.end() ) {
@@ -831,7 +1027,7 @@ bool medDatabaseController::setMetaData( const medDataIndex& index, const QStrin
         }
         if ( id != -1 )
         {
-            query.prepare(QString("UPDATE %1 SET %2 = :value WHERE id = :id")
+            QSqlQuery query = preparedQuery(QString("UPDATE %1 SET %2 = :value WHERE id = :id")
                 .arg(tableName).arg(columnName) );
             query.bindValue(":value", value);
             query.bindValue(":id", id);
@@ -846,6 +1042,41 @@ bool medDatabaseController::setMetaData( const medDataIndex& index, const QStrin
     return success;
 }
 
+/**
+ * Set several metadata in a single transaction, values[i] being the metadata keys[i] of indexes[i].
+ * Either all of them are written or none. Return true on success, false otherwise.
+ */
+bool medDatabaseController::setMetaData(const QList<medDataIndex>& indexes, const QStringList& keys, const QStringList& values)
+{
+    if ( indexes.size() != keys.size() || keys.size() != values.size() )
+    {
+        return false;
+    }
+
+    if ( !m_database.transaction() )
+    {
+        qDebug() << DTK_COLOR_FG_RED << m_database.lastError() << DTK_NO_COLOR;
+        return false;
+    }
+
+    bool success = true;
+    for ( int i = 0; success && i < indexes.size(); ++i )
+    {
+        success = setMetaData(indexes[i], keys[i], values[i]);
+    }
+
+    if ( success )
+    {
+        success = m_database.commit();
+    }
+    if ( !success )
+    {
+        qDebug() << DTK_COLOR_FG_RED << m_database.lastError() << DTK_NO_COLOR;
+        m_database.rollback();
+    }
+    return success;
+}
+
 /** Implement base class */
 int medDatabaseController::dataSourceId() const
 {
@@ -879,8 +1110,7 @@ QList<medDataIndex> medDatabaseController::studies( const medDataIndex& index )
         return ret;
     }
 
-    QSqlQuery query(this->database());
-    query.prepare("SELECT id FROM study WHERE patient = :patientId");
+    QSqlQuery query = preparedQuery("SELECT id FROM study WHERE patient = :patientId");
     query.bindValue(":patientId", index.patientId());
     EXEC_QUERY(query);
 #if QT_VERSION > 0x0406FF
@@ -889,6 +1119,7 @@ QList<medDataIndex> medDatabaseController::studies( const medDataIndex& index )
     while( query.next() ){
         ret.push_back( medDataIndex::makeStudyIndex(this->dataSourceId(), index.patientId(), query.value(0).toInt()));
     }
+    query.finish();
     return ret;
 }
 
@@ -903,8 +1134,7 @@ QList<medDataIndex> medDatabaseController::series( const medDataIndex& index) co
         return ret;
     }
 
-    QSqlQuery query(this->database());
-    query.prepare("SELECT id FROM series WHERE study = :studyId");
+    QSqlQuery query = preparedQuery("SELECT id FROM series WHERE study = :studyId");
     query.bindValue(":studyId", index.studyId());
     EXEC_QUERY(query);
 #if QT_VERSION > 0x0406FF
@@ -913,6 +1143,7 @@ QList<medDataIndex> medDatabaseController::series( const medDataIndex& index) co
     while( query.next() ){
         ret.push_back( medDataIndex::makeSeriesIndex(this->dataSourceId(), index.patientId(), index.studyId(), query.value(0).toInt()));
     }
+    query.finish();
     return ret;
 }
 
@@ -934,6 +1165,37 @@ bool medDatabaseController::isPersistent(  ) const
     return true;
 }
 
+/**
+ * Prepared query for queryString, prepared once and reused as long as the connection is open.
+ * The returned query shares its statement with the cached one, call finish() once its results are read.
+ * Queries from other threads than the one of the controller are prepared each time.
+ */
+QSqlQuery medDatabaseController::preparedQuery(const QString& queryString) const
+{
+    if ( QThread::currentThread() != this->thread() )
+    {
+        QSqlQuery query(this->database());
+        query.prepare(queryString);
+        return query;
+    }
+
+    QHash<QString, QSqlQuery>::const_iterator it = d->preparedQueries.constFind(queryString);
+    if ( it != d->preparedQueries.constEnd() )
+    {
+        return it.value();
+    }
+
+    QSqlQuery query(this->database());
+    query.setForwardOnly(true);
+    if ( !query.prepare(queryString) )
+    {
+        qDebug() << DTK_COLOR_FG_RED << query.lastError() << DTK_NO_COLOR;
+        return query;
+    }
+    d->preparedQueries.insert(queryString, query);
+    return query;
+}
+
 bool medDatabaseController::execQuery(QSqlQuery& query, const char* file, int line) const
 {
     if (!query.exec())
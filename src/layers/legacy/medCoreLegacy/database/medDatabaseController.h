@@ -63,6 +63,8 @@ public:
 
     virtual QString metaData(const medDataIndex& index,const QString& key) const;
     virtual bool setMetaData(const medDataIndex& index, const QString& key, const QString& value);
+    virtual bool setMetaData(const QList<medDataIndex>& indexes, const QStringList& keys, const QStringList& values);
+    virtual QList<QPair<medDataIndex, QStringList> > childrenMetaData(const medDataIndex& parent, const QStringList& keys) const;
 
     virtual bool isPersistent() const;
 
@@ -99,6 +101,9 @@ private:
     bool  createSeriesTable();
 
     bool updateFromNoVersionToVersion1();
+    bool updateFromVersion1ToVersion2();
+
+    QSqlQuery preparedQuery(const QString& queryString) const;
 
     QSqlDatabase m_database;
 
@@ -51,6 +51,9 @@ public:
 
     QHash<medDataIndex, QModelIndex> medIndexMap;
 
+    // Patients whose studies and series have been loaded, see fetchMore()
+    QSet<medDataIndex> fetchedPatients;
+
     enum { DataCount = 13 };
 };
 
@@ -165,7 +168,35 @@ int medDatabaseModel::rowCount(const QModelIndex& parent) const
 
 bool medDatabaseModel::hasChildren ( const QModelIndex & parent ) const
 {
-    return (rowCount(parent) > 0);
+    return (rowCount(parent) > 0) || canFetchMore(parent);
+}
+
+//! Studies and series of a patient are only loaded when the patient is expanded.
+bool medDatabaseModel::canFetchMore(const QModelIndex& parent) const
+{
+    if (!parent.isValid() || parent.column() > 0)
+        return false;
+
+    medDataIndex dataIndex = d->item(parent)->dataIndex();
+    return dataIndex.isValidForPatient() && !dataIndex.isValidForStudy() && !isFetched(dataIndex);
+}
+
+void medDatabaseModel::fetchMore(const QModelIndex& parent)
+{
+    if (!canFetchMore(parent))
+        return;
+
+    medAbstractDatabaseItem *ptItem = d->item(parent);
+    d->fetchedPatients.insert(ptItem->dataIndex());
+
+    QList<medAbstractDatabaseItem*> stItems = createStudyItems(ptItem);
+    if (stItems.isEmpty())
+        return;
+
+    beginInsertRows(parent, ptItem->childCount(), ptItem->childCount() + stItems.count() - 1);
+    for (medAbstractDatabaseItem *stItem : stItems)
+        ptItem->append(stItem);
+    endInsertRows();
 }
 
 int medDatabaseModel::columnCount(const QModelIndex& parent) const
@@ -514,6 +545,8 @@ void medDatabaseModel::repopulate(void)
         this->removeRows(0, this->rowCount(QModelIndex()), QModelIndex());
     endRemoveRows();
 
+    d->fetchedPatients.clear();
+
     beginInsertRows(QModelIndex(),0,0);
     populate(d->root);
     endInsertRows();
@@ -533,87 +566,66 @@ void medDatabaseModel::repopulate(void)
 void medDatabaseModel::populate(medAbstractDatabaseItem *root)
 {
     typedef QList<int> IntList;
-    typedef QList<medDataIndex> IndexList;
 
     IntList dataSources;
     dataSources << medDatabaseController::instance()->dataSourceId()
                 << medDatabaseNonPersistentController::instance()->dataSourceId();
 
+    // Patients are loaded with all their attributes at once, their studies and series
+    // only when they are expanded (see fetchMore).
+    const QStringList ptKeys = attributeKeys(d->ptAttributes);
+
     for( const int dataSourceId : dataSources )
     {
         medAbstractDbController * dbc = medDataManager::instance()->controllerForDataSource(dataSourceId);
 
-        IndexList patientsForSource = dbc->patients();
-
-        // Iterate over patientIds for this data source
-        for( const medDataIndex& patient : patientsForSource )
+        for( const auto& patient : dbc->childrenMetaData(medDataIndex(), ptKeys) )
         {
-            QList<QVariant> ptData = d->ptDefaultData;
-            for (int i(0); i<d->DataCount; ++i)
-            {
-                QVariant attribute = d->ptAttributes[i].toString();
-                if ( !attribute.isNull() )
-                {
-                    QString value =  dbc->metaData(patient, attribute.toString() );
-                    QVariant data = convertQStringToQVariant(attribute.toString(),value);
-                    if ( data.isValid() )
-                        ptData[i] = data;
-                }
-            }
-            medAbstractDatabaseItem *ptItem = new medDatabaseItem(patient, d->ptAttributes, ptData, root);
+            QList<QVariant> ptData = itemData(d->ptAttributes, d->ptDefaultData, patient.second);
+            medAbstractDatabaseItem *ptItem = new medDatabaseItem(patient.first, d->ptAttributes, ptData, root);
 
-            IndexList studiesForSource = dbc->studies(patient);
+            root->append(ptItem);
+        } // for patient
+    } // for dataSource
+}
 
-            // Iterate over studyIds for this patient
-            for( const medDataIndex& study : studiesForSource )
-            {
-                QList<QVariant> stData = d->stDefaultData;
-                for (int i(0); i<d->DataCount; ++i)
-                {
-                    QVariant attribute = d->stAttributes[i];
-                    if ( !attribute.isNull() )
-                    {
-                        QString value =  dbc->metaData(study, attribute.toString() );
-                        QVariant data = convertQStringToQVariant(attribute.toString(),value);
-                        if ( data.isValid() )
-                            stData[i] = data;
-                    }
-                }
+//! Creates the items of the studies of a patient, and of their series.
+/*!
+ *  The items are not appended to the patient, so that the caller can signal the insertion.
+ */
+QList<medAbstractDatabaseItem*> medDatabaseModel::createStudyItems(medAbstractDatabaseItem *ptItem)
+{
+    QList<medAbstractDatabaseItem*> stItems;
 
-                medAbstractDatabaseItem *stItem = new medDatabaseItem(study, d->stAttributes, stData, ptItem);
-                ptItem->append(stItem);
+    const medDataIndex& patient = ptItem->dataIndex();
+    medAbstractDbController * dbc = medDataManager::instance()->controllerForDataSource(patient.dataSourceId());
+    if (!dbc)
+        return stItems;
 
-                IndexList seriesForSource = dbc->series(study);
+    const QStringList stKeys = attributeKeys(d->stAttributes);
+    const QStringList seKeys = attributeKeys(d->seAttributes);
 
-                // justBringStudies: not sure this is useful anymore
-                if(!d->justBringStudies)
-                {
-                    // Iterate over series for this study
-                    for( const medDataIndex& series : seriesForSource )
-                    {
+    // Iterate over studyIds for this patient
+    for( const auto& study : dbc->childrenMetaData(patient, stKeys) )
+    {
+        QList<QVariant> stData = itemData(d->stAttributes, d->stDefaultData, study.second);
+        medAbstractDatabaseItem *stItem = new medDatabaseItem(study.first, d->stAttributes, stData, ptItem);
+        stItems << stItem;
 
-                        QList<QVariant> seData = d->seDefaultData;
-                        for (int i(0); i<d->DataCount; ++i)
-                        {
-                            QVariant attribute = d->seAttributes[i];
-                            if ( !attribute.isNull() )
-                            {
-                                QString value =  dbc->metaData(series, attribute.toString() );
-                                QVariant data = convertQStringToQVariant(attribute.toString(),value);
-                                if ( data.isValid() )
-                                    seData[i] = data;
-                            }
-                        }
-                        medAbstractDatabaseItem *seItem = new medDatabaseItem(series, d->seAttributes, seData, stItem);
-
-                        stItem->append(seItem);
-                    } // for series
-                }
-            }
+        // justBringStudies: not sure this is useful anymore
+        if(!d->justBringStudies)
+        {
+            // Iterate over series for this study
+            for( const auto& series : dbc->childrenMetaData(study.first, seKeys) )
+            {
+                QList<QVariant> seData = itemData(d->seAttributes, d->seDefaultData, series.second);
+                medAbstractDatabaseItem *seItem = new medDatabaseItem(series.first, d->seAttributes, seData, stItem);
 
-            root->append(ptItem);
-        } // for patient
-    } // for dataSource
+                stItem->append(seItem);
+            } // for series
+        }
+    }
+    return stItems;
 }
 
 void medDatabaseModel::update(const medDataIndex& dataIndex)
@@ -698,6 +710,15 @@ void medDatabaseModel::updateSeries(const medDataIndex& dataIndex)
 
         if(!item)
         {
+            // the patient is loaded with the new series
+            medDataIndex ptDataIndex = medDataIndex::makePatientIndex(dataIndex.dataSourceId(), dataIndex.patientId());
+            QModelIndex ptIndex = d->medIndexMap.value(ptDataIndex);
+            if (ptIndex.isValid() && !isFetched(ptDataIndex))
+            {
+                fetchForUpdate(ptIndex, dataIndex);
+                return;
+            }
+
             medDataIndex stDataIndex(dataIndex);
             stDataIndex.setSeriesId(-1);
 
@@ -714,6 +735,7 @@ void medDatabaseModel::updateSeries(const medDataIndex& dataIndex)
                 if(!stItem)
                 {
                     qWarning() << "A problem occured while updating the series " << dataIndex.asString();
+                    return;
                 }
             }
 
@@ -814,6 +836,13 @@ void medDatabaseModel::updateStudy(const medDataIndex& dataIndex, bool updateChi
 
             QModelIndex ptIndex = d->medIndexMap.value(ptDataIndex);
 
+            // the patient is loaded with the new study
+            if (ptIndex.isValid() && !isFetched(ptDataIndex))
+            {
+                fetchForUpdate(ptIndex, dataIndex);
+                return;
+            }
+
             medAbstractDatabaseItem *ptItem = static_cast<medAbstractDatabaseItem *>(ptIndex.internalPointer());
 
             //in some cases (when importing for example), a series is being created while there is no study or patient item)
@@ -890,6 +919,7 @@ void medDatabaseModel::updatePatient(const medDataIndex& dataIndex, bool updateC
 
                 item->parent()->removeChildren(index.row(), 1);
                 d->medIndexMap.remove(dataIndex);
+                d->fetchedPatients.remove(dataIndex);
 
                 emit layoutChanged();
             }
@@ -920,6 +950,9 @@ void medDatabaseModel::updatePatient(const medDataIndex& dataIndex, bool updateC
             // and append it to the parent patientId
             medAbstractDatabaseItem *ptItem = new medDatabaseItem(dataIndex, d->ptAttributes, ptData,  d->root);
 
+            // a new patient is empty, its studies and series will come with their own updates
+            d->fetchedPatients.insert(dataIndex);
+
             emit layoutAboutToBeChanged();
             d->root->append(ptItem);
             QModelIndex newIndex = this->index(d->root->childCount()-1,0,QModelIndex());
@@ -993,6 +1026,72 @@ QVariant medDatabaseModel::convertQStringToQVariant(QString keyName, QString val
     return res;
 }
 
+QStringList medDatabaseModel::attributeKeys(const QList<QVariant>& attributes) const
+{
+    QStringList keys;
+    for (const QVariant& attribute : attributes)
+    {
+        keys << (attribute.isNull() ? QString() : attribute.toString());
+    }
+    return keys;
+}
+
+QList<QVariant> medDatabaseModel::itemData(const QList<QVariant>& attributes, const QList<QVariant>& defaultData, const QStringList& values)
+{
+    QList<QVariant> itemData = defaultData;
+    for (int i(0); i<d->DataCount; ++i)
+    {
+        if ( !attributes[i].isNull() )
+        {
+            QVariant data = convertQStringToQVariant(attributes[i].toString(), values[i]);
+            if ( data.isValid() )
+                itemData[i] = data;
+        }
+    }
+    return itemData;
+}
+
+bool medDatabaseModel::isFetched(const medDataIndex& patient) const
+{
+    medDataIndex ptDataIndex = medDataIndex::makePatientIndex(patient.dataSourceId(), patient.patientId());
+    return d->fetchedPatients.contains(ptDataIndex);
+}
+
+/**
+ * Loads the studies and series of a patient for an update of one of them,
+ * and signals the updated items as if they had been added one by one.
+ */
+void medDatabaseModel::fetchForUpdate(const QModelIndex& ptIndex, const medDataIndex& dataIndex)
+{
+    fetchMore(ptIndex);
+    emit dataChanged(ptIndex, ptIndex);
+
+    medAbstractDatabaseItem *ptItem = d->item(ptIndex);
+    medDataIndex stDataIndex(dataIndex);
+    stDataIndex.setSeriesId(-1);
+
+    for (int i = 0; i < ptItem->childCount(); ++i)
+    {
+        medAbstractDatabaseItem *stItem = ptItem->child(i);
+        if (stItem->dataIndex() != stDataIndex)
+            continue;
+
+        //calling index() to update medIndexMap
+        QModelIndex stIndex = this->index(i, 0, ptIndex);
+        emit dataChanged(stIndex, stIndex);
+
+        for (int j = 0; dataIndex.isValidForSeries() && j < stItem->childCount(); ++j)
+        {
+            if (stItem->child(j)->dataIndex() == dataIndex)
+            {
+                QModelIndex seIndex = this->index(j, 0, stIndex);
+                emit dataChanged(seIndex, seIndex);
+            }
+        }
+        break;
+    }
+}
+
 void medDatabaseModel::changePersistenIndexAndSubIndex(QModelIndex index)
 {
     for(int i=0; i<columnCount(); i++)
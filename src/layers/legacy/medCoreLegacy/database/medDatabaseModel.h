@@ -63,11 +63,15 @@ public:
 
     bool hasChildren ( const QModelIndex & parent = QModelIndex() ) const;
 
+    bool canFetchMore(const QModelIndex& parent) const;
+    void fetchMore(const QModelIndex& parent);
+
 protected slots:
     void repopulate();
 
 protected:
     void populate(medAbstractDatabaseItem *parent);
+    QList<medAbstractDatabaseItem*> createStudyItems(medAbstractDatabaseItem *ptItem);
 
 private:
     medDatabaseModelPrivate *d;
@@ -80,5 +84,9 @@ private:
     void updateStudy(const medDataIndex&, bool updateChildren = true);
     void updatePatient(const medDataIndex&, bool updateChildren = true);
     QVariant convertQStringToQVariant(QString key, QString value);
+    QList<QVariant> itemData(const QList<QVariant>& attributes, const QList<QVariant>& defaultData, const QStringList& values);
+    QStringList attributeKeys(const QList<QVariant>& attributes) const;
+    bool isFetched(const medDataIndex& patient) const;
+    void fetchForUpdate(const QModelIndex& ptIndex, const medDataIndex& dataIndex);
     void changePersistenIndexAndSubIndex(QModelIndex index);
 };
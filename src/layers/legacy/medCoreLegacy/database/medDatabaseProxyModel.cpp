@@ -51,6 +51,17 @@ bool medDatabaseProxyModel::filterAcceptsColumn( int source_column, const QModel
 
 void medDatabaseProxyModel::setFilterRegExpWithColumn( const QRegExp &regExp, int column )
 {
+    // Filters look into the studies and series, load the ones of patients not expanded yet
+    if (!regExp.isEmpty())
+    {
+        for (int row = 0; row < sourceModel()->rowCount(); ++row)
+        {
+            QModelIndex patient = sourceModel()->index(row, 0);
+            if (sourceModel()->canFetchMore(patient))
+                sourceModel()->fetchMore(patient);
+        }
+    }
+
     filterVector[column] = regExp;
     invalidateFilter();
 }
@@ -187,12 +187,9 @@ void medDatabaseView::setModel(QAbstractItemModel *model)
 {
     QTreeView::setModel(model);
 
-    this->expandAll();
-    
-    
+    // sized from the header and the loaded rows, the patients being fetched on expansion
     this->header()->setMinimumSectionSize(60);
     this->header()->resizeSections(QHeaderView::ResizeToContents);
-    this->collapseAll();
 
     // we stopped using this signal as it is not being emitted after removing or saving an item (and the selection does change)
     //connect( this->selectionModel(), SIGNAL(currentChanged(const QModelIndex&, const QModelIndex&)), SLOT(onSelectionChanged(const QModelIndex&, const QModelIndex&)));
@@ -603,14 +600,19 @@ void medDatabaseView::onEditRequested()
 
         if(res == QDialog::Accepted)
         {
+            QList<medDataIndex> indexes;
+            QStringList keys, newValues;
             int i=0;
             for(QString label : labels)
             {
                 QVariant data = editDialog.value(label);
                 QVariant variant = item->attribute(i);
-                medDataManager::instance()->setMetadata(index, variant.toString(), data.toString());
+                indexes << index;
+                keys << variant.toString();
+                newValues << data.toString();
                 i++;    
             }
+            medDataManager::instance()->setMetadata(indexes, keys, newValues);
         } 
     }
 
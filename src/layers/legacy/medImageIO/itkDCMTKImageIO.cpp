@@ -21,6 +21,7 @@
 
 #include <dcmtk/dcmdata/dctk.h>
 #include <dcmtk/dcmdata/dcistrmf.h>
+#include <dcmtk/dcmdata/dcfcache.h>
 #include <dcmtk/ofstd/ofstdinc.h>
 #include <dcmtk/dcmimgle/dcmimage.h>
 
@@ -50,7 +51,8 @@ namespace itk
 
 double DCMTKImageIO::MAXIMUM_GAP = 999999;
 
-DCMTKImageIO::DCMTKImageIO()
+DCMTKImageIO::DCMTKImageIO() :
+    m_KeepParsedDatasets(false)
 {
     this->SetNumberOfDimensions(3);
     this->SetNumberOfComponents(1);
@@ -64,6 +66,7 @@ DCMTKImageIO::DCMTKImageIO()
 
 DCMTKImageIO::~DCMTKImageIO()
 {
+    this->ReleaseParsedDatasets();
     DcmRLEDecoderRegistration::cleanup();
     DJDecoderRegistration::cleanup();
 }
@@ -137,22 +140,54 @@ void DCMTKImageIO::ReadImageInformation()
     m_FilenameToIndexMap.clear();
     m_LocationToFilenamesMap.clear();
 
+    // forget the parsed files which are not part of this set
+    for (ParsedDatasetMapType::iterator it = m_ParsedDatasets.begin(); it != m_ParsedDatasets.end(); )
+    {
+        if (!m_KeepParsedDatasets || !fileNamesSet.count(it->first))
+        {
+            it = m_ParsedDatasets.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
     int fileIndex = 0;
 
-    /** The purpose of the next loop is to parse the DICOM header of each file and to store all
-     fields in the Dictionary. */
-    for (auto filename: fileNamesSet)
+    /** The purpose of the next loops is to parse the DICOM header of each file and to store all
+     fields in the Dictionary. Headers are parsed concurrently, and then stored one file after the
+     other in the order of the set, so the dictionary is the same as with a sequential parsing. */
+    const StringVectorType fileNames (fileNamesSet.begin(), fileNamesSet.end());
+    std::vector<ParsedHeader> headers (fileCount);
+
+    this->GetMultiThreaderBase()->SetNumberOfWorkUnits( this->GetNumberOfThreads() );
+    this->GetMultiThreaderBase()->ParallelizeArray( 0, fileCount, [this, &fileNames, &headers] (SizeValueType i)
     {
         try
         {
-            this->ReadHeader( filename, fileIndex, fileCount );
+            this->ParseHeader( fileNames[i], headers[i] );
         }
         catch (ExceptionObject &e)
         {
-            std::cerr << e; // continue to be robust to odd files
+            std::ostringstream oss;
+            oss << e;
+            headers[i].error = oss.str();
+        }
+    }, nullptr );
+
+    for (fileIndex = 0; fileIndex < fileCount; ++fileIndex)
+    {
+        if (headers[fileIndex].error.empty())
+        {
+            this->StoreHeader( fileNames[fileIndex], headers[fileIndex], fileIndex, fileCount );
+        }
+        else
+        {
+            std::cerr << headers[fileIndex].error; // continue to be robust to odd files
         }
-        ++fileIndex;
     }
+    headers.clear();
 
     /** Spacing between slices calculation (needs the dictionary to be filled)*/
 
@@ -376,17 +411,23 @@ void DCMTKImageIO::DetermineNumberOfPixelComponents()
 
 void DCMTKImageIO::DeterminePixelType()
 {
-    OFFilename dcmFileName(m_FileName, OFTrue);
     DcmFileFormat dicomFile;
-    OFCondition condition = dicomFile.loadFile(dcmFileName);
-    
+    DcmFileFormat *parsedFile = this->GetParsedDataset(m_FileName);
+    OFCondition condition = EC_Normal;
+    if (!parsedFile)
+    {
+        OFFilename dcmFileName(m_FileName, OFTrue);
+        condition = dicomFile.loadFile(dcmFileName);
+        parsedFile = &dicomFile;
+    }
+
     if (condition.bad())
     {
         this->SetComponentType(UNKNOWNCOMPONENTTYPE);
         return;
     }
 
-    DicomImage image(&dicomFile, EXS_Unknown, CIF_UseAbsolutePixelRange, 0, 0);
+    DicomImage image(parsedFile, EXS_Unknown, CIF_UseAbsolutePixelRange, 0, 0);
     if (condition.good())
     {
         if (image.getStatus() == EIS_Normal)
@@ -751,16 +792,28 @@ void DCMTKImageIO::InternalRead (void* buffer, int slice, unsigned long pixelCou
     std::string filename;
     filename = m_OrderedFileNames[slice];
 
-    OFFilename dcmFileName(filename, OFTrue);
-    DcmFileFormat dicomFile;
-
-    OFCondition cond = dicomFile.loadFile(dcmFileName, EXS_Unknown, EGL_noChange, DCM_MaxReadLength, ERM_autoDetect);
-    if (cond.bad())
+    // reuse the file parsed by ReadImageInformation if it was kept, its pixel data
+    // has not been loaded yet and will be read from its known position in the file
+    std::unique_ptr<DcmFileFormat> dicomFile;
+    ParsedDatasetMapType::iterator parsed = m_ParsedDatasets.find(filename);
+    if (parsed != m_ParsedDatasets.end() && parsed->second)
     {
-        itkExceptionMacro (<< cond.text() );
+        // each slice is read by one thread only, releasing our entry does not touch the others
+        dicomFile = std::move(parsed->second);
     }
+    else
+    {
+        OFFilename dcmFileName(filename, OFTrue);
+        dicomFile.reset(new DcmFileFormat);
 
-    E_TransferSyntax xfer = dicomFile.getDataset()->getOriginalXfer();
+        OFCondition cond = dicomFile->loadFile(dcmFileName, EXS_Unknown, EGL_noChange, DCM_MaxReadLength, ERM_autoDetect);
+        if (cond.bad())
+        {
+            itkExceptionMacro (<< cond.text() );
+        }
+    }
+
+    E_TransferSyntax xfer = dicomFile->getDataset()->getOriginalXfer();
 
     if( xfer == EXS_JPEG2000LosslessOnly ||
         xfer == EXS_JPEG2000 ||
@@ -805,8 +858,19 @@ void DCMTKImageIO::InternalRead (void* buffer, int slice, unsigned long pixelCou
             throw ExceptionObject (__FILE__,__LINE__,"Unsupported pixel data type in DICOM");
     }
 
+    Uint8* destBuffer = static_cast<Uint8*>(buffer);
+    if (!destBuffer)
+    {
+        itkExceptionMacro ( << "Bad copy or dest buffer" );
+    }
+
+    if (this->ReadRawPixelData(dicomFile->getDataset(), destBuffer + slice*length, length))
+    {
+        return;
+    }
+
     // We use DicomImage as it rescales the raw values properly for visualization
-    DicomImage image (&dicomFile, EXS_Unknown, CIF_UseAbsolutePixelRange | CIF_DecompressCompletePixelData);
+    DicomImage image (dicomFile.get(), EXS_Unknown, CIF_UseAbsolutePixelRange | CIF_DecompressCompletePixelData);
 
     if ( image.getStatus() != EIS_Normal)
     {
@@ -818,12 +882,6 @@ void DCMTKImageIO::InternalRead (void* buffer, int slice, unsigned long pixelCou
         itkExceptionMacro ( << "DiPixel object is null" );
     }
 
-    Uint8* destBuffer = static_cast<Uint8*>(buffer);
-    if (!destBuffer)
-    {
-        itkExceptionMacro ( << "Bad copy or dest buffer" );
-    }
-
     // If the image has more than one component, the DicomImage stores it as an
     // array of array, each sub-array containing all the pixels for one of the
     // components
@@ -860,6 +918,88 @@ void DCMTKImageIO::InternalRead (void* buffer, int slice, unsigned long pixelCou
 }
 
 
+/**
+   Copies the stored pixel values of an uncompressed slice straight into the destination buffer,
+   when they are known to be identical to the values DicomImage would compute: single component,
+   native encoding, all the bits allocated are stored, no modality transformation and the stored
+   type matches the component type of the volume. Returns false when DicomImage must be used.
+ */
+bool DCMTKImageIO::ReadRawPixelData(DcmDataset* dataSet, void* destBuffer, size_t length)
+{
+    DcmXfer xfer(dataSet->getOriginalXfer());
+    if (xfer.isEncapsulated() || xfer.getStreamCompression() != ESC_none)
+    {
+        return false;
+    }
+
+    Uint16 samplesPerPixel = 0, bitsAllocated = 0, bitsStored = 0, highBit = 0, pixelRepresentation = 0;
+    if (dataSet->findAndGetUint16(DCM_SamplesPerPixel, samplesPerPixel).bad() || samplesPerPixel != 1 ||
+        dataSet->findAndGetUint16(DCM_BitsAllocated, bitsAllocated).bad() ||
+        dataSet->findAndGetUint16(DCM_BitsStored, bitsStored).bad() || bitsStored != bitsAllocated ||
+        dataSet->findAndGetUint16(DCM_HighBit, highBit).bad() || highBit != bitsStored - 1 ||
+        dataSet->findAndGetUint16(DCM_PixelRepresentation, pixelRepresentation).bad())
+    {
+        return false;
+    }
+
+    OFString photometricInterpretation;
+    dataSet->findAndGetOFString(DCM_PhotometricInterpretation, photometricInterpretation);
+    if (photometricInterpretation != "MONOCHROME2")
+    {
+        return false;
+    }
+
+    Float64 rescaleSlope = 1.0, rescaleIntercept = 0.0;
+    dataSet->findAndGetFloat64(DCM_RescaleSlope, rescaleSlope);
+    dataSet->findAndGetFloat64(DCM_RescaleIntercept, rescaleIntercept);
+    Sint32 numberOfFrames = 1;
+    dataSet->findAndGetSint32(DCM_NumberOfFrames, numberOfFrames);
+    if (rescaleSlope != 1.0 || rescaleIntercept != 0.0 || numberOfFrames > 1 ||
+        dataSet->tagExists(DCM_ModalityLUTSequence))
+    {
+        return false;
+    }
+
+    IOComponentType storedType = UNKNOWNCOMPONENTTYPE;
+    switch (bitsAllocated)
+    {
+        case 8:
+            storedType = pixelRepresentation ? CHAR : UCHAR;
+            break;
+        case 16:
+            storedType = pixelRepresentation ? SHORT : USHORT;
+            break;
+        case 32:
+            storedType = pixelRepresentation ? INT : UINT;
+            break;
+        default:
+            break;
+    }
+    if (storedType != this->GetComponentType())
+    {
+        return false;
+    }
+
+    DcmElement* pixelData = nullptr;
+    if (dataSet->findAndGetElement(DCM_PixelData, pixelData).bad() || !pixelData ||
+        pixelData->getLength() < length)
+    {
+        return false;
+    }
+
+    // reads the value from its position in the file if it has not been loaded,
+    // swapping bytes to the local byte order when needed
+    DcmFileCache fileCache;
+    return pixelData->getPartialValue(destBuffer, 0, static_cast<Uint32>(length), &fileCache).good();
+}
+
+
+void DCMTKImageIO::ReleaseParsedDatasets()
+{
+    m_ParsedDatasets.clear();
+}
+
+
 std::string DCMTKImageIO::GetPatientName() const
 {
     std::string name = this->GetMetaDataValueString ( "(0010,0010)", 0 );
@@ -1066,17 +1206,49 @@ DCMTKImageIO
 {
 }
 
+DcmFileFormat* DCMTKImageIO::GetParsedDataset( const std::string& name ) const
+{
+    ParsedDatasetMapType::const_iterator it = m_ParsedDatasets.find(name);
+    if (it != m_ParsedDatasets.end())
+    {
+        return it->second.get();
+    }
+    return nullptr;
+}
+
+
 void DCMTKImageIO::ReadHeader(const std::string& name, const int& fileIndex, const int& fileCount )
 {
-    OFFilename dcmFileName(name, OFTrue);
-    DcmFileFormat dicomFile;
-    OFCondition condition = dicomFile.loadFile(dcmFileName);
+    ParsedHeader header;
+    this->ParseHeader( name, header );
+    this->StoreHeader( name, header, fileIndex, fileCount );
+}
 
-    // checking that given file is available
-    if ( !condition.good() )
+
+/**
+   Parses the DICOM header of a file into a list of (tag, value) pairs, without touching
+   the dictionary nor the kept datasets, so that several files may be parsed concurrently.
+ */
+void DCMTKImageIO::ParseHeader(const std::string& name, ParsedHeader& header ) const
+{
+    DcmFileFormat *parsedFile = this->GetParsedDataset(name);
+    if (!parsedFile)
     {
-        itkExceptionMacro ( << condition.text() );
+        OFFilename dcmFileName(name, OFTrue);
+        header.file.reset(new DcmFileFormat);
+        OFCondition condition = header.file->loadFile(dcmFileName);
+
+        // checking that given file is available
+        if ( !condition.good() )
+        {
+            header.file.reset();
+            itkExceptionMacro ( << condition.text() );
+        }
+        parsedFile = header.file.get();
     }
+    DcmFileFormat &dicomFile = *parsedFile;
+
+    TagAndValueType tagAndValue;
 
     // reading meta info
     DcmMetaInfo* metaInfo = dicomFile.getMetaInfo();
@@ -1085,9 +1257,9 @@ void DCMTKImageIO::ReadHeader(const std::string& name, const int& fileIndex, con
         DcmElement* element = metaInfo->getElement( e );
 
         DcmPixelData* pixelData = dynamic_cast<DcmPixelData*>(element);
-        if (!pixelData) // don't want to read PixData right now
+        if (!pixelData && this->ReadDicomElement( element, tagAndValue )) // don't want to read PixData right now
         {
-            this->ReadDicomElement( element, fileIndex, fileCount );
+            header.elements.push_back( tagAndValue );
         }
     }
 
@@ -1097,57 +1269,72 @@ void DCMTKImageIO::ReadHeader(const std::string& name, const int& fileIndex, con
     {
         DcmElement* element = dataSet->getElement( e );
         DcmPixelData* pixelData = dynamic_cast<DcmPixelData*>(element);
-        if (!pixelData) // don't want to read PixData right now
+        if (!pixelData && this->ReadDicomElement( element, tagAndValue )) // don't want to read PixData right now
         {
-            this->ReadDicomElement( element, fileIndex, fileCount );
+            header.elements.push_back( tagAndValue );
         }
     }
+
+    // the dataset, pixel data included, is only held until it is stored when it is kept
+    if (!m_KeepParsedDatasets)
+    {
+        header.file.reset();
+    }
 }
 
 
-inline void DCMTKImageIO::ReadDicomElement(DcmElement* element, const int &fileIndex, const int &fileCount )
+void DCMTKImageIO::StoreHeader(const std::string& name, ParsedHeader& header, const int& fileIndex, const int& fileCount )
 {
+    MetaDataDictionary& dicomDictionary = this->GetMetaDataDictionary();
 
-    DcmTag &dicomTag = const_cast<DcmTag &>(element->getTag());
-
-    std::string tagName   = dicomTag.getTagName();
-    std::string tagVRName = dicomTag.getVRName();
-
-    Uint16 tagGroup   = dicomTag.getGTag();
-    Uint16 tagElement = dicomTag.getETag();
-
-    std::ostringstream oss;
-    oss << '(' << std::hex << std::setw( 4 ) << std::setfill( '0' )<< tagGroup << ','
-        << std::hex << std::setw( 4 ) << std::setfill( '0' ) << tagElement << ")";
-    std::string tagKey = oss.str();
-
+    for (auto &tagAndValue : header.elements)
+    {
+        MetaDataDictionary::Iterator it = dicomDictionary.Find (tagAndValue.first);
+        if (it!=dicomDictionary.End())
+        {
+            MetaDataVectorStringType* vec = dynamic_cast<MetaDataVectorStringType*>( it->second.GetPointer() );
+            StringVectorType& value = const_cast< StringVectorType& >(vec->GetMetaDataObjectValue());
+            value[fileIndex] = tagAndValue.second;
+        }
+        else
+        {
+            StringVectorType vec (fileCount, "");
+            vec[fileIndex] = tagAndValue.second;
+            EncapsulateMetaData< StringVectorType >(dicomDictionary, tagAndValue.first, vec);
+        }
+    }
+    header.elements.clear();
 
-    MetaDataDictionary& dicomDictionary = this->GetMetaDataDictionary();
+    if (header.file)
+    {
+        m_ParsedDatasets[name] = std::move(header.file);
+    }
+}
 
 
+inline bool DCMTKImageIO::ReadDicomElement(DcmElement* element, TagAndValueType& tagAndValue ) const
+{
     OFString ofstring;
     OFCondition cond = element->getOFStringArray (ofstring, 0);
     if ( cond.bad() )
     {
-        return;
+        return false;
     }
 
-    std::string s_value = ofstring.c_str();
-    std::replace(s_value.begin(), s_value.end(), '\\', ' ');
+    const DcmTag &dicomTag = element->getTag();
 
-    MetaDataDictionary::Iterator it = dicomDictionary.Find (tagKey);
-    if (it!=dicomDictionary.End())
-    {
-        MetaDataVectorStringType* vec = dynamic_cast<MetaDataVectorStringType*>( it->second.GetPointer() );
-        StringVectorType& value = const_cast< StringVectorType& >(vec->GetMetaDataObjectValue());
-        value[fileIndex] = s_value;
-    }
-    else
-    {
-        StringVectorType vec (fileCount, "");
-        vec[fileIndex] = s_value;
-        EncapsulateMetaData< StringVectorType >(dicomDictionary, tagKey, vec);
-    }
+    Uint16 tagGroup   = dicomTag.getGTag();
+    Uint16 tagElement = dicomTag.getETag();
+
+    std::ostringstream oss;
+    oss << '(' << std::hex << std::setw( 4 ) << std::setfill( '0' )<< tagGroup << ','
+        << std::hex << std::setw( 4 ) << std::setfill( '0' ) << tagElement << ")";
+    tagAndValue.first = oss.str();
+
+    tagAndValue.second = ofstring.c_str();
+    std::replace(tagAndValue.second.begin(), tagAndValue.second.end(), '\\', ' ');
+
+    return true;
 }
 
 }
@@ -22,12 +22,15 @@
 #include <medImageIOExport.h>
 
 #include <map>
+#include <memory>
 #include <vector>
 #include <set>
 #include <functional>
 
 
+class DcmDataset;
 class DcmElement;
+class DcmFileFormat;
 
 class double_fuzzy_less
 {
@@ -73,6 +76,18 @@ public:
 
     static double MAXIMUM_GAP;
 
+    /**
+       When on, the files parsed by ReadImageInformation are kept until their pixels are read,
+       so that neither a second ReadImageInformation on the same files nor Read parse them again.
+       Pixel data is not loaded by the header pass, only its position in the file. Off by default,
+       as the parsed files are kept in memory until Read or ReleaseParsedDatasets is called.
+     */
+    itkSetMacro (KeepParsedDatasets, bool)
+    itkGetConstMacro (KeepParsedDatasets, bool)
+    itkBooleanMacro (KeepParsedDatasets)
+
+    void ReleaseParsedDatasets();
+
     bool CanReadFile(const char*)  override;
     void ReadImageInformation()    override;
 
@@ -166,6 +181,7 @@ protected:
 
     void ThreadedRead (void* buffer, RegionType region, int threadId) override;
     void InternalRead (void* buffer, int slice, unsigned long pixelCount);
+    bool ReadRawPixelData (DcmDataset* dataSet, void* destBuffer, size_t length);
 
     void SwapBytesIfNecessary(void* buffer, unsigned long numberOfPixels);
 
@@ -188,8 +204,20 @@ protected:
     double GetZPositionForImage (int);
     double GetSliceLocation(std::string);
 
+    typedef std::pair<std::string, std::string> TagAndValueType;
+
+    struct ParsedHeader
+    {
+        std::vector<TagAndValueType>   elements;
+        std::unique_ptr<DcmFileFormat> file;  // set when the file was loaded by this parsing
+        std::string                    error; // set when the file could not be parsed
+    };
+
     void ReadHeader( const std::string& name, const int& fileIndex, const int& fileCount );
-    inline void ReadDicomElement(DcmElement* element, const int &fileIndex, const int &fileCount );
+    void ParseHeader( const std::string& name, ParsedHeader& header ) const;
+    void StoreHeader( const std::string& name, ParsedHeader& header, const int& fileIndex, const int& fileCount );
+    DcmFileFormat* GetParsedDataset( const std::string& name ) const;
+    inline bool ReadDicomElement(DcmElement* element, TagAndValueType& tagAndValue ) const;
 
 private:
     DCMTKImageIO(const Self&);
@@ -203,6 +231,11 @@ private:
     SliceLocationToNamesMultiMapType m_LocationToFilenamesMap;
 
     StringVectorType           m_EmptyVector;
+
+    typedef std::map< std::string, std::unique_ptr<DcmFileFormat> > ParsedDatasetMapType;
+
+    bool                       m_KeepParsedDatasets;
+    ParsedDatasetMapType       m_ParsedDatasets;
 };
 
 } // end of namespace
@@ -16,10 +16,15 @@
 #include <itkExceptionObject.h>
 #include <itkByteSwapper.h>
 #include <itkImageIOBase.h>
+#include <itkMultiThreaderBase.h>
+#include <itksys/FStream.hxx>
 
 #include <qmath.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <fstream>
 
 #if defined(_WIN32) && (defined(_MSC_VER) || defined(__BORLANDC__))
@@ -120,6 +125,105 @@ static std::string GetRootName(const std::string& filename)
     }
 }
 
+//
+// Block compression
+//
+// The header and the image data cut in blocks of a fixed size are written as
+// independent gzip members, so that gzip still reads them as one stream. An
+// empty last member holds in its extra field 'MX' the offsets of all members,
+// the block size, the number of members before it and a magic, so that it can
+// be found from the end of the file.
+//
+static const unsigned long long BlockSizeMinimum = 256 * 1024;
+static const unsigned long long BlockCountMaximum = 8000; // the offsets must fit a 64 KiB extra field
+static const char BlockIndexMagic[4] = { 'M', 'I', 'B', 'X' };
+static const unsigned int BlockIndexTailSize = 22; // block size, count, magic, empty deflate block and trailer
+
+static void PutLittleEndian(std::string& s, unsigned long long value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i)
+    {
+        s += static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+}
+
+static unsigned long long GetLittleEndian(const unsigned char *p, int bytes)
+{
+    unsigned long long value = 0;
+    for (int i = bytes - 1; i >= 0; --i)
+    {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+static bool CompressMember(const char *data, unsigned long long length, std::string& member)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        return false;
+    }
+
+    member.resize(deflateBound(&stream, static_cast<uLong>(length)));
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream.avail_in = static_cast<uInt>(length);
+    stream.next_out = reinterpret_cast<Bytef *>(&member[0]);
+    stream.avail_out = static_cast<uInt>(member.size());
+
+    const int status = deflate(&stream, Z_FINISH);
+    member.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    return status == Z_STREAM_END;
+}
+
+static bool InflateMember(const std::string& member, char *output, unsigned long long length)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+    {
+        return false;
+    }
+
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(member.data()));
+    stream.avail_in = static_cast<uInt>(member.size());
+    stream.next_out = reinterpret_cast<Bytef *>(output);
+    stream.avail_out = static_cast<uInt>(length);
+
+    const int status = inflate(&stream, Z_FINISH);
+    const bool complete = (status == Z_STREAM_END && stream.total_out == length);
+    inflateEnd(&stream);
+
+    return complete;
+}
+
+static std::string BlockIndexMember(const std::vector<unsigned long long>& offsets, unsigned long long blockSize)
+{
+    std::string index;
+    for (unsigned long long offset : offsets)
+    {
+        PutLittleEndian(index, offset, 8);
+    }
+    PutLittleEndian(index, blockSize, 4);
+    PutLittleEndian(index, offsets.size() - 1, 4);
+    index.append(BlockIndexMagic, 4);
+
+    // gzip header with FEXTRA, no time, unknown OS
+    std::string member("\x1f\x8b\x08\x04\0\0\0\0\0\xff", 10);
+    PutLittleEndian(member, index.size() + 4, 2);
+    member += "MX";
+    PutLittleEndian(member, index.size(), 2);
+    member += index;
+
+    // empty final deflate block, then crc and size of no data
+    member.append("\x03\0", 2);
+    member.append(8, '\0');
+    return member;
+}
+
 
 // Default constructor
 InrimageImageIO::InrimageImageIO()
@@ -150,6 +254,11 @@ InrimageImageIO::InrimageImageIO()
     //length of header of a multiple of 256
     m_NumberBlocksInHeader = 1;
 
+    m_UseBlockCompression = true;
+    m_IsCompressed = true;
+    m_BlockSize = 0;
+    m_PayloadWritten = 0;
+
 }
 
 
@@ -166,6 +275,8 @@ void InrimageImageIO::PrintSelf(std::ostream& os, itk::Indent indent) const
     Superclass::PrintSelf(os, indent);
     os << "LOCAL PARAMETERS" << std::endl;
     os << indent << "hdr=" << m_NumberBlocksInHeader << std::endl;
+    os << indent << "UseBlockCompression=" << m_UseBlockCompression << std::endl;
+    os << indent << "Blocks=" << m_BlockOffsets.size() << std::endl;
     os << "GLOBAL PARAMETERS" << std::endl;
     os << indent << "ByteOrder=" << m_ByteOrder << std::endl;
     os << indent << "PixelType " << m_PixelType << std::endl;
@@ -730,6 +841,9 @@ void InrimageImageIO::ReadImageInformation()
         }
     }
 
+    // block compressed files come with an index of their gzip members
+    this->ReadBlockIndex();
+
     return;
 }
 
@@ -737,8 +851,6 @@ void InrimageImageIO::ReadImageInformation()
 
 void InrimageImageIO::Read(void* buffer)
 {
-    unsigned int nread;
-
     if (0) {
         std::cerr << "* ComponentType " << this->GetComponentType() << std::endl;
         std::cerr << "PixelType ";
@@ -753,37 +865,22 @@ void InrimageImageIO::Read(void* buffer)
         std::cerr << std::endl;
     }
 
-    m_file = universal_GzOpen(m_FileName.c_str(), "rb");
-    if (m_file == NULL) {
-        itk::ExceptionObject exception(__FILE__, __LINE__);
-        exception.SetDescription("Unable to open file");
-        throw exception;
-    }
-
-    char buf_header[257];
-    for (unsigned int i = 0; i < m_NumberBlocksInHeader; i++) {
-        nread = ::gzread(m_file, buf_header, 256);
-        if (nread != 256) {
-            ::gzclose(m_file);
-            itk::ExceptionObject exception(__FILE__, __LINE__);
-            exception.SetDescription("Unable to skip header");
-            throw exception;
-        }
-    }
+    const std::vector<Run> runs = this->GetIORegionRuns();
 
     char * p = static_cast<char *>(buffer);
-    nread = ::gzread(m_file, p, this->GetImageSizeInBytes() + 10000);
-    if (nread != this->GetImageSizeInBytes()) {
-        ::gzclose(m_file);
-        itk::ExceptionObject exception(__FILE__, __LINE__);
-        exception.SetDescription("Unable to read buffer");
-        throw exception;
-    }
+    if (!m_BlockOffsets.empty())
+        this->ReadBlocks(p, runs);
+    else
+        this->ReadStream(p, runs);
 
-    ::gzclose(m_file);
+    SwapBytesIfNecessary(buffer, m_IORegion.GetNumberOfPixels() * this->GetNumberOfComponents());
 
-    SwapBytesIfNecessary(buffer, this->GetImageSizeInComponents());
+}
 
+bool InrimageImageIO::CanStreamRead()
+{
+    // known once ReadImageInformation() looked for the block index
+    return !m_IsCompressed || !m_BlockOffsets.empty();
 }
 
 bool InrimageImageIO::CanWriteFile(const char * FileNameToWrite)
@@ -806,35 +903,165 @@ void InrimageImageIO::WriteImageInformation(void)
     return;
 }
 
+bool InrimageImageIO::CanStreamWrite()
+{
+    return !(GetExtension(m_FileName) == ".inr.gz" && !m_UseBlockCompression);
+}
+
 void
 InrimageImageIO
 ::Write(const void* buffer)
 {
-
-    // try to open the file
-    bool isGz = true;
     std::string fileExt = GetExtension(m_FileName);
-    // if it doesn't work, try by substracting extension .gz
-    if (fileExt == (".inr.gz"))
+    if (fileExt != ".inr.gz" && fileExt != ".inr")
+        throw itk::ExceptionObject(__FILE__, __LINE__, "Unrecognized extension.");
+
+    const bool isGz = (fileExt == ".inr.gz");
+    const bool isBlock = isGz && m_UseBlockCompression;
+
+    // the region is written after the previous one, or starts the file
+    const std::vector<Run> runs = this->GetIORegionRuns();
+    if (runs.size() > 1)
+        throw itk::ExceptionObject(__FILE__, __LINE__, "Error: the region to write is not contiguous in the file.");
+
+    const unsigned long long offset = runs.empty() ? 0 : runs.front().fileOffset;
+    const unsigned long long length = runs.empty() ? 0 : runs.front().length;
+    const bool isFirst = (offset == 0);
+    const bool isLast = (offset + length == this->GetImageSizeInBytes());
+
+    if (!isFirst && (!this->CanStreamWrite() || offset != m_PayloadWritten))
+        throw itk::ExceptionObject(__FILE__, __LINE__, "Error: regions must be written in order.");
+
+    const char *data = static_cast<const char *>(buffer);
+
+    if (isGz && !isBlock)
     {
+        if (!isLast)
+            throw itk::ExceptionObject(__FILE__, __LINE__, "Error: the whole image must be written at once.");
+
+        const std::string header = this->BuildHeader();
+
         m_file = universal_GzOpen(m_FileName.c_str(), "wb");
         if (m_file == NULL)
             throw itk::ExceptionObject(__FILE__, __LINE__, "Error in opening file for writing");
+
+        if (::gzwrite(m_file, (void *)header.data(), header.size()) != (int)header.size())
+        {
+            ::gzclose(m_file);
+            throw itk::ExceptionObject(__FILE__, __LINE__, "Error: bad number of bytes written.");
+        }
+
+        // write the buffer:
+        unsigned long long remaining = length;
+        while (remaining > 0)
+        {
+            const unsigned int chunk = static_cast<unsigned int>(std::min<unsigned long long>(remaining, 1U << 30));
+            if (::gzwrite(m_file, (void *)data, chunk) != (int)chunk)
+            {
+                ::gzclose(m_file);
+                throw itk::ExceptionObject(__FILE__, __LINE__, "Error: bad number of bytes written.");
+            }
+            data += chunk;
+            remaining -= chunk;
+        }
+
+        ::gzclose(m_file);
+        m_PayloadWritten = length;
+        return;
     }
-    else
+
+    itksys::ofstream file(m_FileName.c_str(), std::ios::out | std::ios::binary | (isFirst ? std::ios::trunc : std::ios::app));
+    if (!file)
+        throw itk::ExceptionObject(__FILE__, __LINE__, "Error in opening file for writing");
+
+    if (isFirst)
     {
-        if (fileExt == (".inr"))
+        const std::string header = this->BuildHeader();
+        m_PayloadWritten = 0;
+
+        if (isBlock)
         {
-            isGz = false;
-            m_file = gzopen(m_FileName.c_str(), "wb");
-            if (m_file == NULL)
-                throw itk::ExceptionObject(__FILE__, __LINE__, "Error in opening file for writing");
+            // blocks large enough for the index to fit its extra field
+            const unsigned long long step = 64 * 1024;
+            const unsigned long long blocks = (this->GetImageSizeInBytes() + BlockCountMaximum - 1) / BlockCountMaximum;
+            m_BlockSize = std::max(BlockSizeMinimum, (blocks + step - 1) / step * step);
+            m_PendingPayload.clear();
+
+            std::string member;
+            if (!CompressMember(header.data(), header.size(), member))
+                throw itk::ExceptionObject(__FILE__, __LINE__, "Error: cannot compress the header.");
+
+            file.write(member.data(), member.size());
+            m_WrittenBlockOffsets.assign(1, 0);
+            m_WrittenBlockOffsets.push_back(member.size());
         }
         else
-            throw itk::ExceptionObject(__FILE__, __LINE__, "Unrecognized extension.");
+        {
+            file.write(header.data(), header.size());
+        }
+    }
+
+    if (isBlock)
+        this->WriteBlocks(file, data, length, isLast);
+    else
+        file.write(data, length);
+
+    if (!file)
+        throw itk::ExceptionObject(__FILE__, __LINE__, "Error: bad number of bytes written.");
+
+    m_PayloadWritten = offset + length;
+}
+
+
+/************************************************************
+ *
+ * private methods
+ *
+ ************************************************************/
+
+std::vector<InrimageImageIO::Run> InrimageImageIO::GetIORegionRuns() const
+{
+    // image data is x fastest, then y, then z
+    const unsigned long long pixelSize = this->GetPixelSize();
+    unsigned long long dimensions[3] = { 1, 1, 1 };
+    unsigned long long index[3] = { 0, 0, 0 };
+    unsigned long long size[3] = { 1, 1, 1 };
+    for (unsigned int i = 0; i < 3 && i < this->GetNumberOfDimensions() && i < m_IORegion.GetImageDimension(); ++i)
+    {
+        dimensions[i] = this->GetDimensions(i);
+        index[i] = m_IORegion.GetIndex(i);
+        size[i] = m_IORegion.GetSize(i);
     }
 
+    std::vector<Run> runs;
+    const unsigned long long rowLength = size[0] * pixelSize;
+    if (rowLength == 0)
+        return runs;
+
+    // rows following each other in the file are merged
+    unsigned long long bufferOffset = 0;
+    for (unsigned long long z = index[2]; z < index[2] + size[2]; ++z)
+    {
+        for (unsigned long long y = index[1]; y < index[1] + size[1]; ++y)
+        {
+            const unsigned long long fileOffset = ((z * dimensions[1] + y) * dimensions[0] + index[0]) * pixelSize;
+            if (!runs.empty() && runs.back().fileOffset + runs.back().length == fileOffset)
+            {
+                runs.back().length += rowLength;
+            }
+            else
+            {
+                Run run = { fileOffset, bufferOffset, rowLength };
+                runs.push_back(run);
+            }
+            bufferOffset += rowLength;
+        }
+    }
+    return runs;
+}
 
+std::string InrimageImageIO::BuildHeader()
+{
     std::string type = "signed fixed";
     char scale[20];
     switch (this->GetComponentType())
@@ -940,7 +1167,7 @@ InrimageImageIO
     if (vz < 1e-9)
         vz = 1.0;
 
-    /* write header information */
+    /* header information */
     sprintf(buf, "#INRIMAGE-4#{\nXDIM=%lu\nYDIM=%lu\nZDIM=%lu\nVDIM=%d\nTYPE=%s\nPIXSIZE=%i bits\n%sCPU=%s\nVX=%f\nVY=%f\nVZ=%f\nTX=%f\nTY=%f\nTZ=%f\nRX=%f\nRY=%f\nRZ=%f\n#GEOMETRY=CARTESIAN\n",
             this->GetDimensions(0), this->GetDimensions(1), this->GetDimensions(2), this->GetNumberOfComponents(),
             type.c_str(), pixsize, scale, endianness.c_str(),
@@ -948,98 +1175,268 @@ InrimageImageIO
             this->GetOrigin(0), this->GetOrigin(1), this->GetOrigin(2),
             r[0], r[1], r[2]);
 
-    int pos = strlen(buf);
-    size_t npix = 0;
-    // write the header:
-    if (isGz)
-        npix = ::gzwrite(m_file, (void *)buf, pos);
-    else
-        npix = fwrite((void *)buf, 1, pos, (FILE*)m_file);
+    std::string header = buf;
 
-    if (npix != strlen(buf))
+    /* end of header, padded to a multiple of 256 */
+    int pos = header.size() % 256;
+    if (pos > 252) {
+        header.append(256 - pos, '\n');
+        pos = 0;
+    }
+    header.append(252 - pos, '\n');
+    header += "##}\n";
+
+    return header;
+}
+
+void InrimageImageIO::ReadBlockIndex()
+{
+    m_IsCompressed = false;
+    m_BlockSize = 0;
+    m_BlockOffsets.clear();
+
+    itksys::ifstream file(m_FileName.c_str(), std::ios::in | std::ios::binary);
+    unsigned char magic[2] = { 0, 0 };
+    if (!file.read(reinterpret_cast<char *>(magic), 2) || magic[0] != 0x1f || magic[1] != 0x8b)
+        return;
+    m_IsCompressed = true;
+
+    // the index member is found from the end of the file
+    file.seekg(0, std::ios::end);
+    const unsigned long long fileSize = file.tellg();
+    if (fileSize < BlockIndexTailSize)
+        return;
+
+    unsigned char tail[BlockIndexTailSize];
+    file.seekg(fileSize - BlockIndexTailSize);
+    if (!file.read(reinterpret_cast<char *>(tail), BlockIndexTailSize)
+            || memcmp(tail + 8, BlockIndexMagic, 4) != 0
+            || memcmp(tail + 12, "\x03\0\0\0\0\0\0\0\0\0", 10) != 0)
+        return;
+
+    const unsigned long long blockSize = GetLittleEndian(tail, 4);
+    const unsigned long long count = GetLittleEndian(tail + 4, 4);
+    const unsigned long long indexSize = 8 * (count + 1) + 12;
+    const unsigned long long memberSize = 16 + indexSize + 10;
+    if (blockSize == 0 || count == 0 || indexSize + 4 > 65535 || memberSize > fileSize)
+        return;
+
+    std::vector<unsigned char> member(memberSize);
+    file.seekg(fileSize - memberSize);
+    if (!file.read(reinterpret_cast<char *>(member.data()), memberSize)
+            || memcmp(member.data(), "\x1f\x8b\x08\x04", 4) != 0
+            || member[12] != 'M' || member[13] != 'X')
+        return;
+
+    std::vector<unsigned long long> offsets(count + 1);
+    for (unsigned long long i = 0; i <= count; ++i)
     {
-        if (isGz)
-            ::gzclose(m_file);
-        else
-            fclose((FILE*)m_file);
-        throw itk::ExceptionObject(__FILE__, __LINE__, "Error: bad number of bytes written.");
+        offsets[i] = GetLittleEndian(&member[16 + 8 * i], 8);
+        if ((i == 0 && offsets[i] != 0) || (i > 0 && offsets[i] <= offsets[i - 1]))
+            return;
     }
 
-    /* write end of header */
-    pos = pos % 256;
-    if (pos > 252) {
-        for (int i = pos; i < 256; i++)
-            if (isGz)
-            {
-                if (::gzwrite(m_file, (void *)("\n"), 1) != 1)
-                {
-                    ::gzclose(m_file);
-                    throw itk::ExceptionObject(__FILE__, __LINE__, "Error: bad number of bytes written.");
-                }
-            }
-            else
-            {
-                if (fwrite((void *)("\n"), 1, 1, (FILE*)m_file) != 1)
-                {
-                    fclose((FILE*)m_file);
-                    throw itk::ExceptionObject(__FILE__, __LINE__, "Error: bad number of bytes written.");
-                }
-            }
+    // the header member, then the blocks of image data
+    const unsigned long long blocks = (this->GetImageSizeInBytes() + blockSize - 1) / blockSize;
+    if (offsets[count] != fileSize - memberSize || count != blocks + 1)
+        return;
 
-        pos = 0;
+    m_BlockSize = blockSize;
+    m_BlockOffsets.swap(offsets);
+}
+
+void InrimageImageIO::ReadStream(char *buffer, const std::vector<Run>& runs)
+{
+    // gzread reads uncompressed files as well, and gzseek seeks in them
+    m_file = universal_GzOpen(m_FileName.c_str(), "rb");
+    if (m_file == NULL) {
+        itk::ExceptionObject exception(__FILE__, __LINE__);
+        exception.SetDescription("Unable to open file");
+        throw exception;
     }
-    buf[0] = '\0';
-    for (int i = pos; i < 252; i++) strcat(buf, "\n");
-    strcat(buf, "##}\n");
 
-    if (isGz)
+    unsigned long long position = 0;
+    for (const Run& run : runs)
     {
-        if (::gzwrite(m_file, (void *)buf, strlen(buf)) != (int)(strlen(buf)))
+        const unsigned long long target = 256ULL * m_NumberBlocksInHeader + run.fileOffset;
+        while (position < target)
         {
-            ::gzclose(m_file);
-            throw itk::ExceptionObject(__FILE__, __LINE__, "Error: bad number of bytes written.");
+            const unsigned long long step = std::min<unsigned long long>(target - position, 1U << 30);
+            if (::gzseek(m_file, static_cast<z_off_t>(step), SEEK_CUR) < 0) {
+                ::gzclose(m_file);
+                itk::ExceptionObject exception(__FILE__, __LINE__);
+                exception.SetDescription("Unable to skip header");
+                throw exception;
+            }
+            position += step;
+        }
+
+        char *p = buffer + run.bufferOffset;
+        unsigned long long remaining = run.length;
+        while (remaining > 0)
+        {
+            const unsigned int chunk = static_cast<unsigned int>(std::min<unsigned long long>(remaining, 1U << 30));
+            if (::gzread(m_file, p, chunk) != (int)chunk) {
+                ::gzclose(m_file);
+                itk::ExceptionObject exception(__FILE__, __LINE__);
+                exception.SetDescription("Unable to read buffer");
+                throw exception;
+            }
+            p += chunk;
+            remaining -= chunk;
         }
+        position += run.length;
     }
-    else
+
+    ::gzclose(m_file);
+}
+
+void InrimageImageIO::ReadBlocks(char *buffer, const std::vector<Run>& runs)
+{
+    // blocks holding a part of the region, in order as runs are
+    std::vector<unsigned long long> blocks;
+    for (const Run& run : runs)
+    {
+        const unsigned long long last = (run.fileOffset + run.length - 1) / m_BlockSize;
+        for (unsigned long long b = run.fileOffset / m_BlockSize; b <= last; ++b)
+            if (blocks.empty() || blocks.back() < b)
+                blocks.push_back(b);
+    }
+
+    itksys::ifstream file(m_FileName.c_str(), std::ios::in | std::ios::binary);
+    if (!file) {
+        itk::ExceptionObject exception(__FILE__, __LINE__);
+        exception.SetDescription("Unable to open file");
+        throw exception;
+    }
+
+    const unsigned long long payloadSize = this->GetImageSizeInBytes();
+    itk::MultiThreaderBase::Pointer threader = itk::MultiThreaderBase::New();
+    const size_t batchSize = 4 * threader->GetMaximumNumberOfThreads();
+
+    // batches of blocks are read in order, then inflated in parallel
+    std::vector<std::string> members;
+    for (size_t first = 0; first < blocks.size(); first += batchSize)
     {
-        if (fwrite((void *)buf, 1, strlen(buf), (FILE*)m_file) != (size_t)(strlen(buf)))
+        const size_t count = std::min(batchSize, blocks.size() - first);
+        members.resize(count);
+        for (size_t i = 0; i < count; ++i)
         {
-            fclose((FILE*)m_file);
-            throw itk::ExceptionObject(__FILE__, __LINE__, "Error: bad number of bytes written.");
+            // member 0 is the header
+            const unsigned long long begin = m_BlockOffsets[blocks[first + i] + 1];
+            const unsigned long long end = m_BlockOffsets[blocks[first + i] + 2];
+            members[i].resize(end - begin);
+            file.seekg(begin);
+            if (!file.read(&members[i][0], end - begin)) {
+                itk::ExceptionObject exception(__FILE__, __LINE__);
+                exception.SetDescription("Unable to read buffer");
+                throw exception;
+            }
         }
-    }
 
+        std::atomic<bool> failed(false);
+        threader->ParallelizeArray(0, count, [&](itk::SizeValueType i)
+        {
+            const unsigned long long blockBegin = blocks[first + i] * m_BlockSize;
+            const unsigned long long blockEnd = std::min(blockBegin + m_BlockSize, payloadSize);
 
+            // first run ending in the block
+            std::vector<Run>::const_iterator run = std::partition_point(runs.begin(), runs.end(), [&](const Run& r)
+            {
+                return r.fileOffset + r.length <= blockBegin;
+            });
 
-    // write the buffer:
-    if (isGz)
-        npix = ::gzwrite(m_file, (void *)buffer, this->GetImageSizeInBytes());
-    else
-        npix = fwrite((void *)buffer, 1, this->GetImageSizeInBytes(), (FILE*)m_file);
-    if ((unsigned int)npix != this->GetImageSizeInBytes())
+            // a block within a run is inflated in place
+            if (run->fileOffset <= blockBegin && run->fileOffset + run->length >= blockEnd)
+            {
+                char *output = buffer + run->bufferOffset + (blockBegin - run->fileOffset);
+                if (!InflateMember(members[i], output, blockEnd - blockBegin))
+                    failed = true;
+                return;
+            }
+
+            std::vector<char> block(blockEnd - blockBegin);
+            if (!InflateMember(members[i], block.data(), block.size()))
+            {
+                failed = true;
+                return;
+            }
+            for (; run != runs.end() && run->fileOffset < blockEnd; ++run)
+            {
+                const unsigned long long begin = std::max(blockBegin, run->fileOffset);
+                const unsigned long long end = std::min(blockEnd, run->fileOffset + run->length);
+                memcpy(buffer + run->bufferOffset + (begin - run->fileOffset), block.data() + (begin - blockBegin), end - begin);
+            }
+        }, nullptr);
+
+        if (failed) {
+            itk::ExceptionObject exception(__FILE__, __LINE__);
+            exception.SetDescription("Unable to decompress buffer");
+            throw exception;
+        }
+    }
+}
+
+void InrimageImageIO::WriteBlocks(std::ostream& file, const char *buffer, unsigned long long length, bool isLast)
+{
+    // full blocks, starting with the bytes left by the previous region, and the last one
+    std::vector<std::pair<const char *, unsigned long long> > blocks;
+    std::string head;
+    if (!m_PendingPayload.empty())
     {
-        if (isGz)
-            ::gzclose(m_file);
-        else
-            fclose((FILE*)m_file);
-        throw itk::ExceptionObject(__FILE__, __LINE__, "Error: bad number of bytes written.");
+        const unsigned long long take = std::min(length, m_BlockSize - m_PendingPayload.size());
+        m_PendingPayload.append(buffer, take);
+        buffer += take;
+        length -= take;
+        if (m_PendingPayload.size() == m_BlockSize || isLast)
+        {
+            head.swap(m_PendingPayload);
+            blocks.push_back(std::make_pair(head.data(), static_cast<unsigned long long>(head.size())));
+        }
     }
+    while (length >= m_BlockSize || (isLast && length > 0))
+    {
+        const unsigned long long blockLength = std::min(length, m_BlockSize);
+        blocks.push_back(std::make_pair(buffer, blockLength));
+        buffer += blockLength;
+        length -= blockLength;
+    }
+    m_PendingPayload.append(buffer, length);
 
+    itk::MultiThreaderBase::Pointer threader = itk::MultiThreaderBase::New();
+    const size_t batchSize = 4 * threader->GetMaximumNumberOfThreads();
 
-    if (isGz)
-        ::gzclose(m_file);
-    else
-        fclose((FILE*)m_file);
+    // batches of blocks are compressed in parallel, then written in order
+    std::vector<std::string> members;
+    for (size_t first = 0; first < blocks.size(); first += batchSize)
+    {
+        const size_t count = std::min(batchSize, blocks.size() - first);
+        members.resize(count);
 
-}
+        std::atomic<bool> failed(false);
+        threader->ParallelizeArray(0, count, [&](itk::SizeValueType i)
+        {
+            if (!CompressMember(blocks[first + i].first, blocks[first + i].second, members[i]))
+                failed = true;
+        }, nullptr);
 
+        if (failed)
+            throw itk::ExceptionObject(__FILE__, __LINE__, "Error: cannot compress the buffer.");
 
+        for (size_t i = 0; i < count; ++i)
+        {
+            file.write(members[i].data(), members[i].size());
+            m_WrittenBlockOffsets.push_back(m_WrittenBlockOffsets.back() + members[i].size());
+        }
+    }
 
-/************************************************************
- *
- * private methods
- *
- ************************************************************/
+    if (isLast)
+    {
+        const std::string index = BlockIndexMember(m_WrittenBlockOffsets, m_BlockSize);
+        file.write(index.data(), index.size());
+        m_WrittenBlockOffsets.clear();
+    }
+}
 
 void InrimageImageIO::SwapBytesIfNecessary(void* buffer, unsigned long numberOfPixels)
 {
@@ -39,6 +39,9 @@
 #include <itkMetaDataObject.h>
 #include <itk_zlib.h>
 
+#include <string>
+#include <vector>
+
 /**
      * \author Gregoire Malandain
      * \brief Class that defines how to read Inrimage 4 file format.
@@ -57,6 +60,13 @@ public:
     /** Run-time type information (and related methods). */
     itkTypeMacro(InrimageImageIO, Superclass);
 
+    /** Write .inr.gz files as independent gzip members of fixed size followed by
+         * an index member. Standard gzip still reads them as one stream, and this
+         * reader decompresses them across threads and region by region. On by default. */
+    itkSetMacro(UseBlockCompression, bool);
+    itkGetConstMacro(UseBlockCompression, bool);
+    itkBooleanMacro(UseBlockCompression);
+
     /*-------- This part of the interfaces deals with reading data. ----- */
 
     /** Determine if the file can be read with this ImageIO implementation.
@@ -73,9 +83,13 @@ public:
     /** Convert to type_info */
     const std::type_info& ConvertToTypeInfo(IOPixelType) const;
 
-    /** Reads the data from disk into the memory buffer provided. */
+    /** Reads the data of the IO region from disk into the memory buffer provided. */
     virtual void Read(void* buffer);
 
+    /** Regions are read without the whole file: uncompressed and block
+         * compressed files seek to them, others cannot. */
+    bool CanStreamRead() override;
+
     /** Compute the size (in bytes) of the components of a pixel. For
          * example, and RGB pixel of unsigned char would have a
          * component size of 1 byte. NO MORE USEFUL FOR ITK > 1.8*/
@@ -95,9 +109,13 @@ public:
     virtual void WriteImageInformation();
 
     /** Writes the data to disk from the memory buffer provided. Make sure
-         * that the IORegions has been set properly. */
+         * that the IORegions has been set properly. When streaming, the regions
+         * must be written in order, as done by itk::ImageFileWriter. */
     void Write(const void* buffer) override;
 
+    /** Uncompressed and block compressed files can be written region by region. */
+    bool CanStreamWrite() override;
+
 protected:
     InrimageImageIO();
     ~InrimageImageIO();
@@ -110,10 +128,40 @@ private:
 
     void GetRotationAnglesFromMatrix(const vnl_matrix <double> &rotationMatrix, std::vector <double> &r);
 
+    /** A contiguous part of the IO region: offset in the image data and in the buffer, and length in bytes */
+    struct Run
+    {
+        unsigned long long fileOffset;
+        unsigned long long bufferOffset;
+        unsigned long long length;
+    };
+
+    std::vector<Run> GetIORegionRuns() const;
+
+    std::string BuildHeader();
+
+    void ReadBlockIndex();
+    void ReadBlocks(char *buffer, const std::vector<Run>& runs);
+    void ReadStream(char *buffer, const std::vector<Run>& runs);
+
+    void WriteBlocks(std::ostream& file, const char *buffer, unsigned long long length, bool isLast);
+
     gzFile m_file;
 
     /**  All of the information read in from the header file */
     unsigned int m_NumberBlocksInHeader;
     std::string m_header;
+
+    bool m_UseBlockCompression;
+
+    /** Block index of the file read: gzip member offsets, the header one first, and the index one last */
+    bool m_IsCompressed;
+    unsigned long long m_BlockSize;
+    std::vector<unsigned long long> m_BlockOffsets;
+
+    /** Streamed writing state, kept between the regions */
+    unsigned long long m_PayloadWritten;
+    std::vector<unsigned long long> m_WrittenBlockOffsets;
+    std::string m_PendingPayload;
 };
 
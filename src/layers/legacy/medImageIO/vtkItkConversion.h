@@ -20,7 +20,8 @@ PURPOSE.
 #include <vtkAlgorithmOutput.h>
 #include <vtkMatrix4x4.h>
 
-#include <vector>
+#include <list>
+#include <utility>
 
 class medAbstractData;
 
@@ -77,10 +78,14 @@ private:
     // ///////////////////////////////////////////////////////////////////////
     // 4D
     typename itk::Image<volumeType, 4>::Pointer m_ItkInputImage4D;  /*!<Keep 4D ITK input image. */
-    std::vector<typename itk::Image<volumeType, 3>::Pointer> m_oVolumeVectorFrom4D; /*!<Internal vector for each 3D ITK volume extracted from 4D ITK input image. */
+    std::list<std::pair<unsigned int, typename itk::Image<volumeType, 3>::Pointer> > m_oRecentVolumesFrom4D; /*!<Most recently used 3D volumes of the 4D ITK input image, the most recent first. */
     unsigned int m_uiCurrentTimeIndex; /*!<Keep current index of the time line. */
-    unsigned int m_uiNbVolume; /*!<Number of extracted volume. */
+    unsigned int m_uiNbVolume; /*!<Number of volumes in the 4D image. */
     float m_fTotalTime; /*!<Time line in second. */
+    bool m_bScalarRangeComputed; /*!<True when m_dScalarRange is up to date with the input image. */
+    double m_dScalarRange[2]; /*!<Scalar range over all the volumes. */
+
+    static const unsigned int s_uiRecentVolumesCount = 4; /*!<Number of volumes kept in m_oRecentVolumesFrom4D. */
 
 public:
     vtkItkConversion();
@@ -105,6 +110,8 @@ public:
 private:
     bool initializeImage(typename itk::ImageBase<imageDim>::Pointer &input);
     bool volumeExtraction();
+    typename itk::Image<volumeType, 3>::Pointer getVolume(unsigned int pi_uiTimeIndex);
+    typename itk::Image<volumeType, 3>::Pointer createVolume(unsigned int pi_uiTimeIndex);
     void conversion();
 };
 
@@ -12,7 +12,7 @@ PURPOSE.
 =========================================================================*/
 
 template <typename volumeType, unsigned int imageDim>
-vtkItkConversion<volumeType, imageDim>::vtkItkConversion() :m_ImageConverter(ConverterType::New()), m_uiCurrentTimeIndex(0), m_uiNbVolume(0), m_fTotalTime(0) {}
+vtkItkConversion<volumeType, imageDim>::vtkItkConversion() :m_ImageConverter(ConverterType::New()), m_uiCurrentTimeIndex(0), m_uiNbVolume(0), m_fTotalTime(0), m_bScalarRangeComputed(false) {}
 
 template <typename volumeType, unsigned int imageDim>
 vtkItkConversion<volumeType, imageDim>::~vtkItkConversion() {}
@@ -30,7 +30,11 @@ bool vtkItkConversion<volumeType, imageDim>::SetITKInput(typename itk::DataObjec
     typename itk::ImageBase<imageDim>::Pointer inputImage = dynamic_cast<  itk::ImageBase<imageDim>*> (pi_input.GetPointer());
     
     bool bRes = inputImage.IsNotNull();
-   
+
+    m_oRecentVolumesFrom4D.clear();
+    m_uiCurrentTimeIndex = 0;
+    m_bScalarRangeComputed = false;
+
     bRes = initializeImage(inputImage);
 
     if (bRes && imageDim == 4)
@@ -143,7 +147,9 @@ bool vtkItkConversion<volumeType, imageDim>::initializeImage(typename itk::Image
 }
 
 /**
-* @brief  This internal function process the extraction of diffrents volume from 4D image input.
+* @brief  This internal function prepares the access to the diffrents volumes of the 4D image input.
+* @details Volumes are no longer all extracted up front, only the first one is made current here, the others are
+*          provided on demand by getVolume.
 * @return True if succed. False in other cases.
 */
 template <typename volumeType, unsigned int imageDim>
@@ -153,66 +159,139 @@ bool vtkItkConversion<volumeType, imageDim>::volumeExtraction()
 
     auto size = m_ItkInputImage4D->GetLargestPossibleRegion().GetSize();
     m_uiNbVolume = size[3];
-    m_oVolumeVectorFrom4D.reserve(m_uiNbVolume);
-
-    // split the 4D volume into 3D volumes
-    typename Image4DType::RegionType regionToExtract = m_ItkInputImage4D->GetLargestPossibleRegion();
-    typename Image4DType::IndexType index;
-    index[0] = 0;
-    index[1] = 0;
-    index[2] = 0;
-    index[3] = 0;
-    size[3] = 0;
-
-    regionToExtract.SetSize(size);
-    regionToExtract.SetIndex(index);
 
     if (m_uiNbVolume > 0)
     {
         double dTimeResolution = m_ItkInputImage4D->GetSpacing()[3];
         m_fTotalTime = dTimeResolution * (m_uiNbVolume-1);
-        m_oVolumeVectorFrom4D.resize(m_uiNbVolume);
 
-        for (unsigned int n = 0; (n < m_uiNbVolume) && bRes; n++)
+        m_ItkInputImage = getVolume(0);
+        bRes = m_ItkInputImage.IsNotNull();
+    }
+    else
+    {
+        bRes = false;
+    }
+
+    return bRes;
+
+}
+
+/**
+* @brief  This internal function provides a volume of the 4D image input, from the recently used ones if possible.
+* @param  pi_uiTimeIndex [in] cardinal number of the volume (0..N-1).
+* @return The 3D volume, null if it cannot be extracted.
+*/
+template <typename volumeType, unsigned int imageDim>
+typename itk::Image<volumeType, 3>::Pointer vtkItkConversion<volumeType, imageDim>::getVolume(unsigned int pi_uiTimeIndex)
+{
+    for (auto it = m_oRecentVolumesFrom4D.begin(); it != m_oRecentVolumesFrom4D.end(); ++it)
+    {
+        if (it->first == pi_uiTimeIndex)
         {
-            typedef typename itk::ExtractImageFilter<Image4DType, Image3DType> ExtractImageType;
-            regionToExtract.SetIndex(3, n);
-            typename ExtractImageType::Pointer myExtractor = ExtractImageType::New();
-            myExtractor->SetExtractionRegion(regionToExtract);
-            myExtractor->SetDirectionCollapseToGuess();
-            myExtractor->SetInput(m_ItkInputImage4D);
-
-            try
-            {
-                myExtractor->Update();
-            }
-            catch (itk::ExceptionObject &e)
-            {
-                bRes = false;
-                std::cerr << "no volume into 4D image with exception : " << e << std::endl;
-            }
+            m_oRecentVolumesFrom4D.splice(m_oRecentVolumesFrom4D.begin(), m_oRecentVolumesFrom4D, it);
+            return m_oRecentVolumesFrom4D.front().second;
+        }
+    }
 
-            try
-            {
-                myExtractor->GetOutput();
-                m_oVolumeVectorFrom4D[n] = myExtractor->GetOutput();
-            }
-            catch (itk::ExceptionObject &e)
+    typename Image3DType::Pointer volume = createVolume(pi_uiTimeIndex);
+    if (volume.IsNotNull())
+    {
+        m_oRecentVolumesFrom4D.emplace_front(pi_uiTimeIndex, volume);
+        if (m_oRecentVolumesFrom4D.size() > s_uiRecentVolumesCount)
+        {
+            m_oRecentVolumesFrom4D.pop_back();
+        }
+    }
+
+    return volume;
+}
+
+/**
+* @brief  This internal function builds a volume of the 4D image input.
+* @details When the whole 4D image is buffered, the volume shares the 4D pixel buffer, nothing is copied.
+*          Otherwise the volume is extracted with an itk::ExtractImageFilter.
+* @param  pi_uiTimeIndex [in] cardinal number of the volume (0..N-1).
+* @return The 3D volume, null if it cannot be extracted.
+*/
+template <typename volumeType, unsigned int imageDim>
+typename itk::Image<volumeType, 3>::Pointer vtkItkConversion<volumeType, imageDim>::createVolume(unsigned int pi_uiTimeIndex)
+{
+    typename Image3DType::Pointer volume;
+
+    typename Image4DType::RegionType region4D = m_ItkInputImage4D->GetLargestPossibleRegion();
+    typename Image4DType::SizeType size4D = region4D.GetSize();
+
+    if (m_ItkInputImage4D->GetBufferedRegion() == region4D && m_ItkInputImage4D->GetBufferPointer())
+    {
+        typename Image3DType::SizeType size;
+        typename Image3DType::IndexType index;
+        typename Image3DType::SpacingType spacing;
+        typename Image3DType::PointType origin;
+        typename Image3DType::DirectionType direction;
+
+        typename Image4DType::IndexType volumeIndex4D = region4D.GetIndex();
+        volumeIndex4D[3] += pi_uiTimeIndex;
+        typename Image4DType::PointType volumeOrigin4D;
+        m_ItkInputImage4D->TransformIndexToPhysicalPoint(volumeIndex4D, volumeOrigin4D);
+
+        for (unsigned int i = 0; i < 3; ++i)
+        {
+            size[i] = size4D[i];
+            index[i] = region4D.GetIndex()[i];
+            spacing[i] = m_ItkInputImage4D->GetSpacing()[i];
+            origin[i] = volumeOrigin4D[i];
+            for (unsigned int j = 0; j < 3; ++j)
             {
-                bRes = false;
-                std::cerr<< "error when extracting volume from 4D itk image on volume : " << n << " \n with exception" << e << std::endl;
+                direction(i, j) = m_ItkInputImage4D->GetDirection()(i, j);
             }
         }
 
-        m_ItkInputImage = m_oVolumeVectorFrom4D[0];
+        typename Image3DType::RegionType region;
+        region.SetSize(size);
+        region.SetIndex(index);
+
+        const itk::SizeValueType pixelsPerVolume = size[0] * size[1] * size[2];
+
+        // the container does not own the memory, the 4D image kept in m_ItkInputImage4D does
+        typename Image3DType::PixelContainerPointer container = Image3DType::PixelContainer::New();
+        container->SetImportPointer(m_ItkInputImage4D->GetBufferPointer() + pixelsPerVolume * pi_uiTimeIndex, pixelsPerVolume, false);
+
+        volume = Image3DType::New();
+        volume->SetRegions(region);
+        volume->SetSpacing(spacing);
+        volume->SetOrigin(origin);
+        volume->SetDirection(direction);
+        volume->SetPixelContainer(container);
+        volume->SetNumberOfComponentsPerPixel(m_ItkInputImage4D->GetNumberOfComponentsPerPixel());
     }
     else
     {
-        bRes = false;
+        typedef typename itk::ExtractImageFilter<Image4DType, Image3DType> ExtractImageType;
+        typename Image4DType::RegionType regionToExtract = region4D;
+        size4D[3] = 0;
+        regionToExtract.SetSize(size4D);
+        regionToExtract.SetIndex(3, region4D.GetIndex()[3] + pi_uiTimeIndex);
+
+        typename ExtractImageType::Pointer myExtractor = ExtractImageType::New();
+        myExtractor->SetExtractionRegion(regionToExtract);
+        myExtractor->SetDirectionCollapseToGuess();
+        myExtractor->SetInput(m_ItkInputImage4D);
+
+        try
+        {
+            myExtractor->Update();
+            volume = myExtractor->GetOutput();
+            volume->DisconnectPipeline();
+        }
+        catch (itk::ExceptionObject &e)
+        {
+            volume = nullptr;
+            std::cerr<< "error when extracting volume from 4D itk image on volume : " << pi_uiTimeIndex << " \n with exception" << e << std::endl;
+        }
     }
 
-    return bRes;
-
+    return volume;
 }
 
 /**
@@ -227,9 +306,15 @@ bool vtkItkConversion<volumeType, imageDim>::setTimeIndex(unsigned int pi_uiTime
 
     if (pi_uiTimeIndex != m_uiCurrentTimeIndex)
     {
-        if (pi_uiTimeIndex < m_uiNbVolume)
+        typename Image3DType::Pointer volume;
+        if (pi_uiTimeIndex < m_uiNbVolume && m_ItkInputImage4D.IsNotNull())
+        {
+            volume = getVolume(pi_uiTimeIndex);
+        }
+
+        if (volume.IsNotNull())
         {
-            m_ItkInputImage = m_oVolumeVectorFrom4D[pi_uiTimeIndex];
+            m_ItkInputImage = volume;
             conversion();
             m_uiCurrentTimeIndex = pi_uiTimeIndex;
         }
@@ -290,32 +375,41 @@ void vtkItkConversion<volumeType, imageDim>::conversion()
 }
 
 /**
-* @brief  This function get the total time of 4D image.
-* @return The a table of 2 cases with the scalar range (compute with vtk method).
+* @brief  This function get the scalar range over all the volumes.
+* @details The range is computed once per input image, the following calls return the same values.
+* @return The a table of 2 cases with the scalar range (compute with vtk method), to be deleted by the caller.
 */
 template <typename volumeType, unsigned int imageDim>
 double * vtkItkConversion<volumeType, imageDim>::getCurrentScalarRange()
 {
     double *dResScalarRange = nullptr;
-    double scalarRangeTmp[2];
-    unsigned int uiPreviousTimeIndex = m_uiCurrentTimeIndex;
 
     if (m_ItkInputImage.IsNotNull() || m_ItkInputImage4D.IsNotNull())
     {
-        dResScalarRange = new double[2]; //FloTODO check potential memory leak
-        dResScalarRange[0] = VTK_DOUBLE_MAX;
-        dResScalarRange[1] = VTK_DOUBLE_MIN;
-
-        for (unsigned int i = 0; i < m_uiNbVolume; ++i)
+        if (!m_bScalarRangeComputed)
         {
-            setTimeIndex(i);
-            m_ImageConverter->GetImporter()->GetOutput()->GetScalarRange(scalarRangeTmp);
-            if (dResScalarRange[0] > scalarRangeTmp[0]) dResScalarRange[0] = scalarRangeTmp[0];
-            if (dResScalarRange[1] < scalarRangeTmp[1]) dResScalarRange[1] = scalarRangeTmp[1];
+            double scalarRangeTmp[2];
+            unsigned int uiPreviousTimeIndex = m_uiCurrentTimeIndex;
+
+            m_dScalarRange[0] = VTK_DOUBLE_MAX;
+            m_dScalarRange[1] = VTK_DOUBLE_MIN;
+
+            for (unsigned int i = 0; i < m_uiNbVolume; ++i)
+            {
+                setTimeIndex(i);
+                m_ImageConverter->GetImporter()->GetOutput()->GetScalarRange(scalarRangeTmp);
+                if (m_dScalarRange[0] > scalarRangeTmp[0]) m_dScalarRange[0] = scalarRangeTmp[0];
+                if (m_dScalarRange[1] < scalarRangeTmp[1]) m_dScalarRange[1] = scalarRangeTmp[1];
+            }
+
+            setTimeIndex(uiPreviousTimeIndex);
+            m_bScalarRangeComputed = true;
         }
-    }
 
-    setTimeIndex(uiPreviousTimeIndex);
+        dResScalarRange = new double[2]; //FloTODO check potential memory leak
+        dResScalarRange[0] = m_dScalarRange[0];
+        dResScalarRange[1] = m_dScalarRange[1];
+    }
 
     return dResScalarRange;
 }
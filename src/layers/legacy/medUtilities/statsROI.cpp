@@ -23,13 +23,58 @@
 #include <medAttachedData.h>
 #include <medDataManager.h>
 
-#include <itkImageRegionIterator.h>
 #include <itkMinimumMaximumImageCalculator.h>
+#include <itkMultiThreaderBase.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <vector>
 #include <numeric>
 #include <functional>
 
+// Running statistics of the voxels of one chunk of the image, merged together once all chunks are done.
+// Mean and variance are updated with Welford's method and merged with Chan's formula, which avoids
+// the cancellation of the naive sum of squares on large ROIs.
+struct statsROIAccumulator
+{
+    unsigned long long count = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+    double min = std::numeric_limits<double>::max();
+    double max = std::numeric_limits<double>::lowest();
+
+    inline void add(double value)
+    {
+        ++count;
+        double delta = value - mean;
+        mean += delta / count;
+        m2 += delta * (value - mean);
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+
+    void merge(const statsROIAccumulator &other)
+    {
+        if (!other.count)
+        {
+            return;
+        }
+        if (!count)
+        {
+            *this = other;
+            return;
+        }
+        double total = static_cast<double>(count + other.count);
+        double delta = other.mean - mean;
+        mean += delta * other.count / total;
+        m2 += other.m2 + delta * delta * count * other.count / total;
+        count += other.count;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+};
+
 // /////////////////////////////////////////////////////////////////
 // statsROIInternal
 // /////////////////////////////////////////////////////////////////
@@ -47,139 +92,228 @@ public:
     // If the access qualifiers change on statsROI, remember to change this!
     statsROIInternal(statsROI* statsROIObject) : composite(statsROIObject) { }
 
+    // Calls functor with the itk::Image behind data, for the scalar 3D types handled by statsROI
+    template <class Functor> static int dispatch(medAbstractData *data, Functor functor)
+    {
+        int res = DTK_FAILURE;
+        if (!dispatch<Functor, char, unsigned char, short, unsigned short, int, unsigned int,
+                      long, unsigned long, float, double>(static_cast<itk::Object*>(data->data()), functor, res))
+        {
+            qDebug() << "statsROI, Error : pixel type not yet implemented ("
+                     << data->identifier()
+                     << ")";
+        }
+        return res;
+    }
+
+    template <class Functor, class PixelType, class... OtherPixelTypes> static bool dispatch(itk::Object *object, Functor &functor, int &res)
+    {
+        if (itk::Image<PixelType, 3> *image = dynamic_cast<itk::Image<PixelType, 3>*>(object))
+        {
+            res = functor(image);
+            return true;
+        }
+        if constexpr (sizeof...(OtherPixelTypes) > 0)
+        {
+            return dispatch<Functor, OtherPixelTypes...>(object, functor, res);
+        }
+        else
+        {
+            return false;
+        }
+    }
+
     // Run the Stats process
-    template <class ImageType> int runStats()
+    template <class ImageType> int runStats(ImageType *image)
     {
         int res = DTK_FAILURE;
 
-        if (composite->chooseFct == statsROI::MEANVARIANCE) // DEFAULT: Compute Mean and Variance
+        switch (composite->chooseFct)
         {
-            if (composite->input1)
+            case statsROI::MEANVARIANCE: // DEFAULT: Compute Mean and Variance
+            case statsROI::ROISTATISTICS:
             {
-                QString id = composite->input1->identifier();
-
-                if ( id == "itkDataImageChar3" )
+                if (composite->input1)
                 {
-                    res = runMeanVariance< ImageType, itk::Image <char,3> >();
-                }
-                else if ( id == "itkDataImageUChar3" )
-                {
-                    res = runMeanVariance< ImageType, itk::Image <unsigned char,3> >();
-                }
-                else if ( id == "itkDataImageShort3" )
-                {
-                    res = runMeanVariance< ImageType, itk::Image <short,3> >();
-                }
-                else if ( id == "itkDataImageUShort3" )
-                {
-                    res = runMeanVariance< ImageType, itk::Image <unsigned short,3> >();
-                }
-                else if ( id == "itkDataImageInt3" )
-                {
-                    res = runMeanVariance< ImageType, itk::Image <int,3> >();
-                }
-                else if ( id == "itkDataImageUInt3" )
-                {
-                    res = runMeanVariance< ImageType, itk::Image <unsigned int,3> >();
-                }
-                else if ( id == "itkDataImageLong3" )
-                {
-                    res = runMeanVariance< ImageType, itk::Image <long,3> >();
-                }
-                else if ( id== "itkDataImageULong3" )
-                {
-                    res = runMeanVariance< ImageType, itk::Image <unsigned long,3> >();
-                }
-                else if ( id == "itkDataImageFloat3" )
-                {
-                    res = runMeanVariance< ImageType, itk::Image <float,3> >();
-                }
-                else if ( id == "itkDataImageDouble3" )
-                {
-                    res = runMeanVariance< ImageType, itk::Image <double,3> >();
+                    res = dispatch(composite->input1, [this, image](auto *mask)
+                    {
+                        return runRegionStatistics(image, mask);
+                    });
                 }
-                else
+                else if (composite->chooseFct == statsROI::ROISTATISTICS)
                 {
-                    qDebug() <<"statsROI, Error : pixel type not yet implemented ("
-                             << id
-                             << ")";
+                    res = runRegionStatistics<ImageType, ImageType>(image, nullptr);
                 }
+                break;
             }
-        }
-        else // Compute Volume in mL
-        {
-            if (composite->chooseFct == statsROI::VOLUMEML)
+            case statsROI::VOLUMEML: // Compute Volume in mL
             {
-                res = runVolumeML<ImageType>();
+                res = runVolumeML(image);
+                break;
             }
-            else if (composite->chooseFct == statsROI::MINMAX)
+            case statsROI::MINMAX:
             {
-                res = runMinMax<ImageType>();
+                res = runMinMax(image);
+                break;
             }
         }
         return res;
+    }
 
+    // Calls fct(chunk, beginOffset, endOffset) in parallel on slabs of whole slices of the buffer.
+    // The chunking only depends on the image size, so that merging the chunks in order is deterministic.
+    template <class ImageType, class Functor> static unsigned int parallelizeOverSlabs(ImageType *image, Functor fct)
+    {
+        const typename ImageType::SizeType size = image->GetBufferedRegion().GetSize();
+        const itk::SizeValueType sliceSize  = size[0] * size[1];
+        const itk::SizeValueType sliceCount = size[2];
+        const itk::SizeValueType chunkCount = std::max<itk::SizeValueType>(1,
+                    std::min<itk::SizeValueType>(sliceCount, itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads()));
+
+        itk::MultiThreaderBase::Pointer threader = itk::MultiThreaderBase::New();
+        threader->ParallelizeArray(0, chunkCount, [&](itk::SizeValueType chunk)
+        {
+            fct(chunk, chunk * sliceCount / chunkCount * sliceSize, (chunk + 1) * sliceCount / chunkCount * sliceSize);
+        }, nullptr);
+
+        return chunkCount;
     }
 
-    template <class ImageType, class ImageType2> int runMeanVariance()
+    // Single pass over the image (and mask if any) computing mean, variance, min, max and volume.
+    // The histogram, if requested, needs the range of the ROI and is filled in a second pass.
+    template <class ImageType, class MaskType> int runRegionStatistics(ImageType *image, MaskType *mask)
     {
-        typename ImageType::Pointer  imag = dynamic_cast<ImageType  *> ( ( itk::Object* ) ( composite->input0->data() )) ;
-        typename ImageType2::Pointer mask = dynamic_cast<ImageType2 *> ( ( itk::Object* ) ( composite->input1->data() )) ;
+        if (mask && mask->GetBufferedRegion().GetSize() != image->GetBufferedRegion().GetSize())
+        {
+            qDebug() << "statsROI, Error : the mask and the image have different sizes";
+            return DTK_FAILURE;
+        }
 
-        // Iterators
-        typedef itk::ImageRegionIterator <ImageType> MaskIterator;
-        MaskIterator iti(imag, imag->GetBufferedRegion());
-        typedef itk::ImageRegionIterator <ImageType2> MaskIterator2;
-        MaskIterator2 itm(mask, mask->GetBufferedRegion());
+        const typename ImageType::PixelType *pixels = image->GetBufferPointer();
+        const typename MaskType::PixelType *maskPixels = mask ? mask->GetBufferPointer() : nullptr;
 
-        std::vector<double> v;
+        std::vector<statsROIAccumulator> accumulators(itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads());
+        unsigned int chunkCount = parallelizeOverSlabs(image, [&](itk::SizeValueType chunk, itk::SizeValueType begin, itk::SizeValueType end)
+        {
+            statsROIAccumulator accumulator;
+            for (itk::SizeValueType i = begin; i < end; ++i)
+            {
+                if (!maskPixels || maskPixels[i])
+                {
+                    accumulator.add(static_cast<double>(pixels[i]));
+                }
+            }
+            accumulators[chunk] = accumulator;
+        });
 
-        // Loop over the mask
-        for (itm.GoToBegin(); !itm.IsAtEnd(); ++itm)
+        statsROIAccumulator stats;
+        for (unsigned int chunk = 0; chunk < chunkCount; ++chunk)
         {
-            if(itm.Get())
-                v.push_back((double)iti.Get());
-            ++iti;
+            stats.merge(accumulators[chunk]);
         }
 
-        double sum = std::accumulate(v.begin(), v.end(), 0.0);
-        double mean =  sum / v.size();
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        const double mean     = stats.count ? stats.mean : nan;
+        const double variance = stats.count ? stats.m2 / stats.count : nan;
 
-        std::vector<double> diff(v.size());
-        std::transform(v.begin(), v.end(), diff.begin(), [mean](double dDiffVal) {return dDiffVal - mean; });
+        if (composite->chooseFct == statsROI::MEANVARIANCE)
+        {
+            composite->computedOutput.push_back(mean);
+            composite->computedOutput.push_back(std::sqrt(variance));
+            return DTK_SUCCEED;
+        }
 
-        double sq_sum = std::inner_product(diff.begin(), diff.end(), diff.begin(), 0.0);
-        double stdev = std::sqrt(sq_sum / v.size());
+        const typename ImageType::SpacingType spacing = image->GetSpacing();
+        const double volumeInMm3 = stats.count * spacing[0] * spacing[1] * spacing[2];
 
         composite->computedOutput.push_back(mean);
-        composite->computedOutput.push_back(stdev);
+        composite->computedOutput.push_back(variance);
+        composite->computedOutput.push_back(stats.count ? stats.min : nan);
+        composite->computedOutput.push_back(stats.count ? stats.max : nan);
+        composite->computedOutput.push_back(volumeInMm3 / 1000.);
+        composite->computedOutput.push_back(static_cast<double>(stats.count));
+
+        // Percentiles are interpolated from the histogram, use a fine default one if none was asked for
+        unsigned int bins = composite->histogramBins;
+        if (!bins && !composite->percentiles.empty())
+        {
+            bins = 1024;
+        }
+        if (!bins)
+        {
+            return DTK_SUCCEED;
+        }
 
-        return DTK_SUCCEED;
-    }
+        composite->histogramRange[0] = stats.count ? stats.min : 0.0;
+        composite->histogramRange[1] = stats.count ? stats.max : 0.0;
+        const double lower = composite->histogramRange[0];
+        const double binsPerUnit = (composite->histogramRange[1] > lower) ? bins / (composite->histogramRange[1] - lower) : 0.0;
 
-    template <class ImageType> int runVolumeML()
-    {
-        typename ImageType::Pointer m_itkMask = dynamic_cast<ImageType *> ( static_cast<itk::Object*> ( composite->input0->data() ));
+        std::vector<std::vector<unsigned long long> > histograms(chunkCount);
+        parallelizeOverSlabs(image, [&](itk::SizeValueType chunk, itk::SizeValueType begin, itk::SizeValueType end)
+        {
+            std::vector<unsigned long long> histogram(bins, 0);
+            for (itk::SizeValueType i = begin; i < end; ++i)
+            {
+                if (!maskPixels || maskPixels[i])
+                {
+                    unsigned int bin = static_cast<unsigned int>((static_cast<double>(pixels[i]) - lower) * binsPerUnit);
+                    ++histogram[std::min(bin, bins - 1)];
+                }
+            }
+            histograms[chunk].swap(histogram);
+        });
+
+        std::vector<double> histogram(bins, 0.0);
+        for (unsigned int chunk = 0; chunk < chunkCount; ++chunk)
+        {
+            for (unsigned int bin = 0; bin < bins; ++bin)
+            {
+                histogram[bin] += histograms[chunk][bin];
+            }
+        }
 
-        typename ImageType::SizeType size = m_itkMask->GetLargestPossibleRegion().GetSize();
-        typename ImageType::IndexType px;
-        int nbPixInMask = 0;
-        for (unsigned int sl=0 ; sl<size[2] ; sl++)
+        const double binWidth = binsPerUnit > 0 ? 1.0 / binsPerUnit : 0.0;
+        for (double percentile : composite->percentiles)
         {
-            for (unsigned int y=0 ; y<size[1] ; y++)
+            double target = std::min(std::max(percentile, 0.0), 100.0) / 100. * stats.count;
+            double cumulated = 0.0;
+            double value = stats.count ? stats.max : nan;
+            for (unsigned int bin = 0; bin < bins; ++bin)
             {
-                for (unsigned int x=0 ; x<size[0] ; x++)
+                if (histogram[bin] > 0 && cumulated + histogram[bin] >= target)
                 {
-                    px[0] = x;
-                    px[1] = y;
-                    px[2] = sl;
-                    if (m_itkMask->GetPixel(px)!=composite->outsideValue)
-                    {
-                        nbPixInMask++;
-                    }
+                    value = lower + binWidth * (bin + (target - cumulated) / histogram[bin]);
+                    break;
                 }
+                cumulated += histogram[bin];
             }
+            composite->computedOutput.push_back(value);
+        }
+
+        if (composite->histogramBins)
+        {
+            composite->computedHistogram.swap(histogram);
         }
+
+        return DTK_SUCCEED;
+    }
+
+    template <class ImageType> int runVolumeML(ImageType *m_itkMask)
+    {
+        const typename ImageType::PixelType *pixels = m_itkMask->GetBufferPointer();
+        const double outsideValue = composite->outsideValue;
+
+        std::vector<unsigned long long> counts(itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads(), 0);
+        unsigned int chunkCount = parallelizeOverSlabs(m_itkMask, [&](itk::SizeValueType chunk, itk::SizeValueType begin, itk::SizeValueType end)
+        {
+            counts[chunk] = std::count_if(pixels + begin, pixels + end, [outsideValue](typename ImageType::PixelType value)
+            {
+                return static_cast<double>(value) != outsideValue;
+            });
+        });
+
+        unsigned long long nbPixInMask = std::accumulate(counts.begin(), counts.begin() + chunkCount, 0ULL);
         double volumeInMm3 =
                 nbPixInMask * m_itkMask->GetSpacing()[0]*m_itkMask->GetSpacing()[1]*m_itkMask->GetSpacing()[2];
 
@@ -188,14 +322,12 @@ public:
         return DTK_SUCCEED;
     }
 
-    template <class ImageType> int runMinMax()
+    template <class ImageType> int runMinMax(ImageType *imgInput)
     {
         typedef itk::MinimumMaximumImageCalculator <ImageType> ImageCalculatorFilterType;
         typename ImageCalculatorFilterType::Pointer imageCalculatorFilter
                 = ImageCalculatorFilterType::New ();
 
-        typename ImageType::Pointer imgInput = dynamic_cast<ImageType *> ( ( itk::Object* ) ( composite->input0->data() )) ;
-
         imageCalculatorFilter->SetImage(imgInput);
         imageCalculatorFilter->Compute();
 
@@ -219,6 +351,8 @@ statsROI::statsROI()
     this->computedOutput.empty();
     chooseFct = MEANVARIANCE;
     outsideValue = 0;
+    histogramBins = 0;
+    histogramRange[0] = histogramRange[1] = 0;
 }
 
 statsROI::~statsROI()
@@ -251,62 +385,31 @@ void statsROI::setParameter(double outsideValue)
     this->outsideValue = outsideValue;
 }
 
+void statsROI::setHistogramBins(unsigned int bins)
+{
+    histogramBins = bins;
+}
+
+void statsROI::setPercentiles(const std::vector<double> &percentiles)
+{
+    this->percentiles = percentiles;
+}
+
 // Convert medAbstractData to ITK volume
 int statsROI::update()
 {
     int res = DTK_FAILURE;
     statsROIInternal internalHandler(this);
 
+    computedOutput.clear();
+    computedHistogram.clear();
+
     if (this->input0)
     {
-        QString id = this->input0->identifier();
-
-        if ( id == "itkDataImageChar3" )
-        {
-            res = internalHandler.runStats< itk::Image <char,3> >();
-        }
-        else if ( id == "itkDataImageUChar3" )
+        res = statsROIInternal::dispatch(this->input0, [&internalHandler](auto *image)
         {
-            res = internalHandler.runStats< itk::Image <unsigned char,3> >();
-        }
-        else if ( id == "itkDataImageShort3" )
-        {
-            res = internalHandler.runStats< itk::Image <short,3> >();
-        }
-        else if ( id == "itkDataImageUShort3" )
-        {
-            res = internalHandler.runStats< itk::Image <unsigned short,3> >();
-        }
-        else if ( id == "itkDataImageInt3" )
-        {
-            res = internalHandler.runStats< itk::Image <int,3> >();
-        }
-        else if ( id == "itkDataImageUInt3" )
-        {
-            res = internalHandler.runStats< itk::Image <unsigned int,3> >();
-        }
-        else if ( id == "itkDataImageLong3" )
-        {
-            res = internalHandler.runStats< itk::Image <long,3> >();
-        }
-        else if ( id== "itkDataImageULong3" )
-        {
-            res = internalHandler.runStats< itk::Image <unsigned long,3> >();
-        }
-        else if ( id == "itkDataImageFloat3" )
-        {
-            res = internalHandler.runStats< itk::Image <float,3> >();
-        }
-        else if ( id == "itkDataImageDouble3" )
-        {
-            res = internalHandler.runStats< itk::Image <double,3> >();
-        }
-        else
-        {
-            qDebug() << "statsROI, Error : pixel type not yet implemented ("
-                     << id
-                     << ")";
-        }
+            return internalHandler.runStats(image);
+        });
     }
     return res;
 }
@@ -315,3 +418,8 @@ std::vector<double> statsROI::output()
 {
     return ( this->computedOutput );
 }
+
+std::vector<double> statsROI::histogram()
+{
+    return ( this->computedHistogram );
+}
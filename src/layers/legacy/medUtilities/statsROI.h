@@ -24,9 +24,13 @@ public:
     dtkSmartPointer <medAbstractData> input0; //data
     dtkSmartPointer <medAbstractData> input1; //mask
     std::vector<double> computedOutput;
-    enum statsParameter {MEANVARIANCE, VOLUMEML, MINMAX};
+    std::vector<double> computedHistogram;
+    enum statsParameter {MEANVARIANCE, VOLUMEML, MINMAX, ROISTATISTICS};
     statsParameter chooseFct;
     double outsideValue;
+    unsigned int histogramBins;
+    std::vector<double> percentiles;
+    double histogramRange[2];
 
     statsROI();
     virtual ~statsROI();
@@ -40,9 +44,19 @@ public:
     //! Parameter used only with VOLUMEML statsParameter
     void setParameter(double outsideValue);
 
+    //! Number of histogram bins computed with ROISTATISTICS, 0 disables the histogram
+    void setHistogramBins(unsigned int bins);
+
+    //! Percentiles (between 0 and 100) computed with ROISTATISTICS, interpolated from the histogram
+    void setPercentiles(const std::vector<double> &percentiles);
+
     //! Method to actually start the filter
     int update();
     
-    //! The output will be available through here
+    //! The output will be available through here.
+    //! ROISTATISTICS outputs mean, variance, min, max, volume in mL, number of voxels, then the requested percentiles
     std::vector<double> output();
+
+    //! Voxel counts of the ROISTATISTICS histogram, whose bins evenly split histogramRange
+    std::vector<double> histogram();
 };
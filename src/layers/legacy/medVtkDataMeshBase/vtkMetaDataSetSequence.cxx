@@ -28,16 +28,126 @@
 #include <vtkActor.h>
 #include <vtkColorTransferFunction.h>
 #include <vtkCellData.h>
+#include <vtkFieldData.h>
 #include <vtksys/SystemTools.hxx>
 #include <vtkDirectory.h>
 #include <vtkErrorCode.h>
 #include <vtkLookupTable.h>
 #include <vtkCellArray.h>
 #include <vtkDoubleArray.h>
+#include <vtkPoints.h>
+#include <vtkPointSet.h>
 #include <vtkDataArrayCollection.h>
+#include <vtkGenericDataObjectReader.h>
+#include <vtkXMLGenericDataObjectReader.h>
+#include <vtkSmartPointer.h>
 
 #include <sstream>
 #include <algorithm> // for sort algorithm
+#include <cstring>
+#include <future>
+#include <list>
+#include <map>
+#include <set>
+
+//----------------------------------------------------------------------------
+struct vtkMetaDataSetSequenceInternals
+{
+    // Points and cells of the first frame, without attributes
+    vtkSmartPointer<vtkDataSet> SharedTopology;
+
+    // Frames whose attributes are read from their file, and the loaded ones, most recently used first
+    std::set<vtkMetaDataSet*> PagedFrames;
+    std::list<vtkMetaDataSet*> LoadedFrames;
+
+    // Frames being read ahead
+    std::map<vtkMetaDataSet*, std::future<vtkSmartPointer<vtkDataSet> > > Prefetched;
+
+    // Ranges of the point and cell arrays of the paged frames, by name, computed when they are first loaded
+    struct FrameRanges
+    {
+        std::map<std::string, std::pair<double, double> > Points;
+        std::map<std::string, std::pair<double, double> > Cells;
+    };
+    std::map<vtkMetaDataSet*, FrameRanges> Ranges;
+
+    // The array the sequence is colored by, looked up again in the frames when they are loaded
+    std::string ColorArrayName;
+    bool ColorArrayInPoints = true;
+    vtkSmartPointer<vtkLookupTable> ColorLookupTable;
+};
+
+namespace
+{
+
+// Reads a dataset from a legacy or XML vtk file, can be called from any thread
+vtkSmartPointer<vtkDataSet> ReadFrameFile (const std::string &filename)
+{
+    vtkSmartPointer<vtkDataSet> dataset;
+    if (vtksys::SystemTools::GetFilenameLastExtension(filename) == ".vtk")
+    {
+        vtkSmartPointer<vtkGenericDataObjectReader> reader = vtkSmartPointer<vtkGenericDataObjectReader>::New();
+        reader->SetFileName (filename.c_str());
+        reader->Update();
+        dataset = vtkDataSet::SafeDownCast (reader->GetOutput());
+    }
+    else
+    {
+        vtkSmartPointer<vtkXMLGenericDataObjectReader> reader = vtkSmartPointer<vtkXMLGenericDataObjectReader>::New();
+        reader->SetFileName (filename.c_str());
+        reader->Update();
+        dataset = vtkDataSet::SafeDownCast (reader->GetOutput());
+    }
+    return dataset;
+}
+
+bool SameArrays (vtkDataArray *a, vtkDataArray *b)
+{
+    if (a == b)
+        return true;
+    if (!a || !b)
+        return false;
+    if (a->GetDataType() != b->GetDataType()
+        || a->GetNumberOfComponents() != b->GetNumberOfComponents()
+        || a->GetNumberOfTuples() != b->GetNumberOfTuples())
+        return false;
+    return std::memcmp (a->GetVoidPointer(0), b->GetVoidPointer(0),
+                        a->GetNumberOfValues() * a->GetDataTypeSize()) == 0;
+}
+
+bool SamePoints (vtkPoints *a, vtkPoints *b)
+{
+    if (a == b)
+        return true;
+    if (!a || !b)
+        return false;
+    return SameArrays (a->GetData(), b->GetData());
+}
+
+void StoreRanges (vtkDataSetAttributes *attributes, std::map<std::string, std::pair<double, double> > &ranges)
+{
+    for (int i = 0; i < attributes->GetNumberOfArrays(); ++i)
+    {
+        vtkDataArray *array = attributes->GetArray (i);
+        if (array && array->GetName())
+        {
+            double range[2];
+            array->GetRange (range);
+            ranges[array->GetName()] = std::make_pair (range[0], range[1]);
+        }
+    }
+}
+
+bool SameCells (vtkCellArray *a, vtkCellArray *b)
+{
+    if (a == b)
+        return true;
+    if (!a || !b)
+        return false;
+    return a->GetNumberOfCells() == b->GetNumberOfCells() && SameArrays (a->GetData(), b->GetData());
+}
+
+}
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro( vtkMetaDataSetSequence )
@@ -51,6 +161,9 @@ vtkMetaDataSetSequence::vtkMetaDataSetSequence()
     this->Type = vtkMetaDataSet::VTK_META_UNKNOWN;
     this->SameGeometryFlag = true;
     this->ParseAttributes = true;
+    this->FrameCacheSize = 8;
+    this->PrefetchFrames = 2;
+    this->Internals = new vtkMetaDataSetSequenceInternals;
 }
 
 vtkMetaDataSetSequence::vtkMetaDataSetSequence(const vtkMetaDataSetSequence& other)
@@ -60,16 +173,25 @@ vtkMetaDataSetSequence::vtkMetaDataSetSequence(const vtkMetaDataSetSequence& oth
     this->CurrentId = other.CurrentId;
     this->SameGeometryFlag = other.SameGeometryFlag;
     this->ParseAttributes = other.ParseAttributes;
+    this->FrameCacheSize = other.FrameCacheSize;
+    this->PrefetchFrames = other.PrefetchFrames;
+    this->Internals = new vtkMetaDataSetSequenceInternals;
 
+    // The clone holds its own copy of every frame, paged ones are loaded to be copied
+    vtkMetaDataSetSequence &source = const_cast<vtkMetaDataSetSequence&>(other);
     for (unsigned int i = 0; i < other.MetaDataSetList.size(); ++i)
     {
-        this->MetaDataSetList.push_back(other.MetaDataSetList[i]->Clone());
+        this->MetaDataSetList.push_back(source.GetMetaDataSet(i)->Clone());
     }
 }
 
 //----------------------------------------------------------------------------
 vtkMetaDataSetSequence::~vtkMetaDataSetSequence()
 {
+    // Wait for the frames being read ahead before releasing them
+    this->Internals->Prefetched.clear();
+    delete this->Internals;
+
     for (unsigned int i=0; i<this->MetaDataSetList.size(); i++)
     {
         this->MetaDataSetList[i]->Delete();
@@ -115,6 +237,7 @@ void vtkMetaDataSetSequence::AddMetaDataSet (vtkMetaDataSet *metadataset)
         {
             this->MetaDataSetList.insert(it, metadataset);
             inserted = true;
+            break;
         }
     }
     if (!inserted)
@@ -123,6 +246,11 @@ void vtkMetaDataSetSequence::AddMetaDataSet (vtkMetaDataSet *metadataset)
     }
     metadataset->Register(this);
 
+    if (this->SameGeometryFlag && metadataset->GetDataSet())
+    {
+        this->ShareTopology (metadataset);
+    }
+
     try
     {
         if (!this->GetDataSet())
@@ -139,6 +267,288 @@ void vtkMetaDataSetSequence::AddMetaDataSet (vtkMetaDataSet *metadataset)
     }
 }
 
+//----------------------------------------------------------------------------
+vtkMetaDataSet* vtkMetaDataSetSequence::AddPagedMetaDataSet (const char *filename, double time)
+{
+    if (!filename || !this->Internals->SharedTopology || this->MetaDataSetList.empty())
+    {
+        vtkErrorMacro(<<"A paged frame needs a file and a first frame to share the topology of !"<<endl);
+        throw vtkErrorCode::UserError;
+    }
+
+    // The frame is built empty, so that its dataset is not deep copied, then shares the topology
+    vtkMetaDataSet *frame = this->MetaDataSetList[0]->NewInstance();
+    vtkDataSet *dataset = this->Internals->SharedTopology->NewInstance();
+    frame->SetDataSet (dataset);
+    dataset->Delete();
+    frame->GetDataSet()->ShallowCopy (this->Internals->SharedTopology);
+
+    frame->SetTime (time);
+    frame->SetFilePath (filename);
+    frame->SetName (vtksys::SystemTools::GetFilenameWithoutLastExtension (filename).c_str());
+    frame->SetType (this->Type);
+
+    this->Internals->PagedFrames.insert (frame);
+    try
+    {
+        this->AddMetaDataSet (frame);
+    }
+    catch (vtkErrorCode::ErrorIds error)
+    {
+        this->Internals->PagedFrames.erase (frame);
+        frame->Delete();
+        throw error;
+    }
+    frame->Delete();
+
+    return frame;
+}
+
+//----------------------------------------------------------------------------
+void vtkMetaDataSetSequence::ShareTopology (vtkMetaDataSet *metadataset)
+{
+    vtkDataSet *dataset = metadataset->GetDataSet();
+    vtkDataSet *shared = this->Internals->SharedTopology;
+
+    if (!shared)
+    {
+        shared = dataset->NewInstance();
+        shared->ShallowCopy (dataset);
+        shared->GetPointData()->Initialize();
+        shared->GetCellData()->Initialize();
+        this->Internals->SharedTopology.TakeReference (shared);
+        return;
+    }
+
+    if (shared->GetDataObjectType() != dataset->GetDataObjectType()
+        || shared->GetNumberOfPoints() != dataset->GetNumberOfPoints()
+        || shared->GetNumberOfCells() != dataset->GetNumberOfCells())
+    {
+        return;
+    }
+
+    vtkPolyData *polydata = vtkPolyData::SafeDownCast (dataset);
+    vtkPolyData *sharedpolydata = vtkPolyData::SafeDownCast (shared);
+    vtkUnstructuredGrid *grid = vtkUnstructuredGrid::SafeDownCast (dataset);
+    vtkUnstructuredGrid *sharedgrid = vtkUnstructuredGrid::SafeDownCast (shared);
+
+    if (polydata && sharedpolydata)
+    {
+        if (SameCells (polydata->GetVerts(),  sharedpolydata->GetVerts())
+            && SameCells (polydata->GetLines(),  sharedpolydata->GetLines())
+            && SameCells (polydata->GetPolys(),  sharedpolydata->GetPolys())
+            && SameCells (polydata->GetStrips(), sharedpolydata->GetStrips()))
+        {
+            polydata->SetVerts  (sharedpolydata->GetVerts());
+            polydata->SetLines  (sharedpolydata->GetLines());
+            polydata->SetPolys  (sharedpolydata->GetPolys());
+            polydata->SetStrips (sharedpolydata->GetStrips());
+        }
+        if (SamePoints (polydata->GetPoints(), sharedpolydata->GetPoints()))
+        {
+            polydata->SetPoints (sharedpolydata->GetPoints());
+        }
+    }
+    else if (grid && sharedgrid)
+    {
+        if (SameArrays (grid->GetCellTypesArray(), sharedgrid->GetCellTypesArray())
+            && SameArrays (grid->GetCellLocationsArray(), sharedgrid->GetCellLocationsArray())
+            && SameCells (grid->GetCells(), sharedgrid->GetCells()))
+        {
+            grid->SetCells (sharedgrid->GetCellTypesArray(), sharedgrid->GetCellLocationsArray(), sharedgrid->GetCells());
+        }
+        if (SamePoints (grid->GetPoints(), sharedgrid->GetPoints()))
+        {
+            grid->SetPoints (sharedgrid->GetPoints());
+        }
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkMetaDataSetSequence::LoadFrame (vtkMetaDataSet *metadataset)
+{
+    if (!this->Internals->PagedFrames.count (metadataset))
+        return;
+
+    std::list<vtkMetaDataSet*> &loaded = this->Internals->LoadedFrames;
+    std::list<vtkMetaDataSet*>::iterator it = std::find (loaded.begin(), loaded.end(), metadataset);
+    if (it != loaded.end())
+    {
+        loaded.splice (loaded.begin(), loaded, it);
+        return;
+    }
+
+    vtkSmartPointer<vtkDataSet> data;
+    std::map<vtkMetaDataSet*, std::future<vtkSmartPointer<vtkDataSet> > >::iterator prefetched =
+            this->Internals->Prefetched.find (metadataset);
+    if (prefetched != this->Internals->Prefetched.end())
+    {
+        data = prefetched->second.get();
+        this->Internals->Prefetched.erase (prefetched);
+    }
+    else
+    {
+        data = ReadFrameFile (metadataset->GetFilePath());
+    }
+
+    if (!data)
+    {
+        vtkErrorMacro(<<"Cannot read frame "<<metadataset->GetFilePath()<<endl);
+        return;
+    }
+
+    vtkDataSet *dataset = metadataset->GetDataSet();
+    vtkDataSet *shared = this->Internals->SharedTopology;
+    vtkPointSet *pointset = vtkPointSet::SafeDownCast (dataset);
+    vtkPointSet *datapointset = vtkPointSet::SafeDownCast (data);
+
+    // The field data belongs to the frame in memory, not to its file
+    vtkSmartPointer<vtkFieldData> fielddata = dataset->GetFieldData();
+
+    if (data->GetDataObjectType() == shared->GetDataObjectType()
+        && data->GetNumberOfPoints() == shared->GetNumberOfPoints()
+        && data->GetNumberOfCells() == shared->GetNumberOfCells())
+    {
+        // Only the attributes, and the points if they moved, are taken from the file
+        dataset->GetPointData()->ShallowCopy (data->GetPointData());
+        dataset->GetCellData()->ShallowCopy (data->GetCellData());
+        if (pointset && datapointset && !SamePoints (pointset->GetPoints(), datapointset->GetPoints()))
+        {
+            pointset->SetPoints (datapointset->GetPoints());
+        }
+    }
+    else
+    {
+        dataset->ShallowCopy (data);
+        dataset->SetFieldData (fielddata);
+    }
+    dataset->Modified();
+
+    if (!this->Internals->Ranges.count (metadataset))
+    {
+        vtkMetaDataSetSequenceInternals::FrameRanges &ranges = this->Internals->Ranges[metadataset];
+        StoreRanges (dataset->GetPointData(), ranges.Points);
+        StoreRanges (dataset->GetCellData(), ranges.Cells);
+    }
+    this->ApplyColorArray (metadataset);
+
+    loaded.push_front (metadataset);
+    while (static_cast<int>(loaded.size()) > this->FrameCacheSize)
+    {
+        this->UnloadFrame (loaded.back());
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkMetaDataSetSequence::UnloadFrame (vtkMetaDataSet *metadataset)
+{
+    this->Internals->LoadedFrames.remove (metadataset);
+
+    // The active array is released with the attributes, it is looked up again when the frame is loaded
+    metadataset->SetCurrentActiveArray (nullptr);
+
+    // Arrays still displayed are referenced by the output and stay alive until the next update
+    vtkSmartPointer<vtkFieldData> fielddata = metadataset->GetDataSet()->GetFieldData();
+    metadataset->GetDataSet()->ShallowCopy (this->Internals->SharedTopology);
+    metadataset->GetDataSet()->SetFieldData (fielddata);
+    metadataset->GetDataSet()->GetPointData()->Initialize();
+    metadataset->GetDataSet()->GetCellData()->Initialize();
+}
+
+//----------------------------------------------------------------------------
+bool vtkMetaDataSetSequence::GetFrameArrayRange (vtkMetaDataSet *metadataset, const char *name, bool inpoints, double range[2])
+{
+    if (!metadataset || !name)
+        return false;
+
+    if (!this->Internals->PagedFrames.count (metadataset))
+    {
+        vtkDataSet *dataset = metadataset->GetDataSet();
+        vtkDataArray *array = nullptr;
+        if (dataset)
+        {
+            array = inpoints ? dataset->GetPointData()->GetArray (name) : dataset->GetCellData()->GetArray (name);
+        }
+        if (!array)
+            return false;
+        array->GetRange (range);
+        return true;
+    }
+
+    // A paged frame is only read the first time, to know its ranges
+    std::map<vtkMetaDataSet*, vtkMetaDataSetSequenceInternals::FrameRanges>::iterator frameranges =
+            this->Internals->Ranges.find (metadataset);
+    if (frameranges == this->Internals->Ranges.end())
+    {
+        this->LoadFrame (metadataset);
+        frameranges = this->Internals->Ranges.find (metadataset);
+        if (frameranges == this->Internals->Ranges.end())
+            return false;
+    }
+
+    const std::map<std::string, std::pair<double, double> > &ranges =
+            inpoints ? frameranges->second.Points : frameranges->second.Cells;
+    std::map<std::string, std::pair<double, double> >::const_iterator it = ranges.find (name);
+    if (it == ranges.end())
+        return false;
+    range[0] = it->second.first;
+    range[1] = it->second.second;
+    return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkMetaDataSetSequence::GetFrameScalarRange (vtkMetaDataSet *metadataset, const char *name, double range[2])
+{
+    // As vtkMetaDataSet::GetScalarRange(): the point array, else the cell array, else [0, 1]
+    if (!this->GetFrameArrayRange (metadataset, name, true, range)
+        && !this->GetFrameArrayRange (metadataset, name, false, range))
+    {
+        range[0] = 0;
+        range[1] = 1;
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkMetaDataSetSequence::ApplyColorArray (vtkMetaDataSet *metadataset)
+{
+    const std::string &name = this->Internals->ColorArrayName;
+    if (name.empty() || !metadataset->GetDataSet())
+        return;
+
+    vtkDataSetAttributes *attributes = this->Internals->ColorArrayInPoints
+            ? static_cast<vtkDataSetAttributes*>(metadataset->GetDataSet()->GetPointData())
+            : static_cast<vtkDataSetAttributes*>(metadataset->GetDataSet()->GetCellData());
+    vtkDataArray *array = attributes->GetArray (name.c_str());
+    if (!array)
+        return;
+
+    if (this->Internals->ColorLookupTable)
+        array->SetLookupTable (this->Internals->ColorLookupTable);
+
+    attributes->SetActiveScalars (name.c_str());
+    metadataset->SetCurrentActiveArray (array);
+}
+
+//----------------------------------------------------------------------------
+void vtkMetaDataSetSequence::PrefetchFrom (unsigned int id)
+{
+    const unsigned int count = this->MetaDataSetList.size();
+    const unsigned int ahead = std::min<unsigned int>(this->PrefetchFrames, this->FrameCacheSize - 1);
+
+    for (unsigned int i = 1; i <= ahead && i < count; ++i)
+    {
+        vtkMetaDataSet *frame = this->MetaDataSetList[(id + i) % count];
+        if (!this->Internals->PagedFrames.count (frame)
+            || this->Internals->Prefetched.count (frame)
+            || std::find (this->Internals->LoadedFrames.begin(), this->Internals->LoadedFrames.end(), frame)
+               != this->Internals->LoadedFrames.end())
+        {
+            continue;
+        }
+        this->Internals->Prefetched[frame] = std::async (std::launch::async, ReadFrameFile, std::string(frame->GetFilePath()));
+    }
+}
+
 //----------------------------------------------------------------------------
 void vtkMetaDataSetSequence::RemoveMetaDataSet (unsigned int id)
 {
@@ -154,6 +564,10 @@ void vtkMetaDataSetSequence::RemoveMetaDataSet (unsigned int id)
             this->MetaDataSetList.push_back (templist[i]);
         else
         {
+            this->Internals->Prefetched.erase (templist[i]);
+            this->Internals->LoadedFrames.remove (templist[i]);
+            this->Internals->PagedFrames.erase (templist[i]);
+            this->Internals->Ranges.erase (templist[i]);
             templist[i]->UnRegister(this);
         }
     }
@@ -163,6 +577,7 @@ void vtkMetaDataSetSequence::RemoveMetaDataSet (unsigned int id)
     if (this->MetaDataSetList.size() == 0)
     {
         this->Type = vtkMetaDataSet::VTK_META_UNKNOWN;
+        this->Internals->SharedTopology = nullptr;
         if (this->DataSet)
         {
             this->DataSet->Delete();
@@ -186,6 +601,12 @@ void vtkMetaDataSetSequence::RemoveMetaDataSet (vtkMetaDataSet *metadataset)
 //----------------------------------------------------------------------------
 void vtkMetaDataSetSequence::RemoveAllMetaDataSets()
 {
+    this->Internals->Prefetched.clear();
+    this->Internals->LoadedFrames.clear();
+    this->Internals->PagedFrames.clear();
+    this->Internals->Ranges.clear();
+    this->Internals->SharedTopology = nullptr;
+
     for (unsigned int i=0; i<this->MetaDataSetList.size(); i++)
     {
         this->MetaDataSetList[i]->UnRegister(this);
@@ -205,6 +626,7 @@ vtkMetaDataSet*vtkMetaDataSetSequence::GetMetaDataSet (unsigned int i)
 {
     if (i>=this->MetaDataSetList.size())
         return nullptr;
+    this->LoadFrame (this->MetaDataSetList[i]);
     return this->MetaDataSetList[i];
 }
 
@@ -380,8 +802,28 @@ void vtkMetaDataSetSequence::UpdateToIndex (unsigned int id)
     if (id >= this->MetaDataSetList.size())
         return;
 
+    this->LoadFrame (this->MetaDataSetList[id]);
     vtkDataSet *datasettoshow  = this->MetaDataSetList[id]->GetDataSet();
 
+    // Names of the displayed attributes, kept from one frame to the other
+    std::string pdscalars, cdscalars, pdtensors, cdtensors;
+    if (this->ParseAttributes)
+    {
+        vtkDataArray *array = this->GetDataSet()->GetPointData()->GetScalars();
+        if (array && array->GetName())
+            pdscalars = array->GetName();
+        array = this->GetDataSet()->GetCellData()->GetScalars();
+        if (array && array->GetName())
+            cdscalars = array->GetName();
+        array = this->GetDataSet()->GetPointData()->GetTensors();
+        if (array && array->GetName())
+            pdtensors = array->GetName();
+        array = this->GetDataSet()->GetCellData()->GetTensors();
+        if (array && array->GetName())
+            cdtensors = array->GetName();
+    }
+
+    // The output references the points, cells and arrays of the frame, nothing is copied
     vtkPolyData *polydatatoshow   = vtkPolyData::SafeDownCast (datasettoshow);
     vtkPolyData *polydatatochange = vtkPolyData::SafeDownCast (this->GetDataSet());
 
@@ -397,92 +839,25 @@ void vtkMetaDataSetSequence::UpdateToIndex (unsigned int id)
 
     if (this->ParseAttributes)
     {
-        vtkDataArray *pdscalars = this->GetDataSet()->GetPointData()->GetScalars();
-        vtkDataArray *cdscalars = this->GetDataSet()->GetCellData()->GetScalars();
-        vtkDataArray *pdtensors = this->GetDataSet()->GetPointData()->GetTensors();
-        vtkDataArray *cdtensors = this->GetDataSet()->GetCellData()->GetTensors();
-
-        if (pdscalars)
-        {
-            const char *c_name = pdscalars->GetName();
-            if ( c_name && (*c_name) )
-            {
-                std::string name = c_name;
-                vtkDataArray *array = datasettoshow->GetPointData()->GetArray(name.c_str());
-                if (array)
-                {
-                    pdscalars->DeepCopy (array);
-                }
-            }
-            else
-            {
-                this->GetDataSet()->GetPointData()->SetScalars(datasettoshow->GetPointData()->GetScalars());
-            }
-
-            this->GetDataSet()->GetPointData()->Modified();
-            this->GetDataSet()->Modified();
-        }
-
-        if (cdscalars)
-        {
-            const char *c_name = cdscalars->GetName();
-            if ( c_name && (*c_name) )
-            {
-                std::string name = c_name;
-                vtkDataArray *array = datasettoshow->GetCellData()->GetArray(name.c_str());
-
-                if (array)
-                {
-                    cdscalars->DeepCopy (array);
-                }
-            }
-            else
-            {
-                this->GetDataSet()->GetCellData()->SetScalars(datasettoshow->GetCellData()->GetScalars());
-            }
-            this->GetDataSet()->GetCellData()->Modified();
-        }
-        if (pdtensors)
-        {
-            const char *c_name = pdtensors->GetName();
-            if ( c_name && (*c_name) )
-            {
-                std::string name = c_name;
-                vtkDataArray *array = datasettoshow->GetPointData()->GetArray(name.c_str());
-                if (array)
-                {
-                    pdtensors->DeepCopy (array);
-                }
-            }
-            else
-            {
-                this->GetDataSet()->GetPointData()->SetTensors(datasettoshow->GetPointData()->GetTensors());
-            }
-
-            this->GetDataSet()->GetPointData()->Modified();
-        }
-
-        if (cdtensors)
-        {
-            const char *c_name = cdtensors->GetName();
-            if ( c_name && (*c_name) )
-            {
-                std::string name = c_name;
-                vtkDataArray *array = datasettoshow->GetCellData()->GetArray(name.c_str());
-
-                if (array)
-                {
-                    cdtensors->DeepCopy (array);
-                }
-            }
-            else
-            {
-                this->GetDataSet()->GetCellData()->SetTensors(datasettoshow->GetCellData()->GetTensors());
-            }
-            this->GetDataSet()->GetCellData()->Modified();
-        }
+        vtkPointData *pointdata = this->GetDataSet()->GetPointData();
+        vtkCellData *celldata = this->GetDataSet()->GetCellData();
+
+        if (!pdscalars.empty() && pointdata->HasArray (pdscalars.c_str()))
+            pointdata->SetActiveScalars (pdscalars.c_str());
+        if (!cdscalars.empty() && celldata->HasArray (cdscalars.c_str()))
+            celldata->SetActiveScalars (cdscalars.c_str());
+        if (!pdtensors.empty() && pointdata->HasArray (pdtensors.c_str()))
+            pointdata->SetActiveTensors (pdtensors.c_str());
+        if (!cdtensors.empty() && celldata->HasArray (cdtensors.c_str()))
+            celldata->SetActiveTensors (cdtensors.c_str());
+
+        pointdata->Modified();
+        celldata->Modified();
+        this->GetDataSet()->Modified();
     }
 
+    this->PrefetchFrom (id);
+
     // updating the current id
     this->CurrentId   = id;
 }
@@ -496,7 +871,8 @@ double*vtkMetaDataSetSequence::GetCurrentScalarRange()
 
     for (unsigned int i=0; i<this->MetaDataSetList.size(); i++)
     {
-        double *range = this->MetaDataSetList[i]->GetScalarRange();
+        double range[2];
+        this->GetFrameScalarRange (this->MetaDataSetList[i], this->Internals->ColorArrayName.c_str(), range);
 
         if (val[0] > range[0])
             val[0] = range[0];
@@ -530,37 +906,30 @@ void vtkMetaDataSetSequence::ColorByArray(vtkDataArray *array)
 
     vtkLookupTable *lut = array->GetLookupTable();
 
+    // The array is found by name in each frame, paged frames not loaded get it when they are
+    this->Internals->ColorArrayName = array->GetName() ? array->GetName() : "";
+    this->Internals->ColorArrayInPoints = array_is_in_points;
+    this->Internals->ColorLookupTable = lut;
+
     for (unsigned int i=0; i<this->MetaDataSetList.size(); i++)
     {
-        vtkDataArray *junk;
-        vtkDataSetAttributes *attributes;
-
-        if (array_is_in_points)
-        {
-            junk = this->MetaDataSetList[i]->GetDataSet()->GetPointData()->GetArray (array->GetName());
-            attributes = this->MetaDataSetList[i]->GetDataSet()->GetPointData();
-        }
-        else
-        {
-            junk = this->MetaDataSetList[i]->GetDataSet()->GetCellData()->GetArray (array->GetName());
-            attributes = this->MetaDataSetList[i]->GetDataSet()->GetCellData();
-        }
+        vtkMetaDataSet *frame = this->MetaDataSetList[i];
 
-        if (!junk)
+        double range[2];
+        if (!this->GetFrameArrayRange (frame, this->Internals->ColorArrayName.c_str(), array_is_in_points, range))
             continue;
 
-        if (min > junk->GetRange()[0])
-            min = junk->GetRange()[0];
-        if (max < junk->GetRange()[1])
-            max = junk->GetRange()[1];
-
+        if (min > range[0])
+            min = range[0];
+        if (max < range[1])
+            max = range[1];
 
-        if (lut)
-            junk->SetLookupTable (lut);
-
-        attributes->SetActiveScalars(array->GetName());
-
-        this->MetaDataSetList[i]->SetCurrentActiveArray (junk);
+        if (!this->Internals->PagedFrames.count (frame)
+            || std::find (this->Internals->LoadedFrames.begin(), this->Internals->LoadedFrames.end(), frame)
+               != this->Internals->LoadedFrames.end())
+        {
+            this->ApplyColorArray (frame);
+        }
     }
 
     if (lut)
@@ -717,9 +1086,12 @@ double* vtkMetaDataSetSequence::GetScalarRange(QString attributeName)
     val[0] = VTK_DOUBLE_MAX;
     val[1] = VTK_DOUBLE_MIN;
 
+    std::string name = attributeName.trimmed().isEmpty() ? this->Internals->ColorArrayName : attributeName.toStdString();
+
     for (unsigned int i = 0; i < this->MetaDataSetList.size(); i++)
     {
-      double* range = this->MetaDataSetList[i]->GetScalarRange(attributeName);
+      double range[2];
+      this->GetFrameScalarRange (this->MetaDataSetList[i], name.c_str(), range);
 
       if (val[0] > range[0])
       {
@@ -31,6 +31,13 @@
    can be updated to a specific time with UpdateToTime().
 
    It does not compute any time interpolation. 
+
+   When the SameGeometryFlag is set, frames with the connectivity of the first one share
+   it, and their points too when these are equal, so that the topology is stored once.
+   Frames added with AddPagedMetaDataSet() only keep this shared topology in memory: their
+   point and cell data are read from their file when the sequence is updated to them, kept
+   in a cache of FrameCacheSize frames, and the next PrefetchFrames frames are read ahead
+   in the background.
    
    \see
    vtkMetaSurfaceMesh vtkMetaVolumeMesh
@@ -39,6 +46,7 @@
 
 
 class vtkDoubleArray;
+struct vtkMetaDataSetSequenceInternals;
 
 class MEDVTKDATAMESHBASE_EXPORT vtkMetaDataSetSequence: public vtkMetaDataSet
 {
@@ -59,6 +67,13 @@ class MEDVTKDATAMESHBASE_EXPORT vtkMetaDataSetSequence: public vtkMetaDataSet
      adding new heterogeneous vtkMetaDataSet will fail.
   */
   virtual void AddMetaDataSet (vtkMetaDataSet* metadataset);
+  /**
+     Insert a frame at the given time whose attributes are read from filename on demand.
+     The frame has the topology of the first frame of the sequence, which must have been
+     added with AddMetaDataSet(). If the file holds a different topology, the frame uses
+     the one of the file once loaded. Returns the frame, owned by the sequence.
+  */
+  virtual vtkMetaDataSet* AddPagedMetaDataSet (const char* filename, double time);
   /**
      Remove a given vtkMetaDataSet from the sequence.
      This will unregister the given vtkMetaDataSet from the sequence.
@@ -95,13 +110,14 @@ class MEDVTKDATAMESHBASE_EXPORT vtkMetaDataSetSequence: public vtkMetaDataSet
   virtual void UpdateToIndex (unsigned int id = 0);
 
   /**
-     Access to one of the vtkMetaDataSet in the sequence list
+     Access to one of the vtkMetaDataSet in the sequence list.
+     A paged frame is loaded first.
   */
   virtual vtkMetaDataSet* GetMetaDataSet (unsigned int i);
 
   /**
      Access to the entire list of vtkMetaDataSet.
-     Use with care.
+     Paged frames in this list may not be loaded, use GetMetaDataSet() to access their attributes.
   */
   //BTX
   std::vector<vtkMetaDataSet*> GetMetaDataSetList() const
@@ -211,6 +227,15 @@ class MEDVTKDATAMESHBASE_EXPORT vtkMetaDataSetSequence: public vtkMetaDataSet
   double* GetScalarRange(QString attributeName = QString()) override;
 
   vtkGetMacro (CurrentId, int);
+
+  /**
+     Number of paged frames kept loaded, and number of frames after the current one
+     read ahead when updating the sequence.
+  */
+  vtkGetMacro (FrameCacheSize, int);
+  vtkSetClampMacro (FrameCacheSize, int, 1, VTK_INT_MAX);
+  vtkGetMacro (PrefetchFrames, int);
+  vtkSetClampMacro (PrefetchFrames, int, 0, VTK_INT_MAX);
   
 protected:
   vtkMetaDataSetSequence();
@@ -225,6 +250,26 @@ protected:
      Internal use : Build the output from a given vtkMetaDataSet.
   */
   virtual void   BuildMetaDataSetFromMetaDataSet (vtkMetaDataSet* metadataset);
+  /**
+     Internal use : Make the dataset of a frame share the topology of the first frame.
+  */
+  virtual void   ShareTopology (vtkMetaDataSet* metadataset);
+  /**
+     Internal use : Read the attributes of a paged frame if they are not loaded.
+  */
+  virtual void   LoadFrame (vtkMetaDataSet* metadataset);
+  virtual void   UnloadFrame (vtkMetaDataSet* metadataset);
+  virtual void   PrefetchFrom (unsigned int id);
+  /**
+     Internal use : Range of an array of a frame, from the ranges kept for paged frames.
+     GetFrameScalarRange() looks in the point then cell arrays, and is [0, 1] if none is found.
+  */
+  virtual bool   GetFrameArrayRange (vtkMetaDataSet* metadataset, const char* name, bool inpoints, double range[2]);
+  virtual void   GetFrameScalarRange (vtkMetaDataSet* metadataset, const char* name, double range[2]);
+  /**
+     Internal use : Make the array the sequence is colored by the active one of a loaded frame.
+  */
+  virtual void   ApplyColorArray (vtkMetaDataSet* metadataset);
   
   
   //BTX
@@ -234,7 +279,11 @@ protected:
  private:
   void operator=(const vtkMetaDataSetSequence&);              // Not implemented.
 
+  vtkMetaDataSetSequenceInternals *Internals;
+
   int    CurrentId;
+  int    FrameCacheSize;
+  int    PrefetchFrames;
   double SequenceDuration;
   bool   SameGeometryFlag;
   bool  ParseAttributes;
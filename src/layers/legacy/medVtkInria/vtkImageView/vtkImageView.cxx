@@ -324,11 +324,13 @@ vtkAlgorithmOutput* vtkImageView::ResliceImageToInput(vtkAlgorithmOutput* pi_poV
         return nullptr;
     }
 
+    // No matrix is the identity, the input does not need to be resliced if the view is not oriented either
+    vtkSmartPointer<vtkMatrix4x4> identity = vtkSmartPointer<vtkMatrix4x4>::New();
     if ( pi_poVtkAlgoPort &&
          this->Compare(image->GetOrigin(),  this->GetMedVtkImageInfo()->origin, 3) &&
          this->Compare(image->GetSpacing(), this->GetMedVtkImageInfo()->spacing, 3) &&
          this->Compare(image->GetExtent(),  this->GetMedVtkImageInfo()->extent, 6) &&
-         (matrix && this->Compare(matrix, this->OrientationMatrix)) )
+         this->Compare(matrix ? matrix : identity.GetPointer(), this->OrientationMatrix) )
     {
         poResOutput = pi_poVtkAlgoPort;
     }
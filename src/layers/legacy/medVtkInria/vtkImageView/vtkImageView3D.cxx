@@ -20,15 +20,16 @@
 #include <vtkActor.h>
 #include <vtkAnnotatedCubeActor.h>
 #include <vtkColorTransferFunction.h>
+#include <vtkDataArray.h>
 #include <vtkDataSetCollection.h>
 #include <vtkDataSetSurfaceFilter.h>
 #include <vtkImageActor.h>
-#include <vtkImageAppendComponents.h>
-#include <vtkImageCast.h>
+#include <vtkImageData.h>
 #include <vtkImageMapper3D.h>
 #include <vtkImageMapToColors.h>
 #include <vtkInteractorStyleTrackball.h>
 #include <vtkPiecewiseFunction.h>
+#include <vtkPointData.h>
 #include <vtkPointSet.h>
 #include <vtkPolyDataMapper.h>
 #include <vtkPolyDataNormals.h>
@@ -38,11 +39,53 @@
 #include <vtkRenderWindow.h>
 #include <vtkRenderWindowInteractor.h>
 #include <vtkRendererCollection.h>
+#include <vtkSMPTools.h>
 #include <vtkSmartVolumeMapper.h>
 #include <vtkTextProperty.h>
+#include <vtkTrivialProducer.h>
 
 vtkStandardNewMacro(vtkImageView3D)
 
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Writes the components of a layer at their offset in the interleaved combined image,
+// converting them to its scalar type.
+template <class TIn, class TOut>
+void CopyLayerComponents(vtkImageData *input, TIn *, vtkImageData *combined, TOut *, int offset)
+{
+    const TIn *source = static_cast<TIn *>(input->GetScalarPointer());
+    TOut *destination = static_cast<TOut *>(combined->GetScalarPointer()) + offset;
+    const int inputComponents = input->GetNumberOfScalarComponents();
+    const int combinedComponents = combined->GetNumberOfScalarComponents();
+
+    auto copy = [=](vtkIdType begin, vtkIdType end)
+    {
+        const TIn *in = source + begin * inputComponents;
+        TOut *out = destination + begin * combinedComponents;
+        for (vtkIdType i = begin; i < end; ++i, in += inputComponents, out += combinedComponents)
+        {
+            for (int c = 0; c < inputComponents; ++c)
+            {
+                out[c] = static_cast<TOut>(in[c]);
+            }
+        }
+    };
+    vtkSMPTools::For(0, input->GetNumberOfPoints(), copy);
+}
+
+template <class TIn>
+void CopyLayerComponents(vtkImageData *input, TIn *, vtkImageData *combined, int offset)
+{
+    switch (combined->GetScalarType())
+    {
+        vtkTemplateMacro(CopyLayerComponents(input, static_cast<TIn *>(nullptr), combined, static_cast<VTK_TT *>(nullptr), offset));
+    }
+}
+
+}
+
 //----------------------------------------------------------------------------
 vtkImageView3D::vtkImageView3D()
 {
@@ -67,6 +110,10 @@ vtkImageView3D::vtkImageView3D()
   ExtraPlaneCollection = vtkProp3DCollection::New();
   ExtraPlaneInputCollection = vtkProp3DCollection::New();
 
+  CombinedImage = vtkSmartPointer<vtkImageData>::New();
+  CombinedImageProducer = vtkSmartPointer<vtkTrivialProducer>::New();
+  CombinedImageProducer->SetOutput(CombinedImage);
+
   LayerInfoVec.resize(1);
   LayerInfoVec[0].ImageDisplay = vtkSmartPointer<vtkImage3DDisplay>::New();
 
@@ -484,18 +531,9 @@ bool vtkImageView3D::data2DTreatment()
 //----------------------------------------------------------------------------
 void vtkImageView3D::SetInputLayer(vtkAlgorithmOutput* pi_poVtkAlgoOutput, vtkMatrix4x4 *matrix /*= 0*/, int layer /*= 0*/)
 {
+    // The scalar type of the first layer is only needed in the combined image, where
+    // the components are converted while copied
     auto *poVtkAlgoOutputTmp = ResliceImageToInput(pi_poVtkAlgoOutput, matrix);
-    // cast it if needed
-    int inputImgScalarType = static_cast<vtkImageAlgorithm*>(poVtkAlgoOutputTmp->GetProducer())->GetOutput()->GetScalarType();
-    if (inputImgScalarType != GetMedVtkImageInfo()->scalarType)
-    {
-        auto *cast = vtkImageCast::New();
-        cast->SetInputConnection(poVtkAlgoOutputTmp);
-        cast->SetOutputScalarType (GetMedVtkImageInfo()->scalarType);
-        cast->Update();
-
-        poVtkAlgoOutputTmp = cast->GetOutputPort();
-    }
 
     AddLayer(layer);
     GetImage3DDisplayForLayer(layer)->SetInputProducer(poVtkAlgoOutputTmp);
@@ -528,21 +566,8 @@ void vtkImageView3D::InternalUpdate()
                               (m_poInternalImageFromInput->GetNumberOfScalarComponents() == 3 ||
                                m_poInternalImageFromInput->GetNumberOfScalarComponents() == 4 ));
 
-    auto *appender = vtkImageAppendComponents::New();
-    if (LayerInfoVec.size()>0 && !multichannelInput)
-    {
-        // append all scalar buffer into the same image
-        for (auto &it : this->LayerInfoVec)
-        {
-            if (it.ImageDisplay->GetInputProducer())
-            {
-                appender->AddInputConnection(it.ImageDisplay->GetInputProducer()->GetOutputPort());
-            }
-        }
-    }
-    appender->Update();
-    appender->GetOutput();
-    VolumeMapper->SetInputConnection( appender->GetOutputPort());
+    auto *volumeOutput = UpdateCombinedImage();
+    VolumeMapper->SetInputConnection(volumeOutput);
     VolumeMapper->Update();
     VolumeMapper->Modified();
 
@@ -554,9 +579,9 @@ void vtkImageView3D::InternalUpdate()
         //shading and more than one dependent component (rgb) don't work well...
         //as vtk stands now in debug mode an assert makes this crash.
         VolumeProperty->ShadeOff();
-        ActorX->GetMapper()->SetInputConnection(appender->GetOutputPort());
-        ActorY->GetMapper()->SetInputConnection(appender->GetOutputPort());
-        ActorZ->GetMapper()->SetInputConnection(appender->GetOutputPort());
+        ActorX->GetMapper()->SetInputConnection(volumeOutput);
+        ActorY->GetMapper()->SetInputConnection(volumeOutput);
+        ActorZ->GetMapper()->SetInputConnection(volumeOutput);
     }
     else if(LayerInfoVec.size()>0)
     {
@@ -594,17 +619,112 @@ void vtkImageView3D::InternalUpdate()
     }
     // Read bounds and use these to place widget, rather than force whole dataset to be read.
 
-    auto image = appender->GetOutput();
-    double * bounds = image->GetBounds();
+    double bounds[6] = {0.0, -1.0, 0.0, -1.0, 0.0, -1.0};
+    if (volumeOutput)
+    {
+        vtkImageData::SafeDownCast(volumeOutput->GetProducer()->GetOutputDataObject(volumeOutput->GetIndex()))->GetBounds(bounds);
+    }
 
-    BoxWidget->SetInputConnection(appender->GetOutputPort());
+    BoxWidget->SetInputConnection(volumeOutput);
     BoxWidget->PlaceWidget (bounds);
     Callback->Execute (BoxWidget, 0, bounds);
-    PlaneWidget->SetInputConnection(appender->GetOutputPort());
+    PlaneWidget->SetInputConnection(volumeOutput);
     PlaneWidget->PlaceWidget(bounds);
     UpdateDisplayExtent();
+}
+
+//----------------------------------------------------------------------------
+/**
+ The volume mapper renders the layers as the components of one image. A single
+ layer is used as it is; several are copied into CombinedImage, which is only
+ reallocated when its geometry, scalar type or number of components changes.
+ Otherwise only the layers whose image was replaced or modified are copied.
+*/
+vtkAlgorithmOutput* vtkImageView3D::UpdateCombinedImage()
+{
+    std::vector<size_t> layers;
+    for (size_t i = 0; i < LayerInfoVec.size(); ++i)
+    {
+        auto *producer = LayerInfoVec[i].ImageDisplay->GetInputProducer();
+        if (producer)
+        {
+            producer->Update();
+            layers.push_back(i);
+        }
+    }
+
+    if (layers.empty())
+    {
+        return nullptr;
+    }
+
+    auto *firstProducer = LayerInfoVec[layers[0]].ImageDisplay->GetInputProducer();
+    auto *first = firstProducer->GetOutput();
+    bool multichannelInput = (first->GetScalarType() == VTK_UNSIGNED_CHAR &&
+                              (first->GetNumberOfScalarComponents() == 3 ||
+                               first->GetNumberOfScalarComponents() == 4 ));
+    if (layers.size() == 1 || multichannelInput)
+    {
+        CombinedImage->ReleaseData();
+        for (auto &it : LayerInfoVec)
+        {
+            it.CombinedInput = nullptr;
+        }
+        return firstProducer->GetOutputPort();
+    }
+
+    int components = 0;
+    for (size_t i : layers)
+    {
+        auto *image = LayerInfoVec[i].ImageDisplay->GetInputProducer()->GetOutput();
+        if (image->GetNumberOfPoints() != first->GetNumberOfPoints())
+        {
+            vtkErrorMacro( <<"Layer " << i << " does not match the geometry of the first layer" );
+            return firstProducer->GetOutputPort();
+        }
+        components += image->GetNumberOfScalarComponents();
+    }
+
+    bool geometryChanged = CombinedImage->GetPointData()->GetScalars() == nullptr ||
+                           CombinedImage->GetScalarType() != first->GetScalarType() ||
+                           CombinedImage->GetNumberOfScalarComponents() != components ||
+                           !Compare(CombinedImage->GetExtent(), first->GetExtent(), 6) ||
+                           !Compare(CombinedImage->GetSpacing(), first->GetSpacing(), 3) ||
+                           !Compare(CombinedImage->GetOrigin(), first->GetOrigin(), 3);
+    if (geometryChanged)
+    {
+        CombinedImage->SetExtent(first->GetExtent());
+        CombinedImage->SetSpacing(first->GetSpacing());
+        CombinedImage->SetOrigin(first->GetOrigin());
+        CombinedImage->AllocateScalars(first->GetScalarType(), components);
+    }
+
+    bool combinedModified = geometryChanged;
+    int offset = 0;
+    for (size_t i : layers)
+    {
+        LayerInfo &info = LayerInfoVec[i];
+        auto *image = info.ImageDisplay->GetInputProducer()->GetOutput();
+        if (geometryChanged || info.CombinedInput != image || info.CombinedInputMTime < image->GetMTime())
+        {
+            switch (image->GetScalarType())
+            {
+                vtkTemplateMacro(CopyLayerComponents(image, static_cast<VTK_TT *>(nullptr), CombinedImage, offset));
+            }
+            info.CombinedInput = image;
+            info.CombinedInputMTime = image->GetMTime();
+            combinedModified = true;
+        }
+        offset += image->GetNumberOfScalarComponents();
+    }
+
+    if (combinedModified)
+    {
+        CombinedImage->GetPointData()->GetScalars()->Modified();
+        CombinedImage->Modified();
+    }
 
-    appender->Delete();
+    return CombinedImageProducer->GetOutputPort();
 }
 
 //----------------------------------------------------------------------------
@@ -20,6 +20,7 @@
 #include <vtkOrientedBoxWidget.h>
 #include <vtkPlaneWidget.h>
 #include <vtkVolumeProperty.h>
+#include <vtkWeakPointer.h>
 
 class vtkVolume;
 class vtkPiecewiseFunction;
@@ -37,6 +38,7 @@ class vtkColorTransferFunction;
 class vtkSmartVolumeMapper;
 class vtkImage3DDisplay;
 class vtkProp3DCollection;
+class vtkTrivialProducer;
 
 /**
    \class vtkImageView3D vtkImageView3D.h "vtkImageView3D.h"
@@ -227,6 +229,7 @@ protected:
     virtual void UpdateVolumeFunctions(int layer);
     void ApplyColorTransferFunction(vtkScalarsToColors *, int) override;
     virtual void InternalUpdate();
+    virtual vtkAlgorithmOutput* UpdateCombinedImage();
 
     vtkImage3DDisplay * GetImage3DDisplayForLayer(int layer) const;
 
@@ -283,8 +286,16 @@ protected:
 
     struct LayerInfo {
         vtkSmartPointer<vtkImage3DDisplay> ImageDisplay;
+        // Image whose components are in CombinedImage, and its modification time then
+        vtkWeakPointer<vtkImageData> CombinedInput;
+        vtkMTimeType CombinedInputMTime = 0;
     };
 
+    // Components of all the layers, for the volume mapper. Reallocated when
+    // the geometry changes, otherwise only the layers modified are copied.
+    vtkSmartPointer<vtkImageData>       CombinedImage;
+    vtkSmartPointer<vtkTrivialProducer> CombinedImageProducer;
+
     vtkSmartPointer<vtkImageMapToColors>        PlanarWindowLevelX;
     vtkSmartPointer<vtkImageMapToColors>        PlanarWindowLevelY;
     vtkSmartPointer<vtkImageMapToColors>        PlanarWindowLevelZ;
@@ -14,6 +14,8 @@
 #include <medJobManager.h>
 
 #include <QApplication>
+#include <QElapsedTimer>
+#include <QThread>
 #include <QThreadPool>
 
 #include <dtkLog>
@@ -30,15 +32,52 @@ medJobManager* medJobManager::instance()
     return s_instance;
 }
 
+struct medScheduledJob
+{
+    medAbstractJob *job;
+    medJobManager::JobCategory category;
+    int priority;
+    bool memoryHeavy;
+    QElapsedTimer queuedTimer;
+    qint64 waitTime;
+    QElapsedTimer runningTimer;
+};
+
 class medJobManagerPrivate
 {
 public:
     QList<medAbstractJob *> jobs;
+
+    QThreadPool pools[3]; // one per medJobManager::JobCategory
+    QList<medScheduledJob> queuedJobs; // sorted by decreasing priority
+    QList<medScheduledJob> runningJobs;
+    int runningMemoryHeavyJobs;
+    int maxMemoryHeavyJobs;
+
+    int jobCount(const QList<medScheduledJob> &scheduledJobs, medJobManager::JobCategory category) const
+    {
+        int count = 0;
+        for (const medScheduledJob &scheduledJob : scheduledJobs)
+        {
+            if (scheduledJob.category == category)
+            {
+                ++count;
+            }
+        }
+        return count;
+    }
 };
 
 medJobManager::medJobManager(QObject *parent)
     : QObject(parent), d(new medJobManagerPrivate)
 {
+    int idealThreadCount = QThread::idealThreadCount();
+    d->pools[InteractiveJob].setMaxThreadCount(qMax(2, idealThreadCount / 2));
+    d->pools[ComputeJob].setMaxThreadCount(qMax(1, idealThreadCount));
+    d->pools[IOJob].setMaxThreadCount(2);
+    d->runningMemoryHeavyJobs = 0;
+    d->maxMemoryHeavyJobs = qMax(1, idealThreadCount / 4);
+
     // register medAbstractJob::medJobExitStatus at run-time
     // to use the type it in queued signal and slot connections
     qRegisterMetaType<medAbstractJob::medJobExitStatus>("medJobExitStatus");
@@ -62,6 +101,16 @@ void medJobManager::registerJob(medAbstractJob *job)
 void medJobManager::unregisterJob(medAbstractJob *job)
 {
     d->jobs.removeAll(job);
+
+    // a deleted job must not be started later on
+    for (int i = 0; i < d->queuedJobs.size(); ++i)
+    {
+        if (d->queuedJobs[i].job == job)
+        {
+            d->queuedJobs.removeAt(i);
+            break;
+        }
+    }
 }
 
 QList<medAbstractJob *> medJobManager::jobs() const
@@ -69,9 +118,152 @@ QList<medAbstractJob *> medJobManager::jobs() const
     return d->jobs;
 }
 
-void medJobManager::startJobInThread(medAbstractJob *job)
+void medJobManager::startJobInThread(medAbstractJob *job, JobCategory category, int priority, bool memoryHeavy)
+{
+    medScheduledJob scheduledJob;
+    scheduledJob.job = job;
+    scheduledJob.category = category;
+    scheduledJob.priority = priority;
+    scheduledJob.memoryHeavy = memoryHeavy;
+    scheduledJob.waitTime = 0;
+    scheduledJob.queuedTimer.start();
+
+    int position = 0;
+    while (position < d->queuedJobs.size() && d->queuedJobs[position].priority >= priority)
+    {
+        ++position;
+    }
+    d->queuedJobs.insert(position, scheduledJob);
+
+    emit jobQueued(job);
+
+    dispatchJobs();
+}
+
+bool medJobManager::cancelQueuedJob(medAbstractJob *job)
+{
+    for (int i = 0; i < d->queuedJobs.size(); ++i)
+    {
+        if (d->queuedJobs[i].job == job)
+        {
+            d->queuedJobs.removeAt(i);
+            emit job->finished(medAbstractJob::MED_JOB_EXIT_CANCELLED);
+            return true;
+        }
+    }
+    return false;
+}
+
+int medJobManager::queuedJobCount(JobCategory category) const
+{
+    return d->jobCount(d->queuedJobs, category);
+}
+
+int medJobManager::runningJobCount(JobCategory category) const
+{
+    return d->jobCount(d->runningJobs, category);
+}
+
+int medJobManager::activeJobCount() const
+{
+    return d->queuedJobs.size() + d->runningJobs.size();
+}
+
+bool medJobManager::waitForDone(int msecs)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // Finished jobs are only removed, and queued ones started, by queued calls to jobDone()
+    while (activeJobCount() > 0)
+    {
+        int remaining = -1;
+        if (msecs >= 0)
+        {
+            remaining = msecs - static_cast<int>(timer.elapsed());
+            if (remaining <= 0)
+            {
+                return false;
+            }
+        }
+        for (QThreadPool &pool : d->pools)
+        {
+            pool.waitForDone(remaining >= 0 ? qMin(remaining, 100) : 100);
+        }
+        QCoreApplication::processEvents();
+    }
+    return true;
+}
+
+QThreadPool* medJobManager::threadPool(JobCategory category) const
+{
+    return &d->pools[category];
+}
+
+void medJobManager::setMaxMemoryHeavyJobs(int count)
+{
+    d->maxMemoryHeavyJobs = qMax(1, count);
+    dispatchJobs();
+}
+
+int medJobManager::maxMemoryHeavyJobs() const
+{
+    return d->maxMemoryHeavyJobs;
+}
+
+/**
+ * Starts the queued jobs, by decreasing priority, as long as the pool
+ * of their category has an idle thread and the memory heavy jobs limit is not reached.
+ */
+void medJobManager::dispatchJobs()
 {
-    QThreadPool::globalInstance()->start(new medJobRunner(job));
+    for (int i = 0; i < d->queuedJobs.size(); )
+    {
+        medScheduledJob scheduledJob = d->queuedJobs[i];
+        QThreadPool &pool = d->pools[scheduledJob.category];
+
+        if (d->jobCount(d->runningJobs, scheduledJob.category) >= pool.maxThreadCount() ||
+            (scheduledJob.memoryHeavy && d->runningMemoryHeavyJobs >= d->maxMemoryHeavyJobs))
+        {
+            ++i;
+            continue;
+        }
+
+        d->queuedJobs.removeAt(i);
+        scheduledJob.waitTime = scheduledJob.queuedTimer.elapsed();
+        scheduledJob.runningTimer.start();
+        d->runningJobs << scheduledJob;
+        if (scheduledJob.memoryHeavy)
+        {
+            ++d->runningMemoryHeavyJobs;
+        }
+
+        medAbstractJob *job = scheduledJob.job;
+        medJobRunner *runner = new medJobRunner(job);
+        connect(runner, &medJobRunner::done, this, [this, job]() { jobDone(job); }, Qt::QueuedConnection);
+        pool.start(runner);
+
+        emit jobStarted(job, scheduledJob.waitTime);
+    }
+}
+
+void medJobManager::jobDone(medAbstractJob *job)
+{
+    for (int i = 0; i < d->runningJobs.size(); ++i)
+    {
+        if (d->runningJobs[i].job == job)
+        {
+            medScheduledJob scheduledJob = d->runningJobs.takeAt(i);
+            if (scheduledJob.memoryHeavy)
+            {
+                --d->runningMemoryHeavyJobs;
+            }
+            emit jobFinished(job, scheduledJob.waitTime, scheduledJob.runningTimer.elapsed());
+            break;
+        }
+    }
+
+    dispatchJobs();
 }
 
 medJobRunner::medJobRunner(medAbstractJob *job)
@@ -109,4 +301,5 @@ void medJobRunner::run()
     }
     emit m_job->finished(jobExitStatus);
     emit m_job->running(false);
+    emit done();
 }
@@ -17,6 +17,8 @@
 
 #include <medCoreExport.h>
 
+class QThreadPool;
+
 class medAbstractJob;
 
 class medJobManagerPrivate;
@@ -33,13 +35,65 @@ private:
 public:
     static medJobManager *instance();
 
+    /**
+     * Jobs are started in the pool of their category, each with its own threads and
+     * limit, so that long computations do not delay short interactive jobs or file transfers.
+     */
+    enum JobCategory
+    {
+        InteractiveJob,
+        ComputeJob,
+        IOJob
+    };
+
 public:
     void registerJob(medAbstractJob *job);
     void unregisterJob(medAbstractJob *job);
     QList<medAbstractJob *> jobs() const;
 
 public:
-     void startJobInThread(medAbstractJob* job);
+    /**
+     * Queues the job in the pool of its category. The pools are the manager's own, not
+     * the global one shared with Qt, ITK and VTK. Queued jobs start by decreasing priority,
+     * in the order they were queued for equal priorities. At most maxMemoryHeavyJobs()
+     * jobs flagged as memory heavy run at the same time, whatever their category.
+     */
+    void startJobInThread(medAbstractJob* job, JobCategory category = ComputeJob, int priority = 0, bool memoryHeavy = false);
+
+    /**
+     * Removes a job which has not started yet from its queue. The job then emits
+     * finished(MED_JOB_EXIT_CANCELLED). Returns false if the job is not queued.
+     */
+    bool cancelQueuedJob(medAbstractJob* job);
+
+    int queuedJobCount(JobCategory category) const;
+    int runningJobCount(JobCategory category) const;
+
+    //! Queued and running jobs, of all categories
+    int activeJobCount() const;
+
+    /**
+     * Waits for the queued and running jobs to finish, processing events meanwhile
+     * so that queued jobs are started. Returns false if msecs elapsed first.
+     */
+    bool waitForDone(int msecs = -1);
+
+    //! The pool's maxThreadCount() is the number of jobs of the category run at the same time
+    QThreadPool* threadPool(JobCategory category) const;
+
+    void setMaxMemoryHeavyJobs(int count);
+    int maxMemoryHeavyJobs() const;
+
+signals:
+    void jobQueued(medAbstractJob *job);
+    //! waitTime is the time spent in the queue, in milliseconds.
+    void jobStarted(medAbstractJob *job, qint64 waitTime);
+    //! runTime is the time spent running, in milliseconds.
+    void jobFinished(medAbstractJob *job, qint64 waitTime, qint64 runTime);
+
+private:
+    void dispatchJobs();
+    void jobDone(medAbstractJob *job);
 
 private:
     const QScopedPointer<medJobManagerPrivate> d;
@@ -54,6 +108,7 @@ public:
 
 signals:
     void exceptionCaught(QString const& message);
+    void done();
 
 private:
     medAbstractJob *m_job;
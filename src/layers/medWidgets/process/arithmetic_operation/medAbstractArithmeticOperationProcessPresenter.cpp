@@ -125,3 +125,8 @@ medAbstractArithmeticOperationProcess* medAbstractArithmeticOperationProcessPres
 {
     return d->process;
 }
+
+medJobManager::JobCategory medAbstractArithmeticOperationProcessPresenter::jobCategory() const
+{
+    return medJobManager::InteractiveJob;
+}
@@ -39,6 +39,9 @@ public:
 
     const QScopedPointer<medAbstractArithmeticOperationProcessPresenterPrivate> d;
 
+protected:
+    virtual medJobManager::JobCategory jobCategory() const;
+
 private slots:
     // TODO RDE - have to be moved later.
     void _importOutput(medAbstractJob::medJobExitStatus jobExitStatus);
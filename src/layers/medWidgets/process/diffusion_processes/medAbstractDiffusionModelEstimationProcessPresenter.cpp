@@ -196,3 +196,8 @@ void medAbstractDiffusionModelEstimationProcessPresenter::setInputBValuesFile()
     d->bvaluesFileLabel->setText(fileName);
     d->bvaluesFileLabel->setToolTip(fileName);
 }
+
+bool medAbstractDiffusionModelEstimationProcessPresenter::isMemoryHeavy() const
+{
+    return true;
+}
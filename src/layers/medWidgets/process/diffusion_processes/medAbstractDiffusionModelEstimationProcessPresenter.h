@@ -38,6 +38,9 @@ public:
     void setUseRunControls(bool useRun);
     bool useRunControls();
 
+protected:
+    virtual bool isMemoryHeavy() const;
+
 private:
     const QScopedPointer<medAbstractDiffusionModelEstimationProcessPresenterPrivate> d;
 
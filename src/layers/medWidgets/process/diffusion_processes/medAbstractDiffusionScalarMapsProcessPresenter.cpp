@@ -100,3 +100,13 @@ void medAbstractDiffusionScalarMapsProcessPresenter::_importOutput(medAbstractJo
         emit _outputImported(d->process->output());
     }
 }
+
+int medAbstractDiffusionScalarMapsProcessPresenter::jobPriority() const
+{
+    return 1;
+}
+
+bool medAbstractDiffusionScalarMapsProcessPresenter::isMemoryHeavy() const
+{
+    return true;
+}
@@ -38,6 +38,10 @@ public:
 
     const QScopedPointer<medAbstractDiffusionScalarMapsProcessPresenterPrivate> d;
 
+protected:
+    virtual int jobPriority() const;
+    virtual bool isMemoryHeavy() const;
+
 private slots:
     void _importOutput(medAbstractJob::medJobExitStatus jobExitStatus);
 
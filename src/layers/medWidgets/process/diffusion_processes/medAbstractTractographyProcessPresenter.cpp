@@ -93,3 +93,8 @@ void medAbstractTractographyProcessPresenter::_importOutput(medAbstractJob::medJ
         emit _outputImported(d->process->output());
     }
 }
+
+bool medAbstractTractographyProcessPresenter::isMemoryHeavy() const
+{
+    return true;
+}
@@ -38,6 +38,9 @@ public:
 
     const QScopedPointer<medAbstractTractographyProcessPresenterPrivate> d;
 
+protected:
+    virtual bool isMemoryHeavy() const;
+
 private slots:
     void _importOutput(medAbstractJob::medJobExitStatus jobExitStatus);
 
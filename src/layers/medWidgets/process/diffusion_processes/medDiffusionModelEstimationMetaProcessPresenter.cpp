@@ -229,3 +229,8 @@ void medDiffusionModelEstimationMetaProcessPresenter::chooseEstimationPlugin(int
     else if (!d->process->modelEstimationProcess())
         d->modelEstimationWidget->hide();
 }
+
+bool medDiffusionModelEstimationMetaProcessPresenter::isMemoryHeavy() const
+{
+    return true;
+}
@@ -39,6 +39,9 @@ public:
 
     const QScopedPointer<medDiffusionModelEstimationMetaProcessPresenterPrivate> d;
 
+protected:
+    virtual bool isMemoryHeavy() const;
+
 private slots:
     void _importOutput(medAbstractJob::medJobExitStatus jobExitStatus);
 
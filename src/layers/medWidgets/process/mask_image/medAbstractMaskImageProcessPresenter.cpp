@@ -120,3 +120,8 @@ void medAbstractMaskImageProcessPresenter::_importOutput(medAbstractJob::medJobE
         emit _outputImported(d->process->output());
     }
 }
+
+medJobManager::JobCategory medAbstractMaskImageProcessPresenter::jobCategory() const
+{
+    return medJobManager::InteractiveJob;
+}
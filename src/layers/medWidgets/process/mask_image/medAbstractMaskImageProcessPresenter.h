@@ -37,6 +37,9 @@ public:
 
     const QScopedPointer<medAbstractMaskImageProcessPresenterPrivate> d;
 
+protected:
+    virtual medJobManager::JobCategory jobCategory() const;
+
 private slots:
     void _importOutput(medAbstractJob::medJobExitStatus jobExitStatus);
     void _setInputFromContainer(medAbstractData *data);
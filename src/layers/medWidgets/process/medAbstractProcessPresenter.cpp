@@ -69,7 +69,22 @@ QPushButton* medAbstractProcessPresenter::buildCancelButton()
     return cancelButton;
 }
 
+medJobManager::JobCategory medAbstractProcessPresenter::jobCategory() const
+{
+    return medJobManager::ComputeJob;
+}
+
+int medAbstractProcessPresenter::jobPriority() const
+{
+    return 0;
+}
+
+bool medAbstractProcessPresenter::isMemoryHeavy() const
+{
+    return false;
+}
+
 void medAbstractProcessPresenter::_runProcessFromThread()
 {
-    medJobManager::instance()->startJobInThread(d->process);
+    medJobManager::instance()->startJobInThread(d->process, jobCategory(), jobPriority(), isMemoryHeavy());
 }
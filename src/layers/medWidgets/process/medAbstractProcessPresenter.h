@@ -15,6 +15,7 @@
 #include <QObject>
 
 #include <medAbstractProcess.h>
+#include <medJobManager.h>
 #include <medProcessPresenterFactory.h>
 #include <medWidgetsExport.h>
 
@@ -39,6 +40,12 @@ public:
     QPushButton *buildRunButton();
     QPushButton *buildCancelButton();
 
+protected:
+    //! How the process is scheduled by the job manager when it is run: compute job of priority 0 by default
+    virtual medJobManager::JobCategory jobCategory() const;
+    virtual int jobPriority() const;
+    virtual bool isMemoryHeavy() const;
+
 protected slots:
     void _runProcessFromThread();
 
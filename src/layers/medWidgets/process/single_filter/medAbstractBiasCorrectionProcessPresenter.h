@@ -24,6 +24,9 @@ public:
    medAbstractBiasCorrectionProcessPresenter(medAbstractBiasCorrectionProcess *parent) : medAbstractSingleFilterOperationProcessPresenter(parent) {}
     virtual QWidget* buildToolBoxWidget() = 0;
     virtual medAbstractBiasCorrectionProcess* process() const = 0;
+
+protected:
+    virtual bool isMemoryHeavy() const {return true;}
 };
 
 MED_DECLARE_PROCESS_PRESENTER_FACTORY(medAbstractBiasCorrectionProcess, MEDWIDGETS_EXPORT)
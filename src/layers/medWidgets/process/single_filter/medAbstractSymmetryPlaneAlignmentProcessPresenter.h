@@ -25,6 +25,9 @@ public:
         : medAbstractSingleFilterOperationProcessPresenter(parent)
     {}
     virtual medAbstractSymmetryPlaneAlignmentProcess* process() const = 0;
+
+protected:
+    virtual bool isMemoryHeavy() const {return true;}
 };
 
 MED_DECLARE_PROCESS_PRESENTER_FACTORY(medAbstractSymmetryPlaneAlignmentProcess, MEDWIDGETS_EXPORT)
@@ -21,6 +21,7 @@
 #include <medAbstractTypedImageData.h>
 #include <itkDataImagePluginExport.h>
 #include <itkDataPrivateTypes.h>
+#include <itkDataImageThumbnail.h>
 
 template <unsigned DIM,typename T>
 struct ImagePrivateType: public itkDataScalarImagePrivateType<DIM,T>
@@ -166,6 +167,18 @@ public:
     int scalarValueMinCount() { return d->scalarValueMinCount(); }
     int scalarValueMaxCount() { return d->scalarValueMaxCount(); }
 
+    // derived from medAbstractData
+
+    QImage generateThumbnail(QSize size) override
+    {
+        if (d->image.IsNull())
+            return medAbstractTypedImageData<DIM,T>::generateThumbnail(size);
+
+        // Computed from the image buffer, so that importers do not wait for the GUI thread
+        double range[2];
+        return itkDataImageThumbnail::generate(d->image.GetPointer(), size, d->cachedRange(range) ? range : nullptr);
+    }
+
 private:
 
     PrivateMember* d;
@@ -0,0 +1,184 @@
+#pragma once
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#include <itkImage.h>
+#include <itkRGBPixel.h>
+#include <itkRGBAPixel.h>
+#include <itkVector.h>
+
+#include <QImage>
+#include <QPainter>
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * Thumbnails of itk images computed on the CPU, without a view nor the GUI thread.
+ *
+ * The middle slice along the third axis (of the first volume for 4D images) is read
+ * from the image buffer, mapped to gray levels through a window, resampled to the
+ * physical aspect ratio of the slice and centered on a black background, which is
+ * what the 2D view shows for a thumbnail.
+ */
+namespace itkDataImageThumbnail
+{
+
+// Number of slice values sampled to estimate the window
+static const size_t maxSamples = 65536;
+
+template <typename T>
+inline double intensity(const T& value) { return static_cast<double>(value); }
+
+template <typename T, unsigned N>
+inline double intensity(const itk::Vector<T,N>& value) { return value.GetNorm(); }
+
+template <typename T>
+inline double intensity(const itk::RGBPixel<T>& value) { return value.GetLuminance(); }
+
+template <typename T>
+inline double intensity(const itk::RGBAPixel<T>& value) { return value.GetLuminance(); }
+
+inline int toGray(double value, double lower, double width)
+{
+    return static_cast<int>(std::min(255.0, std::max(0.0, 255.0 * (value - lower) / width)));
+}
+
+template <typename T>
+inline QRgb toColor(const T& value, double lower, double width)
+{
+    const int gray = toGray(intensity(value), lower, width);
+    return qRgb(gray, gray, gray);
+}
+
+template <typename T>
+inline QRgb toColor(const itk::RGBPixel<T>& value, double lower, double width)
+{
+    return qRgb(toGray(value[0], lower, width), toGray(value[1], lower, width), toGray(value[2], lower, width));
+}
+
+template <typename T>
+inline QRgb toColor(const itk::RGBAPixel<T>& value, double lower, double width)
+{
+    return qRgb(toGray(value[0], lower, width), toGray(value[1], lower, width), toGray(value[2], lower, width));
+}
+
+/**
+ * Window of the intensities between the 1st and 99th percentiles of a sample of values,
+ * or their full range if these are equal, as in masks where most of the values are 0.
+ */
+inline void sampledWindow(std::vector<double>& samples, double& lower, double& upper)
+{
+    if (samples.empty())
+    {
+        lower = 0.0;
+        upper = 1.0;
+        return;
+    }
+
+    const auto minMax = std::minmax_element(samples.begin(), samples.end());
+    const double minimum = *minMax.first;
+    const double maximum = *minMax.second;
+
+    const size_t last = samples.size() - 1;
+    std::nth_element(samples.begin(), samples.begin() + last / 100, samples.end());
+    lower = samples[last / 100];
+    std::nth_element(samples.begin(), samples.begin() + last - last / 100, samples.end());
+    upper = samples[last - last / 100];
+
+    if (upper <= lower)
+    {
+        lower = minimum;
+        upper = maximum;
+    }
+}
+
+/**
+ * Thumbnail of image of the given size. When cachedRange is not null, the image range it
+ * holds is used as window instead of one estimated from the slice.
+ */
+template <unsigned DIM, typename T>
+QImage generate(const itk::Image<T,DIM> *image, const QSize& size, const double *cachedRange = nullptr)
+{
+    typedef itk::Image<T,DIM> ImageType;
+
+    QImage thumbnail(size, QImage::Format_RGB32);
+    thumbnail.fill(Qt::black);
+
+    const typename ImageType::RegionType region = image->GetBufferedRegion();
+    const typename ImageType::SizeType imageSize = region.GetSize();
+    if (region.GetNumberOfPixels() == 0 || size.isEmpty())
+    {
+        return thumbnail;
+    }
+
+    const unsigned int width  = imageSize[0];
+    const unsigned int height = (DIM > 1) ? imageSize[1] : 1;
+
+    typename ImageType::IndexType origin = region.GetIndex();
+    if (DIM > 2)
+    {
+        origin[2] += imageSize[2] / 2;
+    }
+    const T *slice = image->GetBufferPointer() + image->ComputeOffset(origin);
+
+    double lower, upper;
+    if (cachedRange)
+    {
+        lower = cachedRange[0];
+        upper = cachedRange[1];
+    }
+    else
+    {
+        const size_t count = static_cast<size_t>(width) * height;
+        const size_t step = std::max<size_t>(1, count / maxSamples);
+        std::vector<double> samples;
+        samples.reserve(count / step + 1);
+        for (size_t i = 0; i < count; i += step)
+        {
+            samples.push_back(intensity(slice[i]));
+        }
+        sampledWindow(samples, lower, upper);
+    }
+    const double windowWidth = std::max(upper - lower, 1e-6);
+
+    // The 2D view shows the first row at the bottom
+    QImage sliceImage(width, height, QImage::Format_RGB32);
+    for (unsigned int y = 0; y < height; ++y)
+    {
+        QRgb *line = reinterpret_cast<QRgb*>(sliceImage.scanLine(height - 1 - y));
+        const T *row = slice + static_cast<size_t>(y) * width;
+        for (unsigned int x = 0; x < width; ++x)
+        {
+            line[x] = toColor(row[x], lower, windowWidth);
+        }
+    }
+
+    // Keep the physical aspect ratio of the slice
+    const double physicalWidth  = width * image->GetSpacing()[0];
+    const double physicalHeight = height * ((DIM > 1) ? image->GetSpacing()[1] : 1.0);
+    QSize scaledSize = size;
+    if (physicalWidth > 0 && physicalHeight > 0)
+    {
+        scaledSize = QSizeF(physicalWidth, physicalHeight).scaled(size, Qt::KeepAspectRatio).toSize().expandedTo(QSize(1, 1));
+    }
+
+    const QImage scaled = sliceImage.scaled(scaledSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    QPainter painter(&thumbnail);
+    painter.drawImage((size.width() - scaled.width()) / 2, (size.height() - scaled.height()) / 2, scaled);
+    painter.end();
+
+    return thumbnail;
+}
+
+}
@@ -46,6 +46,7 @@ public:
 
     int minRangeValue() const { return -1; }
     int maxRangeValue() const { return -1; }
+    bool cachedRange(double*) const { return false; }
 
     int scalarValueCount(int) const { return -1; }
     int scalarValueMinCount() const { return -1; }
@@ -101,6 +102,15 @@ public:
         return range_max;
     }
 
+    //! Fills range with the image range if it was already computed
+    bool cachedRange(double* range) const {
+        if (!range_computed)
+            return false;
+        range[0] = range_min;
+        range[1] = range_max;
+        return true;
+    }
+
     int scalarValueCount(int value) {
         computeValueCounts();
         return histogram->GetFrequency((PixelType)value);
@@ -515,6 +515,8 @@ bool itkDCMTKDataImageReader::read(const QStringList& paths)
     if (paths.size() == 0)
         return false;
 
+    // the files parsed here are kept for the second header pass of the itk reader and for the pixels
+    d->io->KeepParsedDatasetsOn();
     this->readInformation(paths);
 
     itk::DCMTKDataImageReaderCommand::Pointer command = itk::DCMTKDataImageReaderCommand::New();
@@ -548,12 +550,16 @@ bool itkDCMTKDataImageReader::read(const QStringList& paths)
             else
             {
                 qWarning() << "Unrecognized pixel type";
+                d->io->ReleaseParsedDatasets();
+                d->io->KeepParsedDatasetsOff();
                 return false;
             }
         }
         catch (itk::ExceptionObject &e)
         {
             qDebug() << e.GetDescription();
+            d->io->ReleaseParsedDatasets();
+            d->io->KeepParsedDatasetsOff();
             return false;
         }
 
@@ -578,6 +584,8 @@ bool itkDCMTKDataImageReader::read(const QStringList& paths)
     }
 
     d->io->RemoveAllObservers();
+    d->io->ReleaseParsedDatasets();
+    d->io->KeepParsedDatasetsOff();
 
     return true;
 }
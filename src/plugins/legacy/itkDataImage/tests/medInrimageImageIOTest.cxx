@@ -0,0 +1,242 @@
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#include <medInrimageImageIO.h>
+
+#include <itkImage.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIterator.h>
+#include <itk_zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Round trip of the block compressed .inr.gz files: whole and streamed writes,
+// whole and sub-region reads, the stream fallback for single stream files, and
+// the inflation of a block compressed file by plain zlib.
+
+typedef itk::Image<short, 3> ImageType;
+
+namespace
+{
+
+ImageType::Pointer createImage()
+{
+    // 128 x 128 x 20 shorts: 640 KiB, in three blocks of the minimum size of 256 KiB
+    ImageType::SizeType size;
+    size[0] = 128;
+    size[1] = 128;
+    size[2] = 20;
+
+    ImageType::SpacingType spacing;
+    spacing[0] = 0.5;
+    spacing[1] = 0.75;
+    spacing[2] = 2.0;
+
+    ImageType::Pointer image = ImageType::New();
+    image->SetRegions(size);
+    image->SetSpacing(spacing);
+    image->Allocate();
+
+    itk::ImageRegionIterator<ImageType> it(image, image->GetLargestPossibleRegion());
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+        const ImageType::IndexType index = it.GetIndex();
+        it.Set(static_cast<short>(index[0] * 7 + index[1] * 13 + index[2] * 31 + (index[0] * index[1]) % 17 - 1000));
+    }
+    return image;
+}
+
+itk::ImageIORegion toIORegion(const ImageType::RegionType& region)
+{
+    itk::ImageIORegion ioRegion(3);
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        ioRegion.SetIndex(i, region.GetIndex()[i]);
+        ioRegion.SetSize(i, region.GetSize()[i]);
+    }
+    return ioRegion;
+}
+
+InrimageImageIO::Pointer createWriterIO(const std::string& fileName, ImageType *image, bool blockCompression)
+{
+    InrimageImageIO::Pointer io = InrimageImageIO::New();
+    io->SetFileName(fileName);
+    io->SetUseBlockCompression(blockCompression);
+    io->SetNumberOfDimensions(3);
+    io->SetPixelType(itk::ImageIOBase::SCALAR);
+    io->SetComponentType(itk::ImageIOBase::SHORT);
+    io->SetNumberOfComponents(1);
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        io->SetDimensions(i, image->GetLargestPossibleRegion().GetSize()[i]);
+        io->SetSpacing(i, image->GetSpacing()[i]);
+        io->SetOrigin(i, image->GetOrigin()[i]);
+
+        std::vector<double> direction(3);
+        for (unsigned int j = 0; j < 3; ++j)
+            direction[j] = image->GetDirection()[j][i];
+        io->SetDirection(i, direction);
+    }
+    return io;
+}
+
+void writeRegion(InrimageImageIO *io, ImageType *image, const ImageType::RegionType& region)
+{
+    std::vector<short> buffer;
+    buffer.reserve(region.GetNumberOfPixels());
+    itk::ImageRegionConstIterator<ImageType> it(image, region);
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+        buffer.push_back(it.Get());
+
+    io->SetIORegion(toIORegion(region));
+    io->Write(buffer.data());
+}
+
+bool readRegion(const std::string& fileName, ImageType *image, const ImageType::RegionType& region, bool expectStreamable)
+{
+    InrimageImageIO::Pointer io = InrimageImageIO::New();
+    if (!io->CanReadFile(fileName.c_str()))
+    {
+        std::cerr << fileName << ": cannot be read" << std::endl;
+        return false;
+    }
+    io->SetFileName(fileName);
+    io->ReadImageInformation();
+
+    if (io->CanStreamRead() != expectStreamable)
+    {
+        std::cerr << fileName << ": " << (expectStreamable ? "no block index found" : "unexpected block index") << std::endl;
+        return false;
+    }
+
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        if (io->GetDimensions(i) != image->GetLargestPossibleRegion().GetSize()[i])
+        {
+            std::cerr << fileName << ": wrong dimension " << i << std::endl;
+            return false;
+        }
+    }
+
+    std::vector<short> buffer(region.GetNumberOfPixels());
+    io->SetIORegion(toIORegion(region));
+    io->Read(buffer.data());
+
+    unsigned long long i = 0;
+    itk::ImageRegionConstIterator<ImageType> it(image, region);
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it, ++i)
+    {
+        if (buffer[i] != it.Get())
+        {
+            std::cerr << fileName << ": pixel " << it.GetIndex() << " is " << buffer[i] << " instead of " << it.Get() << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool inflatesAsOneStream(const std::string& fileName, ImageType *image)
+{
+    gzFile file = ::gzopen(fileName.c_str(), "rb");
+    if (file == NULL)
+        return false;
+
+    std::string content;
+    char chunk[64 * 1024];
+    int length;
+    while ((length = ::gzread(file, chunk, sizeof(chunk))) > 0)
+        content.append(chunk, length);
+    ::gzclose(file);
+
+    // the header, a multiple of 256 bytes, followed by the image data
+    const unsigned long long imageSize = image->GetLargestPossibleRegion().GetNumberOfPixels() * sizeof(short);
+    if (length < 0 || content.size() < imageSize || (content.size() - imageSize) % 256 != 0
+            || content.compare(0, 13, "#INRIMAGE-4#{") != 0)
+    {
+        std::cerr << fileName << ": gzread gives " << content.size() << " bytes" << std::endl;
+        return false;
+    }
+
+    if (memcmp(content.data() + content.size() - imageSize, image->GetBufferPointer(), imageSize) != 0)
+    {
+        std::cerr << fileName << ": gzread gives other image data" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+}
+
+int medInrimageImageIOTest(int argc, char* argv[])
+{
+    const std::string directory = argc > 1 ? argv[1] : ".";
+    const std::string wholeFile = directory + "/medInrimageImageIOTestWhole.inr.gz";
+    const std::string streamedFile = directory + "/medInrimageImageIOTestStreamed.inr.gz";
+    const std::string legacyFile = directory + "/medInrimageImageIOTestLegacy.inr.gz";
+
+    ImageType::Pointer image = createImage();
+    const ImageType::RegionType whole = image->GetLargestPossibleRegion();
+
+    // slabs of 7 slices, 224 KiB: neither the regions nor their ends are on block boundaries
+    std::vector<ImageType::RegionType> slabs;
+    for (unsigned int z = 0; z < whole.GetSize()[2]; z += 7)
+    {
+        ImageType::RegionType slab = whole;
+        slab.SetIndex(2, z);
+        slab.SetSize(2, std::min<unsigned int>(7, whole.GetSize()[2] - z));
+        slabs.push_back(slab);
+    }
+
+    // slices 6 to 17, across the block boundaries after slices 7 and 15
+    ImageType::IndexType subIndex = {{ 5, 10, 6 }};
+    ImageType::SizeType subSize = {{ 115, 90, 12 }};
+    const ImageType::RegionType subRegion(subIndex, subSize);
+
+    bool success = true;
+
+    try
+    {
+        writeRegion(createWriterIO(wholeFile, image, true), image, whole);
+
+        InrimageImageIO::Pointer streamingIO = createWriterIO(streamedFile, image, true);
+        if (!streamingIO->CanStreamWrite())
+        {
+            std::cerr << "block compressed files cannot be streamed" << std::endl;
+            return EXIT_FAILURE;
+        }
+        for (const ImageType::RegionType& slab : slabs)
+            writeRegion(streamingIO, image, slab);
+
+        writeRegion(createWriterIO(legacyFile, image, false), image, whole);
+
+        success = readRegion(wholeFile, image, whole, true) && success;
+        success = readRegion(streamedFile, image, whole, true) && success;
+        success = readRegion(streamedFile, image, subRegion, true) && success;
+        success = readRegion(legacyFile, image, whole, false) && success;
+        success = readRegion(legacyFile, image, subRegion, false) && success;
+    }
+    catch (itk::ExceptionObject &e)
+    {
+        std::cerr << e << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    success = inflatesAsOneStream(wholeFile, image) && success;
+    success = inflatesAsOneStream(streamedFile, image) && success;
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
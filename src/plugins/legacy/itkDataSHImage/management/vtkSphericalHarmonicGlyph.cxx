@@ -11,15 +11,20 @@
 
 =========================================================================*/
 
+#include <algorithm>
 #include <iostream>
+#include <vector>
 #include <vtkPolyData.h>
 #include <vtkCellArray.h>
 #include <vtkDataSet.h>
 #include <vtkExecutive.h>
 #include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
-#include <vtkTransform.h>
+#include <vtkMath.h>
+#include <vtkMultiThreader.h>
+#include <vtkSmartPointer.h>
 
 #include "vtkSphericalHarmonicGlyph.h"
 
@@ -114,6 +119,161 @@ vtkSphericalHarmonicGlyph::~vtkSphericalHarmonicGlyph() {
         SphericalHarmonicSource->UnRegister(this);
 }
 
+// Everything the glyph threads share. The spherical function of glyph g at direction i
+// is the dot product of its coefficients with Basis[i*Rank..(i+1)*Rank), and its point is
+// Centers[g] + Scale*(value*Directions[i] + Offset) in output coordinates.
+
+struct vtkSphericalHarmonicGlyphThreadData {
+    const std::vector<vtkIdType>* GlyphPointIds;
+    const double*                 Centers;
+    vtkDataArray*                 Coefficients;
+    int                           NumberOfCoefficients;
+
+    const double* Basis;
+    int           Rank;
+    vtkIdType     NumberOfDirections;
+
+    const double* Directions;
+    double        Offset[3];
+    const double* ShellPoints;      // rotated unit directions, for the rgb colors
+    double        ShellOffset[3];
+    const std::vector<vtkIdType>* Triangles;
+
+    double Scale;
+    double Radius;
+    bool   Normalize;
+    bool   Deform;
+    bool   ColorByDirections;
+
+    float* Points;
+    float* Normals;
+    float* Values;
+    float* Colors;
+};
+
+static VTK_THREAD_RETURN_TYPE GenerateGlyphsThread(void* arg) {
+    vtkMultiThreader::ThreadInfo* info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    const vtkSphericalHarmonicGlyphThreadData* data = static_cast<vtkSphericalHarmonicGlyphThreadData*>(info->UserData);
+
+    const vtkIdType numGlyphs = data->GlyphPointIds->size();
+    const vtkIdType blockSize = (numGlyphs+info->NumberOfThreads-1)/info->NumberOfThreads;
+    const vtkIdType begin     = std::min(numGlyphs,blockSize*info->ThreadID);
+    const vtkIdType end       = std::min(numGlyphs,begin+blockSize);
+
+    const vtkIdType N    = data->NumberOfDirections;
+    const int       rank = data->Rank;
+
+    std::vector<double> coeffs(std::max(rank,data->NumberOfCoefficients),0.0);
+    std::vector<double> values(N);
+    std::vector<double> normals(3*N);
+
+    for (vtkIdType g=begin;g<end;++g) {
+        data->Coefficients->GetTuple((*data->GlyphPointIds)[g],coeffs.data());
+
+        // Spherical function: values = B^T c
+
+        const int n = std::min(rank,data->NumberOfCoefficients);
+        double min = VTK_DOUBLE_MAX;
+        double max = VTK_DOUBLE_MIN;
+        for (vtkIdType i=0;i<N;++i) {
+            const double* b = data->Basis+i*rank;
+            double v = 0.0;
+            for (int j=0;j<n;++j)
+                v += b[j]*coeffs[j];
+            values[i] = v;
+            min = std::min(min,v);
+            max = std::max(max,v);
+        }
+
+        if (data->Normalize) {
+            if (max!=min) {
+                const double factor = 1.0/(max-min);
+                for (vtkIdType i=0;i<N;++i)
+                    values[i] = (values[i]-min)*factor;
+            } else
+                std::fill(values.begin(),values.end(),1.0);
+        }
+
+        const double* center = data->Centers+3*g;
+        float* points = data->Points+3*N*g;
+        for (vtkIdType i=0;i<N;++i) {
+            values[i] *= data->Radius;
+            const double r = data->Deform ? values[i] : 1.0;
+            const double* d = data->Directions+3*i;
+            for (int k=0;k<3;++k)
+                points[3*i+k] = center[k]+data->Scale*(r*d[k]+data->Offset[k]);
+            data->Values[N*g+i] = values[i];
+        }
+
+        // Point normals, averaging the normals of the triangles around each point
+
+        std::fill(normals.begin(),normals.end(),0.0);
+        const std::vector<vtkIdType>& triangles = *data->Triangles;
+        for (size_t t=0;t<triangles.size();t+=3) {
+            const float* p0 = points+3*triangles[t];
+            const float* p1 = points+3*triangles[t+1];
+            const float* p2 = points+3*triangles[t+2];
+            const double u[3] = { p1[0]-p0[0], p1[1]-p0[1], p1[2]-p0[2] };
+            const double v[3] = { p2[0]-p0[0], p2[1]-p0[1], p2[2]-p0[2] };
+            double faceNormal[3];
+            vtkMath::Cross(u,v,faceNormal);
+            for (int c=0;c<3;++c)
+                for (int k=0;k<3;++k)
+                    normals[3*triangles[t+c]+k] += faceNormal[k];
+        }
+        float* outNormals = data->Normals+3*N*g;
+        for (vtkIdType i=0;i<N;++i) {
+            vtkMath::Normalize(&normals[3*i]);
+            for (int k=0;k<3;++k)
+                outNormals[3*i+k] = normals[3*i+k];
+        }
+
+        // RGB color : color at every point of the spherical function
+
+        if (data->ColorByDirections) {
+            float* colors = data->Colors+N*g;
+            for (vtkIdType i=0;i<N;++i) {
+                const double r = data->Deform ? values[i] : 1.0;
+                const double* p = data->ShellPoints+3*i;
+                double s;
+                RGBToIndex(fabs(r*p[0]+data->ShellOffset[0]),
+                           fabs(r*p[1]+data->ShellOffset[1]),
+                           fabs(r*p[2]+data->ShellOffset[2]),s);
+                colors[i] = s;
+            }
+        }
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
+}
+
+// Copies the cells of a source cell array for each of numGlyphs glyphs of numSourcePts points.
+
+static vtkCellArray* ReplicateCells(vtkCellArray* sourceCells,const vtkIdType numGlyphs,const vtkIdType numSourcePts) {
+    vtkIdTypeArray*   sourceData = sourceCells->GetData();
+    const vtkIdType   size       = sourceData->GetNumberOfValues();
+    const vtkIdType*  in         = sourceData->GetPointer(0);
+
+    vtkSmartPointer<vtkIdTypeArray> data = vtkSmartPointer<vtkIdTypeArray>::New();
+    data->SetNumberOfValues(numGlyphs*size);
+    vtkIdType* out = data->GetPointer(0);
+
+    for (vtkIdType g=0;g<numGlyphs;++g) {
+        const vtkIdType offset = g*numSourcePts;
+        for (vtkIdType i=0;i<size;) {
+            const vtkIdType npts = in[i];
+            *out++ = npts;
+            for (vtkIdType j=1;j<=npts;++j)
+                *out++ = in[i+j]+offset;
+            i += npts+1;
+        }
+    }
+
+    vtkCellArray* cells = vtkCellArray::New();
+    cells->SetCells(numGlyphs*sourceCells->GetNumberOfCells(),data);
+    return cells;
+}
+
 int
 vtkSphericalHarmonicGlyph::RequestData(vtkInformation*,vtkInformationVector** inputVector,
                                        vtkInformationVector* outputVector)
@@ -123,8 +283,6 @@ vtkSphericalHarmonicGlyph::RequestData(vtkInformation*,vtkInformationVector** in
     vtkInformation* sourceInfo = inputVector[1]->GetInformationObject(0);
     vtkInformation* outInfo    = outputVector->GetInformationObject(0);
 
-    const int numDirs = 1;
-
     // Get the input.
 
     vtkDataSet*  input     = vtkDataSet::SafeDownCast(inInfo->Get(vtkDataObject::DATA_OBJECT()));
@@ -141,203 +299,194 @@ vtkSphericalHarmonicGlyph::RequestData(vtkInformation*,vtkInformationVector** in
     vtkDataArray* inScalars = pd->GetScalars(GetSphericalHarmonicCoefficientsArrayName());
     vtkDataArray* inAniso   = pd->GetScalars(GetAnisotropyMeasureArrayName());
 
-    // Allocate storage for output PolyData
-
-    vtkPolyData* source    = vtkPolyData::SafeDownCast(sourceInfo->Get(vtkDataObject::DATA_OBJECT()));
-    vtkPoints*   sourcePts = source->GetPoints();  //shell
+    vtkPolyData* source = vtkPolyData::SafeDownCast(sourceInfo->Get(vtkDataObject::DATA_OBJECT()));
+    vtkPolyData* shell  = SphericalHarmonicSource->GetShell();
 
     // Number of points on the shell
 
-    const vtkIdType numSourcePts   = sourcePts->GetNumberOfPoints();
-    if (!numSourcePts || numSourcePts < 0) {
+    const vtkIdType numSourcePts = source->GetNumberOfPoints();
+    if (!numSourcePts || numSourcePts < 0 || !inScalars || shell->GetNumberOfPoints()!=numSourcePts) {
         vtkErrorMacro(<<"No data to glyph!");
         return 1;
     }
 
+    vtkPolyData* output = vtkPolyData::SafeDownCast(outInfo->Get(vtkDataObject::DATA_OBJECT()));
+    vtkPointData* outPD = output->GetPointData();
+
+    // Points with a glyph, and the glyph centers in output coordinates
+
+    vtkSmartPointer<vtkMatrix4x4> tMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    if (TMatrix)
+        tMatrix->DeepCopy(TMatrix);
+
+    std::vector<vtkIdType> glyphPointIds;
+    std::vector<double>    centers;
+    glyphPointIds.reserve(numPts);
+    centers.reserve(3*numPts);
+    for (vtkIdType inPtId=0;inPtId<numPts;++inPtId)
+        if (!inAniso || inAniso->GetComponent(inPtId,0)!=0) {
+            double x[4],center[4];
+            input->GetPoint(inPtId,x);
+            x[3] = 1.0;
+            tMatrix->MultiplyPoint(x,center);
+            glyphPointIds.push_back(inPtId);
+            centers.insert(centers.end(),center,center+3);
+        }
+    const vtkIdType numGlyphs = glyphPointIds.size();
+
+    // Shell directions, in the glyph frame and in output coordinates: the source point is
+    // value*R*p + (Rt+Center) and the transform matrix only applies its linear part A to it.
+
+    vtkMatrix4x4* rotation = SphericalHarmonicSource->GetRotationMatrix();
+    double rotationOffset[3] = { 0.0, 0.0, 0.0 };
+    if (rotation)
+        for (int k=0;k<3;++k)
+            rotationOffset[k] = rotation->GetElement(k,3);
+
+    std::vector<double> shellPoints(3*numSourcePts);
+    std::vector<double> directions(3*numSourcePts);
+    for (vtkIdType i=0;i<numSourcePts;++i) {
+        double p[3];
+        shell->GetPoint(i,p);
+        double* q = &shellPoints[3*i];
+        for (int k=0;k<3;++k)
+            q[k] = rotation ? (rotation->GetElement(k,0)*p[0]+rotation->GetElement(k,1)*p[1]+rotation->GetElement(k,2)*p[2]) : p[k];
+        for (int k=0;k<3;++k)
+            directions[3*i+k] = tMatrix->GetElement(k,0)*q[0]+tMatrix->GetElement(k,1)*q[1]+tMatrix->GetElement(k,2)*q[2];
+    }
 
-    // Number of cells is the number of triangles in shell
+    vtkSphericalHarmonicGlyphThreadData data;
+    for (int k=0;k<3;++k)
+        data.ShellOffset[k] = rotationOffset[k]+SphericalHarmonicSource->GetCenter()[k];
+    for (int k=0;k<3;++k)
+        data.Offset[k] = tMatrix->GetElement(k,0)*data.ShellOffset[0]+tMatrix->GetElement(k,1)*data.ShellOffset[1]+tMatrix->GetElement(k,2)*data.ShellOffset[2];
+
+    // Basis matrix transposed, so that each direction reads its coefficients contiguously
+
+    const itk::VariableSizeMatrix<double>& basisFunction = SphericalHarmonicSource->GetBasisFunction();
+    const int rank = basisFunction.Rows();
+    std::vector<double> basis(numSourcePts*rank);
+    for (vtkIdType i=0;i<numSourcePts;++i)
+        for (int j=0;j<rank;++j)
+            basis[i*rank+j] = basisFunction(j,i);
+
+    // Triangles of the shell, for the normals
+
+    std::vector<vtkIdType> triangles;
+    vtkCellArray* polys = source->GetPolys();
+    vtkIdType npts;
+    vtkIdType* pts;
+    for (polys->InitTraversal();polys->GetNextCell(npts,pts);)
+        for (vtkIdType i=1;i+1<npts;++i) {
+            triangles.push_back(pts[0]);
+            triangles.push_back(pts[i]);
+            triangles.push_back(pts[i+1]);
+        }
 
-    const vtkIdType numSourceCells = source->GetNumberOfCells();
-    const unsigned newpts_sz = numDirs*numPts*numSourcePts;
+    // Output arrays, sized once and filled in place by the threads
 
-    vtkPoints* newPts = vtkPoints::New();
-    newPts->Allocate(newpts_sz);
+    const vtkIdType numNewPts = numGlyphs*numSourcePts;
 
-    vtkPointData* newPointData = vtkPointData::New();
-    newPointData->Allocate(newpts_sz);
+    vtkSmartPointer<vtkFloatArray> newPointsData = vtkSmartPointer<vtkFloatArray>::New();
+    newPointsData->SetNumberOfComponents(3);
+    newPointsData->SetNumberOfTuples(numNewPts);
 
-    // Setting up for calls to PolyData::InsertNextCell()
+    vtkSmartPointer<vtkFloatArray> newNormals = vtkSmartPointer<vtkFloatArray>::New();
+    newNormals->SetNumberOfComponents(3);
+    newNormals->SetNumberOfTuples(numNewPts);
 
-    vtkPolyData*  output = vtkPolyData::SafeDownCast(outInfo->Get(vtkDataObject::DATA_OBJECT()));
-    vtkPointData* outPD  = output->GetPointData();
+    vtkSmartPointer<vtkFloatArray> newPointScalars = vtkSmartPointer<vtkFloatArray>::New();
+    newPointScalars->SetNumberOfTuples(numNewPts);
 
-    vtkCellArray* sourceCells;
-    if ((sourceCells=source->GetVerts())->GetNumberOfCells()>0) {
-        vtkCellArray* cells = vtkCellArray::New();
-        cells->Allocate(numDirs*numPts*sourceCells->GetSize());
+    vtkSmartPointer<vtkFloatArray> newScalars;
+    const bool colorByScalars    = ColorGlyphs && inAniso && ColorMode==COLOR_BY_SCALARS;
+    const bool colorByDirections = ColorGlyphs && ColorMode==COLOR_BY_DIRECTIONS;
+    if (colorByScalars || colorByDirections) {
+        newScalars = vtkSmartPointer<vtkFloatArray>::New();
+        newScalars->SetNumberOfTuples(numNewPts);
+    }
+
+    data.GlyphPointIds        = &glyphPointIds;
+    data.Centers              = centers.data();
+    data.Coefficients         = inScalars;
+    data.NumberOfCoefficients = inScalars->GetNumberOfComponents();
+    data.Basis                = basis.data();
+    data.Rank                 = rank;
+    data.NumberOfDirections   = numSourcePts;
+    data.Directions           = directions.data();
+    data.ShellPoints          = shellPoints.data();
+    data.Triangles            = &triangles;
+    data.Scale                = ScaleFactor;
+    data.Radius               = SphericalHarmonicSource->GetRadius();
+    data.Normalize            = SphericalHarmonicSource->GetNormalize();
+    data.Deform               = SphericalHarmonicSource->GetDeform();
+    data.ColorByDirections    = colorByDirections;
+    data.Points               = newPointsData->GetPointer(0);
+    data.Normals              = newNormals->GetPointer(0);
+    data.Values               = newPointScalars->GetPointer(0);
+    data.Colors               = colorByDirections ? newScalars->GetPointer(0) : nullptr;
+
+    UpdateProgress(0.0);
+
+    vtkMultiThreader* threader = vtkMultiThreader::New();
+    threader->SetSingleMethod(GenerateGlyphsThread,&data);
+    threader->SingleMethodExecute();
+    threader->Delete();
+
+    // Scalar color for anisotropy : one color per shell
+
+    if (colorByScalars) {
+        float* colors = newScalars->GetPointer(0);
+        for (vtkIdType g=0;g<numGlyphs;++g)
+            std::fill(colors+g*numSourcePts,colors+(g+1)*numSourcePts,
+                      static_cast<float>(inAniso->GetComponent(glyphPointIds[g],0)));
+    }
+
+    UpdateProgress(0.5);
+
+    // Topology is the same for every glyph, copied with the point ids shifted
+
+    if (source->GetVerts()->GetNumberOfCells()>0) {
+        vtkCellArray* cells = ReplicateCells(source->GetVerts(),numGlyphs,numSourcePts);
         output->SetVerts(cells);
         cells->Delete();
     }
-    if ((sourceCells=GetSource()->GetLines())->GetNumberOfCells()>0) {
-        vtkCellArray* cells = vtkCellArray::New();
-        cells->Allocate(numDirs*numPts*sourceCells->GetSize());
+    if (source->GetLines()->GetNumberOfCells()>0) {
+        vtkCellArray* cells = ReplicateCells(source->GetLines(),numGlyphs,numSourcePts);
         output->SetLines(cells);
         cells->Delete();
     }
-    if ((sourceCells=GetSource()->GetPolys())->GetNumberOfCells()>0) {
-        vtkCellArray* cells = vtkCellArray::New();
-        cells->Allocate(numDirs*numPts*sourceCells->GetSize());
+    if (polys->GetNumberOfCells()>0) {
+        vtkCellArray* cells = ReplicateCells(polys,numGlyphs,numSourcePts);
         output->SetPolys(cells);
         cells->Delete();
     }
-    if ((sourceCells=GetSource()->GetStrips())->GetNumberOfCells()>0) {
-        vtkCellArray* cells = vtkCellArray::New();
-        cells->Allocate(numDirs*numPts*sourceCells->GetSize());
+    if (source->GetStrips()->GetNumberOfCells()>0) {
+        vtkCellArray* cells = ReplicateCells(source->GetStrips(),numGlyphs,numSourcePts);
         output->SetStrips(cells);
         cells->Delete();
     }
 
-    vtkFloatArray* newPointScalars = vtkFloatArray::New();
-    newPointScalars->Allocate(numDirs*numPts*numSourcePts);
-
-    // Only copy scalar data through.
-    pd = GetSource()->GetPointData();
-
-    vtkFloatArray* newScalars = 0;
-    if (ColorGlyphs && (ColorMode==COLOR_BY_DIRECTIONS ||
-        (inAniso && ColorMode==COLOR_BY_SCALARS)))
-    {
-        newScalars = vtkFloatArray::New();
-        newScalars->Allocate(numDirs*numPts*numSourcePts);
-    } else {
-        outPD->CopyAllOff();
-        outPD->CopyScalarsOn();
-        outPD->CopyAllocate(pd,numDirs*numPts*numSourcePts);
-    }
-
-    if (pd->GetNormals()) {
-        vtkFloatArray* newNormals = vtkFloatArray::New();
-        newNormals->SetNumberOfComponents(3);
-        newNormals->Allocate(numDirs*3*numPts*numSourcePts);
-        newNormals->Delete();
-    }
-
-    // First copy all topology (transformation independent)
-
-    for (vtkIdType inPtId=0,inPtIdReal=0;inPtId<numPts;++inPtId)
-        if (inAniso->GetComponent(inPtId,0)!=0) {
-            const vtkIdType ptIncr = numDirs*inPtIdReal*numSourcePts;
-            for (vtkIdType cellId=0;cellId<numSourceCells;++cellId) {
-                vtkCell*   cell    = GetSource()->GetCell(cellId);
-                vtkIdList* cellPts = cell->GetPointIds();
-
-                const int npts = cellPts->GetNumberOfIds();
-                vtkIdType* pts = new vtkIdType[npts];
-
-                for (int dir=0;dir<numDirs;++dir) {
-                    const vtkIdType subIncr = ptIncr+dir*numSourcePts;
-                    for (vtkIdType i=0;i<npts;++i)
-                        pts[i] = cellPts->GetId(i)+subIncr;
-                    output->InsertNextCell(cell->GetCellType(),npts,pts);
-                }
-
-                delete[] pts;
-
-            }
-            inPtIdReal++;
-        }
-
-    // Traverse all Input points, transforming glyph at Source points
-
-    vtkTransform* trans = vtkTransform::New();
-    trans->PreMultiply();
-
-    double x[4];
-    for (vtkIdType inPtId=0,inPtIdReal=0;inPtId<numPts;++inPtId) {
-        if (inPtId%10000==0) {
-            UpdateProgress (static_cast<double>(inPtId)/numPts);
-            if (GetAbortExecute())
-                break;
-        }
-
-        if (inAniso->GetComponent(inPtId,0)) {
-            const vtkIdType ptIncr = numDirs*inPtIdReal*numSourcePts;
-
-            // Get the Spherical Harmonic vector.
-            double* sh = new double[inScalars->GetNumberOfComponents()];
-            inScalars->GetTuple(inPtId,sh);
-
-            // Set harmonics and compute spherical function.
-
-            SphericalHarmonicSource->SetSphericalHarmonics(sh);
-            SphericalHarmonicSource->Update();
-
-            vtkPointData* sourcePointData = SphericalHarmonicSource->GetOutput()->GetPointData();
-            vtkPoints*    deformPts       = SphericalHarmonicSource->GetOutput()->GetPoints();
-
-            trans->SetMatrix( TMatrix);
-            input->GetPoint(inPtId,x);
-            trans->Translate(x[0],x[1],x[2]);
-            trans->Scale(ScaleFactor,ScaleFactor,ScaleFactor);
-
-            // Translate the deform pt to the correct x,y,z location
-
-            trans->TransformPoints(deformPts,newPts);
-
-            // This is for spherical values coloring
-            // Need to set them at the right place in the list of all points
-
-            for (int z=0;z<numSourcePts;++z)
-                newPointScalars->InsertTuple(ptIncr+z,sourcePointData->GetScalars()->GetTuple(z));
-
-            if (ColorGlyphs) {
-
-                // Scalar color for anisotropy : one color per shell
-
-                if (inAniso && ColorMode==COLOR_BY_SCALARS) {
-                    const double s = inAniso->GetComponent(inPtId,0);
-                    for (vtkIdType i=0;i<numSourcePts;++i)
-                        newScalars->InsertTuple(ptIncr+i,&s);
-                }
+    vtkSmartPointer<vtkPoints> newPts = vtkSmartPointer<vtkPoints>::New();
+    newPts->SetData(newPointsData);
+    output->SetPoints(newPts);
 
-                // RGB color : color at every point of the spherical function
+    outPD->SetNormals(newNormals);
 
-                if (ColorMode==COLOR_BY_DIRECTIONS) {
-                    for (vtkIdType i=0;i<numSourcePts;++i) {
-                        double s,vect[3];
-                        SphericalHarmonicSource->GetOutput()->GetPoints()->GetPoint(i,vect);
-                        RGBToIndex(fabs(vect[0]),fabs(vect[1]),fabs(vect[2]),s);
-                        newScalars->InsertTuple(ptIncr+i,&s);
-                    }
-                }
-            }
-
-            inPtIdReal++;
+    // Assigning spherical values
 
-            delete[] sh;
-        }
-    }
-    output->SetPoints(newPts);
+    newPointScalars->SetName(GetSphericalHarmonicValuesArrayName());
+    outPD->AddArray(newPointScalars);
 
     // Assigning color to PointData
 
     if (newScalars) {
-        newScalars->SetName((ColorMode==COLOR_BY_SCALARS) ? GetAnisotropyMeasureArrayName() : GetRGBArrayName());
+        newScalars->SetName(colorByScalars ? GetAnisotropyMeasureArrayName() : GetRGBArrayName());
         const int idx = outPD->AddArray(newScalars);
         outPD->SetActiveAttribute(idx,vtkDataSetAttributes::SCALARS);
-        newScalars->Delete();
-    }
-
-    // Assigning spherical values
-
-    if (newPointScalars) {
-        newPointScalars->SetName(GetSphericalHarmonicValuesArrayName());
-        newPointScalars->Delete();
     }
 
-    newPts->Delete();
-    newPointData->Delete();
-    trans->Delete();
+    UpdateProgress(1.0);
 
     return 1;
 }
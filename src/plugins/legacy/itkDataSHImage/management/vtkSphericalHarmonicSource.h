@@ -150,6 +150,16 @@ public:
 
     void UpdateSphericalHarmonicSource();
 
+    /** Get the spherical harmonic basis, one row per coefficient and one column per
+      * point of the shell, computed by UpdateSphericalHarmonicSource()*/
+
+    const itk::VariableSizeMatrix<double>& GetBasisFunction() const { return BasisFunction; }
+
+    /** Get the undeformed unit sphere sampling the directions, sharing the point order
+      * and topology of the output*/
+
+    vtkPolyData* GetShell() { return sphereT->GetOutput(); }
+
     //     /** Function constructing the Spherical Harmonic function with the given
     //      *  directions text file.  At this point, the number of directions needs
     //      *  to match the Tesselation. i.e. Tesselation = 3 -> 81 directions
@@ -13,7 +13,6 @@
 
 #include <dtkCoreSupport/dtkAbstractProcessFactory.h>
 
-#include <itkConnectedThresholdImageFilter.h>
 #include <itkDanielssonDistanceMapImageFilter.h>
 #include <itkExceptionObject.h>
 #include <itkExtractImageFilter.h>
@@ -36,6 +35,7 @@
 #include <medMessageController.h>
 #include <medPluginManager.h>
 #include <medSelectorToolBox.h>
+#include <medSettingsManager.h>
 #include <medTabbedViewContainers.h>
 #include <medToolBoxFactory.h>
 #include <medUtilities.h>
@@ -492,8 +492,10 @@ AlgorithmPaintToolBox::AlgorithmPaintToolBox(QWidget *parent ) :
     m_copy.second = -1;
     viewCopied = nullptr;
 
-    m_undoStacks = new QHash<medAbstractView*,QStack<PairListSlicePlaneId>*>();
-    m_redoStacks = new QHash<medAbstractView*,QStack<PairListSlicePlaneId>*>();
+    m_undoStacks = new QHash<medAbstractView*,QStack<PaintHistoryStep>*>();
+    m_redoStacks = new QHash<medAbstractView*,QStack<PaintHistoryStep>*>();
+
+    m_historyMemoryBudget = medSettingsManager::instance()->value("segmentation", "paint_history_budget_mb", 256).toULongLong() * 1024 * 1024;
 
     currentPlaneIndex = 0;
     currentIdSlice = 0;
@@ -546,7 +548,7 @@ void AlgorithmPaintToolBox::updateMagicWandComputation()
 {
     if (seedPlanted)
     {
-        if (m_wand3DCheckbox->isChecked() && wandTimer.elapsed()<600) // 1000/24 (24 images per second)
+        if (m_wand3DCheckbox->isChecked() && wandTimer.elapsed()<40) // 1000/24 (24 images per second)
         {
             return;
         }
@@ -1101,116 +1103,51 @@ AlgorithmPaintToolBox::RunConnectedFilter (MaskType::IndexType &index, unsigned
         return;
     }
 
-    typedef itk::ConnectedThresholdImageFilter<IMAGE, MaskType> ConnectedThresholdImageFilterType;
-    typename ConnectedThresholdImageFilterType::Pointer ctiFilter = ConnectedThresholdImageFilterType::New();
-
     double value = tmpPtr->GetPixel(index);
     if (!seedPlanted)
     {
         setSeedPlanted(true,index,planeIndex,value);
     }
 
-    ctiFilter->SetUpper( m_wandUpperThresholdSlider->value() );
-    ctiFilter->SetLower( m_wandLowerThresholdSlider->value() );
-
-    MaskType::RegionType regionRequested = tmpPtr->GetLargestPossibleRegion();
-    regionRequested.SetIndex(planeIndex, index[planeIndex]);
-    regionRequested.SetSize(planeIndex, 1);
-    MaskType::RegionType outRegion = regionRequested;
-    outRegion.SetIndex(planeIndex,0);
+    // Moving the threshold sliders around the same seed only grows the previous region
+    bool is3D = (m_wand3DCheckbox->checkState() != Qt::Unchecked);
+    m_wandFill.update(tmpPtr, index, is3D ? -1 : static_cast<int>(planeIndex),
+                      m_wandLowerThresholdSlider->value(), m_wandUpperThresholdSlider->value());
 
-    if (m_wand3DCheckbox->checkState() == Qt::Unchecked)
+    // For undo/redo purposes ------------------------- Save the changes of the slices modified by the segmentation
+    QList<unsigned int> listIdSlice;
+    if (is3D && !m_wandFill.region().empty())
     {
-        typename IMAGE::Pointer workPtr = IMAGE::New();
-        workPtr->Initialize();
-        workPtr->SetDirection(tmpPtr->GetDirection());
-        workPtr->SetSpacing(tmpPtr->GetSpacing());
-        workPtr->SetOrigin(tmpPtr->GetOrigin());
-        workPtr->SetRegions(outRegion);
-        workPtr->Allocate();
-
-        itk::ImageRegionConstIterator < IMAGE > inputItr (tmpPtr, regionRequested);
-        itk::ImageRegionIterator < IMAGE > workItr (workPtr, outRegion);
-
-        while (!workItr.IsAtEnd())
+        unsigned int firstSlice, lastSlice;
+        m_wandFill.sliceRange(planeIndex, firstSlice, lastSlice);
+        for (unsigned int idSlice = firstSlice; idSlice <= lastSlice; ++idSlice)
         {
-            workItr.Set(inputItr.Get());
-
-            ++workItr;
-            ++inputItr;
+            listIdSlice.append(idSlice);
         }
-
-        // For undo/redo purposes -------------------------
-        QList<unsigned int> listIdSlice;
+    }
+    else
+    {
         listIdSlice.append(index[planeIndex]);
-        addSliceToStack(currentView,planeIndex,listIdSlice);
-        // -------------------------------------------------
-
-        ctiFilter->SetInput( workPtr );
-        index[planeIndex] = 0;
-        ctiFilter->AddSeed( index );
-
-        ctiFilter->Update();
-
-        itk::ImageRegionConstIterator <MaskType> outFilterItr (ctiFilter->GetOutput(), outRegion);
-        itk::ImageRegionIterator <MaskType> maskFilterItr (m_itkMask, regionRequested);
-
-        while (!maskFilterItr.IsAtEnd())
+    }
+    // The mask shares the geometry of the image, only the grown voxels are written and saved
+    if (currentView)
+    {
+        if(!m_undoStacks->contains(currentView))
         {
-            if (outFilterItr.Get() != 0)
-            {
-                maskFilterItr.Set(pxValue);
-            }
-
-            ++outFilterItr;
-            ++maskFilterItr;
+            m_undoStacks->insert(currentView, new QStack<PaintHistoryStep>());
         }
+        pushPaintStep(currentView, planeIndex, listIdSlice, true)->paint(m_itkMask, planeIndex, m_wandFill.region(), pxValue);
+        trimHistory();
     }
     else
     {
-        ctiFilter->SetInput( tmpPtr );
-        ctiFilter->AddSeed( index );
-
-        ctiFilter->Update();
-
-        itk::ImageRegionConstIterator <MaskType> outFilterItr (ctiFilter->GetOutput(), tmpPtr->GetLargestPossibleRegion());
-        itk::ImageRegionIterator <MaskType> maskFilterItr (m_itkMask, tmpPtr->GetLargestPossibleRegion());
-
-        // For undo/redo purposes ------------------------- Save the current states of slices that are going to be modified by the segmentation
-        unsigned int idSlice = index[planeIndex];
-        QList<unsigned int> listIdSlice;
-        listIdSlice.append(idSlice);
-
-        while(!outFilterItr.IsAtEnd())
+        MaskType::PixelType *maskBuffer = m_itkMask->GetBufferPointer();
+        for (size_t offset : m_wandFill.region())
         {
-            if (outFilterItr.Get() != 0)
-            {
-                MaskType::IndexType indexOutFilter = outFilterItr.GetIndex();
-                // save the id of slices that are modified by the 3d mode
-                if (idSlice!=indexOutFilter[planeIndex])
-                {
-                    idSlice = indexOutFilter[planeIndex];
-                    listIdSlice.append(idSlice);
-                }
-            }
-            ++outFilterItr;
-        }
-        addSliceToStack(currentView,planeIndex,listIdSlice);
-        // -------------------------------------------------
-
-        outFilterItr.GoToBegin();
-
-        while (!maskFilterItr.IsAtEnd())
-        {
-            if (outFilterItr.Get() != 0)
-            {
-                maskFilterItr.Set(pxValue);
-            }
-
-            ++outFilterItr;
-            ++maskFilterItr;
+            maskBuffer[offset] = pxValue;
         }
     }
+    // -------------------------------------------------
 
     m_itkMask->Modified();
     m_itkMask->GetPixelContainer()->Modified();
@@ -1553,7 +1490,7 @@ void AlgorithmPaintToolBox::undo()
     {
         return;
     }
-    QStack<PairListSlicePlaneId> * undo_stack = m_undoStacks->value(currentView);
+    QStack<PaintHistoryStep> * undo_stack = m_undoStacks->value(currentView);
 
     if (undo_stack->isEmpty())
     {
@@ -1568,48 +1505,19 @@ void AlgorithmPaintToolBox::undo()
 
     if (!m_redoStacks->contains(currentView))
     {
-        m_redoStacks->insert(currentView,new QStack<PairListSlicePlaneId>());
+        m_redoStacks->insert(currentView,new QStack<PaintHistoryStep>());
     }
 
-    QStack<PairListSlicePlaneId> * redo_stack = m_redoStacks->value(currentView);
+    QStack<PaintHistoryStep> * redo_stack = m_redoStacks->value(currentView);
 
-    PairListSlicePlaneId previousState = undo_stack->pop();
-    unsigned char planeIndex = previousState.second;
+    PaintHistoryStep previousStep = undo_stack->pop();
+    MaskType::Pointer mask = previousStep.mask;
+    previousStep.delta->finish(mask);
+    previousStep.delta->undo(mask);
 
-    MaskType::RegionType requestedRegion = m_itkMask->GetLargestPossibleRegion();
-    Mask2dType::IndexType index2d;
-    Mask2dType::RegionType region;
-    Mask2dType::RegionType::SizeType size;
-
-    unsigned int i, j;
-    char direction[2];
-    for (i = 0, j = 0; i < 3; ++i )
-    {
-        if (i != planeIndex)
-        {
-            direction[j] = i;
-            j++;
-        }
-    }
-
-    index2d[ direction[0] ]    = requestedRegion.GetIndex()[ direction[0] ];
-    index2d[ 1- direction[0] ] = requestedRegion.GetIndex()[ direction[1] ];
-    size[ direction[0] ]     = requestedRegion.GetSize()[  direction[0] ];
-    size[ 1- direction[0] ]  = requestedRegion.GetSize()[  direction[1] ];
-
-    region.SetSize(size);
-    region.SetIndex(index2d);
-
-    PaintBrushSet list;
-    for(auto& prev : previousState.first )
+    for(auto& prev : previousStep.rois )
     {
         unsigned int idSlice = prev->getIdSlice();
-        Mask2dType::Pointer currentSlice = Mask2dType::New();
-        currentSlice->SetRegions(region);
-        currentSlice->Allocate();
-        copySliceFromMask3D(currentSlice, planeIndex, direction, idSlice, false);
-        pasteSliceToMask3D(prev->getSlice(), planeIndex, direction, idSlice, false);
-        list.insert(new medPaintBrush(currentSlice, idSlice, prev->isMasterRoi(), prev->getLabel() ));
 
         for (auto& pB : setOfPaintBrushRois)
         {
@@ -1627,12 +1535,11 @@ void AlgorithmPaintToolBox::undo()
         }
     }
 
-    PairListSlicePlaneId currentState = PairListSlicePlaneId(list,planeIndex);
-    redo_stack->append(currentState);
+    redo_stack->append(previousStep);
 
-    m_itkMask->Modified();
-    m_itkMask->GetPixelContainer()->Modified();
-    m_itkMask->SetPipelineMTime(m_itkMask->GetMTime());
+    mask->Modified();
+    mask->GetPixelContainer()->Modified();
+    mask->SetPipelineMTime(mask->GetMTime());
     m_maskAnnotationData->invokeModified();
 
     // No more painted data
@@ -1649,65 +1556,32 @@ void AlgorithmPaintToolBox::redo()
         return;
     }
 
-    QStack<PairListSlicePlaneId> *redo_stack = m_redoStacks->value(currentView);
-    QStack<PairListSlicePlaneId> *undo_stack = m_undoStacks->value(currentView);
+    QStack<PaintHistoryStep> *redo_stack = m_redoStacks->value(currentView);
+    QStack<PaintHistoryStep> *undo_stack = m_undoStacks->value(currentView);
 
     if (redo_stack->isEmpty())
     {
         return;
     }
 
-    // Save the current state in the undo_stack
-    PairListSlicePlaneId nextState = redo_stack->pop();
-    unsigned char planeIndex = nextState.second;
-    MaskType::RegionType requestedRegion = m_itkMask->GetLargestPossibleRegion();
-    Mask2dType::IndexType index2d;
-    Mask2dType::RegionType region;
-    Mask2dType::RegionType::SizeType size;
-
-    unsigned int i, j;
-    char direction[2];
-    for (i = 0, j = 0; i < 3; ++i )
-    {
-        if (i != planeIndex)
-        {
-            direction[j] = i;
-            j++;
-        }
-    }
-
-    index2d[ direction[0] ]    = requestedRegion.GetIndex()[ direction[0] ];
-    index2d[ 1- direction[0] ] = requestedRegion.GetIndex()[ direction[1] ];
-    size[ direction[0] ]     = requestedRegion.GetSize()[  direction[0] ];
-    size[ 1- direction[0] ]  = requestedRegion.GetSize()[  direction[1] ];
-
-    region.SetSize(size);
-    region.SetIndex(index2d);
+    PaintHistoryStep nextStep = redo_stack->pop();
+    MaskType::Pointer mask = nextStep.mask;
+    nextStep.delta->redo(mask);
 
-    PaintBrushSet list;
-    for(auto& next : nextState.first )
+    for(auto& next : nextStep.rois )
     {
-        unsigned int idSlice = next->getIdSlice();
-        Mask2dType::Pointer currentSlice = Mask2dType::New();
-        currentSlice->SetRegions(region);
-        currentSlice->Allocate();
-        copySliceFromMask3D(currentSlice,planeIndex,direction,idSlice, false);
-        pasteSliceToMask3D(next->getSlice(),nextState.second,direction,idSlice, false);
-        list.insert(new medPaintBrush(currentSlice, idSlice, next->isMasterRoi(), next->getLabel() ));
-
         if (slicingParameter)
         {
-            slicingParameter->getSlider()->addTick(idSlice);
+            slicingParameter->getSlider()->addTick(next->getIdSlice());
             slicingParameter->getSlider()->update();
         }
     }
 
-    PairListSlicePlaneId currentState = PairListSlicePlaneId(list,planeIndex);
-    undo_stack->append(currentState);
+    undo_stack->append(nextStep);
 
-    m_itkMask->Modified();
-    m_itkMask->GetPixelContainer()->Modified();
-    m_itkMask->SetPipelineMTime(m_itkMask->GetMTime());
+    mask->Modified();
+    mask->GetPixelContainer()->Modified();
+    mask->SetPipelineMTime(mask->GetMTime());
     m_maskAnnotationData->invokeModified();
 }
 
@@ -1721,36 +1595,26 @@ void AlgorithmPaintToolBox::addSliceToStack(medAbstractView *view, const unsigne
 
     if(!m_undoStacks->contains(view))
     {
-        m_undoStacks->insert(view, new QStack<PairListSlicePlaneId>());
+        m_undoStacks->insert(view, new QStack<PaintHistoryStep>());
     }
 
-    // copy code
-    MaskType::RegionType requestedRegion = m_itkMask->GetLargestPossibleRegion();
-    Mask2dType::IndexType index2d;
-    Mask2dType::RegionType region;
-    Mask2dType::RegionType::SizeType size;
+    std::shared_ptr<medPaintMaskDelta> delta = pushPaintStep(view, planeIndex, listIdSlice, isMaster);
+    delta->begin(m_itkMask, planeIndex, listIdSlice, interpolatedMaskPixelValue, m_strokeLabelSpinBox->value());
 
-    unsigned int i, j;
-    char direction[2];
-    for (i = 0, j = 0; i < 3; ++i )
-    {
-        if (i != planeIndex)
-        {
-            direction[j] = i;
-            j++;
-        }
-    }
+    trimHistory();
+}
 
-    index2d[ direction[0] ]    = requestedRegion.GetIndex()[ direction[0] ];
-    index2d[ 1- direction[0] ] = requestedRegion.GetIndex()[ direction[1] ];
-    size[ direction[0] ]     = requestedRegion.GetSize()[  direction[0] ];
-    size[ 1- direction[0] ]  = requestedRegion.GetSize()[  direction[1] ];
+std::shared_ptr<medPaintMaskDelta> AlgorithmPaintToolBox::pushPaintStep(medAbstractView *view, const unsigned char planeIndex,
+                                                                        const QList<unsigned int> &listIdSlice, bool isMaster)
+{
+    // The previous operation is over, only keep the voxels it changed
+    finishPaintSteps();
 
-    region.SetSize(size);
-    region.SetIndex(index2d);
+    PaintHistoryStep step;
+    step.planeIndex = planeIndex;
+    step.delta = std::make_shared<medPaintMaskDelta>();
+    step.mask = m_itkMask;
 
-    PaintBrushSet setOfUndoRois;
-    setOfUndoRois.clear();
     for(int i = 0; i<listIdSlice.size(); i++)
     {
         unsigned int idSlice = listIdSlice[i];
@@ -1762,24 +1626,66 @@ void AlgorithmPaintToolBox::addSliceToStack(medAbstractView *view, const unsigne
                 break;
             }
         }
-        Mask2dType::Pointer currentSlice = Mask2dType::New();
-        currentSlice->SetRegions(region);
-        currentSlice->Allocate();
-        copySliceFromMask3D(currentSlice,planeIndex,direction,idSlice);
-        setOfUndoRois.insert(new medPaintBrush(currentSlice, idSlice, isMaster, m_strokeLabelSpinBox->value()));
+        step.rois.insert(new medPaintBrush(Mask2dType::Pointer(), idSlice, isMaster, m_strokeLabelSpinBox->value()));
 
         slicingParameter->getSlider()->addTick(idSlice);
         slicingParameter->getSlider()->update();
     }
 
-    setOfPaintBrushRois.insert(setOfUndoRois.begin(), setOfUndoRois.end());
+    setOfPaintBrushRois.insert(step.rois.begin(), step.rois.end());
 
-    m_undoStacks->value(view)->append(PairListSlicePlaneId(setOfUndoRois,planeIndex));
+    m_undoStacks->value(view)->append(step);
 
     if (m_redoStacks->contains(view))
     {
         m_redoStacks->value(view)->clear();
     }
+
+    return step.delta;
+}
+
+void AlgorithmPaintToolBox::finishPaintSteps()
+{
+    for (QStack<PaintHistoryStep> *undo_stack : *m_undoStacks)
+    {
+        // Each step is finished against the mask it was painted in, which may not be the current one
+        if (undo_stack && !undo_stack->isEmpty() && undo_stack->top().mask)
+        {
+            undo_stack->top().delta->finish(undo_stack->top().mask);
+        }
+    }
+}
+
+void AlgorithmPaintToolBox::trimHistory()
+{
+    size_t historySize = 0;
+    for (QStack<PaintHistoryStep> *stack : m_undoStacks->values() + m_redoStacks->values())
+    {
+        for (const PaintHistoryStep &step : *stack)
+        {
+            historySize += step.delta->memorySize();
+        }
+    }
+
+    // Forget the oldest operations first, always keeping the last one of each view
+    for (QStack<PaintHistoryStep> *undo_stack : *m_undoStacks)
+    {
+        while (historySize > m_historyMemoryBudget && undo_stack->size() > 1)
+        {
+            historySize -= undo_stack->first().delta->memorySize();
+            undo_stack->removeFirst();
+        }
+    }
+
+    // Then the operations furthest from being redone, which can all go
+    for (QStack<PaintHistoryStep> *redo_stack : *m_redoStacks)
+    {
+        while (historySize > m_historyMemoryBudget && !redo_stack->isEmpty())
+        {
+            historySize -= redo_stack->first().delta->memorySize();
+            redo_stack->removeFirst();
+        }
+    }
 }
 
 void AlgorithmPaintToolBox::clear()
@@ -1802,6 +1708,7 @@ void AlgorithmPaintToolBox::clear()
 void AlgorithmPaintToolBox::clearMask()
 {
     setOfPaintBrushRois.clear();
+    m_wandFill.reset();
     if ( m_maskData && m_itkMask )
     {
         m_itkMask->FillBuffer( MaskPixelValues::Unset );
@@ -1868,8 +1775,8 @@ void AlgorithmPaintToolBox::setCurrentView(medAbstractImageView * view)
 
     if (!m_undoStacks->contains(currentView))
     {
-        m_redoStacks->insert(currentView,new QStack<PairListSlicePlaneId>());
-        m_undoStacks->insert(currentView,new QStack<PairListSlicePlaneId>());
+        m_redoStacks->insert(currentView,new QStack<PaintHistoryStep>());
+        m_undoStacks->insert(currentView,new QStack<PaintHistoryStep>());
     }
 }
 
@@ -2228,6 +2135,9 @@ void AlgorithmPaintToolBox::interpolate()
     }
     this->setToolBoxOnWaitStatusForNonRunnableProcess();
 
+    // Interpolated voxels are not part of the painting history
+    finishPaintSteps();
+
     std::vector<std::pair<unsigned int, int>> masterRois;
     for(auto it = setOfPaintBrushRois.begin(); it != setOfPaintBrushRois.end(); )
     {
@@ -14,6 +14,8 @@
 
 #include <medAlgorithmPaintPluginExport.h>
 #include <medPaintBrush.h>
+#include <medPaintMaskDelta.h>
+#include <medPaintWandFill.h>
 
 #include <medAbstractData.h>
 #include <medAbstractSelectableToolBox.h>
@@ -25,6 +27,8 @@
 #include <itkImage.h>
 #include <itkImageRegionIterator.h>
 
+#include <memory>
+
 class medAbstractData;
 class medAbstractImageView;
 class medAnnotationData;
@@ -55,7 +59,6 @@ struct MaskPixelValues
     enum E{ Unset = 0, Foreground = 1, Background = 2 };
 };
 
-typedef itk::Image <unsigned char, 3>              MaskType;
 typedef itk::Image <float, 3>                      MaskFloatType;
 typedef itk::ImageRegionIterator <MaskType>        MaskIterator;
 typedef itk::ImageRegionIterator <MaskFloatType>   MaskFloatIterator;
@@ -85,7 +88,15 @@ class MEDALGORITMPAINT_EXPORT AlgorithmPaintToolBox : public medAbstractSelectab
 public:
 
     typedef std::set<dtkSmartPointer<medPaintBrush>, PaintBrushObjComparator> PaintBrushSet;
-    typedef QPair<PaintBrushSet,unsigned char> PairListSlicePlaneId;
+
+    //! One undoable paint operation: the ROIs of the painted slices and the voxels it changed
+    struct PaintHistoryStep
+    {
+        PaintBrushSet rois;
+        unsigned char planeIndex;
+        std::shared_ptr<medPaintMaskDelta> delta;
+        MaskType::Pointer mask; // the one of the view it was painted in
+    };
     PaintBrushSet setOfPaintBrushRois;
 
     AlgorithmPaintToolBox( QWidget *parent );
@@ -216,6 +227,7 @@ private:
     QCheckBox *m_wand3DCheckbox, *m_wand3DRealTime;
     QLabel *m_wandInfo;
     QTime wandTimer;
+    medPaintWandFill m_wandFill;
 
     bool seedPlanted;
     QVector3D m_seed;
@@ -246,7 +258,8 @@ private:
     QPair<Mask2dType::Pointer,char> m_copy;
 
     // undo_redo_feature's attributes
-    QHash<medAbstractView*,QStack<PairListSlicePlaneId>*> *m_undoStacks,*m_redoStacks;
+    QHash<medAbstractView*,QStack<PaintHistoryStep>*> *m_undoStacks,*m_redoStacks;
+    size_t m_historyMemoryBudget;
     medAbstractImageView *currentView;
     medAbstractImageView *viewCopied;
 
@@ -258,6 +271,11 @@ private:
     template <typename IMAGE> void RunConnectedFilter (MaskType::IndexType &index, unsigned int planeIndex);
     template <typename IMAGE> void GenerateMinMaxValuesFromImage ();
 
+    std::shared_ptr<medPaintMaskDelta> pushPaintStep(medAbstractView *view, const unsigned char planeIndex,
+                                                     const QList<unsigned int> &listIdSlice, bool isMaster);
+    void finishPaintSteps();
+    void trimHistory();
+
     void interpolateBetween2PaintBrush(unsigned int firstSlice, unsigned int secondSlice);
     void deleteSliceFromMask3D(unsigned int sliceIndex);
 
@@ -0,0 +1,264 @@
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#include <medPaintMaskDelta.h>
+
+#include <algorithm>
+
+namespace med
+{
+
+medPaintMaskDelta::medPaintMaskDelta()
+    : m_planeIndex(0), m_finished(true)
+{
+}
+
+medPaintMaskDelta::SliceLayout medPaintMaskDelta::layout(MaskType *mask, unsigned int slice) const
+{
+    const MaskType::SizeType size = mask->GetBufferedRegion().GetSize();
+    const size_t strides[3] = { 1, size[0], size[0] * size[1] };
+
+    unsigned int direction[2];
+    for (unsigned int i = 0, j = 0; i < 3; ++i)
+    {
+        if (i != m_planeIndex)
+        {
+            direction[j++] = i;
+        }
+    }
+
+    SliceLayout sliceLayout;
+    sliceLayout.origin  = slice * strides[m_planeIndex];
+    sliceLayout.strideU = strides[direction[0]];
+    sliceLayout.strideV = strides[direction[1]];
+    sliceLayout.sizeU   = size[direction[0]];
+    sliceLayout.sizeV   = size[direction[1]];
+    return sliceLayout;
+}
+
+void medPaintMaskDelta::begin(MaskType *mask, unsigned char planeIndex, const QList<unsigned int> &slices,
+                              unsigned char replacedValue, unsigned char replacement)
+{
+    m_planeIndex = planeIndex;
+    m_finished = false;
+    m_slices.clear();
+    m_slices.reserve(slices.size());
+
+    MaskType::PixelType *buffer = mask->GetBufferPointer();
+
+    for (unsigned int slice : slices)
+    {
+        SliceDelta sliceDelta;
+        sliceDelta.slice = slice;
+
+        const SliceLayout l = layout(mask, slice);
+        for (unsigned int v = 0; v < l.sizeV; ++v)
+        {
+            MaskType::PixelType *voxel = buffer + l.origin + v * l.strideV;
+            for (unsigned int u = 0; u < l.sizeU; ++u, voxel += l.strideU)
+            {
+                if (*voxel == replacedValue)
+                {
+                    *voxel = replacement;
+                }
+                if (!sliceDelta.saved.empty() && sliceDelta.saved.back().value == *voxel)
+                {
+                    ++sliceDelta.saved.back().length;
+                }
+                else
+                {
+                    sliceDelta.saved.push_back({ 1, *voxel });
+                }
+            }
+        }
+        sliceDelta.saved.shrink_to_fit();
+        m_slices.push_back(std::move(sliceDelta));
+    }
+}
+
+void medPaintMaskDelta::finish(MaskType *mask)
+{
+    if (m_finished)
+    {
+        return;
+    }
+
+    const MaskType::PixelType *buffer = mask->GetBufferPointer();
+
+    for (SliceDelta &sliceDelta : m_slices)
+    {
+        const SliceLayout l = layout(mask, sliceDelta.slice);
+
+        unsigned int offset = 0;
+        unsigned int u = 0;
+        unsigned int v = 0;
+        for (const ValueRun &saved : sliceDelta.saved)
+        {
+            for (unsigned int i = 0; i < saved.length; ++i, ++offset)
+            {
+                const MaskType::PixelType current = buffer[l.origin + u * l.strideU + v * l.strideV];
+                if (current != saved.value)
+                {
+                    if (!sliceDelta.changes.empty())
+                    {
+                        ChangedRun &last = sliceDelta.changes.back();
+                        if (last.offset + last.length == offset && last.before == saved.value && last.after == current)
+                        {
+                            ++last.length;
+                        }
+                        else
+                        {
+                            sliceDelta.changes.push_back({ offset, 1, saved.value, current });
+                        }
+                    }
+                    else
+                    {
+                        sliceDelta.changes.push_back({ offset, 1, saved.value, current });
+                    }
+                }
+                if (++u == l.sizeU)
+                {
+                    u = 0;
+                    ++v;
+                }
+            }
+        }
+        std::vector<ValueRun>().swap(sliceDelta.saved);
+        sliceDelta.changes.shrink_to_fit();
+    }
+
+    // Slices left untouched by the operation do not need to be kept
+    m_slices.erase(std::remove_if(m_slices.begin(), m_slices.end(),
+                                  [](const SliceDelta &sliceDelta) { return sliceDelta.changes.empty(); }),
+                   m_slices.end());
+    m_finished = true;
+}
+
+void medPaintMaskDelta::paint(MaskType *mask, unsigned char planeIndex, const std::vector<size_t> &offsets,
+                              unsigned char value)
+{
+    m_planeIndex = planeIndex;
+    m_finished = true;
+    m_slices.clear();
+
+    MaskType::PixelType *buffer = mask->GetBufferPointer();
+    const MaskType::SizeType size = mask->GetBufferedRegion().GetSize();
+
+    // Changed voxels sorted by slice then by position in the slice, so that they group into runs
+    struct ChangedVoxel
+    {
+        unsigned int slice;
+        unsigned int offset;
+        unsigned char before;
+        bool operator<(const ChangedVoxel &other) const
+        {
+            return slice < other.slice || (slice == other.slice && offset < other.offset);
+        }
+    };
+    std::vector<ChangedVoxel> changedVoxels;
+    const unsigned int sizeU = layout(mask, 0).sizeU;
+
+    for (size_t offset : offsets)
+    {
+        if (buffer[offset] == value)
+        {
+            continue;
+        }
+        const size_t index[3] = { offset % size[0], (offset / size[0]) % size[1], offset / (size[0] * size[1]) };
+        const size_t u = (planeIndex == 0) ? index[1] : index[0];
+        const size_t v = (planeIndex == 2) ? index[1] : index[2];
+        changedVoxels.push_back({ static_cast<unsigned int>(index[planeIndex]),
+                                  static_cast<unsigned int>(u + v * sizeU), buffer[offset] });
+        buffer[offset] = value;
+    }
+
+    std::sort(changedVoxels.begin(), changedVoxels.end());
+
+    for (const ChangedVoxel &voxel : changedVoxels)
+    {
+        if (m_slices.empty() || m_slices.back().slice != voxel.slice)
+        {
+            SliceDelta sliceDelta;
+            sliceDelta.slice = voxel.slice;
+            m_slices.push_back(std::move(sliceDelta));
+        }
+        std::vector<ChangedRun> &changes = m_slices.back().changes;
+        if (!changes.empty() && changes.back().offset + changes.back().length == voxel.offset && changes.back().before == voxel.before)
+        {
+            ++changes.back().length;
+        }
+        else
+        {
+            changes.push_back({ voxel.offset, 1, voxel.before, value });
+        }
+    }
+
+    for (SliceDelta &sliceDelta : m_slices)
+    {
+        sliceDelta.changes.shrink_to_fit();
+    }
+}
+
+bool medPaintMaskDelta::isFinished() const
+{
+    return m_finished;
+}
+
+void medPaintMaskDelta::undo(MaskType *mask) const
+{
+    apply(mask, false);
+}
+
+void medPaintMaskDelta::redo(MaskType *mask) const
+{
+    apply(mask, true);
+}
+
+void medPaintMaskDelta::apply(MaskType *mask, bool after) const
+{
+    MaskType::PixelType *buffer = mask->GetBufferPointer();
+
+    for (const SliceDelta &sliceDelta : m_slices)
+    {
+        const SliceLayout l = layout(mask, sliceDelta.slice);
+        for (const ChangedRun &run : sliceDelta.changes)
+        {
+            const MaskType::PixelType value = after ? run.after : run.before;
+            unsigned int u = run.offset % l.sizeU;
+            unsigned int v = run.offset / l.sizeU;
+            for (unsigned int i = 0; i < run.length; ++i)
+            {
+                buffer[l.origin + u * l.strideU + v * l.strideV] = value;
+                if (++u == l.sizeU)
+                {
+                    u = 0;
+                    ++v;
+                }
+            }
+        }
+    }
+}
+
+size_t medPaintMaskDelta::memorySize() const
+{
+    size_t size = sizeof(*this);
+    for (const SliceDelta &sliceDelta : m_slices)
+    {
+        size += sizeof(SliceDelta)
+                + sliceDelta.saved.capacity() * sizeof(ValueRun)
+                + sliceDelta.changes.capacity() * sizeof(ChangedRun);
+    }
+    return size;
+}
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#include <itkImage.h>
+
+#include <QList>
+
+#include <medAlgorithmPaintPluginExport.h>
+
+#include <vector>
+
+namespace med
+{
+
+typedef itk::Image <unsigned char, 3> MaskType;
+
+/*! \brief Voxel changes made by one paint operation on some slices of a 3D mask.
+*
+* begin() saves the slices about to be painted, run-length encoded. finish() compares them
+* with the painted mask and only keeps the runs of voxels whose value changed, with their
+* previous and new values. When the edited voxels are known, paint() records them directly.
+* undo() and redo() then only write the edited voxels.
+*/
+class MEDALGORITMPAINT_EXPORT medPaintMaskDelta
+{
+public:
+    medPaintMaskDelta();
+
+    //! Saves the slices of the mask. Voxels equal to replacedValue are set to replacement first.
+    void begin(MaskType *mask, unsigned char planeIndex, const QList<unsigned int> &slices,
+               unsigned char replacedValue, unsigned char replacement);
+
+    //! Sets the voxels at the given buffer offsets to value, keeping the ones that changed
+    void paint(MaskType *mask, unsigned char planeIndex, const std::vector<size_t> &offsets, unsigned char value);
+
+    //! Keeps the voxels changed since begin(), and releases the saved slices
+    void finish(MaskType *mask);
+
+    bool isFinished() const;
+
+    //! Writes back the values of the changed voxels from before the operation
+    void undo(MaskType *mask) const;
+
+    //! Writes back the values of the changed voxels from after the operation
+    void redo(MaskType *mask) const;
+
+    //! Memory used by the saved slices or the changed runs, in bytes
+    size_t memorySize() const;
+
+private:
+    // Slice geometry in the mask buffer, voxels of a slice are numbered along direction[0] first
+    struct SliceLayout
+    {
+        size_t origin;
+        size_t strideU, strideV;
+        unsigned int sizeU, sizeV;
+    };
+
+    // Constant value over length voxels
+    struct ValueRun
+    {
+        unsigned int length;
+        unsigned char value;
+    };
+
+    // Voxels [offset, offset+length) of a slice changed from before to after
+    struct ChangedRun
+    {
+        unsigned int offset;
+        unsigned int length;
+        unsigned char before;
+        unsigned char after;
+    };
+
+    struct SliceDelta
+    {
+        unsigned int slice;
+        std::vector<ValueRun> saved;
+        std::vector<ChangedRun> changes;
+    };
+
+    SliceLayout layout(MaskType *mask, unsigned int slice) const;
+    void apply(MaskType *mask, bool after) const;
+
+    unsigned char m_planeIndex;
+    bool m_finished;
+    std::vector<SliceDelta> m_slices;
+};
+
+}
@@ -0,0 +1,70 @@
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#include <medPaintWandFill.h>
+
+#include <limits>
+
+namespace med
+{
+
+medPaintWandFill::medPaintWandFill()
+    : m_image(nullptr), m_imageTime(0), m_seed(0), m_planeIndex(-1), m_lower(0), m_upper(0)
+{
+    m_size[0] = m_size[1] = m_size[2] = 0;
+    restart(0);
+}
+
+void medPaintWandFill::reset()
+{
+    m_image = nullptr;
+    m_region.clear();
+    m_rejected.clear();
+    m_state.clear();
+    m_size[0] = m_size[1] = m_size[2] = 0;
+}
+
+void medPaintWandFill::restart(size_t seed)
+{
+    // Only the voxels visited by the previous fill need to be cleared
+    for (size_t offset : m_region)
+    {
+        m_state[offset] = Unvisited;
+    }
+    for (size_t offset : m_rejected)
+    {
+        m_state[offset] = Unvisited;
+    }
+    m_region.clear();
+    m_rejected.clear();
+
+    m_seed = seed;
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        m_min[i] = std::numeric_limits<size_t>::max();
+        m_max[i] = 0;
+    }
+}
+
+const std::vector<size_t> &medPaintWandFill::region() const
+{
+    return m_region;
+}
+
+void medPaintWandFill::sliceRange(unsigned int axis, unsigned int &first, unsigned int &last) const
+{
+    first = static_cast<unsigned int>(m_min[axis]);
+    last  = static_cast<unsigned int>(m_max[axis]);
+}
+
+}
@@ -0,0 +1,201 @@
+#pragma once
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#include <itkImage.h>
+
+#include <medAlgorithmPaintPluginExport.h>
+#include <medPaintMaskDelta.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace med
+{
+
+/*! \brief Flood fill of the magic wand, growing the region connected to a seed whose values
+* are within a threshold interval.
+*
+* The fill reads the image buffer in place with a queue, face connected like
+* itk::ConnectedThresholdImageFilter. The region and the voxels rejected at its border are
+* kept, so that widening the thresholds around the same seed only grows from the border,
+* which keeps the 3D wand interactive while the threshold sliders move.
+*/
+class MEDALGORITMPAINT_EXPORT medPaintWandFill
+{
+public:
+    medPaintWandFill();
+
+    /*! Grows the region from seed. planeIndex -1 grows in 3D, otherwise the region stays
+    * in the slice of the seed orthogonal to planeIndex. */
+    template <class ImageType>
+    void update(ImageType *image, const typename ImageType::IndexType &seed, int planeIndex,
+                double lower, double upper);
+
+    //! Forgets the current region
+    void reset();
+
+    //! Buffer offsets of the voxels of the region
+    const std::vector<size_t> &region() const;
+
+    //! First and last slices orthogonal to axis containing voxels of the region
+    void sliceRange(unsigned int axis, unsigned int &first, unsigned int &last) const;
+
+private:
+    enum VoxelState { Unvisited = 0, Inside = 1, Rejected = 2 };
+
+    void restart(size_t seed);
+
+    template <class PixelType>
+    void grow(const PixelType *buffer, PixelType lower, PixelType upper, size_t first);
+
+    const itk::Object *m_image;
+    itk::ModifiedTimeType m_imageTime;
+    size_t m_size[3];
+    size_t m_seed;
+    int m_planeIndex;
+    double m_lower, m_upper;
+
+    std::vector<unsigned char> m_state;
+    std::vector<size_t> m_region;
+    std::vector<size_t> m_rejected;
+    size_t m_min[3], m_max[3];
+};
+
+template <class ImageType>
+void medPaintWandFill::update(ImageType *image, const typename ImageType::IndexType &seed, int planeIndex,
+                              double lower, double upper)
+{
+    typedef typename ImageType::PixelType PixelType;
+
+    // Thresholds are compared in the pixel type, as itk::ConnectedThresholdImageFilter does
+    const PixelType lowerValue = static_cast<PixelType>(lower);
+    const PixelType upperValue = static_cast<PixelType>(upper);
+
+    const typename ImageType::RegionType bufferedRegion = image->GetBufferedRegion();
+    const size_t seedOffset = image->ComputeOffset(seed);
+
+    bool sameImage = (m_image == image) && (m_imageTime == image->GetMTime());
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        sameImage = sameImage && (m_size[i] == bufferedRegion.GetSize()[i]);
+    }
+
+    if (!sameImage)
+    {
+        m_image = image;
+        m_imageTime = image->GetMTime();
+        for (unsigned int i = 0; i < 3; ++i)
+        {
+            m_size[i] = bufferedRegion.GetSize()[i];
+        }
+        m_region.clear();
+        m_rejected.clear();
+        m_state.assign(m_size[0] * m_size[1] * m_size[2], Unvisited);
+    }
+
+    const PixelType *buffer = image->GetBufferPointer();
+    size_t first = 0;
+
+    if (sameImage && seedOffset == m_seed && planeIndex == m_planeIndex &&
+        lowerValue <= m_lower && upperValue >= m_upper)
+    {
+        // Wider thresholds: accept the border voxels now within them and grow from there
+        first = m_region.size();
+        std::vector<size_t> rejected;
+        rejected.swap(m_rejected);
+        for (size_t offset : rejected)
+        {
+            if (lowerValue <= buffer[offset] && buffer[offset] <= upperValue)
+            {
+                m_state[offset] = Inside;
+                m_region.push_back(offset);
+            }
+            else
+            {
+                m_rejected.push_back(offset);
+            }
+        }
+    }
+    else
+    {
+        m_planeIndex = planeIndex;
+        restart(seedOffset);
+        if (lowerValue <= buffer[seedOffset] && buffer[seedOffset] <= upperValue)
+        {
+            m_state[seedOffset] = Inside;
+            m_region.push_back(seedOffset);
+        }
+        else
+        {
+            m_state[seedOffset] = Rejected;
+            m_rejected.push_back(seedOffset);
+        }
+    }
+
+    m_lower = lowerValue;
+    m_upper = upperValue;
+
+    grow(buffer, lowerValue, upperValue, first);
+}
+
+template <class PixelType>
+void medPaintWandFill::grow(const PixelType *buffer, PixelType lower, PixelType upper, size_t first)
+{
+    const size_t strides[3] = { 1, m_size[0], m_size[0] * m_size[1] };
+
+    // The region doubles as the queue of the fill
+    for (size_t i = first; i < m_region.size(); ++i)
+    {
+        const size_t offset = m_region[i];
+        const size_t index[3] = { offset % m_size[0], (offset / m_size[0]) % m_size[1], offset / strides[2] };
+
+        for (unsigned int axis = 0; axis < 3; ++axis)
+        {
+            m_min[axis] = std::min(m_min[axis], index[axis]);
+            m_max[axis] = std::max(m_max[axis], index[axis]);
+
+            if (static_cast<int>(axis) == m_planeIndex)
+            {
+                continue;
+            }
+
+            for (int side = 0; side < 2; ++side)
+            {
+                if ((side == 0 && index[axis] == 0) || (side == 1 && index[axis] + 1 == m_size[axis]))
+                {
+                    continue;
+                }
+
+                const size_t neighbor = side ? offset + strides[axis] : offset - strides[axis];
+                if (m_state[neighbor] != Unvisited)
+                {
+                    continue;
+                }
+
+                if (lower <= buffer[neighbor] && buffer[neighbor] <= upper)
+                {
+                    m_state[neighbor] = Inside;
+                    m_region.push_back(neighbor);
+                }
+                else
+                {
+                    m_state[neighbor] = Rejected;
+                    m_rejected.push_back(neighbor);
+                }
+            }
+        }
+    }
+}
+
+}
@@ -155,8 +155,9 @@ int medDecimateMeshProcess::update()
         vtkMetaDataSetSequence *inputSequence = static_cast<vtkMetaDataSetSequence*>(d->input->data());
         vtkMetaDataSetSequence *outputSequence = vtkMetaDataSetSequence::New();
 
-        for(vtkMetaDataSet *inputMetaDataSet : inputSequence->GetMetaDataSetList())
+        for (int i = 0; i < inputSequence->GetNumberOfMetaDataSets(); ++i)
         {
+            vtkMetaDataSet *inputMetaDataSet = inputSequence->GetMetaDataSet(i);
             vtkMetaDataSet *outputMetaDataSet = decimateOneMetaDataSet(inputMetaDataSet);
             outputMetaDataSet->SetTime(inputMetaDataSet->GetTime());
             if (outputMetaDataSet == nullptr)
@@ -134,8 +134,9 @@ int medRefineMeshProcess::update()
         vtkMetaDataSetSequence *inputSequence = static_cast<vtkMetaDataSetSequence*>(d->input->data());
         vtkMetaDataSetSequence *outputSequence = vtkMetaDataSetSequence::New();
 
-        for(vtkMetaDataSet *inputMetaDataSet : inputSequence->GetMetaDataSetList())
+        for (int i = 0; i < inputSequence->GetNumberOfMetaDataSets(); ++i)
         {
+            vtkMetaDataSet *inputMetaDataSet = inputSequence->GetMetaDataSet(i);
             vtkMetaDataSet *outputMetaDataSet = refineOneMetaDataSet(inputMetaDataSet);
             outputMetaDataSet->SetTime(inputMetaDataSet->GetTime());
             if (outputMetaDataSet == nullptr)
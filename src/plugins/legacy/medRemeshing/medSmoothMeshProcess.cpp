@@ -126,8 +126,9 @@ int medSmoothMeshProcess::update()
         vtkMetaDataSetSequence *inputSequence = static_cast<vtkMetaDataSetSequence*>(d->input->data());
         vtkMetaDataSetSequence *outputSequence = vtkMetaDataSetSequence::New();
 
-        for(vtkMetaDataSet *inputMetaDataSet : inputSequence->GetMetaDataSetList())
+        for (int i = 0; i < inputSequence->GetNumberOfMetaDataSets(); ++i)
         {
+            vtkMetaDataSet *inputMetaDataSet = inputSequence->GetMetaDataSet(i);
             vtkMetaDataSet *outputMetaDataSet = smoothOneMetaDataSet(inputMetaDataSet);
             outputMetaDataSet->SetTime(inputMetaDataSet->GetTime());
             if (outputMetaDataSet == nullptr)
@@ -22,6 +22,8 @@
 #include <vtkCellArray.h>
 #include <vtkCellData.h>
 #include <vtkUnsignedCharArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkMultiThreader.h>
 
 #include <vtkMath.h>
 
@@ -42,6 +44,9 @@ vtkLimitFibersToROI::vtkLimitFibersToROI()
     this->BooleanOperationVector[i] = 2;
   }
   this->DirectionMatrix = 0;
+  this->FiberLabelsInput = 0;
+  this->FiberLabelsMask = 0;
+  this->FiberLabelsDirection = 0;
 }
 
 vtkLimitFibersToROI::~vtkLimitFibersToROI()
@@ -97,225 +102,266 @@ int vtkLimitFibersToROI::RequestData (vtkInformation *vtkNotUsed(request),
   }
 
 
-  vtkUnsignedCharArray* newColors = vtkUnsignedCharArray::New();
-  newColors->SetNumberOfComponents (3);
+  if( this->FiberLabelsNeedUpdate (input) )
+  {
+    this->UpdateProgress (0.0);
+    this->ComputeFiberLabels (input);
+  }
 
-  
-  int* dim        = MaskImage->GetDimensions();
-  double* origin  = MaskImage->GetOrigin();
-  double* spacing = MaskImage->GetSpacing();
+  vtkDebugMacro ( << "Number Of Valid ROIs: " << this->MaskLabels.count() );
+
+  char tmp[256];
+  snprintf (tmp, 256, "%d ROIs to process.", (int)this->MaskLabels.count());
+  this->SetProgressText (tmp);
+
+  if( this->MaskLabels.none() )
+  {
+    vtkWarningMacro( << "There is no label to process." );
+    return 1;
+  }
 
   /**
-     Automatically extract labels (i.e. any scalar value except 0) contained
-     in MaskImage.
+     Algorithm: For each fiber, we test the regions (i.e. labels) it passes through.
+     Along with the BooleanOperationVector, we determine if the fiber should be retained or not:
+     it must not visit any NOT region and must visit all the AND regions.
   */
-  std::vector<int> Labels;
-  unsigned char*   MaskValues = (unsigned char*)MaskImage->GetScalarPointer();
-  
-  for (int i=0;i<MaskImage->GetNumberOfPoints();i++)
+
+  // 0: nullptr
+  // 1: NOT
+  // 2: AND
+  LabelSetType notLabels;
+  LabelSetType andLabels;
+  for( unsigned int label=1; label<256; label++)
   {
-    int val = (int)(*MaskValues);
-    if (val>0)
+    if( this->MaskLabels[label] && this->BooleanOperationVector[label] > 0 )
     {
-      bool IsInserted = false;
-      for (unsigned int j=0; j<Labels.size(); j++)
+      if( this->BooleanOperationVector[label] == 1 )
       {
-        if ( Labels[j]==val )
-        {
-          IsInserted = true;
-          break;
-        }
+        notLabels.set (label);
       }
-      
-      if ( !IsInserted )
+      else
       {
-        Labels.push_back (val);
+        andLabels.set (label);
       }
     }
+  }
 
-    ++MaskValues;
+  vtkIdType numFibers = static_cast<vtkIdType>(this->FiberLabels.size());
+  std::vector<vtkIdType> selectedFibers;
+  selectedFibers.reserve (numFibers);
+  for( vtkIdType cellId=0; cellId<numFibers; cellId++)
+  {
+    const LabelSetType &fiberLabels = this->FiberLabels[cellId];
+    if( (fiberLabels & notLabels).none() && (fiberLabels & andLabels) == andLabels )
+    {
+      selectedFibers.push_back (cellId);
+    }
   }
 
-  std::sort ( Labels.begin(), Labels.end() );
-  unsigned int numLabels = static_cast<unsigned int>(Labels.size());
-  
-  vtkDebugMacro ( << "Number Of Valid ROIs: " << numLabels );
+  this->UpdateProgress (0.9);
 
+  // copy the selected fibers in one pass over the connectivity array
+  vtkIdType connectivitySize = 0;
+  lines->InitTraversal();
+  vtkIdType  npts  = 0;
+  vtkIdType* ptids = 0;
+  vtkIdType  cellId = 0;
+  std::vector<vtkIdType*> selectedCells (selectedFibers.size());
+  size_t selected = 0;
+  while( lines->GetNextCell (npts, ptids) && selected<selectedFibers.size() )
+  {
+    if( cellId==selectedFibers[selected] )
+    {
+      selectedCells[selected++] = ptids - 1; // points to the number of points of the cell
+      connectivitySize += npts + 1;
+    }
+    cellId++;
+  }
+
+  vtkIdTypeArray* connectivity = vtkIdTypeArray::New();
+  connectivity->SetNumberOfValues (connectivitySize);
+  vtkIdType* connectivityPtr = connectivity->GetPointer (0);
+  for( size_t i=0; i<selectedCells.size(); i++)
+  {
+    vtkIdType cellSize = selectedCells[i][0] + 1;
+    std::copy (selectedCells[i], selectedCells[i] + cellSize, connectivityPtr);
+    connectivityPtr += cellSize;
+  }
 
+  vtkCellArray* newLines = vtkCellArray::New();
+  newLines->SetCells (static_cast<vtkIdType>(selectedFibers.size()), connectivity);
+  output->SetLines (newLines);
+  newLines->Delete();
+  connectivity->Delete();
 
-  // Test if the BooleanOperationVector size matches the max label
-  if( Labels[numLabels-1]>255 )
+  if( allColors )
   {
-    vtkErrorMacro (<<"Error: The BoolearOperationVector variable has an incompatible length with the mask image.");
+    vtkUnsignedCharArray* newColors = vtkUnsignedCharArray::New();
+    newColors->SetNumberOfComponents (3);
+    newColors->SetNumberOfTuples (static_cast<vtkIdType>(selectedFibers.size()));
+    for( size_t i=0; i<selectedFibers.size(); i++)
+    {
+      unsigned char fiberColor[3];
+      allColors->GetTypedTuple ( selectedFibers[i], fiberColor );
+      newColors->SetTypedTuple ( static_cast<vtkIdType>(i), fiberColor );
+    }
+    output->GetCellData()->SetScalars (newColors);
     newColors->Delete();
-    return 0;
   }
 
+  this->UpdateProgress (1.0);
 
+  return 1;
+}
 
-  //reset the Scalar Pointer
-  MaskValues= (unsigned char*)MaskImage->GetScalarPointer();
 
-  
-  /**
-     Algorithm: For each fiber, we test the number of regions (i.e. labels)
-     it passes through. Along with the BooleanOperationVector, we determine
-     if the fiber should be retained or not.
-  */
-  
-  lines->InitTraversal();
-  
-  vtkIdType  npts  = 0;
-  vtkIdType* ptids = 0;
-  vtkIdType   test = lines->GetNextCell (npts, ptids);
-  int cellId = 0;
+bool vtkLimitFibersToROI::FiberLabelsNeedUpdate (vtkPolyData* input) const
+{
+  return input != this->FiberLabelsInput ||
+         this->MaskImage != this->FiberLabelsMask ||
+         this->DirectionMatrix != this->FiberLabelsDirection ||
+         input->GetMTime() > this->FiberLabelsTime ||
+         this->MaskImage->GetMTime() > this->FiberLabelsTime ||
+         (this->DirectionMatrix && this->DirectionMatrix->GetMTime() > this->FiberLabelsTime) ||
+         static_cast<vtkIdType>(this->FiberLabels.size()) != input->GetLines()->GetNumberOfCells();
+}
 
-  char tmp[256];
-  snprintf (tmp, 256, "%d ROIs to process.", (int)Labels.size());
-  this->SetProgressText (tmp);
 
-  if( !Labels.size() )
-  {
-    vtkWarningMacro( << "There is no label to process." );
-    return 1;
-  }
-  
-    
-  this->UpdateProgress (0.0);
+namespace
+{
 
-  int iterProgress = 0;
-  int maxProgress  = lines->GetNumberOfCells();
-  int step         = maxProgress/100;
+struct FiberLabelsThreadData
+{
+  vtkPoints*               Points;
+  vtkIdType* const*        Cells; // each cell starts with its number of points
+  vtkIdType                NumberOfCells;
+  double                   Direction[16];
+  double                   Origin[3];
+  double                   Spacing[3];
+  int                      Dimensions[3];
+  const unsigned char*     MaskValues;
+  std::bitset<256>*        FiberLabels;
+};
+
+VTK_THREAD_RETURN_TYPE ComputeFiberLabelsThread (void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  FiberLabelsThreadData* data = static_cast<FiberLabelsThreadData*>(info->UserData);
 
+  vtkIdType blockSize = (data->NumberOfCells + info->NumberOfThreads - 1) / info->NumberOfThreads;
+  vtkIdType begin = std::min (data->NumberOfCells, blockSize * info->ThreadID);
+  vtkIdType end   = std::min (data->NumberOfCells, begin + blockSize);
 
-  vtkMatrix4x4 *t_direction = vtkMatrix4x4::New();
-  t_direction->Identity();
-  if (this->DirectionMatrix)
-  {
-    vtkMatrix4x4::Invert (this->DirectionMatrix, t_direction);
-  }
- 
-  
-  // for All the Fibers 
-  while ( test )
+  const int* dim = data->Dimensions;
+  vtkIdType sliceSize = static_cast<vtkIdType>(dim[0]) * dim[1];
+
+  for( vtkIdType cellId=begin; cellId<end; cellId++)
   {
+    std::bitset<256> &fiberLabels = data->FiberLabels[cellId];
+    fiberLabels.reset();
 
-    //bool found = false;
+    vtkIdType  npts  = data->Cells[cellId][0];
+    vtkIdType* ptids = data->Cells[cellId] + 1;
 
-    std::vector<int> FiberRegions (numLabels, 0);
-    
     // for All the points of the fiber
-    for (int k=0; k<npts; k++)
+    for (vtkIdType k=0; k<npts; k++)
     {
       double pt[4];
-      points->GetPoint (ptids[k], pt);
+      data->Points->GetPoint (ptids[k], pt);
       pt[3] = 1.0;
-      
-      int c[3];
 
       for (int i=0; i<3; i++)
       {
-	pt[i] -= origin[i];
+        pt[i] -= data->Origin[i];
       }
 
-      t_direction->MultiplyPoint (pt, pt);
-
-      /*
-	c[0] = (int)( vtkMath::Round( (pt[0]-origin[0])/spacing[0]) );
-	c[1] = (int)( vtkMath::Round( (pt[1]-origin[1])/spacing[1]) );
-	c[2] = (int)( vtkMath::Round( (pt[2]-origin[2])/spacing[2]) );
-      */
-      c[0] = (int)( vtkMath::Round( pt[0]/spacing[0] ));
-      c[1] = (int)( vtkMath::Round( pt[1]/spacing[1] ));
-      c[2] = (int)( vtkMath::Round( pt[2]/spacing[2] ));
-      
+      vtkMatrix4x4::MultiplyPoint (data->Direction, pt, pt);
+
+      int c[3];
+      c[0] = (int)( vtkMath::Round( pt[0]/data->Spacing[0] ));
+      c[1] = (int)( vtkMath::Round( pt[1]/data->Spacing[1] ));
+      c[2] = (int)( vtkMath::Round( pt[2]/data->Spacing[2] ));
+
       if( c[0]>=0 && c[0]<dim[0] &&
           c[1]>=0 && c[1]<dim[1] &&
           c[2]>=0 && c[2]<dim[2] )
       {
-        
-        int index = c[0] + c[1]*dim[0] + c[2]*dim[0]*dim[1];
-        MaskValues += index;
-        int maskVal = (int)(*MaskValues);
-        MaskValues -= index;
-        
-
-        for( unsigned int i=0; i<numLabels; i++)
-        {
-          if( maskVal==Labels[i] )
-          {
-            FiberRegions[i]=1;
-            break;
-          }            
-        }
-
-        
-      }
-    }
-    
-    bool insert = true;
-
-    // 0: nullptr
-    // 1: NOT
-    // 2: AND
-    
-    for( unsigned int i=0; i<numLabels; i++)
-    {
-      if( this->BooleanOperationVector[ Labels[i] ] > 0 )
-      {
-	if( this->BooleanOperationVector[ Labels[i] ] == 1 )
-	{
-	  insert = insert && !FiberRegions[i];
-	}
-	else
-	{
-	  insert = insert && FiberRegions[i];
-	}
+        vtkIdType index = c[0] + c[1]*static_cast<vtkIdType>(dim[0]) + c[2]*sliceSize;
+        fiberLabels.set (data->MaskValues[index]);
       }
     }
-    
-    
-    if (insert)
-    {
-      output->InsertNextCell(VTK_POLY_LINE, npts, ptids);
-      if( allColors )
-      {
-        unsigned char fiberColor[3];
-        allColors->GetTypedTuple ( cellId, fiberColor );
-        newColors->InsertNextValue (fiberColor[0]);
-        newColors->InsertNextValue (fiberColor[1]);
-        newColors->InsertNextValue (fiberColor[2]);
-      }
-      
-    }
-    
-    test = lines->GetNextCell (npts, ptids);
-    cellId++;
-    
-    iterProgress++;
-    if( step>0 )
-    {
-      if ( !(iterProgress%step) )
-      {
-        this->UpdateProgress (double(iterProgress)/double(maxProgress));
-      }
-    }
-    
+
+    fiberLabels.reset (0); // 0 is the background, not a region
   }
 
-  if( allColors )
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+}
+
+
+void vtkLimitFibersToROI::ComputeFiberLabels (vtkPolyData* input)
+{
+  vtkCellArray* lines = input->GetLines();
+
+  /**
+     Automatically extract labels (i.e. any scalar value except 0) contained
+     in MaskImage.
+  */
+  this->MaskLabels.reset();
+  const unsigned char* maskValues = static_cast<unsigned char*>(this->MaskImage->GetScalarPointer());
+  vtkIdType numberOfVoxels = this->MaskImage->GetNumberOfPoints();
+  bool present[256] = {false};
+  for (vtkIdType i=0; i<numberOfVoxels; i++)
   {
-    output->GetCellData()->SetScalars (newColors);
+    present[maskValues[i]] = true;
+  }
+  for (unsigned int label=1; label<256; label++)
+  {
+    this->MaskLabels[label] = present[label];
+  }
+
+  // cells are stored one after the other, with their number of points first
+  std::vector<vtkIdType*> cells;
+  cells.reserve (lines->GetNumberOfCells());
+  lines->InitTraversal();
+  vtkIdType  npts  = 0;
+  vtkIdType* ptids = 0;
+  while( lines->GetNextCell (npts, ptids) )
+  {
+    cells.push_back (ptids - 1);
   }
-  newColors->Delete();
 
+  this->FiberLabels.assign (cells.size(), LabelSetType());
+
+  FiberLabelsThreadData data;
+  data.Points        = input->GetPoints();
+  data.Cells         = cells.data();
+  data.NumberOfCells = static_cast<vtkIdType>(cells.size());
+  data.MaskValues    = maskValues;
+  data.FiberLabels   = this->FiberLabels.data();
+  this->MaskImage->GetDimensions (data.Dimensions);
+  this->MaskImage->GetOrigin (data.Origin);
+  this->MaskImage->GetSpacing (data.Spacing);
+
+  vtkMatrix4x4 *t_direction = vtkMatrix4x4::New();
+  t_direction->Identity();
+  if (this->DirectionMatrix)
+  {
+    vtkMatrix4x4::Invert (this->DirectionMatrix, t_direction);
+  }
+  vtkMatrix4x4::DeepCopy (data.Direction, t_direction);
   t_direction->Delete();
-  
-  this->UpdateProgress (1.0);
-  
 
-  return 1;
-  
+  vtkMultiThreader* threader = vtkMultiThreader::New();
+  threader->SetSingleMethod (ComputeFiberLabelsThread, &data);
+  threader->SingleMethodExecute();
+  threader->Delete();
+
+  this->FiberLabelsInput     = input;
+  this->FiberLabelsMask      = this->MaskImage;
+  this->FiberLabelsDirection = this->DirectionMatrix;
+  this->FiberLabelsTime.Modified();
 }
 
 void vtkLimitFibersToROI::SetBooleanOperation(int id, int value)
@@ -17,6 +17,9 @@
 #include <vtkPolyDataAlgorithm.h>
 #include <vtkImageData.h>
 #include <vtkMatrix4x4.h>
+#include <vtkTimeStamp.h>
+
+#include <bitset>
 #include <vector>
 
 
@@ -63,6 +66,15 @@ protected:
     // Usual data generation method
     int RequestData (vtkInformation *,vtkInformationVector **,vtkInformationVector *);
 
+    typedef std::bitset<256> LabelSetType;
+
+    /**
+       Fills FiberLabels with the labels of MaskImage visited by each fiber, and MaskLabels
+       with all the labels of MaskImage. Fibers are processed in blocks by several threads.
+     */
+    void ComputeFiberLabels (vtkPolyData* input);
+    bool FiberLabelsNeedUpdate (vtkPolyData* input) const;
+
 private:
     vtkLimitFibersToROI (const vtkLimitFibersToROI&);
     void operator=(const vtkLimitFibersToROI&);
@@ -71,4 +83,13 @@ private:
     vtkMatrix4x4* DirectionMatrix;
 
     int BooleanOperationVector[256];
+
+    // Labels are cached until the fibers, the mask or the direction change,
+    // so that changing BooleanOperationVector only evaluates the selection.
+    std::vector<LabelSetType> FiberLabels;
+    LabelSetType              MaskLabels;
+    vtkPolyData*              FiberLabelsInput;
+    vtkImageData*             FiberLabelsMask;
+    vtkMatrix4x4*             FiberLabelsDirection;
+    vtkTimeStamp              FiberLabelsTime;
 };
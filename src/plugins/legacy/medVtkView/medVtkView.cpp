@@ -13,10 +13,14 @@
 
 #include "medVtkView.h"
 
+#include <QElapsedTimer>
 #include <QHash>
 #include <QTest>
+#include <QTimer>
 #include <QWidget>
 
+#include <dtkLog/dtkLog.h>
+
 #include <QVTKOpenGLWidget.h>
 #include <QGLFramebufferObject>
 
@@ -78,8 +82,19 @@ public:
     QScopedPointer<medVtkViewBackend> backend;
 
     QMainWindow* mainWindow;
+
+    // render scheduling
+    QTimer *renderTimer;
+    QElapsedTimer frameClock;
+    qint64 lastFrameTime;
+    qint64 framesWindowStart;
+    int framesInWindow;
+    double framesPerSecond;
 };
 
+// Shortest time between two renders of a view, in ms
+static const qint64 minimumFrameInterval = 16;
+
 medVtkView::medVtkView(QObject* parent): medAbstractImageView(parent),
     d(new medVtkViewPrivate)
 {
@@ -145,6 +160,15 @@ medVtkView::medVtkView(QObject* parent): medAbstractImageView(parent),
 
     d->backend.reset(new medVtkViewBackend(d->view2d, d->view3d, d->renWin));
 
+    d->renderTimer = new QTimer(this);
+    d->renderTimer->setSingleShot(true);
+    connect(d->renderTimer, SIGNAL(timeout()), this, SLOT(renderNow()));
+    d->frameClock.start();
+    d->lastFrameTime = -minimumFrameInterval;
+    d->framesWindowStart = 0;
+    d->framesInWindow = 0;
+    d->framesPerSecond = 0.0;
+
     d->observer = medVtkViewObserver::New();
     d->observer->setView(this);
 
@@ -187,6 +211,8 @@ medVtkView::~medVtkView()
     for(int i=c; i>=0; i--)
         removeLayer(i);
 
+    d->renderTimer->stop();
+
     d->view2d->Delete();
     d->view3d->Delete();
     d->observer->Delete();
@@ -242,6 +268,19 @@ void medVtkView::reset()
 
 void medVtkView::render()
 {
+    if (d->renderTimer->isActive())
+    {
+        return;
+    }
+
+    const qint64 sinceLastFrame = d->frameClock.elapsed() - d->lastFrameTime;
+    d->renderTimer->start(static_cast<int>(qMax<qint64>(0, minimumFrameInterval - sinceLastFrame)));
+}
+
+void medVtkView::renderNow()
+{
+    d->renderTimer->stop();
+
     if(this->is2D())
     {
         d->view2d->Render();
@@ -250,6 +289,36 @@ void medVtkView::render()
     {
         d->view3d->Render();
     }
+
+    const qint64 now = d->frameClock.elapsed();
+    if (now - d->lastFrameTime > 1000)
+    {
+        // The view was idle, start measuring again
+        d->framesWindowStart = now;
+        d->framesInWindow = 0;
+    }
+    d->lastFrameTime = now;
+    ++d->framesInWindow;
+    const qint64 windowLength = d->lastFrameTime - d->framesWindowStart;
+    if (windowLength >= 1000)
+    {
+        d->framesPerSecond = 1000.0 * d->framesInWindow / windowLength;
+        d->framesInWindow = 0;
+        d->framesWindowStart = d->lastFrameTime;
+
+        dtkDebug() << this->description() << "renders" << d->framesPerSecond << "frames per second";
+        emit framesPerSecondChanged(d->framesPerSecond);
+    }
+}
+
+double medVtkView::framesPerSecond() const
+{
+    // No frame for more than a second means the view is idle
+    if (d->frameClock.elapsed() - d->lastFrameTime > 1000)
+    {
+        return 0.0;
+    }
+    return d->framesPerSecond;
 }
 
 QPointF medVtkView::mapWorldToDisplayCoordinates(const QVector3D & worldVec)
@@ -465,7 +534,7 @@ QImage medVtkView::buildThumbnail(const QSize &size)
     d->mainWindow->resize(w,h);
     d->mainWindow->show();
     d->renWin->SetSize(w,h);
-    render();
+    renderNow();
 
 #ifdef Q_OS_LINUX
     // X11 likes to animate window creation, which means by the time we grab the
@@ -60,11 +60,30 @@ public:
      */
     virtual void resetCameraOnLayer(int layer);
 
+    /**
+     * @brief framesPerSecond is the number of frames rendered by the view
+     * per second, measured over the last second of rendering.
+     */
+    double framesPerSecond() const;
+
 public slots:
     virtual void reset();
+
+    /**
+     * @brief render schedules a render of the view on the next event loop turn.
+     * Requests made before then are coalesced into that render, which shows
+     * the latest state, and the view is not rendered more than once per frame.
+     */
     virtual void render();
+
+    //! Renders the view right away, e.g. before grabbing its frame buffer
+    void renderNow();
     virtual void showHistogram(bool checked);
 
+signals:
+    //! Emitted with each new measure of framesPerSecond()
+    void framesPerSecondChanged(double framesPerSecond);
+
 private slots:
     void displayDataInfo(uint layer);
     void changeCurrentLayer();
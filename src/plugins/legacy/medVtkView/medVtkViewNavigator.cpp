@@ -354,7 +354,7 @@ void medVtkViewNavigator::setPan(const QVector2D &pan)
 
     double stdpan[2] = {pan.x(), pan.y()};
     d->view2d->SetPan(stdpan);
-    d->view2d->Render();
+    d->parent->render();
 }
 
 void medVtkViewNavigator::moveToPosition(const QVector3D &position)
@@ -375,9 +375,7 @@ void medVtkViewNavigator::moveToPosition(const QVector3D &position)
 
     d->view3d->SetCurrentPoint(pos);
 
-    if(d->orientation == medImageView::VIEW_ORIENTATION_3D)
-        d->view3d->Render();
-    else d->view2d->Render();
+    d->parent->render();
 }
 
 /*=========================================================================
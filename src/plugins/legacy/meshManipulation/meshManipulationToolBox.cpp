@@ -269,11 +269,10 @@ void meshManipulationToolBox::computeData()
         else if (data->identifier() == "vtkDataMesh4D")
         {
             vtkMetaDataSetSequence *seq = vtkMetaDataSetSequence::SafeDownCast(dataset);
-            const std::vector<vtkMetaDataSet*>& datasetList = seq->GetMetaDataSetList();
-
             vtkMetaDataSetSequence *newSeq = vtkMetaDataSetSequence::New();
-            for(vtkMetaDataSet *metaDataset : datasetList)
+            for (int i = 0; i < seq->GetNumberOfMetaDataSets(); ++i)
             {
+                vtkMetaDataSet *metaDataset = seq->GetMetaDataSet(i);
                 vtkPointSet *newPointSet = transformDataSet(metaDataset, transformFilter, t);
                 vtkMetaDataSet *newDataset = metaDataset->NewInstance();
                 newDataset->SetDataSet(newPointSet);
@@ -18,6 +18,8 @@
 #include <itkImageRegionIterator.h>
 #include <itkImageToImageFilter.h>
 
+#include <vector>
+
 namespace itk
 {
 
@@ -47,6 +49,7 @@ public:
     typedef typename ImageType::RegionType         OutputImageRegionType;
     typedef typename ImageType::PointType          PointType;
     typedef Vector<PixelType, ImageDimension>      VectorType;
+    typedef typename PointType::VectorType         StepType;
 
     typedef std::pair<PointType, ScalarType>       ConstraintType;
     typedef std::vector<ConstraintType>            ConstraintListType;
@@ -56,14 +59,28 @@ public:
 
     void SetConstraints (ConstraintListType constraints)
     {
+        if (constraints == m_Constraints)
+        {
+            return;
+        }
         m_Constraints = constraints;
         this->Modified();
     }
-    ConstraintType GetConstraints (void)
+    ConstraintListType GetConstraints (void)
     {
         return m_Constraints;
     }
 
+    /** Evaluate the function exactly only near its zero level set. It is first evaluated
+     *  on a grid subsampled by CoarseGridFactor, then the cells of this grid whose corners
+     *  are far from zero compared to their variation are interpolated trilinearly. */
+    itkSetMacro(FastEvaluation, bool)
+    itkGetConstMacro(FastEvaluation, bool)
+    itkBooleanMacro(FastEvaluation)
+
+    itkSetClampMacro(CoarseGridFactor, unsigned int, 1, 64)
+    itkGetConstMacro(CoarseGridFactor, unsigned int)
+
 protected:
     VariationalFunctionImageToImageFilter();
     ~VariationalFunctionImageToImageFilter();
@@ -74,6 +91,12 @@ protected:
 
     InternalMatrixType EstimateConstraintMatrix(ConstraintListType constraints);
     ScalarType EstimatePhi(VectorType r);
+
+    /** Evaluates the function at n points start + i*step into values */
+    void EvaluateScanline(const PointType &start, const StepType &step, unsigned int n, ScalarType *values) const;
+
+    void ComputeCoarseGrid();
+    unsigned int CoarseNode(unsigned int axis, unsigned int node) const;
     
 private:
     VariationalFunctionImageToImageFilter(const Self&); //purposely not implemented
@@ -81,6 +104,27 @@ private:
 
     ConstraintListType m_Constraints;
     InternalVectorType m_LinearSolution;
+
+    bool         m_FastEvaluation;
+    unsigned int m_CoarseGridFactor;
+
+    // Constraint matrix of the last solve, to only update the entries of moved constraints
+    ConstraintListType m_MatrixConstraints;
+    InternalMatrixType m_ConstraintMatrix;
+
+    // Constraint positions and weights of the solution, one array per coordinate for the scanline kernel
+    std::vector<ScalarType> m_ConstraintX, m_ConstraintY, m_ConstraintZ, m_Weights;
+
+    // Geometry of the output: index origin, physical point of that index and step along each axis
+    OutputIndexType m_RegionIndex;
+    unsigned int    m_RegionSize[3];
+    PointType       m_RegionOrigin;
+    StepType        m_Steps[3];
+
+    // Function values at the nodes of the coarse grid, and whether each of its cells is evaluated exactly
+    unsigned int               m_CoarseNodes[3];
+    std::vector<ScalarType>    m_CoarseValues;
+    std::vector<unsigned char> m_RefineCell;
 };
 
 
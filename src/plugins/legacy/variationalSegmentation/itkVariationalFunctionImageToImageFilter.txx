@@ -28,6 +28,8 @@ VariationalFunctionImageToImageFilter<TInputImage>
 ::VariationalFunctionImageToImageFilter()
 {
     this->DynamicMultiThreadingOff();
+    m_FastEvaluation = false;
+    m_CoarseGridFactor = 4;
 }
 
 // ----------------------------------------------------------------------
@@ -45,6 +47,8 @@ void VariationalFunctionImageToImageFilter<TInputImage>
 ::PrintSelf(std::ostream &os, Indent indent) const
 {
     Superclass::PrintSelf(os, indent);
+    os << indent << "FastEvaluation: " << m_FastEvaluation << std::endl;
+    os << indent << "CoarseGridFactor: " << m_CoarseGridFactor << std::endl;
 }
 
 // ----------------------------------------------------------------------
@@ -83,8 +87,152 @@ void VariationalFunctionImageToImageFilter<TInputImage>
     
     SolverType solver (A);
     m_LinearSolution = solver.solve (b);
+
+    m_ConstraintX.resize(n_constraints);
+    m_ConstraintY.resize(n_constraints);
+    m_ConstraintZ.resize(n_constraints);
+    m_Weights.resize(n_constraints);
+    for (unsigned int i = 0; i < n_constraints; i++)
+    {
+        m_ConstraintX[i] = m_Constraints[i].first[0];
+        m_ConstraintY[i] = m_Constraints[i].first[1];
+        m_ConstraintZ[i] = m_Constraints[i].first[2];
+        m_Weights[i] = m_LinearSolution[i];
+    }
+
+    // Physical position of the first voxel and of the steps along each axis
+    const OutputImageRegionType region = output->GetLargestPossibleRegion();
+    m_RegionIndex = region.GetIndex();
+    output->TransformIndexToPhysicalPoint (m_RegionIndex, m_RegionOrigin);
+    for (unsigned int axis = 0; axis < 3; axis++)
+    {
+        m_RegionSize[axis] = region.GetSize()[axis];
+
+        OutputIndexType next = m_RegionIndex;
+        next[axis]++;
+        PointType point;
+        output->TransformIndexToPhysicalPoint (next, point);
+        m_Steps[axis] = point - m_RegionOrigin;
+    }
+
+    if (m_FastEvaluation && m_CoarseGridFactor > 1)
+    {
+        this->ComputeCoarseGrid();
+    }
+    else
+    {
+        m_CoarseValues.clear();
+        m_RefineCell.clear();
+    }
 }
 
+// ----------------------------------------------------------------------
+// EvaluateScanline
+template <class TInputImage>
+void VariationalFunctionImageToImageFilter<TInputImage>
+::EvaluateScanline(const PointType &start, const StepType &step, unsigned int n, ScalarType *values) const
+{
+    const unsigned int n_constraints = m_Weights.size();
+    const unsigned int system_size = n_constraints + 4;
+
+    // Affine part, then one pass over the scanline per constraint, which the compiler vectorizes
+    for (unsigned int t = 0; t < n; t++)
+    {
+        values[t] = m_LinearSolution[system_size-4]
+                + (start[0] + t * step[0]) * m_LinearSolution[system_size-3]
+                + (start[1] + t * step[1]) * m_LinearSolution[system_size-2]
+                + (start[2] + t * step[2]) * m_LinearSolution[system_size-1];
+    }
+
+    for (unsigned int i = 0; i < n_constraints; i++)
+    {
+        const ScalarType dx = start[0] - m_ConstraintX[i];
+        const ScalarType dy = start[1] - m_ConstraintY[i];
+        const ScalarType dz = start[2] - m_ConstraintZ[i];
+        const ScalarType w = m_Weights[i];
+        for (unsigned int t = 0; t < n; t++)
+        {
+            const ScalarType rx = dx + t * step[0];
+            const ScalarType ry = dy + t * step[1];
+            const ScalarType rz = dz + t * step[2];
+            const ScalarType a = rx*rx + ry*ry + rz*rz;
+            values[t] += w * a * std::sqrt(a);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------
+// CoarseNode
+template <class TInputImage>
+unsigned int VariationalFunctionImageToImageFilter<TInputImage>
+::CoarseNode(unsigned int axis, unsigned int node) const
+{
+    // Position along axis of a node of the coarse grid, the last node is on the last voxel
+    return std::min(node * m_CoarseGridFactor, m_RegionSize[axis] - 1);
+}
+
+// ----------------------------------------------------------------------
+// ComputeCoarseGrid
+template <class TInputImage>
+void VariationalFunctionImageToImageFilter<TInputImage>
+::ComputeCoarseGrid()
+{
+    for (unsigned int axis = 0; axis < 3; axis++)
+    {
+        m_CoarseNodes[axis] = (m_RegionSize[axis] + m_CoarseGridFactor - 2) / m_CoarseGridFactor + 1;
+    }
+
+    // Values at the nodes, row by row with the nodes of a row as a strided scanline
+    const unsigned int nx = m_CoarseNodes[0];
+    m_CoarseValues.resize(static_cast<size_t>(nx) * m_CoarseNodes[1] * m_CoarseNodes[2]);
+    const StepType coarseStep = m_Steps[0] * static_cast<double>(m_CoarseGridFactor);
+    for (unsigned int k = 0; k < m_CoarseNodes[2]; k++)
+    {
+        for (unsigned int j = 0; j < m_CoarseNodes[1]; j++)
+        {
+            const PointType start = m_RegionOrigin
+                    + m_Steps[1] * static_cast<double>(CoarseNode(1, j))
+                    + m_Steps[2] * static_cast<double>(CoarseNode(2, k));
+            ScalarType *row = &m_CoarseValues[(static_cast<size_t>(k) * m_CoarseNodes[1] + j) * nx];
+            this->EvaluateScanline(start, coarseStep, nx - 1, row);
+            this->EvaluateScanline(start + m_Steps[0] * static_cast<double>(CoarseNode(0, nx - 1)), coarseStep, 1, row + nx - 1);
+        }
+    }
+
+    // A cell is evaluated exactly if the function may cross zero in it: its corners change
+    // sign, or are closer to zero than their variation over the cell.
+    unsigned int cells[3];
+    for (unsigned int axis = 0; axis < 3; axis++)
+    {
+        cells[axis] = std::max(m_CoarseNodes[axis] - 1, 1u);
+    }
+    m_RefineCell.assign(static_cast<size_t>(cells[0]) * cells[1] * cells[2], 0);
+
+    for (unsigned int k = 0; k < cells[2]; k++)
+    {
+        for (unsigned int j = 0; j < cells[1]; j++)
+        {
+            for (unsigned int i = 0; i < cells[0]; i++)
+            {
+                ScalarType minimum = NumericTraits<ScalarType>::max();
+                ScalarType maximum = NumericTraits<ScalarType>::NonpositiveMin();
+                ScalarType minimumAbs = NumericTraits<ScalarType>::max();
+                for (unsigned int corner = 0; corner < 8; corner++)
+                {
+                    const unsigned int ci = std::min(i + (corner & 1), m_CoarseNodes[0] - 1);
+                    const unsigned int cj = std::min(j + ((corner >> 1) & 1), m_CoarseNodes[1] - 1);
+                    const unsigned int ck = std::min(k + ((corner >> 2) & 1), m_CoarseNodes[2] - 1);
+                    const ScalarType value = m_CoarseValues[(static_cast<size_t>(ck) * m_CoarseNodes[1] + cj) * nx + ci];
+                    minimum = std::min(minimum, value);
+                    maximum = std::max(maximum, value);
+                    minimumAbs = std::min(minimumAbs, std::abs(value));
+                }
+                const bool refine = (minimum <= 0 && maximum >= 0) || (minimumAbs <= maximum - minimum);
+                m_RefineCell[(static_cast<size_t>(k) * cells[1] + j) * cells[0] + i] = refine;
+            }
+        }
+    }
+}
 
 // ----------------------------------------------------------------------
 // ThreadedGenerateData
@@ -92,37 +240,108 @@ template <class TInputImage>
 void VariationalFunctionImageToImageFilter<TInputImage>
 ::ThreadedGenerateData(const OutputImageRegionType& outputRegionForThread, ThreadIdType threadId)
 {
-    typename ImageType::Pointer output = this->GetOutput();
+    ImageType *output = this->GetOutput();
 
-    OutputIteratorType itOut(const_cast<ImageType*>(this->GetOutput()), outputRegionForThread);
-    PointType point, constraint;
-    OutputIndexType index;
-    PixelType value;
+    const OutputIndexType regionIndex = outputRegionForThread.GetIndex();
+    const unsigned int length = outputRegionForThread.GetSize()[0];
+    std::vector<ScalarType> values(length);
 
-    unsigned int n_constraints = m_Constraints.size();
-    unsigned int system_size = n_constraints + 4;
-    
-    while(!itOut.IsAtEnd())
+    const bool coarse = !m_RefineCell.empty();
+    const unsigned int factor = m_CoarseGridFactor;
+    unsigned int cells[3];
+    for (unsigned int axis = 0; axis < 3; axis++)
     {
-        index = itOut.GetIndex();
-        output->TransformIndexToPhysicalPoint (index, point);
-        value = 0;
+        cells[axis] = coarse ? std::max(m_CoarseNodes[axis] - 1, 1u) : 1;
+    }
 
-        for (unsigned int i = 0; i < n_constraints; i++)
+    for (unsigned int z = 0; z < outputRegionForThread.GetSize()[2]; z++)
+    {
+        for (unsigned int y = 0; y < outputRegionForThread.GetSize()[1]; y++)
         {
-            constraint = m_Constraints[i].first;
-            value += m_LinearSolution[i] * this->EstimatePhi(point - constraint);
-        }
+            OutputIndexType index = regionIndex;
+            index[1] += y;
+            index[2] += z;
+
+            // Position in the full output region
+            const unsigned int position[3] = { static_cast<unsigned int>(index[0] - m_RegionIndex[0]),
+                                               static_cast<unsigned int>(index[1] - m_RegionIndex[1]),
+                                               static_cast<unsigned int>(index[2] - m_RegionIndex[2]) };
+            const PointType start = m_RegionOrigin
+                    + m_Steps[0] * static_cast<double>(position[0])
+                    + m_Steps[1] * static_cast<double>(position[1])
+                    + m_Steps[2] * static_cast<double>(position[2]);
+
+            if (!coarse)
+            {
+                this->EvaluateScanline(start, m_Steps[0], length, values.data());
+            }
+            else
+            {
+                // Cell of the coarse grid of the row, and interpolation weights along y and z
+                unsigned int cell[3];
+                ScalarType weight[3];
+                for (unsigned int axis = 1; axis < 3; axis++)
+                {
+                    cell[axis] = std::min(position[axis] / factor, cells[axis] - 1);
+                    const unsigned int first = CoarseNode(axis, cell[axis]);
+                    const unsigned int last = CoarseNode(axis, std::min(cell[axis] + 1, m_CoarseNodes[axis] - 1));
+                    weight[axis] = (last > first) ? static_cast<ScalarType>(position[axis] - first) / (last - first) : 0.0;
+                }
 
-        value += 1.0 * m_LinearSolution[system_size-4]
-                + point[0] * m_LinearSolution[system_size-3]
-                + point[1] * m_LinearSolution[system_size-2]
-                + point[2] * m_LinearSolution[system_size-1];
+                unsigned int x = 0;
+                while (x < length)
+                {
+                    // Run of voxels in cells with the same refinement
+                    cell[0] = std::min((position[0] + x) / factor, cells[0] - 1);
+                    const size_t cellRow = (static_cast<size_t>(cell[2]) * cells[1] + cell[1]) * cells[0];
+                    const bool refine = m_RefineCell[cellRow + cell[0]];
+                    unsigned int end = x + 1;
+                    while (end < length
+                           && m_RefineCell[cellRow + std::min((position[0] + end) / factor, cells[0] - 1)] == refine)
+                    {
+                        end++;
+                    }
 
-        itOut.Set (value);
-        ++itOut;
+                    if (refine)
+                    {
+                        this->EvaluateScanline(start + m_Steps[0] * static_cast<double>(x), m_Steps[0], end - x, &values[x]);
+                    }
+                    else
+                    {
+                        for (; x < end; x++)
+                        {
+                            cell[0] = std::min((position[0] + x) / factor, cells[0] - 1);
+                            const unsigned int first = CoarseNode(0, cell[0]);
+                            const unsigned int last = CoarseNode(0, std::min(cell[0] + 1, m_CoarseNodes[0] - 1));
+                            weight[0] = (last > first) ? static_cast<ScalarType>(position[0] + x - first) / (last - first) : 0.0;
+
+                            ScalarType value = 0.0;
+                            for (unsigned int corner = 0; corner < 8; corner++)
+                            {
+                                ScalarType w = 1.0;
+                                unsigned int node[3];
+                                for (unsigned int axis = 0; axis < 3; axis++)
+                                {
+                                    const unsigned int side = (corner >> axis) & 1;
+                                    node[axis] = std::min(cell[axis] + side, m_CoarseNodes[axis] - 1);
+                                    w *= side ? weight[axis] : 1.0 - weight[axis];
+                                }
+                                value += w * m_CoarseValues[(static_cast<size_t>(node[2]) * m_CoarseNodes[1] + node[1]) * m_CoarseNodes[0] + node[0]];
+                            }
+                            values[x] = value;
+                        }
+                    }
+                    x = end;
+                }
+            }
+
+            PixelType *out = output->GetBufferPointer() + output->ComputeOffset(index);
+            for (unsigned int x = 0; x < length; x++)
+            {
+                out[x] = static_cast<PixelType>(values[x]);
+            }
+        }
     }
-    
 }
 
 // ----------------------------------------------------------------------
@@ -136,12 +355,25 @@ VariationalFunctionImageToImageFilter<TInputImage>
     unsigned int system_size = n_constraints + 4;
     
     InternalMatrixType ret (system_size, system_size);
+
+    // Entries between constraints that did not move since the previous matrix are kept,
+    // so that adding or dragging a constraint only recomputes its row and column
+    std::vector<bool> unchanged(n_constraints, false);
+    for (unsigned int i = 0; i < n_constraints && i < m_MatrixConstraints.size(); i++)
+    {
+        unchanged[i] = (constraints[i].first == m_MatrixConstraints[i].first);
+    }
     
     for (unsigned int i = 0; i < n_constraints; i++)
     {
         PointType pi = constraints[i].first;
         for (unsigned int j = 0; j < n_constraints; j++)
         {
+            if (unchanged[i] && unchanged[j])
+            {
+                ret[i][j] = m_ConstraintMatrix[i][j];
+                continue;
+            }
             PointType pj = constraints[j].first;
             ret[i][j] = this->EstimatePhi(pi - pj);
         }
@@ -174,6 +406,9 @@ VariationalFunctionImageToImageFilter<TInputImage>
         ret[system_size-i][system_size-1] = 0.0;
     }
 
+    m_MatrixConstraints = constraints;
+    m_ConstraintMatrix = ret;
+
     return ret;
 }
 
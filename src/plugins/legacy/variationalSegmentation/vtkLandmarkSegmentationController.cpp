@@ -200,6 +200,7 @@ vtkLandmarkSegmentationController::vtkLandmarkSegmentationController()
     this->Actor              = vtkActor::New();
     this->TotalLandmarkCollection = vtkCollection::New();
     this->Command->SetController (this);
+    m_Filter->FastEvaluationOn();
     m_Converter->SetInput (m_Filter->GetOutput());
 
     vtkImageData *tmp = vtkImageData::New();
@@ -0,0 +1,106 @@
+/*=========================================================================
+
+medInria
+
+Copyright (c) INRIA 2013 - 2020. All rights reserved.
+See LICENSE.txt for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.
+
+=========================================================================*/
+
+#include <voiCutterSpanMask.h>
+
+#include <algorithm>
+#include <cmath>
+
+voiCutterSpanMask::voiCutterSpanMask()
+    : m_height(0)
+{
+}
+
+void voiCutterSpanMask::rasterize(const std::vector<double> &xs, const std::vector<double> &ys, int width, int height)
+{
+    m_height = std::max(height, 0);
+    m_rowStart.assign(m_height + 1, 0);
+    m_spans.clear();
+
+    const size_t count = std::min(xs.size(), ys.size());
+    if (count < 3 || width <= 0 || m_height == 0)
+    {
+        return;
+    }
+
+    // Rows whose center y+0.5 is in [min(y0,y1), max(y0,y1)) of an edge
+    auto rowRange = [&](size_t k, int &first, int &last)
+    {
+        const size_t next = (k + 1) % count;
+        const double low  = std::min(ys[k], ys[next]);
+        const double high = std::max(ys[k], ys[next]);
+        first = std::max(0, static_cast<int>(std::ceil(low - 0.5)));
+        last  = std::min(m_height, static_cast<int>(std::ceil(high - 0.5)));
+    };
+
+    // Crossings of the edges with the row centers, bucketed by row
+    std::vector<unsigned int> crossingStart(m_height + 1, 0);
+    for (size_t k = 0; k < count; ++k)
+    {
+        int first, last;
+        rowRange(k, first, last);
+        for (int y = first; y < last; ++y)
+        {
+            ++crossingStart[y + 1];
+        }
+    }
+    for (int y = 0; y < m_height; ++y)
+    {
+        crossingStart[y + 1] += crossingStart[y];
+    }
+
+    std::vector<double> crossings(crossingStart[m_height]);
+    std::vector<unsigned int> filled(crossingStart.begin(), crossingStart.end() - 1);
+    for (size_t k = 0; k < count; ++k)
+    {
+        int first, last;
+        rowRange(k, first, last);
+        const size_t next = (k + 1) % count;
+        const double slope = (xs[next] - xs[k]) / (ys[next] - ys[k]);
+        for (int y = first; y < last; ++y)
+        {
+            crossings[filled[y]++] = xs[k] + (y + 0.5 - ys[k]) * slope;
+        }
+    }
+
+    // Pairs of sorted crossings enclose the pixels whose center lies in [x0, x1)
+    for (int y = 0; y < m_height; ++y)
+    {
+        std::sort(crossings.begin() + crossingStart[y], crossings.begin() + crossingStart[y + 1]);
+        for (unsigned int c = crossingStart[y]; c + 1 < crossingStart[y + 1]; c += 2)
+        {
+            const int begin = std::max(0, static_cast<int>(std::ceil(crossings[c] - 0.5)));
+            const int end   = std::min(width, static_cast<int>(std::ceil(crossings[c + 1] - 0.5)));
+            if (begin < end)
+            {
+                m_spans.push_back({ begin, end });
+            }
+        }
+        m_rowStart[y + 1] = m_spans.size();
+    }
+}
+
+bool voiCutterSpanMask::isEmpty() const
+{
+    return m_spans.empty();
+}
+
+const voiCutterSpanMask::Span *voiCutterSpanMask::rowBegin(int y) const
+{
+    return m_spans.data() + m_rowStart[y];
+}
+
+const voiCutterSpanMask::Span *voiCutterSpanMask::rowEnd(int y) const
+{
+    return m_spans.data() + m_rowStart[y + 1];
+}
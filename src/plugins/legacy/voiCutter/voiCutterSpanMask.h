@@ -0,0 +1,49 @@
+#pragma once
+/*=========================================================================
+
+medInria
+
+Copyright (c) INRIA 2013 - 2020. All rights reserved.
+See LICENSE.txt for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.
+
+=========================================================================*/
+
+#include <vector>
+
+/*! \brief Inside of a 2D polygon on a pixel grid, as runs of pixels per row.
+ *
+ * The polygon is filled with the even-odd rule: a pixel is inside when its center
+ * (i+0.5, j+0.5) is, which is what QPainter fills without antialiasing. Rows are
+ * rasterized with a scanline over the crossings of the polygon edges, so the cost
+ * depends on the number of edges and rows, not on the number of pixels.
+ */
+class voiCutterSpanMask
+{
+public:
+    //! Pixels [begin, end) of a row
+    struct Span
+    {
+        int begin;
+        int end;
+    };
+
+    voiCutterSpanMask();
+
+    //! Rasterizes the closed polygon (xs[k], ys[k]) in a width x height grid, clipped to it
+    void rasterize(const std::vector<double> &xs, const std::vector<double> &ys, int width, int height);
+
+    bool isEmpty() const;
+
+    //! Spans of row y, sorted and disjoint
+    const Span *rowBegin(int y) const;
+    const Span *rowEnd(int y) const;
+
+private:
+    int m_height;
+    std::vector<unsigned int> m_rowStart;
+    std::vector<Span> m_spans;
+};
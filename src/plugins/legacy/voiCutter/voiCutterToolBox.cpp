@@ -33,7 +33,11 @@
 #include <vtkRenderWindowInteractor.h>
 #include <vtkTransform.h>
 
-#include <itkImageDuplicator.h>
+#include <itkMultiThreaderBase.h>
+
+#include <voiCutterSpanMask.h>
+
+#include <algorithm>
 
 class voiCutterToolBoxPrivate
 {
@@ -46,6 +50,7 @@ public:
     bool scissorOn;
     vtkCutterObserver *observer;
     dtkSmartPointer<medAbstractData> resultData;
+    bool resultShared; // resultData was saved or given as output, it must not be cut in place
     medAbstractData *input;
     unsigned int layerInput;
     medStringListParameterL *mode3DParam;
@@ -141,6 +146,7 @@ voiCutterToolBox::voiCutterToolBox(QWidget *parent) :
     d->scissorOn = false;
     d->currentView = nullptr;
     d->resultData = nullptr;
+    d->resultShared = false;
     d->input = nullptr;
     d->layerInput = 0;
 
@@ -281,6 +287,7 @@ medAbstractData *voiCutterToolBox::processOutput()
     }
 
     fillOutputMetaData();
+    d->resultShared = true;
     return d->resultData;
 }
 
@@ -395,6 +402,7 @@ void voiCutterToolBox::saveImage()
     if (d->resultData)
     {
         fillOutputMetaData();
+        d->resultShared = true;
         medDataManager::instance()->importData(d->resultData, false);
     }
 }
@@ -523,8 +531,6 @@ void voiCutterToolBox::definePolygonsImage(std::vector<vtkVector2i> polygonPoint
     }
     vtkImageView3D *view3D =  static_cast<medVtkViewBackend*>(d->currentView->backend())->view3D;
     vtkSmartPointer<vtkPoints> points = vtkPoints::New();
-    vtkIdType ids[100];
-    QList<vtkPolygon*> *RoiList = new QList<vtkPolygon*>();
     QList<vtkPoints*> *RoiPointList = new QList<vtkPoints*>();
 
     vtkMatrix4x4 *ActorMatrix;
@@ -549,7 +555,6 @@ void voiCutterToolBox::definePolygonsImage(std::vector<vtkVector2i> polygonPoint
         points->InsertNextPoint(polygonPoints[i].GetX(),
                                 polygonPoints[i].GetY(),
                                 0);
-        ids[i] = i;
     }
 
     double vector[9];
@@ -591,7 +596,6 @@ void voiCutterToolBox::definePolygonsImage(std::vector<vtkVector2i> polygonPoint
 
     for( int i = 0 ; i < stackMax ; i++)
     {
-        RoiList->append(vtkPolygon::New());
         RoiPointList->append(vtkPoints::New());
     }
     double *ImageSpacing  = view3D->GetMedVtkImageInfo()->spacing;
@@ -712,75 +716,79 @@ void voiCutterToolBox::definePolygonsImage(std::vector<vtkVector2i> polygonPoint
     }
     Transform->Delete();
 
-    for(int i= 0; i<RoiList->size(); i++)
-    {
-        RoiList->at(i)->Initialize(RoiPointList->at(i)->GetNumberOfPoints(),
-                                   ids,
-                                   RoiPointList->at(i));
-    }
-
     if (d->input->identifier() == "itkDataImageChar3")
     {
-        cutThroughImage<itk::Image<char,3> >(RoiList,RoiPointList,stackMax,stackOrientation,m);
+        cutThroughImage<itk::Image<char,3> >(RoiPointList,stackMax,stackOrientation,m);
     }
     else if (d->input->identifier() == "itkDataImageUChar3")
     {
-        cutThroughImage<itk::Image<unsigned char,3> >(RoiList,RoiPointList,stackMax,stackOrientation,m);
+        cutThroughImage<itk::Image<unsigned char,3> >(RoiPointList,stackMax,stackOrientation,m);
     }
     else if (d->input->identifier() == "itkDataImageShort3")
     {
-        cutThroughImage<itk::Image<short,3> >(RoiList,RoiPointList,stackMax,stackOrientation,m);
+        cutThroughImage<itk::Image<short,3> >(RoiPointList,stackMax,stackOrientation,m);
     }
     else if (d->input->identifier() == "itkDataImageUShort3")
     {
-        cutThroughImage<itk::Image<unsigned short,3> >(RoiList,RoiPointList,stackMax,stackOrientation,m);
+        cutThroughImage<itk::Image<unsigned short,3> >(RoiPointList,stackMax,stackOrientation,m);
     }
     else if (d->input->identifier() == "itkDataImageInt3")
     {
-        cutThroughImage<itk::Image<int,3> >(RoiList,RoiPointList,stackMax,stackOrientation,m);
+        cutThroughImage<itk::Image<int,3> >(RoiPointList,stackMax,stackOrientation,m);
     }
     else if (d->input->identifier() == "itkDataImageUInt3")
     {
-        cutThroughImage<itk::Image<unsigned int,3> >(RoiList,RoiPointList,stackMax,stackOrientation,m);
+        cutThroughImage<itk::Image<unsigned int,3> >(RoiPointList,stackMax,stackOrientation,m);
     }
     else if (d->input->identifier() == "itkDataImageLong3")
     {
-        cutThroughImage<itk::Image<long,3> >(RoiList,RoiPointList,stackMax,stackOrientation,m);
+        cutThroughImage<itk::Image<long,3> >(RoiPointList,stackMax,stackOrientation,m);
     }
     else if (d->input->identifier() == "itkDataImageULong3")
     {
-        cutThroughImage<itk::Image<unsigned long,3> >(RoiList,RoiPointList,stackMax,stackOrientation,m);
+        cutThroughImage<itk::Image<unsigned long,3> >(RoiPointList,stackMax,stackOrientation,m);
     }
     else if (d->input->identifier() == "itkDataImageFloat3")
     {
-        cutThroughImage<itk::Image<float,3> >(RoiList,RoiPointList,stackMax,stackOrientation,m);
+        cutThroughImage<itk::Image<float,3> >(RoiPointList,stackMax,stackOrientation,m);
     }
     else if (d->input->identifier() == "itkDataImageDouble3")
     {
-        cutThroughImage<itk::Image<double,3> >(RoiList,RoiPointList,stackMax,stackOrientation,m);
+        cutThroughImage<itk::Image<double,3> >(RoiPointList,stackMax,stackOrientation,m);
+    }
+
+    for(int i= 0; i<RoiPointList->size(); i++)
+    {
+        RoiPointList->at(i)->Delete();
     }
+    delete RoiPointList;
 }
 
 template <typename IMAGE>
-void voiCutterToolBox::cutThroughImage(QList<vtkPolygon*>*RoiList, QList<vtkPoints*>*RoiPointList,
+void voiCutterToolBox::cutThroughImage(QList<vtkPoints*>*RoiPointList,
                                        long stackMax, unsigned int stackOrientation, MODE m)
 {
-    int valOfOutside = medUtilitiesITK::minimumValue(d->input);
+    typedef typename IMAGE::PixelType PixelType;
+    const PixelType valOfOutside = static_cast<PixelType>(medUtilitiesITK::minimumValue(d->input));
 
     vtkImageView3D *view3D =  static_cast<medVtkViewBackend*>(d->currentView->backend())->view3D;
-    int *dim = view3D->GetMedVtkImageInfo()->dimensions;
 
     IMAGE *inputImage = dynamic_cast<IMAGE*>((itk::Object*)(d->input->data()));
 
-    typedef itk::ImageDuplicator< IMAGE > DuplicatorType;
-    typename DuplicatorType::Pointer duplicator = DuplicatorType::New();
-    duplicator->SetInputImage(inputImage);
-    duplicator->Update();
-    typename IMAGE::Pointer clonedImage = duplicator->GetOutput();
+    // A result of this toolbox that was not handed out yet is cut in place, otherwise
+    // the cut is written in a new image while copying the input, one pass per voxel
+    const bool inPlace = (d->input == d->resultData.data()) && !d->resultShared;
+
+    typename IMAGE::Pointer outputImage = inputImage;
+    if (!inPlace)
+    {
+        outputImage = IMAGE::New();
+        outputImage->CopyInformation(inputImage);
+        outputImage->SetRegions(inputImage->GetBufferedRegion());
+        outputImage->Allocate();
+    }
 
-    typename IMAGE::IndexType index;
     unsigned int x=0, y=0, z=0;
-    unsigned int bx=0, by=0;
 
     switch (stackOrientation)
     {
@@ -789,8 +797,6 @@ void voiCutterToolBox::cutThroughImage(QList<vtkPolygon*>*RoiList, QList<vtkPoin
             x = 1;
             y = 2;
             z = 0;
-            bx = 2;
-            by = 4;
             break;
         }
         case 1 :
@@ -798,8 +804,6 @@ void voiCutterToolBox::cutThroughImage(QList<vtkPolygon*>*RoiList, QList<vtkPoin
             x = 0;
             y = 2;
             z = 1;
-            bx = 0;
-            by = 4;
             break;
         }
         case 2 :
@@ -807,131 +811,83 @@ void voiCutterToolBox::cutThroughImage(QList<vtkPolygon*>*RoiList, QList<vtkPoin
             x = 0;
             y = 1;
             z = 2;
-            bx = 0;
-            by = 2;
             break;
         }
     }
 
-    for(int stack = 0; stack<stackMax; stack++)
-    {
-        double *boundsPoints;
-        int nbPoints = RoiList->at(stack)->GetNumberOfPoints();
-        boundsPoints = RoiPointList->at(stack)->GetBounds(); //(xmin,xmax, ymin,ymax, zmin,zmax)
-
-        int i, end_i, j, end_j, start_i, start_j;
+    const typename IMAGE::SizeType size = inputImage->GetBufferedRegion().GetSize();
+    const size_t strides[3] = { 1, size[0], size[0] * size[1] };
+    const int width  = static_cast<int>(size[x]);
+    const int height = static_cast<int>(size[y]);
+    const size_t strideX = strides[x];
+    const long stackCount = std::min<long>(stackMax, static_cast<long>(size[z]));
 
-        if (dim[x]<=boundsPoints[bx+1])
-        {
-            end_i = dim[x]-1;
-        }
-        else
-        {
-            end_i = boundsPoints[bx+1];
-        }
-
-        if (dim[y]<=boundsPoints[by+1])
-        {
-            end_j = dim[y]-1;
-        }
-        else
-        {
-            end_j = boundsPoints[by+1];
-        }
-
-        if (boundsPoints[bx]>=0)
-        {
-            start_i = boundsPoints[bx];
-        }
-        else
-        {
-            start_i = 0;
-        }
+    const PixelType *input = inputImage->GetBufferPointer();
+    PixelType *output = outputImage->GetBufferPointer();
 
-        if (boundsPoints[by]>=0)
+    // Writes voxels [begin, end) of a row, either cut or from the input
+    auto writeRun = [&](size_t rowOffset, int begin, int end, bool cut)
+    {
+        size_t offset = rowOffset + begin * strideX;
+        if (cut)
         {
-            start_j = boundsPoints[by];
+            for (int i = begin; i < end; ++i, offset += strideX)
+            {
+                output[offset] = valOfOutside;
+            }
         }
-        else
+        else if (!inPlace)
         {
-            start_j = 0;
+            for (int i = begin; i < end; ++i, offset += strideX)
+            {
+                output[offset] = input[offset];
+            }
         }
+    };
 
-        // Qt rasterization
-        vtkPoints *pointsArray = RoiList->at(stack)->GetPoints();
-        
-        QPolygonF polygon;
-        for(int i=0; i<nbPoints; i++)
+    // Each stack has its own projection of the polygon, rasterized once into spans
+    // then applied row by row. Stacks are independent and processed in parallel.
+    itk::MultiThreaderBase::Pointer threader = itk::MultiThreaderBase::New();
+    threader->ParallelizeArray(0, stackCount, [&](itk::SizeValueType stack)
+    {
+        vtkPoints *stackPoints = RoiPointList->at(stack);
+        std::vector<double> xs(stackPoints->GetNumberOfPoints()), ys(stackPoints->GetNumberOfPoints());
+        for (vtkIdType k = 0; k < stackPoints->GetNumberOfPoints(); ++k)
         {
-            polygon << QPointF(pointsArray->GetPoint(i)[x],
-                               pointsArray->GetPoint(i)[y]);
+            double point[3];
+            stackPoints->GetPoint(k, point);
+            xs[k] = point[x];
+            ys[k] = point[y];
         }
 
-        QPainterPath path;
-        path.addPolygon(polygon);
-
-        QBrush brush;
-        brush.setColor(Qt::white);
-        brush.setStyle(Qt::SolidPattern);
+        voiCutterSpanMask mask;
+        mask.rasterize(xs, ys, width, height);
 
-        QImage imagePolygon(dim[x], dim[y], QImage::Format_RGB16);
-        imagePolygon.fill(Qt::black);
-        QPainter painter;
-        painter.begin(&imagePolygon);
-        painter.fillPath(path, brush);
-        
-        if (m == Keep)
-        {
-            for(i = 0; i<dim[x]; i++)
-            {
-                for(j = 0; j<dim[y]; j++)
-                {
-                    index[x] = i;
-                    index[y] = j;
-                    index[z] = stack;
-                    if (i >= start_i && i <= end_i)
-                    {
-                        if (j >= start_j && j <= end_j)
-                        {
-                            QRgb val = imagePolygon.pixel(i, j);
-                            if (val != qRgb(255, 255, 255))
-                            {
-                                clonedImage->SetPixel(index, valOfOutside);
-                            }
-                        }
-                        else
-                        {
-                            clonedImage->SetPixel(index, valOfOutside);
-                        }
-                    }
-                    else
-                    {
-                        clonedImage->SetPixel(index, valOfOutside);
-                    }
-                }
-            }
-        }
-        if (m == Remove)
+        for (int j = 0; j < height; ++j)
         {
-            for(i = start_i; i<=end_i; i++)
+            const size_t rowOffset = stack * strides[z] + j * strides[y];
+            int i = 0;
+            for (const voiCutterSpanMask::Span *span = mask.rowBegin(j); span != mask.rowEnd(j); ++span)
             {
-                for(j = start_j; j<=end_j; j++)
-                {
-                    index[x] = i;
-                    index[y] = j;
-                    index[z] = stack;
-                    QRgb val = imagePolygon.pixel(i, j);
-                    if (val == qRgb(255, 255, 255))
-                    {
-                        clonedImage->SetPixel(index, valOfOutside);
-                    }
-                }
+                writeRun(rowOffset, i, span->begin, m == Keep);
+                writeRun(rowOffset, span->begin, span->end, m == Remove);
+                i = span->end;
             }
+            writeRun(rowOffset, i, width, m == Keep);
         }
+    }, nullptr);
+
+    // Stacks the polygon does not reach are copied as they are
+    for (long stack = stackCount; stack < static_cast<long>(size[z]) && !inPlace; ++stack)
+    {
+        std::copy(input + stack * strides[z], input + (stack + 1) * strides[z], output + stack * strides[z]);
     }
 
+    outputImage->Modified();
+
     d->resultData = medAbstractDataFactory::instance()->createSmartPointer(d->input->identifier());
-    d->resultData->setData(clonedImage);
+    d->resultData->setData(outputImage);
+    d->resultShared = false;
 
     medUtilities::setDerivedMetaData(d->resultData, d->input, "");
 
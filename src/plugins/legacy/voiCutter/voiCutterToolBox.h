@@ -16,9 +16,9 @@ PURPOSE.
 
 #include <voiCutterPluginExport.h>
 #include <vtkVector.h>
-#include <vtkPolygon.h>
 
 class vtkCutterObserver;
+class vtkPoints;
 class voiCutterToolBoxPrivate;
 
 enum MODE{Keep, Remove, Restore};
@@ -63,7 +63,7 @@ protected:
                                  double* resultPt);
 
     template <typename IMAGE>
-    void cutThroughImage(QList<vtkPolygon*>*RoiList, QList<vtkPoints*>*RoiPointList,
+    void cutThroughImage(QList<vtkPoints*>*RoiPointList,
                          long stackMax, unsigned int stackOrientation, MODE m);
 
     template <typename IMAGE>
@@ -12,6 +12,7 @@
 =========================================================================*/
 
 #include "vtkDataMesh.h"
+#include "vtkDataMeshThumbnail.h"
 
 #include <medAbstractDataFactory.h>
 
@@ -60,6 +61,16 @@ bool vtkDataMesh::registered()
   return medAbstractDataFactory::instance()->registerDataType<vtkDataMesh>();
 }
 
+QImage vtkDataMesh::generateThumbnail(QSize size)
+{
+  if (!d->mesh)
+  {
+    return medAbstractMeshData::generateThumbnail(size);
+  }
+  // Rasterized on the CPU, so that importers do not wait for the GUI thread
+  return vtkDataMeshThumbnail(d->mesh->GetDataSet(), size);
+}
+
 void vtkDataMesh::setData(void *data)
 {
   vtkMetaDataSet * mesh = vtkMetaDataSet::SafeDownCast( (vtkObject*) data );
@@ -32,6 +32,8 @@ class VTKDATAMESHPLUGIN_EXPORT vtkDataMesh : public medAbstractMeshData
 
     static bool registered();
 
+    QImage generateThumbnail(QSize size) override;
+
  public slots:
     // derived from dtkAbstractData
 
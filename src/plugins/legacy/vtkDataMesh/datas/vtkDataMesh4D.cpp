@@ -12,6 +12,7 @@
 =========================================================================*/
 
 #include <vtkDataMesh4D.h>
+#include <vtkDataMeshThumbnail.h>
 
 #include <medAbstractDataFactory.h>
 
@@ -66,6 +67,16 @@ vtkDataMesh4D* vtkDataMesh4D::clone()
   return new vtkDataMesh4D(*this);
 }
 
+QImage vtkDataMesh4D::generateThumbnail(QSize size)
+{
+  if (!d->meshsequence)
+  {
+    return medAbstractMeshData::generateThumbnail(size);
+  }
+  // Rasterized on the CPU from the current mesh of the sequence
+  return vtkDataMeshThumbnail(d->meshsequence->GetDataSet(), size);
+}
+
 void vtkDataMesh4D::setData(void *data)
 {
   vtkMetaDataSetSequence* sequence = vtkMetaDataSetSequence::SafeDownCast( (vtkObject*) data );
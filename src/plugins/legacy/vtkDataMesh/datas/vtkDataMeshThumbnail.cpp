@@ -0,0 +1,182 @@
+/*=========================================================================
+
+medInria
+
+Copyright (c) INRIA 2013 - 2020. All rights reserved.
+See LICENSE.txt for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.
+
+=========================================================================*/
+
+#include "vtkDataMeshThumbnail.h"
+
+#include <vtkCellArray.h>
+#include <vtkDataSetSurfaceFilter.h>
+#include <vtkMath.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace
+{
+
+// Screen space vertex: pixel coordinates and depth, larger depth is closer
+struct ProjectedPoint
+{
+    double x, y, z;
+};
+
+void rasterizeTriangle(const ProjectedPoint& a, const ProjectedPoint& b, const ProjectedPoint& c,
+                       QRgb color, QImage& image, std::vector<double>& depth)
+{
+    const double area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (std::abs(area) < 1e-12)
+    {
+        return;
+    }
+
+    const int width = image.width();
+    const int height = image.height();
+    const int xMin = std::max(0, static_cast<int>(std::floor(std::min({a.x, b.x, c.x}))));
+    const int xMax = std::min(width - 1, static_cast<int>(std::ceil(std::max({a.x, b.x, c.x}))));
+    const int yMin = std::max(0, static_cast<int>(std::floor(std::min({a.y, b.y, c.y}))));
+    const int yMax = std::min(height - 1, static_cast<int>(std::ceil(std::max({a.y, b.y, c.y}))));
+
+    for (int y = yMin; y <= yMax; ++y)
+    {
+        QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        const double py = y + 0.5;
+        for (int x = xMin; x <= xMax; ++x)
+        {
+            const double px = x + 0.5;
+            const double wa = ((b.x - px) * (c.y - py) - (b.y - py) * (c.x - px)) / area;
+            const double wb = ((c.x - px) * (a.y - py) - (c.y - py) * (a.x - px)) / area;
+            const double wc = 1.0 - wa - wb;
+            if (wa < 0 || wb < 0 || wc < 0)
+            {
+                continue;
+            }
+
+            const double z = wa * a.z + wb * b.z + wc * c.z;
+            double& pixelDepth = depth[static_cast<size_t>(y) * width + x];
+            if (z > pixelDepth)
+            {
+                pixelDepth = z;
+                line[x] = color;
+            }
+        }
+    }
+}
+
+}
+
+QImage vtkDataMeshThumbnail(vtkDataSet *dataset, const QSize& size)
+{
+    QImage thumbnail(size, QImage::Format_RGB32);
+    thumbnail.fill(Qt::black);
+
+    if (!dataset || dataset->GetNumberOfPoints() == 0 || size.isEmpty())
+    {
+        return thumbnail;
+    }
+
+    // Volume meshes are drawn through their outer surface
+    vtkSmartPointer<vtkPolyData> surface = vtkPolyData::SafeDownCast(dataset);
+    if (!surface)
+    {
+        vtkSmartPointer<vtkDataSetSurfaceFilter> surfaceFilter = vtkSmartPointer<vtkDataSetSurfaceFilter>::New();
+        surfaceFilter->SetInputData(dataset);
+        surfaceFilter->Update();
+        surface = surfaceFilter->GetOutput();
+    }
+
+    vtkPoints *points = surface->GetPoints();
+    vtkCellArray *polys = surface->GetPolys();
+    if (!points || !polys || polys->GetNumberOfCells() == 0)
+    {
+        return thumbnail;
+    }
+
+    // Orthonormal camera frame, looking at the mesh from the front, slightly from the right and above
+    const double azimuth = vtkMath::RadiansFromDegrees(30.0);
+    const double elevation = vtkMath::RadiansFromDegrees(20.0);
+    const double viewDirection[3] = { std::sin(azimuth) * std::cos(elevation),
+                                      std::sin(elevation),
+                                      std::cos(azimuth) * std::cos(elevation) };
+    double right[3] = { std::cos(azimuth), 0.0, -std::sin(azimuth) };
+    double up[3];
+    vtkMath::Cross(viewDirection, right, up);
+    vtkMath::Normalize(up);
+
+    const vtkIdType numberOfPoints = points->GetNumberOfPoints();
+    std::vector<ProjectedPoint> projected(numberOfPoints);
+    double bounds[4] = { std::numeric_limits<double>::max(), -std::numeric_limits<double>::max(),
+                         std::numeric_limits<double>::max(), -std::numeric_limits<double>::max() };
+    for (vtkIdType i = 0; i < numberOfPoints; ++i)
+    {
+        double p[3];
+        points->GetPoint(i, p);
+        ProjectedPoint& q = projected[i];
+        q.x = vtkMath::Dot(p, right);
+        q.y = vtkMath::Dot(p, up);
+        q.z = vtkMath::Dot(p, viewDirection);
+        bounds[0] = std::min(bounds[0], q.x);
+        bounds[1] = std::max(bounds[1], q.x);
+        bounds[2] = std::min(bounds[2], q.y);
+        bounds[3] = std::max(bounds[3], q.y);
+    }
+
+    // Fit the projected bounds in the thumbnail with a small margin, y pointing down
+    const double extent = std::max({bounds[1] - bounds[0], bounds[3] - bounds[2], 1e-12});
+    const double scale = 0.9 * std::min(size.width(), size.height()) / extent;
+    const double centerX = 0.5 * (bounds[0] + bounds[1]);
+    const double centerY = 0.5 * (bounds[2] + bounds[3]);
+    for (ProjectedPoint& q : projected)
+    {
+        q.x = 0.5 * size.width() + (q.x - centerX) * scale;
+        q.y = 0.5 * size.height() - (q.y - centerY) * scale;
+    }
+
+    std::vector<double> depth(static_cast<size_t>(size.width()) * size.height(),
+                              -std::numeric_limits<double>::max());
+
+    vtkIdType numberOfCellPoints;
+    vtkIdType *cellPoints;
+    polys->InitTraversal();
+    while (polys->GetNextCell(numberOfCellPoints, cellPoints))
+    {
+        if (numberOfCellPoints < 3)
+        {
+            continue;
+        }
+
+        // Flat shading with a light at the camera, on both sides of the faces
+        double p0[3], p1[3], p2[3], normal[3];
+        points->GetPoint(cellPoints[0], p0);
+        points->GetPoint(cellPoints[1], p1);
+        points->GetPoint(cellPoints[2], p2);
+        const double u[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        const double v[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        vtkMath::Cross(u, v, normal);
+        vtkMath::Normalize(normal);
+        const int shade = static_cast<int>(60 + 195 * std::abs(vtkMath::Dot(normal, viewDirection)));
+        const QRgb color = qRgb(shade, shade, shade);
+
+        // Polygons are drawn as triangle fans
+        for (vtkIdType i = 1; i + 1 < numberOfCellPoints; ++i)
+        {
+            rasterizeTriangle(projected[cellPoints[0]], projected[cellPoints[i]], projected[cellPoints[i + 1]],
+                              color, thumbnail, depth);
+        }
+    }
+
+    return thumbnail;
+}
@@ -0,0 +1,25 @@
+#pragma once
+/*=========================================================================
+
+medInria
+
+Copyright (c) INRIA 2013 - 2020. All rights reserved.
+See LICENSE.txt for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.
+
+=========================================================================*/
+
+#include <QImage>
+#include <QSize>
+
+class vtkDataSet;
+
+/**
+ * Thumbnail of the surface of a mesh, rasterized on the CPU with a depth buffer.
+ * The mesh is seen from a fixed oblique direction with an orthographic projection
+ * and flat shading, so it does not need a view, the GUI thread nor an OpenGL context.
+ */
+QImage vtkDataMeshThumbnail(vtkDataSet *dataset, const QSize& size);
@@ -184,25 +184,81 @@ vtkDataSet*vtkDataManagerReader::FileToDataSet(const char *type, const std::stri
 }
 
 //----------------------------------------------------------------------------
-vtkMetaDataSet*vtkDataManagerReader::CreateMetaDataSetFromXMLElement (vtkXMLDataElement *element)
+std::string vtkDataManagerReader::GetDataSetFileName (vtkXMLDataElement *element)
 {
-    vtkMetaDataSet *metadataset = nullptr;
+    vtkXMLDataElement *data = nullptr;
+    for(int i=0; i < element->GetNumberOfNestedElements(); ++i)
+    {
+        vtkXMLDataElement *eNested = element->GetNestedElement(i);
+        if(strcmp(eNested->GetName(), "vtkMetaDataSet") == 0)
+        {
+            return "";
+        }
+        else if(strcmp(eNested->GetName(), "DataSet") == 0)
+        {
+            data = eNested;
+        }
+    }
 
-    int type = 0;
+    const char *file = data ? data->GetAttribute("file") : nullptr;
+    if (!file || !*file)
+    {
+        return "";
+    }
+
+    // Construct the name of the internal file.
+    std::string fileName;
+    if(!(file[0] == '/' || file[1] == ':'))
+    {
+        std::string filePath = this->FileName;
+        std::string::size_type pos = filePath.find_last_of("/\\");
+        if(pos != filePath.npos)
+        {
+            fileName = filePath.substr(0, pos);
+            fileName += "/";
+        }
+    }
+    fileName += file;
+
+    return fileName;
+}
+
+//----------------------------------------------------------------------------
+void vtkDataManagerReader::ReadMetaDataSetInformation (vtkXMLDataElement *element, vtkMetaDataSet *metadataset)
+{
     const char *name;
     double time = 0;
     const char *tag;
 
-    std::string filePath = this->FileName;
-    std::string::size_type pos = filePath.find_last_of("/\\");
-    if(pos != filePath.npos)
-    {
-        filePath = filePath.substr(0, pos);
-    }
-    else
+    name = element->GetAttribute("name");
+    if (name)
+        metadataset->SetName (name);
+    if (element->GetScalarAttribute("time", time))
+        metadataset->SetTime (time);
+    tag = element->GetAttribute("tag");
+    if (tag)
+        metadataset->SetTag (tag);
+
+    for(int i=0; i < element->GetNumberOfNestedElements(); ++i)
     {
-        filePath = "";
+        vtkXMLDataElement *eNested = element->GetNestedElement(i);
+        if(strcmp(eNested->GetName(), "MetaData") != 0)
+            continue;
+        const char *key = eNested->GetAttribute("key");
+        if (!key)
+            continue;
+        double val;
+        eNested->GetScalarAttribute("value", val);
+        metadataset->SetMetaData<double>(key, val);
     }
+}
+
+//----------------------------------------------------------------------------
+vtkMetaDataSet*vtkDataManagerReader::CreateMetaDataSetFromXMLElement (vtkXMLDataElement *element)
+{
+    vtkMetaDataSet *metadataset = nullptr;
+
+    int type = 0;
 
     if (!element->GetScalarAttribute("type", type))
     {
@@ -212,8 +268,6 @@ vtkMetaDataSet*vtkDataManagerReader::CreateMetaDataSetFromXMLElement (vtkXMLData
 
     int numberofnested = element->GetNumberOfNestedElements();
     std::vector<vtkXMLDataElement*> frames;
-    std::vector<vtkXMLDataElement*> flags;
-    vtkXMLDataElement *data = nullptr;
 
     for(int i=0; i < numberofnested; ++i)
     {
@@ -222,14 +276,6 @@ vtkMetaDataSet*vtkDataManagerReader::CreateMetaDataSetFromXMLElement (vtkXMLData
         {
             frames.push_back (eNested);
         }
-        else if(strcmp(eNested->GetName(), "MetaData") == 0)
-        {
-            flags.push_back (eNested);
-        }
-        else if(strcmp(eNested->GetName(), "DataSet") == 0)
-        {
-            data = eNested;
-        }
     }
 
     if (!frames.size())
@@ -247,39 +293,16 @@ vtkMetaDataSet*vtkDataManagerReader::CreateMetaDataSetFromXMLElement (vtkXMLData
         metadataset = vtkMetaDataSetSequence::New();
     }
 
-    name = element->GetAttribute("name");
-    if (name)
-        metadataset->SetName (name);
-    if (element->GetScalarAttribute("time", time))
-        metadataset->SetTime (time);
-    tag = element->GetAttribute("tag");
-    if (tag)
-        metadataset->SetTag (tag);
-
-    for (unsigned int j=0; j<flags.size(); j++)
+    if (!metadataset)
     {
-        const char *key = flags[j]->GetAttribute("key");
-        if (!key)
-            continue;
-        double val;
-        flags[j]->GetScalarAttribute("value", val);
-        metadataset->SetMetaData<double>(key, val);
+        return nullptr;
     }
 
+    this->ReadMetaDataSetInformation (element, metadataset);
+
     if (!frames.size())
     {
-        // Construct the name of the internal file.
-        std::string fileName;
-        const char *file = data->GetAttribute("file");
-        if(!(file[0] == '/' || file[1] == ':'))
-        {
-            fileName = filePath;
-            if(fileName.length())
-            {
-                fileName += "/";
-            }
-        }
-        fileName += file;
+        std::string fileName = this->GetDataSetFileName (element);
 
         // Get the file extension.
         std::string ext;
@@ -300,25 +323,39 @@ vtkMetaDataSet*vtkDataManagerReader::CreateMetaDataSetFromXMLElement (vtkXMLData
                 rname = r->name;
             }
         }
-        vtkDataSet *output = this->FileToDataSet(rname, fileName);
+        vtkDataSet *output = rname ? this->FileToDataSet(rname, fileName) : nullptr;
         if (!output)
         {
-            vtkErrorMacro("Output is not a dataset for  " << rname);
+            vtkErrorMacro("Output is not a dataset for  " << fileName);
+            metadataset->Delete();
             return nullptr;
         }
 
         metadataset->SetDataSet (output);
+        metadataset->SetFilePath (fileName.c_str());
     }
     else
     {
+        // The first frame is read, the attributes of the next ones are read when they are shown
         vtkMetaDataSetSequence *sequence = vtkMetaDataSetSequence::SafeDownCast (metadataset);
         for (unsigned int i=0; i<frames.size(); i++)
         {
+            std::string frameFile = this->GetDataSetFileName (frames[i]);
+            if (sequence->GetNumberOfMetaDataSets() && !frameFile.empty())
+            {
+                double frametime = 0;
+                frames[i]->GetScalarAttribute("time", frametime);
+                vtkMetaDataSet *frame = sequence->AddPagedMetaDataSet (frameFile.c_str(), frametime);
+                this->ReadMetaDataSetInformation (frames[i], frame);
+                continue;
+            }
+
             vtkMetaDataSet *frame = this->CreateMetaDataSetFromXMLElement (frames[i]);
             if (frame)
+            {
                 sequence->AddMetaDataSet (frame);
-
-            frame->Delete();
+                frame->Delete();
+            }
         }
     }
 
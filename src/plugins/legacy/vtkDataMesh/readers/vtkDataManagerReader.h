@@ -16,6 +16,8 @@ PURPOSE.
 
 #include <vtkXMLReader.h>
 
+#include <string>
+
 class vtkDataManager;
 class vtkMetaDataSet;
 
@@ -63,6 +65,11 @@ protected:
   virtual void RestoreMetaDataSetInformation(vtkXMLDataElement* element);
 
   virtual vtkMetaDataSet* CreateMetaDataSetFromXMLElement (vtkXMLDataElement* element);
+
+  // Full path of the file of a single dataset element, empty for a sequence
+  std::string GetDataSetFileName (vtkXMLDataElement* element);
+  // Name, time, tag and metadata of a metadataset element
+  void ReadMetaDataSetInformation (vtkXMLDataElement* element, vtkMetaDataSet* metadataset);
   
   
 private:
@@ -64,9 +64,9 @@ bool vtkDataMesh4DWriter::write(const QString& path)
         return false;
     }
 
-    for(vtkMetaDataSet* dataSet : sequence->GetMetaDataSetList())
+    for (int i = 0; i < sequence->GetNumberOfMetaDataSets(); ++i)
     {
-        addMetaDataAsFieldData(dataSet);
+        addMetaDataAsFieldData(sequence->GetMetaDataSet(i));
     }
 
     vtkDataManager* manager = vtkDataManager::New();
@@ -77,9 +77,9 @@ bool vtkDataMesh4DWriter::write(const QString& path)
     // this->writer->SetFileTypeToBinary();
     this->writer->Update();
 
-    for(vtkMetaDataSet* dataSet : sequence->GetMetaDataSetList())
+    for (int i = 0; i < sequence->GetNumberOfMetaDataSets(); ++i)
     {
-        clearMetaDataFieldData(dataSet);
+        clearMetaDataFieldData(sequence->GetMetaDataSet(i));
     }
 
     manager->Delete();
@@ -0,0 +1,184 @@
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#pragma once
+
+#include <itkBinaryFunctorImageFilter.h>
+#include <itkCommand.h>
+#include <itkImage.h>
+#include <itkNumericTraits.h>
+
+#include <medAbstractDataFactory.h>
+#include <medAbstractImageData.h>
+
+#include <algorithm>
+#include <type_traits>
+
+/**
+ * Arithmetic between two scalar 3D images, computed on their own pixel types.
+ *
+ * The output pixel type is promoted at compile time from the input ones: integers of
+ * twice the size for sums, differences and products, floating point for quotients.
+ * Each pixel is cast by the functor while computing, so no converted copy of the inputs
+ * is made. The operation runs in an itk::BinaryFunctorImageFilter, multithreaded over
+ * scanlines, and can write in the first input when it already has the output type.
+ */
+namespace medItkArithmeticOperation
+{
+
+// Integer type of twice Size bytes, double when there is none
+template <unsigned int Size, bool Signed> struct WiderInteger { typedef double Type; };
+template <> struct WiderInteger<1, false> { typedef unsigned short Type; };
+template <> struct WiderInteger<1, true>  { typedef short Type; };
+template <> struct WiderInteger<2, false> { typedef unsigned int Type; };
+template <> struct WiderInteger<2, true>  { typedef int Type; };
+template <> struct WiderInteger<4, false> { typedef std::conditional<(sizeof(unsigned long) > 4), unsigned long, double>::type Type; };
+template <> struct WiderInteger<4, true>  { typedef std::conditional<(sizeof(long) > 4), long, double>::type Type; };
+
+// float when it holds both inputs exactly enough, double otherwise
+template <class T1, class T2> struct FloatingType
+{
+    static const bool needsDouble = std::is_same<T1, double>::value || std::is_same<T2, double>::value
+            || (std::is_integral<T1>::value && sizeof(T1) >= 4)
+            || (std::is_integral<T2>::value && sizeof(T2) >= 4);
+    typedef typename std::conditional<needsDouble, double, float>::type Type;
+};
+
+template <class T1, class T2, bool ForceSigned> struct WidenedType
+{
+    static const bool isFloating = std::is_floating_point<T1>::value || std::is_floating_point<T2>::value;
+    static const bool isSigned = ForceSigned || std::is_signed<T1>::value || std::is_signed<T2>::value;
+    typedef typename std::conditional<isFloating,
+        typename FloatingType<T1, T2>::Type,
+        typename WiderInteger<(sizeof(T1) > sizeof(T2) ? sizeof(T1) : sizeof(T2)), isSigned>::Type>::type Type;
+};
+
+struct Add
+{
+    template <class T1, class T2> using Output = typename WidenedType<T1, T2, false>::Type;
+    template <class TOut> static TOut apply(TOut a, TOut b) { return a + b; }
+};
+
+struct Subtract
+{
+    template <class T1, class T2> using Output = typename WidenedType<T1, T2, true>::Type;
+    template <class TOut> static TOut apply(TOut a, TOut b) { return a - b; }
+};
+
+struct Multiply
+{
+    template <class T1, class T2> using Output = typename WidenedType<T1, T2, false>::Type;
+    template <class TOut> static TOut apply(TOut a, TOut b) { return a * b; }
+};
+
+struct Divide
+{
+    template <class T1, class T2> using Output = typename FloatingType<T1, T2>::Type;
+    // Same convention as itk::DivideImageFilter for a null divisor
+    template <class TOut> static TOut apply(TOut a, TOut b) { return b != 0 ? a / b : itk::NumericTraits<TOut>::max(); }
+};
+
+template <class Operation, class T1, class T2, class TOut> class Functor
+{
+public:
+    bool operator==(const Functor &) const { return true; }
+    bool operator!=(const Functor &) const { return false; }
+
+    inline TOut operator()(const T1 &a, const T2 &b) const
+    {
+        return Operation::template apply<TOut>(static_cast<TOut>(a), static_cast<TOut>(b));
+    }
+};
+
+template <class T> const char *identifier()
+{
+    if (std::is_same<T, char>::value)           return "itkDataImageChar3";
+    if (std::is_same<T, unsigned char>::value)  return "itkDataImageUChar3";
+    if (std::is_same<T, short>::value)          return "itkDataImageShort3";
+    if (std::is_same<T, unsigned short>::value) return "itkDataImageUShort3";
+    if (std::is_same<T, int>::value)            return "itkDataImageInt3";
+    if (std::is_same<T, unsigned int>::value)   return "itkDataImageUInt3";
+    if (std::is_same<T, long>::value)           return "itkDataImageLong3";
+    if (std::is_same<T, unsigned long>::value)  return "itkDataImageULong3";
+    if (std::is_same<T, float>::value)          return "itkDataImageFloat3";
+    return "itkDataImageDouble3";
+}
+
+//! Calls f with a value of the pixel type of the image identifier, returns false if it is not handled
+template <class F> bool dispatchPixelType(const QString &id, F &&f)
+{
+    if      (id == "itkDataImageChar3")   f(char());
+    else if (id == "itkDataImageUChar3")  f((unsigned char)0);
+    else if (id == "itkDataImageShort3")  f(short());
+    else if (id == "itkDataImageUShort3") f((unsigned short)0);
+    else if (id == "itkDataImageInt3")    f(int());
+    else if (id == "itkDataImageUInt3")   f((unsigned int)0);
+    else if (id == "itkDataImageLong3")   f(long());
+    else if (id == "itkDataImageULong3")  f((unsigned long)0);
+    else if (id == "itkDataImageFloat3")  f(float());
+    else if (id == "itkDataImageDouble3") f(double());
+    else return false;
+    return true;
+}
+
+/**
+ * Computes input1 (operation) input2. The filter is stored in filter while it runs, so that
+ * it can be aborted, and reports its progress to progressCommand. With inPlace, the output
+ * reuses the buffer of input1 when it has the output type. Returns nullptr when a pixel
+ * type is not handled; itk exceptions, including itk::ProcessAborted, are let through.
+ */
+template <class Operation>
+medAbstractImageData *run(medAbstractImageData *input1, medAbstractImageData *input2,
+                          itk::SmartPointer<itk::ProcessObject> &filter, itk::Command *progressCommand,
+                          bool inPlace = false)
+{
+    medAbstractImageData *output = nullptr;
+
+    dispatchPixelType(input1->identifier(), [&](auto value1)
+    {
+        dispatchPixelType(input2->identifier(), [&](auto value2)
+        {
+            typedef decltype(value1) T1;
+            typedef decltype(value2) T2;
+            typedef typename Operation::template Output<T1, T2> TOut;
+
+            typedef itk::Image<T1, 3> Input1Type;
+            typedef itk::Image<T2, 3> Input2Type;
+            typedef itk::Image<TOut, 3> OutputType;
+            typedef itk::BinaryFunctorImageFilter<Input1Type, Input2Type, OutputType, Functor<Operation, T1, T2, TOut> > FilterType;
+
+            typename FilterType::Pointer operationFilter = FilterType::New();
+            filter = operationFilter;
+
+            operationFilter->SetInput1(dynamic_cast<Input1Type *>((itk::Object*)(input1->data())));
+            operationFilter->SetInput2(dynamic_cast<Input2Type *>((itk::Object*)(input2->data())));
+            operationFilter->SetInPlace(inPlace);
+            if (progressCommand)
+            {
+                operationFilter->AddObserver(itk::ProgressEvent(), progressCommand);
+            }
+
+            operationFilter->Update();
+
+            output = qobject_cast<medAbstractImageData *>(medAbstractDataFactory::instance()->create(identifier<TOut>()));
+            if (output)
+            {
+                output->setData(operationFilter->GetOutput());
+            }
+        });
+    });
+
+    return output;
+}
+
+}
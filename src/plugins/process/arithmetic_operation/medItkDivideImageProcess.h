@@ -17,7 +17,6 @@
 
 #include <itkProcessObject.h>
 #include <itkSmartPointer.h>
-#include <itkImage.h>
 
 #include <medIntParameter.h>
 
@@ -43,11 +42,6 @@ public:
     virtual QString caption() const;
     virtual QString description() const;
 
-private:
-    typedef itk::Image<double, 3> ImageType;
-    ImageType::Pointer CastImage(medAbstractImageData *data);
-    template <class inputType> ImageType::Pointer _cast(medAbstractImageData *data);
-
 private:
     itk::SmartPointer<itk::ProcessObject> m_filter;
 };
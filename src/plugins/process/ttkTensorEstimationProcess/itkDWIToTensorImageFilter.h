@@ -0,0 +1,116 @@
+#pragma once
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#include <itkImageToImageFilter.h>
+
+#include <vnl/vnl_matrix.h>
+#include <vnl/vnl_vector_fixed.h>
+
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * Estimates diffusion tensors from a 4D DWI image, the fourth dimension being the
+ * gradients, without splitting it into 3D images: rows of voxels are read in place
+ * from every volume, and the log-linear least squares fit is a product with the
+ * pseudo-inverse of the b-matrix, computed once. Slabs are estimated in parallel.
+ *
+ * Volumes of null gradient (or null b-value) are averaged as the baseline, and
+ * voxels whose baseline is not above BST get a null tensor. When b-values are
+ * given, each row of the b-matrix is scaled by its b-value over the largest one,
+ * so that single shell tensors are in the same units as without b-values.
+ *
+ * Non positive tensors are fixed in the same pass: their eigenvalues are raised
+ * to a small fraction of the largest one, or the tensor is nulled if no
+ * eigenvalue is positive.
+ */
+template <class TDWIImage, class TTensorImage>
+class ITK_EXPORT DWIToTensorImageFilter:
+        public ImageToImageFilter<TDWIImage, TTensorImage>
+{
+
+public:
+    typedef DWIToTensorImageFilter                      Self;
+    typedef ImageToImageFilter<TDWIImage, TTensorImage> Superclass;
+    typedef SmartPointer<Self>       Pointer;
+    typedef SmartPointer<const Self> ConstPointer;
+
+    itkNewMacro(Self)
+    itkTypeMacro (DWIToTensorImageFilter, ImageToImageFilter)
+
+    typedef TDWIImage                                 DWIImageType;
+    typedef TTensorImage                              TensorImageType;
+    typedef typename TensorImageType::PixelType       TensorType;
+    typedef typename TensorImageType::RegionType      OutputImageRegionType;
+
+    typedef vnl_vector_fixed<double, 3>               GradientType;
+    typedef std::vector<GradientType>                 GradientListType;
+
+    /** One gradient per volume of the DWI image */
+    void SetGradientList(const GradientListType& gradients)
+    {
+        m_GradientList = gradients;
+        this->Modified();
+    }
+    const GradientListType& GetGradientList() const
+    {
+        return m_GradientList;
+    }
+
+    /** Optional, one b-value per volume */
+    void SetBValues(const std::vector<double>& bvalues)
+    {
+        m_BValues = bvalues;
+        this->Modified();
+    }
+
+    /** Baseline signal threshold */
+    itkSetMacro(BST, double)
+    itkGetConstMacro(BST, double)
+
+protected:
+    DWIToTensorImageFilter();
+    ~DWIToTensorImageFilter() {}
+    void PrintSelf(std::ostream &os, Indent indent) const override;
+
+    /** The output is the first three dimensions of the input */
+    void GenerateOutputInformation() override;
+
+    /** Every volume of the requested slab is needed */
+    void GenerateInputRequestedRegion() override;
+
+    void BeforeThreadedGenerateData() override;
+    void DynamicThreadedGenerateData(const OutputImageRegionType &outputRegionForThread) override;
+
+private:
+    DWIToTensorImageFilter(const Self&); //purposely not implemented
+    void operator=(const Self&); //purposely not implemented
+
+    GradientListType    m_GradientList;
+    std::vector<double> m_BValues;
+    double              m_BST;
+
+    // Volumes of the baseline and of the gradients, and the 6 x gradients pseudo-inverse of the b-matrix
+    std::vector<unsigned int> m_BaselineVolumes;
+    std::vector<unsigned int> m_GradientVolumes;
+    vnl_matrix<double>        m_PseudoInverse;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkDWIToTensorImageFilter.txx"
+#endif
@@ -0,0 +1,303 @@
+#pragma once
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#include <itkDWIToTensorImageFilter.h>
+
+#include <vnl/algo/vnl_svd.h>
+#include <vnl/algo/vnl_symmetric_eigensystem.h>
+#include <vnl/vnl_det.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace itk
+{
+
+// ----------------------------------------------------------------------
+// Constructor
+template <class TDWIImage, class TTensorImage>
+DWIToTensorImageFilter<TDWIImage, TTensorImage>
+::DWIToTensorImageFilter()
+{
+    m_BST = 0.0;
+}
+
+// ----------------------------------------------------------------------
+// PrintSelf
+template <class TDWIImage, class TTensorImage>
+void DWIToTensorImageFilter<TDWIImage, TTensorImage>
+::PrintSelf(std::ostream &os, Indent indent) const
+{
+    Superclass::PrintSelf(os, indent);
+    os << indent << "Gradients: " << m_GradientList.size() << std::endl;
+    os << indent << "BValues: " << m_BValues.size() << std::endl;
+    os << indent << "BST: " << m_BST << std::endl;
+}
+
+// ----------------------------------------------------------------------
+// GenerateOutputInformation
+template <class TDWIImage, class TTensorImage>
+void DWIToTensorImageFilter<TDWIImage, TTensorImage>
+::GenerateOutputInformation()
+{
+    const DWIImageType *input = this->GetInput();
+    TensorImageType *output = this->GetOutput();
+    if (!input || !output)
+    {
+        return;
+    }
+
+    const typename DWIImageType::RegionType inputRegion = input->GetLargestPossibleRegion();
+    OutputImageRegionType region;
+    typename TensorImageType::SpacingType spacing;
+    typename TensorImageType::PointType origin;
+    typename TensorImageType::DirectionType direction;
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        region.SetIndex(i, inputRegion.GetIndex(i));
+        region.SetSize(i, inputRegion.GetSize(i));
+        spacing[i] = input->GetSpacing()[i];
+        origin[i] = input->GetOrigin()[i];
+        for (unsigned int j = 0; j < 3; ++j)
+        {
+            direction[i][j] = input->GetDirection()[i][j];
+        }
+    }
+
+    // as ExtractImageFilter guesses it, when the volumes are not 3D sub-spaces
+    if (std::abs(vnl_det(direction.GetVnlMatrix())) < 1e-6)
+    {
+        direction.SetIdentity();
+    }
+
+    output->SetLargestPossibleRegion(region);
+    output->SetSpacing(spacing);
+    output->SetOrigin(origin);
+    output->SetDirection(direction);
+}
+
+// ----------------------------------------------------------------------
+// GenerateInputRequestedRegion
+template <class TDWIImage, class TTensorImage>
+void DWIToTensorImageFilter<TDWIImage, TTensorImage>
+::GenerateInputRequestedRegion()
+{
+    DWIImageType *input = const_cast<DWIImageType *>(this->GetInput());
+    if (!input)
+    {
+        return;
+    }
+
+    typename DWIImageType::RegionType region = input->GetLargestPossibleRegion();
+    const OutputImageRegionType& requested = this->GetOutput()->GetRequestedRegion();
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        region.SetIndex(i, requested.GetIndex(i));
+        region.SetSize(i, requested.GetSize(i));
+    }
+    input->SetRequestedRegion(region);
+}
+
+// ----------------------------------------------------------------------
+// BeforeThreadedGenerateData
+template <class TDWIImage, class TTensorImage>
+void DWIToTensorImageFilter<TDWIImage, TTensorImage>
+::BeforeThreadedGenerateData()
+{
+    const unsigned int volumes = this->GetInput()->GetLargestPossibleRegion().GetSize()[3];
+    if (m_GradientList.size() != volumes)
+    {
+        throw itk::ExceptionObject (__FILE__,__LINE__,"Error: the number of gradients does not match the number of volumes.");
+    }
+
+    const bool hasBValues = (m_BValues.size() == volumes);
+    double largestBValue = 0.0;
+    if (hasBValues)
+    {
+        largestBValue = *std::max_element(m_BValues.begin(), m_BValues.end());
+    }
+
+    m_BaselineVolumes.clear();
+    m_GradientVolumes.clear();
+    std::vector<double> weights;
+    for (unsigned int i = 0; i < volumes; ++i)
+    {
+        const double bvalue = hasBValues ? m_BValues[i] : 1.0;
+        if (m_GradientList[i].squared_magnitude() < 1e-12 || bvalue <= 0.0)
+        {
+            m_BaselineVolumes.push_back(i);
+        }
+        else
+        {
+            m_GradientVolumes.push_back(i);
+            weights.push_back(hasBValues ? bvalue / largestBValue : 1.0);
+        }
+    }
+
+    if (m_BaselineVolumes.empty() || m_GradientVolumes.size() < 6)
+    {
+        throw itk::ExceptionObject (__FILE__,__LINE__,"Error: a baseline and at least 6 gradients are needed.");
+    }
+
+    // y = B d, with d = (Dxx, Dxy, Dxz, Dyy, Dyz, Dzz) and y the log attenuation
+    vnl_matrix<double> bMatrix(m_GradientVolumes.size(), 6);
+    for (unsigned int i = 0; i < m_GradientVolumes.size(); ++i)
+    {
+        const GradientType& g = m_GradientList[m_GradientVolumes[i]];
+        bMatrix(i, 0) = weights[i] * g[0] * g[0];
+        bMatrix(i, 1) = weights[i] * 2.0 * g[0] * g[1];
+        bMatrix(i, 2) = weights[i] * 2.0 * g[0] * g[2];
+        bMatrix(i, 3) = weights[i] * g[1] * g[1];
+        bMatrix(i, 4) = weights[i] * 2.0 * g[1] * g[2];
+        bMatrix(i, 5) = weights[i] * g[2] * g[2];
+    }
+
+    vnl_svd<double> svd(bMatrix);
+    if (svd.rank() < 6)
+    {
+        throw itk::ExceptionObject (__FILE__,__LINE__,"Error: the gradients do not determine a tensor.");
+    }
+    m_PseudoInverse = svd.pinverse();
+}
+
+// ----------------------------------------------------------------------
+// DynamicThreadedGenerateData
+template <class TDWIImage, class TTensorImage>
+void DWIToTensorImageFilter<TDWIImage, TTensorImage>
+::DynamicThreadedGenerateData(const OutputImageRegionType& outputRegionForThread)
+{
+    typedef typename DWIImageType::PixelType DWIPixelType;
+
+    const DWIImageType *input = this->GetInput();
+    TensorImageType *output = this->GetOutput();
+
+    const unsigned int length = outputRegionForThread.GetSize()[0];
+    const unsigned int gradients = m_GradientVolumes.size();
+
+    // signals below this are taken as this, their log being used
+    const double smallestSignal = std::numeric_limits<DWIPixelType>::is_integer ? 1.0 : 1e-6;
+
+    // eigenvalues of non positive tensors are raised to this fraction of the largest one
+    const double smallestEigenvalueRatio = 1e-3;
+
+    std::vector<double> baseline(length), logAttenuation(length), coefficients(6 * length);
+
+    for (unsigned int z = 0; z < outputRegionForThread.GetSize()[2]; ++z)
+    {
+        for (unsigned int y = 0; y < outputRegionForThread.GetSize()[1]; ++y)
+        {
+            typename TensorImageType::IndexType index = outputRegionForThread.GetIndex();
+            index[1] += y;
+            index[2] += z;
+
+            // the row of each volume is contiguous in the DWI buffer
+            typename DWIImageType::IndexType dwiIndex;
+            for (unsigned int i = 0; i < 3; ++i)
+            {
+                dwiIndex[i] = index[i];
+            }
+
+            std::fill(baseline.begin(), baseline.end(), 0.0);
+            for (unsigned int volume : m_BaselineVolumes)
+            {
+                dwiIndex[3] = volume;
+                const DWIPixelType *row = input->GetBufferPointer() + input->ComputeOffset(dwiIndex);
+                for (unsigned int x = 0; x < length; ++x)
+                {
+                    baseline[x] += row[x];
+                }
+            }
+            for (unsigned int x = 0; x < length; ++x)
+            {
+                baseline[x] /= m_BaselineVolumes.size();
+            }
+
+            std::fill(coefficients.begin(), coefficients.end(), 0.0);
+            for (unsigned int g = 0; g < gradients; ++g)
+            {
+                dwiIndex[3] = m_GradientVolumes[g];
+                const DWIPixelType *row = input->GetBufferPointer() + input->ComputeOffset(dwiIndex);
+                for (unsigned int x = 0; x < length; ++x)
+                {
+                    logAttenuation[x] = std::log(std::max(baseline[x], smallestSignal))
+                            - std::log(std::max(static_cast<double>(row[x]), smallestSignal));
+                }
+
+                for (unsigned int k = 0; k < 6; ++k)
+                {
+                    const double p = m_PseudoInverse(k, g);
+                    double *c = &coefficients[k * length];
+                    for (unsigned int x = 0; x < length; ++x)
+                    {
+                        c[x] += p * logAttenuation[x];
+                    }
+                }
+            }
+
+            TensorType *out = output->GetBufferPointer() + output->ComputeOffset(index);
+            for (unsigned int x = 0; x < length; ++x)
+            {
+                double d[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+                if (baseline[x] > m_BST)
+                {
+                    for (unsigned int k = 0; k < 6; ++k)
+                    {
+                        d[k] = coefficients[k * length + x];
+                    }
+                }
+
+                // positive definite by Sylvester's criterion, or fixed from the eigenvalues
+                const bool nonNull = (d[0] != 0.0 || d[1] != 0.0 || d[2] != 0.0 || d[3] != 0.0 || d[4] != 0.0 || d[5] != 0.0);
+                const double minor = d[0] * d[3] - d[1] * d[1];
+                const double det = d[0] * (d[3] * d[5] - d[4] * d[4]) - d[1] * (d[1] * d[5] - d[4] * d[2]) + d[2] * (d[1] * d[4] - d[3] * d[2]);
+                if (nonNull && (d[0] <= 0.0 || minor <= 0.0 || det <= 0.0))
+                {
+                    vnl_matrix<double> m(3, 3);
+                    m(0, 0) = d[0]; m(0, 1) = d[1]; m(0, 2) = d[2];
+                    m(1, 0) = d[1]; m(1, 1) = d[3]; m(1, 2) = d[4];
+                    m(2, 0) = d[2]; m(2, 1) = d[4]; m(2, 2) = d[5];
+
+                    // eigenvalues in increasing order
+                    vnl_symmetric_eigensystem<double> eigensystem(m);
+                    const double largest = eigensystem.D(2, 2);
+                    if (largest <= 0.0)
+                    {
+                        std::fill(d, d + 6, 0.0);
+                    }
+                    else
+                    {
+                        for (unsigned int i = 0; i < 2; ++i)
+                        {
+                            eigensystem.D(i, i) = std::max(eigensystem.D(i, i), smallestEigenvalueRatio * largest);
+                        }
+                        m = eigensystem.recompose();
+                        d[0] = m(0, 0); d[1] = m(0, 1); d[2] = m(0, 2);
+                        d[3] = m(1, 1); d[4] = m(1, 2); d[5] = m(2, 2);
+                    }
+                }
+
+                TensorType& tensor = out[x];
+                tensor.SetComponent(0, 0, d[0]);
+                tensor.SetComponent(0, 1, d[1]);
+                tensor.SetComponent(0, 2, d[2]);
+                tensor.SetComponent(1, 1, d[3]);
+                tensor.SetComponent(1, 2, d[4]);
+                tensor.SetComponent(2, 2, d[5]);
+            }
+        }
+    }
+}
+
+} // end namespace itk
@@ -4,12 +4,10 @@
 
 #include <itkImage.h>
 #include <itkTensor.h>
-#include <itkDTIEstimatorTensorImageFilter.h>
-#include <itkRemoveNonPositiveTensorsTensorImageFilter.h>
+#include <itkDWIToTensorImageFilter.h>
 #include <itkAnisotropicDiffusionTensorImageFilter.h>
 #include <itkLogTensorImageFilter.h>
 #include <itkExpTensorImageFilter.h>
-#include <itkExtractImageFilter.h>
 
 #include <medAbstractImageData.h>
 #include <medAbstractDiffusionModelImageData.h>
@@ -140,7 +138,6 @@ template <class inputType>
 medAbstractJob::medJobExitStatus ttkTensorEstimationProcess::_run()
 {
     typedef itk::Image <inputType,4> DWIImageType;
-    typedef itk::Image <inputType,3> SingleDWIImageType;
     typename DWIImageType::Pointer inData = dynamic_cast<DWIImageType *>((itk::Object*)(this->input()->data()));
 
     typedef float ScalarType;
@@ -150,7 +147,8 @@ medAbstractJob::medJobExitStatus ttkTensorEstimationProcess::_run()
     if (!inData)
         return medAbstractJob::MED_JOB_EXIT_FAILURE;
 
-    typedef itk::DTIEstimatorTensorImageFilter < SingleDWIImageType, TensorImageType > TensorEstimatorType;
+    // The volumes are read in place from the 4D image, and non positive tensors fixed in the same pass
+    typedef itk::DWIToTensorImageFilter < DWIImageType, TensorImageType > TensorEstimatorType;
     typedef typename TensorEstimatorType::GradientType GradientType;
     typedef typename TensorEstimatorType::GradientListType GradientListType;
 
@@ -165,52 +163,22 @@ medAbstractJob::medJobExitStatus ttkTensorEstimationProcess::_run()
         gradientList[i] = grad;
     }
 
-    typename TensorEstimatorType::Pointer filter = TensorEstimatorType::New();
-
-    typedef itk::ExtractImageFilter<DWIImageType, SingleDWIImageType> ExtractorType;
-    typename DWIImageType::SizeType size = inData->GetLargestPossibleRegion().GetSize();
-    unsigned int imageCount = size[3];
-
+    unsigned int imageCount = inData->GetLargestPossibleRegion().GetSize()[3];
     if (imageCount != diffGrads.size())
     {
         dtkWarn() << "Number of gradients not matching number of DWI images";
         return medAbstractJob::MED_JOB_EXIT_FAILURE;
     }
 
-    size[3] = 0;
-    typename DWIImageType::IndexType index = {{0,0,0,0}};
-    typename DWIImageType::RegionType region;
-    region.SetSize (size);
-    for (unsigned int i=0; i<imageCount; i++)
+    typename TensorEstimatorType::Pointer filter = TensorEstimatorType::New();
+    filter->SetInput(inData);
+    filter->SetGradientList(gradientList);
+    if (this->bvalues().size() == imageCount)
     {
-        index[3] = i;
-        region.SetIndex (index);
-        typename ExtractorType::Pointer extractor = ExtractorType::New();
-        extractor->SetExtractionRegion (region);
-        extractor->SetInput (inData);
-        extractor->SetDirectionCollapseToGuess();
-        try
-        {
-            extractor->Update();
-        }
-        catch (itk::ExceptionObject &e)
-        {
-            qDebug() << e.GetDescription();
-            return medAbstractJob::MED_JOB_EXIT_FAILURE;
-        }
-
-       filter->SetInput(i, extractor->GetOutput());
+        filter->SetBValues(this->bvalues());
     }
-
-    filter->SetGradientList(gradientList);
     filter->SetBST(0);
-
-    typedef itk::RemoveNonPositiveTensorsTensorImageFilter <TensorImageType,TensorImageType> NonPositiveRemoverType;
-    typename NonPositiveRemoverType::Pointer nptRemoverFilter = NonPositiveRemoverType::New();
-
-    nptRemoverFilter->SetRemovingType(1);
-    nptRemoverFilter->SetInput(filter->GetOutput());
-    m_estimationfilter = nptRemoverFilter;
+    m_estimationfilter = filter;
 
     if (m_NoSmoothing->value())
     {
@@ -218,6 +186,10 @@ medAbstractJob::medJobExitStatus ttkTensorEstimationProcess::_run()
         {
             m_estimationfilter->Update();
         }
+        catch(itk::ProcessAborted &e)
+        {
+            return medAbstractJob::MED_JOB_EXIT_CANCELLED;
+        }
         catch(itk::ExceptionObject &e)
         {
             qDebug() << e.GetDescription();
@@ -225,7 +197,7 @@ medAbstractJob::medJobExitStatus ttkTensorEstimationProcess::_run()
         }
 
         medAbstractDiffusionModelImageData *out = qobject_cast<medAbstractDiffusionModelImageData *>(medAbstractDataFactory::instance()->create("itkDataTensorImageFloat3"));
-        out->setData(nptRemoverFilter->GetOutput());
+        out->setData(filter->GetOutput());
         this->setOutput(out);
         return medAbstractJob::MED_JOB_EXIT_SUCCESS;
     }
@@ -262,7 +234,7 @@ medAbstractJob::medJobExitStatus ttkTensorEstimationProcess::_run()
     }
 
     typename LogFilterType::Pointer logFilter = LogFilterType::New();
-    logFilter->SetInput(nptRemoverFilter->GetOutput());
+    logFilter->SetInput(filter->GetOutput());
 
     smootherFilter->SetInput(logFilter->GetOutput());
 
@@ -275,6 +247,10 @@ medAbstractJob::medJobExitStatus ttkTensorEstimationProcess::_run()
     {
         m_smoothingfilter->Update();
     }
+    catch(itk::ProcessAborted &e)
+    {
+        return medAbstractJob::MED_JOB_EXIT_CANCELLED;
+    }
     catch(itk::ExceptionObject &e)
     {
         qDebug() << e.GetDescription();
@@ -290,5 +266,12 @@ medAbstractJob::medJobExitStatus ttkTensorEstimationProcess::_run()
 
 void ttkTensorEstimationProcess::cancel()
 {
-    // Not implemented yet
+    if(this->isRunning() && m_estimationfilter.IsNotNull())
+    {
+        m_estimationfilter->AbortGenerateDataOn();
+    }
+    if(this->isRunning() && m_smoothingfilter.IsNotNull())
+    {
+        m_smoothingfilter->AbortGenerateDataOn();
+    }
 }
@@ -0,0 +1,90 @@
+#pragma once
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#include <itkImageToImageFilter.h>
+#include <itkRGBAPixel.h>
+
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * Computes several scalar maps of a 3D tensor image in one pass: each tensor is
+ * eigendecomposed once, with the closed form solution of symmetric 3x3 matrices,
+ * and every requested map is written from its eigenvalues. Output i is the map
+ * i of SetMaps(), a TScalarImage except for ColorFA which is an RGBA image.
+ *
+ * With l1 >= l2 >= l3 the eigenvalues, m their mean and e1 the main eigenvector:
+ * FA = sqrt(3/2 sum (li-m)^2 / sum li^2), LogFA the FA of log(li), ADC = m,
+ * Cl = (l1-l2)/3m, Cp = 2(l2-l3)/3m, Cs = l3/m, RA = sqrt(sum (li-m)^2 / 3) / m,
+ * VR = l1 l2 l3 / m^3, and ColorFA = 255 FA |direction e1| with an opaque alpha.
+ */
+template <class TTensorImage, class TScalarImage>
+class ITK_EXPORT TensorToScalarMapsImageFilter:
+        public ImageToImageFilter<TTensorImage, TScalarImage>
+{
+
+public:
+    typedef TensorToScalarMapsImageFilter                  Self;
+    typedef ImageToImageFilter<TTensorImage, TScalarImage> Superclass;
+    typedef SmartPointer<Self>       Pointer;
+    typedef SmartPointer<const Self> ConstPointer;
+
+    itkNewMacro(Self)
+    itkTypeMacro (TensorToScalarMapsImageFilter, ImageToImageFilter)
+    itkStaticConstMacro(ImageDimension, unsigned int, TTensorImage::ImageDimension);
+
+    typedef TTensorImage                              TensorImageType;
+    typedef TScalarImage                              ScalarImageType;
+    typedef typename ScalarImageType::PixelType       ScalarType;
+    typedef RGBAPixel<unsigned char>                  ColorType;
+    typedef Image<ColorType, ImageDimension>          ColorImageType;
+    typedef typename ScalarImageType::RegionType      OutputImageRegionType;
+    typedef typename Superclass::DataObjectPointerArraySizeType DataObjectPointerArraySizeType;
+
+    enum Map { FA, LogFA, ADC, Cl, Cp, Cs, RA, VR, Lambda1, Lambda2, Lambda3, ColorFA };
+
+    /** Maps to compute, one output each in this order */
+    void SetMaps(const std::vector<Map>& maps);
+    const std::vector<Map>& GetMaps() const
+    {
+        return m_Maps;
+    }
+
+    ScalarImageType *GetScalarOutput(unsigned int i);
+    ColorImageType *GetColorOutput(unsigned int i);
+
+    using Superclass::MakeOutput;
+    DataObject::Pointer MakeOutput(DataObjectPointerArraySizeType idx) override;
+
+protected:
+    TensorToScalarMapsImageFilter();
+    ~TensorToScalarMapsImageFilter() {}
+    void PrintSelf(std::ostream &os, Indent indent) const override;
+
+    void DynamicThreadedGenerateData(const OutputImageRegionType &outputRegionForThread) override;
+
+private:
+    TensorToScalarMapsImageFilter(const Self&); //purposely not implemented
+    void operator=(const Self&); //purposely not implemented
+
+    std::vector<Map> m_Maps;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkTensorToScalarMapsImageFilter.txx"
+#endif
@@ -0,0 +1,377 @@
+#pragma once
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#include <itkTensorToScalarMapsImageFilter.h>
+#include <itkImageScanlineConstIterator.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+namespace TensorToScalarMaps
+{
+
+// ----------------------------------------------------------------------
+// Eigenvalues l1 >= l2 >= l3 of n symmetric 3x3 matrices, given by one array
+// per coefficient, with the trigonometric solution of the characteristic
+// equation. There is no branch, so that the loop is vectorized.
+inline void SymmetricEigenvalues(unsigned int n,
+                                 const double *a00, const double *a01, const double *a02,
+                                 const double *a11, const double *a12, const double *a22,
+                                 double *mean, double *l1, double *l2, double *l3)
+{
+    const double twoThirdsOfPi = 2.0 * std::acos(-1.0) / 3.0;
+
+    for (unsigned int x = 0; x < n; ++x)
+    {
+        const double q = (a00[x] + a11[x] + a22[x]) / 3.0;
+        const double d0 = a00[x] - q;
+        const double d1 = a11[x] - q;
+        const double d2 = a22[x] - q;
+        const double p1 = a01[x] * a01[x] + a02[x] * a02[x] + a12[x] * a12[x];
+        const double p = std::sqrt((d0 * d0 + d1 * d1 + d2 * d2 + 2.0 * p1) / 6.0);
+
+        // half the determinant of (A - qI) / p, the cosine of three times the angle
+        const double det = d0 * (d1 * d2 - a12[x] * a12[x])
+                - a01[x] * (a01[x] * d2 - a12[x] * a02[x])
+                + a02[x] * (a01[x] * a12[x] - d1 * a02[x]);
+        const double p3 = p * p * p;
+        const double r = std::min(1.0, std::max(-1.0, p3 > 0.0 ? det / (2.0 * p3) : 0.0));
+        const double phi = std::acos(r) / 3.0;
+
+        mean[x] = q;
+        l1[x] = q + 2.0 * p * std::cos(phi);
+        l3[x] = q + 2.0 * p * std::cos(phi + twoThirdsOfPi);
+        l2[x] = 3.0 * q - l1[x] - l3[x];
+    }
+}
+
+// ----------------------------------------------------------------------
+// Unit eigenvectors of the eigenvalues l: the largest cross product of two
+// rows of A - lI, which are orthogonal to it. When l is a double eigenvalue,
+// the rows are all along the third eigenvector and their cross products
+// vanish: any vector orthogonal to the largest row is then taken, as the
+// eigenvectors of l are.
+inline void SymmetricEigenvectors(unsigned int n,
+                                  const double *a00, const double *a01, const double *a02,
+                                  const double *a11, const double *a12, const double *a22,
+                                  const double *l, double *e0, double *e1, double *e2)
+{
+    for (unsigned int x = 0; x < n; ++x)
+    {
+        const double r00 = a00[x] - l[x], r01 = a01[x], r02 = a02[x];
+        const double r10 = a01[x], r11 = a11[x] - l[x], r12 = a12[x];
+        const double r20 = a02[x], r21 = a12[x], r22 = a22[x] - l[x];
+
+        double c0 = r01 * r12 - r02 * r11;
+        double c1 = r02 * r10 - r00 * r12;
+        double c2 = r00 * r11 - r01 * r10;
+        double norm = c0 * c0 + c1 * c1 + c2 * c2;
+
+        const double b0 = r01 * r22 - r02 * r21;
+        const double b1 = r02 * r20 - r00 * r22;
+        const double b2 = r00 * r21 - r01 * r20;
+        const double bNorm = b0 * b0 + b1 * b1 + b2 * b2;
+        const bool useB = bNorm > norm;
+        c0 = useB ? b0 : c0;
+        c1 = useB ? b1 : c1;
+        c2 = useB ? b2 : c2;
+        norm = useB ? bNorm : norm;
+
+        const double d0 = r11 * r22 - r12 * r21;
+        const double d1 = r12 * r20 - r10 * r22;
+        const double d2 = r10 * r21 - r11 * r20;
+        const double dNorm = d0 * d0 + d1 * d1 + d2 * d2;
+        const bool useD = dNorm > norm;
+        c0 = useD ? d0 : c0;
+        c1 = useD ? d1 : c1;
+        c2 = useD ? d2 : c2;
+        norm = useD ? dNorm : norm;
+
+        const double n0 = r00 * r00 + r01 * r01 + r02 * r02;
+        const double n1 = r10 * r10 + r11 * r11 + r12 * r12;
+        const double n2 = r20 * r20 + r21 * r21 + r22 * r22;
+        const bool use1 = n1 > n0;
+        const double s0 = use1 ? r10 : r00, s1 = use1 ? r11 : r01, s2 = use1 ? r12 : r02;
+        const double sNorm = use1 ? n1 : n0;
+        const bool use2 = n2 > sNorm;
+        const double t0 = use2 ? r20 : s0, t1 = use2 ? r21 : s1, t2 = use2 ? r22 : s2;
+        const double rowNorm = use2 ? n2 : sNorm;
+
+        // the cross products of the largest row with the x and y axes
+        const double f0 = 0.0, f1 = t2, f2 = -t1;
+        const double g0 = -t2, g1 = 0.0, g2 = t0;
+        const double fNorm = f1 * f1 + f2 * f2;
+        const double gNorm = g0 * g0 + g2 * g2;
+        const bool useG = gNorm > fNorm;
+
+        const bool degenerate = norm <= 1e-12 * rowNorm * rowNorm;
+        c0 = degenerate ? (useG ? g0 : f0) : c0;
+        c1 = degenerate ? (useG ? g1 : f1) : c1;
+        c2 = degenerate ? (useG ? g2 : f2) : c2;
+        norm = degenerate ? (useG ? gNorm : fNorm) : norm;
+
+        const double inverse = norm > 0.0 ? 1.0 / std::sqrt(norm) : 0.0;
+        e0[x] = c0 * inverse;
+        e1[x] = c1 * inverse;
+        e2[x] = c2 * inverse;
+    }
+}
+
+inline double FractionalAnisotropy(double l1, double l2, double l3)
+{
+    const double m = (l1 + l2 + l3) / 3.0;
+    const double deviation = (l1 - m) * (l1 - m) + (l2 - m) * (l2 - m) + (l3 - m) * (l3 - m);
+    const double norm = l1 * l1 + l2 * l2 + l3 * l3;
+    return norm > 0.0 ? std::sqrt(1.5 * deviation / norm) : 0.0;
+}
+
+} // end namespace TensorToScalarMaps
+
+// ----------------------------------------------------------------------
+// Constructor
+template <class TTensorImage, class TScalarImage>
+TensorToScalarMapsImageFilter<TTensorImage, TScalarImage>
+::TensorToScalarMapsImageFilter()
+{
+    // output 0 is made by the superclass, a scalar image
+    m_Maps.push_back(FA);
+}
+
+// ----------------------------------------------------------------------
+// PrintSelf
+template <class TTensorImage, class TScalarImage>
+void TensorToScalarMapsImageFilter<TTensorImage, TScalarImage>
+::PrintSelf(std::ostream &os, Indent indent) const
+{
+    Superclass::PrintSelf(os, indent);
+    os << indent << "Maps:";
+    for (Map map : m_Maps)
+    {
+        os << " " << map;
+    }
+    os << std::endl;
+}
+
+// ----------------------------------------------------------------------
+// SetMaps
+template <class TTensorImage, class TScalarImage>
+void TensorToScalarMapsImageFilter<TTensorImage, TScalarImage>
+::SetMaps(const std::vector<Map>& maps)
+{
+    if (maps.empty())
+    {
+        itkExceptionMacro(<< "At least one map must be requested.");
+    }
+    if (maps == m_Maps)
+    {
+        return;
+    }
+
+    m_Maps = maps;
+    this->SetNumberOfIndexedOutputs(m_Maps.size());
+    this->SetNumberOfRequiredOutputs(m_Maps.size());
+    for (unsigned int i = 0; i < m_Maps.size(); ++i)
+    {
+        this->SetNthOutput(i, this->MakeOutput(i));
+    }
+    this->Modified();
+}
+
+// ----------------------------------------------------------------------
+// MakeOutput
+template <class TTensorImage, class TScalarImage>
+DataObject::Pointer TensorToScalarMapsImageFilter<TTensorImage, TScalarImage>
+::MakeOutput(DataObjectPointerArraySizeType idx)
+{
+    if (idx < m_Maps.size() && m_Maps[idx] == ColorFA)
+    {
+        return ColorImageType::New().GetPointer();
+    }
+    return ScalarImageType::New().GetPointer();
+}
+
+template <class TTensorImage, class TScalarImage>
+typename TensorToScalarMapsImageFilter<TTensorImage, TScalarImage>::ScalarImageType *
+TensorToScalarMapsImageFilter<TTensorImage, TScalarImage>
+::GetScalarOutput(unsigned int i)
+{
+    return dynamic_cast<ScalarImageType *>(this->ProcessObject::GetOutput(i));
+}
+
+template <class TTensorImage, class TScalarImage>
+typename TensorToScalarMapsImageFilter<TTensorImage, TScalarImage>::ColorImageType *
+TensorToScalarMapsImageFilter<TTensorImage, TScalarImage>
+::GetColorOutput(unsigned int i)
+{
+    return dynamic_cast<ColorImageType *>(this->ProcessObject::GetOutput(i));
+}
+
+// ----------------------------------------------------------------------
+// DynamicThreadedGenerateData
+template <class TTensorImage, class TScalarImage>
+void TensorToScalarMapsImageFilter<TTensorImage, TScalarImage>
+::DynamicThreadedGenerateData(const OutputImageRegionType& outputRegionForThread)
+{
+    const TensorImageType *input = this->GetInput();
+    const unsigned int maps = m_Maps.size();
+    const unsigned int length = outputRegionForThread.GetSize()[0];
+    if (length == 0)
+    {
+        return;
+    }
+
+    std::vector<ScalarImageType *> scalarOutputs(maps, nullptr);
+    std::vector<ColorImageType *> colorOutputs(maps, nullptr);
+    bool needsEigenvectors = false;
+    for (unsigned int i = 0; i < maps; ++i)
+    {
+        if (m_Maps[i] == ColorFA)
+        {
+            colorOutputs[i] = this->GetColorOutput(i);
+            needsEigenvectors = true;
+        }
+        else
+        {
+            scalarOutputs[i] = this->GetScalarOutput(i);
+        }
+    }
+
+    // one array per tensor coefficient, eigenvalue and eigenvector coordinate, a row at a time
+    std::vector<double> rows(13 * length);
+    double *a00 = &rows[0],          *a01 = &rows[length],      *a02 = &rows[2 * length];
+    double *a11 = &rows[3 * length], *a12 = &rows[4 * length],  *a22 = &rows[5 * length];
+    double *mean = &rows[6 * length];
+    double *l1 = &rows[7 * length],  *l2 = &rows[8 * length],   *l3 = &rows[9 * length];
+    double *e0 = &rows[10 * length], *e1 = &rows[11 * length],  *e2 = &rows[12 * length];
+
+    const typename TensorImageType::DirectionType direction = input->GetDirection();
+
+    ImageScanlineConstIterator<TensorImageType> it(input, outputRegionForThread);
+    while (!it.IsAtEnd())
+    {
+        const typename TensorImageType::IndexType index = it.GetIndex();
+        for (unsigned int x = 0; !it.IsAtEndOfLine(); ++x, ++it)
+        {
+            const typename TensorImageType::PixelType tensor = it.Get();
+            a00[x] = tensor.GetComponent(0, 0);
+            a01[x] = tensor.GetComponent(0, 1);
+            a02[x] = tensor.GetComponent(0, 2);
+            a11[x] = tensor.GetComponent(1, 1);
+            a12[x] = tensor.GetComponent(1, 2);
+            a22[x] = tensor.GetComponent(2, 2);
+        }
+        it.NextLine();
+
+        TensorToScalarMaps::SymmetricEigenvalues(length, a00, a01, a02, a11, a12, a22, mean, l1, l2, l3);
+        if (needsEigenvectors)
+        {
+            TensorToScalarMaps::SymmetricEigenvectors(length, a00, a01, a02, a11, a12, a22, l1, e0, e1, e2);
+        }
+
+        for (unsigned int i = 0; i < maps; ++i)
+        {
+            if (m_Maps[i] == ColorFA)
+            {
+                ColorType *out = colorOutputs[i]->GetBufferPointer() + colorOutputs[i]->ComputeOffset(index);
+                for (unsigned int x = 0; x < length; ++x)
+                {
+                    const double fa = TensorToScalarMaps::FractionalAnisotropy(l1[x], l2[x], l3[x]);
+                    for (unsigned int c = 0; c < 3; ++c)
+                    {
+                        const double v = direction[c][0] * e0[x] + direction[c][1] * e1[x] + direction[c][2] * e2[x];
+                        out[x][c] = static_cast<unsigned char>(std::min(255.0, 255.0 * fa * std::abs(v)));
+                    }
+                    out[x][3] = 255;
+                }
+                continue;
+            }
+
+            ScalarType *out = scalarOutputs[i]->GetBufferPointer() + scalarOutputs[i]->ComputeOffset(index);
+            switch (m_Maps[i])
+            {
+            case FA:
+                for (unsigned int x = 0; x < length; ++x)
+                    out[x] = static_cast<ScalarType>(TensorToScalarMaps::FractionalAnisotropy(l1[x], l2[x], l3[x]));
+                break;
+
+            case LogFA:
+                for (unsigned int x = 0; x < length; ++x)
+                {
+                    const double smallest = 1e-12;
+                    out[x] = static_cast<ScalarType>(TensorToScalarMaps::FractionalAnisotropy(std::log(std::max(l1[x], smallest)),
+                                                                                              std::log(std::max(l2[x], smallest)),
+                                                                                              std::log(std::max(l3[x], smallest))));
+                }
+                break;
+
+            case ADC:
+                for (unsigned int x = 0; x < length; ++x)
+                    out[x] = static_cast<ScalarType>(mean[x]);
+                break;
+
+            case Cl:
+                for (unsigned int x = 0; x < length; ++x)
+                    out[x] = static_cast<ScalarType>(mean[x] > 0.0 ? (l1[x] - l2[x]) / (3.0 * mean[x]) : 0.0);
+                break;
+
+            case Cp:
+                for (unsigned int x = 0; x < length; ++x)
+                    out[x] = static_cast<ScalarType>(mean[x] > 0.0 ? 2.0 * (l2[x] - l3[x]) / (3.0 * mean[x]) : 0.0);
+                break;
+
+            case Cs:
+                for (unsigned int x = 0; x < length; ++x)
+                    out[x] = static_cast<ScalarType>(mean[x] > 0.0 ? l3[x] / mean[x] : 0.0);
+                break;
+
+            case RA:
+                for (unsigned int x = 0; x < length; ++x)
+                {
+                    const double m = mean[x];
+                    const double deviation = (l1[x] - m) * (l1[x] - m) + (l2[x] - m) * (l2[x] - m) + (l3[x] - m) * (l3[x] - m);
+                    out[x] = static_cast<ScalarType>(m > 0.0 ? std::sqrt(deviation / 3.0) / m : 0.0);
+                }
+                break;
+
+            case VR:
+                for (unsigned int x = 0; x < length; ++x)
+                    out[x] = static_cast<ScalarType>(mean[x] > 0.0 ? l1[x] * l2[x] * l3[x] / (mean[x] * mean[x] * mean[x]) : 0.0);
+                break;
+
+            case Lambda1:
+                for (unsigned int x = 0; x < length; ++x)
+                    out[x] = static_cast<ScalarType>(l1[x]);
+                break;
+
+            case Lambda2:
+                for (unsigned int x = 0; x < length; ++x)
+                    out[x] = static_cast<ScalarType>(l2[x]);
+                break;
+
+            case Lambda3:
+                for (unsigned int x = 0; x < length; ++x)
+                    out[x] = static_cast<ScalarType>(l3[x]);
+                break;
+
+            default:
+                break;
+            }
+        }
+    }
+}
+
+} // end namespace itk
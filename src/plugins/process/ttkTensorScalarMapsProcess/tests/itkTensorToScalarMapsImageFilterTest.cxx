@@ -0,0 +1,233 @@
+/*=========================================================================
+
+ medInria
+
+ Copyright (c) INRIA 2013 - 2020. All rights reserved.
+ See LICENSE.txt for details.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+=========================================================================*/
+
+#include <itkImage.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIterator.h>
+#include <itkRGBAPixel.h>
+#include <itkTensor.h>
+
+#include <itkTensorToScalarTensorImageFilter.h>
+#include <itkTensorToFAFunction.h>
+#include <itkTensorToColorFAFunction.h>
+#include <itkTensorToLogFAFunction.h>
+#include <itkTensorToADCFunction.h>
+#include <itkTensorToClFunction.h>
+#include <itkTensorToCpFunction.h>
+#include <itkTensorToCsFunction.h>
+#include <itkTensorToRAFunction.h>
+#include <itkTensorToVRFunction.h>
+#include <itkTensorToLambdaFunction.h>
+
+#include <itkTensorToScalarMapsImageFilter.h>
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Compares every map of TensorToScalarMapsImageFilter with the TTK function
+// computing it alone, on isotropic, prolate, oblate (l1 == l2) and non-positive
+// tensors.
+
+typedef itk::Tensor<float, 3>                                      TensorType;
+typedef itk::Image<TensorType, 3>                                  TensorImageType;
+typedef itk::Image<float, 3>                                       ImageType;
+typedef itk::RGBAPixel<unsigned char>                              ColorType;
+typedef itk::Image<ColorType, 3>                                   ColorImageType;
+typedef itk::TensorToScalarMapsImageFilter<TensorImageType, ImageType> MapsFilterType;
+typedef itk::TensorToScalarFunction<TensorType, float>             FunctionType;
+
+namespace
+{
+
+struct SyntheticTensor
+{
+    const char *name;
+    double a00, a01, a02, a11, a12, a22;
+    bool positive;
+};
+
+// the eigenvalues are given in comment, the rotated ones have their eigenvectors
+// along (1, 1, 0) / sqrt(2), (1, -1, 0) / sqrt(2) and z
+const SyntheticTensor tensors[] =
+{
+    { "isotropic",                1.0,  0.0, 0.0, 1.0,  0.0, 1.0, true  }, // 1 1 1
+    { "prolate",                  3.0,  0.0, 0.0, 1.0,  0.0, 1.0, true  }, // 3 1 1
+    { "rotated prolate",          2.0,  1.0, 0.0, 2.0,  0.0, 1.0, true  }, // 3 1 1
+    { "oblate",                   2.0,  0.0, 0.0, 2.0,  0.0, 1.0, true  }, // 2 2 1
+    { "rotated oblate",           1.5, -0.5, 0.0, 1.5,  0.0, 2.0, true  }, // 2 2 1
+    { "general",                  4.0,  0.5, 0.2, 2.0, -0.3, 1.0, true  },
+    { "semi-definite",            2.0,  0.0, 0.0, 0.5,  0.0, 0.0, false }, // 2 0.5 0
+    { "negative eigenvalue",      3.0,  0.0, 0.0, 1.0,  0.0, -0.5, false }, // 3 1 -0.5
+};
+const unsigned int tensorCount = sizeof(tensors) / sizeof(tensors[0]);
+
+bool closeEnough(double value, double expected)
+{
+    return std::abs(value - expected) <= 1e-4 * std::abs(expected) + 1e-5;
+}
+
+ImageType::Pointer computeWithFunction(TensorImageType *input, FunctionType *function)
+{
+    typedef itk::TensorToScalarTensorImageFilter<TensorImageType, ImageType> FilterType;
+    FilterType::Pointer filter = FilterType::New();
+    filter->SetInput(input);
+    filter->SetTensorToScalarFunction(function);
+    filter->Update();
+    return filter->GetOutput();
+}
+
+FunctionType::Pointer lambdaFunction(unsigned int index)
+{
+    itk::TensorToLambdaFunction<TensorType, float>::Pointer function = itk::TensorToLambdaFunction<TensorType, float>::New();
+    function->SetLambdaIndex(index);
+    return function.GetPointer();
+}
+
+}
+
+int itkTensorToScalarMapsImageFilterTest(int argc, char* argv[])
+{
+    TensorImageType::Pointer input = TensorImageType::New();
+    TensorImageType::SizeType size;
+    size[0] = tensorCount;
+    size[1] = 1;
+    size[2] = 1;
+    input->SetRegions(size);
+    input->Allocate();
+
+    // a non trivial orientation, applied to the colors by both filters
+    TensorImageType::DirectionType direction;
+    direction.Fill(0.0);
+    direction[0][1] = 1.0;
+    direction[1][0] = -1.0;
+    direction[2][2] = 1.0;
+    input->SetDirection(direction);
+
+    itk::ImageRegionIterator<TensorImageType> inputIt(input, input->GetLargestPossibleRegion());
+    for (unsigned int i = 0; i < tensorCount; ++i, ++inputIt)
+    {
+        TensorType tensor;
+        tensor.SetComponent(0, 0, tensors[i].a00);
+        tensor.SetComponent(0, 1, tensors[i].a01);
+        tensor.SetComponent(0, 2, tensors[i].a02);
+        tensor.SetComponent(1, 1, tensors[i].a11);
+        tensor.SetComponent(1, 2, tensors[i].a12);
+        tensor.SetComponent(2, 2, tensors[i].a22);
+        inputIt.Set(tensor);
+    }
+
+    std::vector<MapsFilterType::Map> maps;
+    std::vector<FunctionType::Pointer> functions;
+    maps.push_back(MapsFilterType::FA);      functions.push_back(itk::TensorToFAFunction<TensorType, float>::New().GetPointer());
+    maps.push_back(MapsFilterType::LogFA);   functions.push_back(itk::TensorToLogFAFunction<TensorType, float>::New().GetPointer());
+    maps.push_back(MapsFilterType::ADC);     functions.push_back(itk::TensorToADCFunction<TensorType, float>::New().GetPointer());
+    maps.push_back(MapsFilterType::Cl);      functions.push_back(itk::TensorToClFunction<TensorType, float>::New().GetPointer());
+    maps.push_back(MapsFilterType::Cp);      functions.push_back(itk::TensorToCpFunction<TensorType, float>::New().GetPointer());
+    maps.push_back(MapsFilterType::Cs);      functions.push_back(itk::TensorToCsFunction<TensorType, float>::New().GetPointer());
+    maps.push_back(MapsFilterType::RA);      functions.push_back(itk::TensorToRAFunction<TensorType, float>::New().GetPointer());
+    maps.push_back(MapsFilterType::VR);      functions.push_back(itk::TensorToVRFunction<TensorType, float>::New().GetPointer());
+    maps.push_back(MapsFilterType::Lambda1); functions.push_back(lambdaFunction(2));
+    maps.push_back(MapsFilterType::Lambda2); functions.push_back(lambdaFunction(1));
+    maps.push_back(MapsFilterType::Lambda3); functions.push_back(lambdaFunction(0));
+    maps.push_back(MapsFilterType::ColorFA);
+
+    MapsFilterType::Pointer mapsFilter = MapsFilterType::New();
+    mapsFilter->SetInput(input);
+    mapsFilter->SetMaps(maps);
+
+    try
+    {
+        mapsFilter->Update();
+    }
+    catch (itk::ExceptionObject &e)
+    {
+        std::cerr << e << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    int errors = 0;
+
+    for (unsigned int m = 0; m < functions.size(); ++m)
+    {
+        ImageType::Pointer expected = computeWithFunction(input, functions[m]);
+
+        itk::ImageRegionConstIterator<ImageType> expectedIt(expected, expected->GetLargestPossibleRegion());
+        itk::ImageRegionConstIterator<ImageType> valueIt(mapsFilter->GetScalarOutput(m), expected->GetLargestPossibleRegion());
+        for (unsigned int i = 0; i < tensorCount; ++i, ++expectedIt, ++valueIt)
+        {
+            // the logarithm of a non-positive eigenvalue is clamped, only check it is defined
+            const bool comparable = tensors[i].positive || maps[m] != MapsFilterType::LogFA;
+            const bool valid = comparable ? closeEnough(valueIt.Get(), expectedIt.Get()) : std::isfinite(valueIt.Get());
+            if (!valid)
+            {
+                std::cerr << functions[m]->GetNameOfClass() << " on the " << tensors[i].name << " tensor: "
+                          << valueIt.Get() << " instead of " << expectedIt.Get() << std::endl;
+                ++errors;
+            }
+        }
+    }
+
+    typedef itk::TensorToScalarTensorImageFilter<TensorImageType, ColorImageType> ColorFilterType;
+    typedef itk::TensorToColorFAFunction<TensorType, ColorType> ColorFunctionType;
+    ColorFunctionType::Pointer colorFunction = ColorFunctionType::New();
+    colorFunction->SetTransformColorWithDirection(true);
+    colorFunction->SetDirection(input->GetDirection());
+
+    ColorFilterType::Pointer colorFilter = ColorFilterType::New();
+    colorFilter->SetInput(input);
+    colorFilter->SetTensorToScalarFunction(colorFunction);
+    colorFilter->Update();
+
+    const unsigned int colorMap = maps.size() - 1;
+    itk::ImageRegionConstIterator<ColorImageType> expectedColorIt(colorFilter->GetOutput(), input->GetLargestPossibleRegion());
+    itk::ImageRegionConstIterator<ColorImageType> colorIt(mapsFilter->GetColorOutput(colorMap), input->GetLargestPossibleRegion());
+    for (unsigned int i = 0; i < tensorCount; ++i, ++expectedColorIt, ++colorIt)
+    {
+        const ColorType expected = expectedColorIt.Get();
+        const ColorType color = colorIt.Get();
+
+        // with l1 == l2 any vector of their plane is a main eigenvector: only
+        // the norm of the color, 255 FA, is defined
+        const bool oblate = std::string(tensors[i].name).find("oblate") != std::string::npos;
+        bool valid = true;
+        if (oblate)
+        {
+            const double expectedNorm = std::sqrt(double(expected[0] * expected[0] + expected[1] * expected[1] + expected[2] * expected[2]));
+            const double norm = std::sqrt(double(color[0] * color[0] + color[1] * color[1] + color[2] * color[2]));
+            valid = norm > 0.0 && std::abs(norm - expectedNorm) <= 2.0;
+        }
+        else
+        {
+            for (unsigned int c = 0; c < 3; ++c)
+                valid = valid && std::abs(int(color[c]) - int(expected[c])) <= 1;
+        }
+
+        if (!valid)
+        {
+            std::cerr << "ColorFA on the " << tensors[i].name << " tensor: ("
+                      << int(color[0]) << ", " << int(color[1]) << ", " << int(color[2]) << ") instead of ("
+                      << int(expected[0]) << ", " << int(expected[1]) << ", " << int(expected[2]) << ")" << std::endl;
+            ++errors;
+        }
+    }
+
+    if (errors)
+    {
+        std::cerr << errors << " differences with the TTK functions" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -26,6 +26,8 @@
 #include <itkTensorToVolumeFunction.h>
 #include <itkTensorToLambdaFunction.h>
 
+#include <itkTensorToScalarMapsImageFilter.h>
+
 #include <itkCommand.h>
 #include <medMetaDataKeys.h>
 
@@ -36,6 +38,7 @@ ttkTensorScalarMapsProcess::ttkTensorScalarMapsProcess(QObject *parent)
 {
     m_filter = 0;
     m_scalarMapRequested = "fa";
+    m_scalarMapsRequested << m_scalarMapRequested;
 }
 
 ttkTensorScalarMapsProcess::~ttkTensorScalarMapsProcess()
@@ -55,6 +58,40 @@ QString ttkTensorScalarMapsProcess::description() const
 void ttkTensorScalarMapsProcess::selectRequestedScalarMap(QString mapRequested)
 {
     m_scalarMapRequested = mapRequested;
+    m_scalarMapsRequested = QStringList() << mapRequested;
+}
+
+void ttkTensorScalarMapsProcess::selectRequestedScalarMaps(QStringList mapsRequested)
+{
+    mapsRequested.removeDuplicates();
+    if (mapsRequested.isEmpty())
+        return;
+
+    m_scalarMapRequested = mapsRequested.first();
+    m_scalarMapsRequested = mapsRequested;
+}
+
+QStringList ttkTensorScalarMapsProcess::requestedScalarMaps() const
+{
+    return m_scalarMapsRequested;
+}
+
+medAbstractImageData *ttkTensorScalarMapsProcess::scalarMapOutput(QString map) const
+{
+    if (map == m_scalarMapRequested)
+        return this->output();
+    return m_scalarMapOutputs.value(map).data();
+}
+
+QList<medAbstractImageData *> ttkTensorScalarMapsProcess::scalarMapOutputs() const
+{
+    QList<medAbstractImageData *> outputs;
+    for (QString map : m_scalarMapsRequested)
+    {
+        if (medAbstractImageData *output = this->scalarMapOutput(map))
+            outputs << output;
+    }
+    return outputs;
 }
 
 medAbstractJob::medJobExitStatus ttkTensorScalarMapsProcess::run()
@@ -64,14 +101,18 @@ medAbstractJob::medJobExitStatus ttkTensorScalarMapsProcess::run()
     if(this->input())
     {
         QString id =  this->input()->identifier();
+        m_scalarMapOutputs.clear();
+
+        // a single map keeps the TTK function computing it
+        const bool severalMaps = m_scalarMapsRequested.size() > 1;
 
         if ( id == "itkDataTensorImageFloat3" )
         {
-            jobExitSatus = this->_run<float>();
+            jobExitSatus = severalMaps ? this->_runMaps<float>() : this->_run<float>();
         }
         else if ( id == "itkDataTensorImageDouble3" )
         {
-            jobExitSatus = this->_run<double>();
+            jobExitSatus = severalMaps ? this->_runMaps<double>() : this->_run<double>();
         }
     }
 
@@ -191,6 +232,79 @@ medAbstractJob::medJobExitStatus ttkTensorScalarMapsProcess::_run()
     return medAbstractJob::MED_JOB_EXIT_SUCCESS;
 }
 
+template <class inputType>
+medAbstractJob::medJobExitStatus ttkTensorScalarMapsProcess::_runMaps()
+{
+    typedef itk::Tensor<inputType, 3> TensorType;
+    typedef itk::Image<TensorType, 3> TensorImageType;
+    typedef itk::Image<inputType, 3> ImageType;
+    typedef itk::TensorToScalarMapsImageFilter<TensorImageType, ImageType> FilterType;
+
+    typename TensorImageType::Pointer inData = dynamic_cast<TensorImageType *>((itk::Object*)(this->input()->data()));
+    if (!inData)
+        return medAbstractJob::MED_JOB_EXIT_FAILURE;
+
+    static const QStringList mapNames = QStringList() << "FA" << "LogFA" << "ADC" << "Cl" << "Cp" << "Cs"
+                                                      << "RA" << "VR" << "Lambda1" << "Lambda2" << "Lambda3" << "ColorFA";
+    std::vector<typename FilterType::Map> maps;
+    for (QString map : m_scalarMapsRequested)
+    {
+        int mapIndex = mapNames.indexOf(map);
+        if (mapIndex < 0)
+        {
+            dtkWarn() << "Unknown tensor scalar map" << map;
+            return medAbstractJob::MED_JOB_EXIT_FAILURE;
+        }
+        maps.push_back(static_cast<typename FilterType::Map>(mapIndex));
+    }
+
+    itk::CStyleCommand::Pointer callback = itk::CStyleCommand::New();
+    callback->SetClientData((void*)this);
+    callback->SetCallback(ttkTensorScalarMapsProcess::eventCallback);
+
+    typename FilterType::Pointer filter = FilterType::New();
+    filter->SetInput(inData);
+    filter->SetMaps(maps);
+    filter->AddObserver(itk::ProgressEvent(), callback);
+    m_filter = filter;
+
+    try
+    {
+        filter->Update();
+    }
+    catch(itk::ProcessAborted &e)
+    {
+        return medAbstractJob::MED_JOB_EXIT_CANCELLED;
+    }
+
+    QString scalarIdentifier = this->input()->identifier().contains("Double") ? "itkDataImageDouble3" : "itkDataImageFloat3";
+
+    // the first map is set last, to be the output of the process
+    for (int i = m_scalarMapsRequested.size() - 1; i >= 0; --i)
+    {
+        QString map = m_scalarMapsRequested[i];
+
+        medAbstractImageData *output;
+        if (map == "ColorFA")
+        {
+            output = qobject_cast <medAbstractImageData *> (medAbstractDataFactory::instance()->create ("itkDataImageRGBA3"));
+            output->setData(filter->GetColorOutput(i));
+        }
+        else
+        {
+            output = qobject_cast <medAbstractImageData *> (medAbstractDataFactory::instance()->create (scalarIdentifier));
+            output->setData(filter->GetScalarOutput(i));
+        }
+
+        output->setMetaData(medMetaDataKeys::SeriesDescription.key(), this->input()->metadata(medMetaDataKeys::SeriesDescription.key()) + " " + map);
+        this->setOutput(output);
+        if (i > 0)
+            m_scalarMapOutputs[map] = output;
+    }
+
+    return medAbstractJob::MED_JOB_EXIT_SUCCESS;
+}
+
 void ttkTensorScalarMapsProcess::cancel()
 {
     if(this->isRunning())
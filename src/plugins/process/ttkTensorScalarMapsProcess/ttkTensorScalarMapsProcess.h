@@ -1,6 +1,9 @@
 #pragma once
 
 #include <medAbstractDiffusionScalarMapsProcess.h>
+#include <medAbstractImageData.h>
+
+#include <dtkCoreSupport/dtkSmartPointer.h>
 
 #include <itkProcessObject.h>
 #include <itkSmartPointer.h>
@@ -8,6 +11,9 @@
 #include <medIntParameter.h>
 #include <medDoubleParameter.h>
 
+#include <QHash>
+#include <QStringList>
+
 #include <ttkTensorScalarMapsProcessPluginExport.h>
 
 class TTKTENSORSCALARMAPSPROCESSPLUGIN_EXPORT ttkTensorScalarMapsProcess: public medAbstractDiffusionScalarMapsProcess
@@ -30,16 +36,30 @@ public:
     virtual QString caption() const;
     virtual QString description() const;
 
+    QStringList requestedScalarMaps() const;
+
+    //! Output of one of the requested maps, output() being the one of the first
+    medAbstractImageData *scalarMapOutput(QString map) const;
+
+    //! Outputs of the requested maps, in the requested order
+    QList<medAbstractImageData *> scalarMapOutputs() const;
+
 public slots:
     void selectRequestedScalarMap(QString mapRequested);
 
+    //! Computes several maps in one pass over the tensors, each eigendecomposed once
+    void selectRequestedScalarMaps(QStringList mapsRequested);
+
 private:
     template <class inputType> medAbstractJob::medJobExitStatus _run();
+    template <class inputType> medAbstractJob::medJobExitStatus _runMaps();
 
 private:
     itk::SmartPointer<itk::ProcessObject> m_filter;
 
     QString m_scalarMapRequested;
+    QStringList m_scalarMapsRequested;
+    QHash<QString, dtkSmartPointer<medAbstractImageData> > m_scalarMapOutputs; // the maps after the first
 };
 
 inline medAbstractDiffusionScalarMapsProcess* ttkTensorScalarMapsProcessCreator()
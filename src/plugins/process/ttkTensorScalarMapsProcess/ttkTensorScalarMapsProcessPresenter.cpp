@@ -1,7 +1,6 @@
 #include "ttkTensorScalarMapsProcessPresenter.h"
 
-#include <medJobManager.h>
-
+#include <medDataManager.h>
 #include <medIntParameterPresenter.h>
 #include <QVBoxLayout>
 #include <QPushButton>
@@ -17,6 +16,10 @@ ttkTensorScalarMapsProcessPresenter::ttkTensorScalarMapsProcessPresenter(medAbst
 {
     m_process = qobject_cast <ttkTensorScalarMapsProcess *> (parent);
     m_progressionPresenter = new medIntParameterPresenter(m_process->progression());
+
+    connect(m_process, &ttkTensorScalarMapsProcess::finished,
+            this, &ttkTensorScalarMapsProcessPresenter::importOtherScalarMaps,
+            Qt::QueuedConnection);
 }
 
 medAbstractDiffusionScalarMapsProcess* ttkTensorScalarMapsProcessPresenter::process() const
@@ -122,6 +125,11 @@ QWidget* ttkTensorScalarMapsProcessPresenter::buildToolBoxWidget()
 
     tbGlobalLayout->addWidget(tensorToScalarBox);
 
+    QPushButton *allMapsButton = new QPushButton(tr("All maps"), tbWidget);
+    allMapsButton->setToolTip(tr("Compute all the maps in one pass over the tensors"));
+    connect(allMapsButton, SIGNAL(clicked()), this, SLOT(requestAllScalarMaps()));
+    tbGlobalLayout->addWidget(allMapsButton);
+
     // Setting button mappings
     m_mapper = new QSignalMapper (this);
 
@@ -160,5 +168,24 @@ QWidget* ttkTensorScalarMapsProcessPresenter::buildToolBoxWidget()
 void ttkTensorScalarMapsProcessPresenter::requestScalarMap(QString mapRequested)
 {
     m_process->selectRequestedScalarMap(mapRequested);
-    medJobManager::instance()->startJobInThread(this->process());
+    _runProcessFromThread();
+}
+
+void ttkTensorScalarMapsProcessPresenter::requestAllScalarMaps()
+{
+    m_process->selectRequestedScalarMaps(QStringList() << "FA" << "ColorFA" << "RA" << "Lambda1" << "Lambda2" << "Lambda3"
+                                                       << "Cl" << "Cp" << "Cs" << "ADC" << "VR" << "LogFA");
+    _runProcessFromThread();
+}
+
+void ttkTensorScalarMapsProcessPresenter::importOtherScalarMaps(medAbstractJob::medJobExitStatus jobExitStatus)
+{
+    if (jobExitStatus != medAbstractJob::MED_JOB_EXIT_SUCCESS)
+        return;
+
+    for (medAbstractImageData *output : m_process->scalarMapOutputs())
+    {
+        if (output != m_process->output())
+            medDataManager::instance()->importData(output);
+    }
 }
@@ -19,6 +19,11 @@ public:
 
 public slots:
     void requestScalarMap(QString mapRequested);
+    void requestAllScalarMaps();
+
+private slots:
+    //! The first map is imported as output() by the base presenter, the others here
+    void importOtherScalarMaps(medAbstractJob::medJobExitStatus jobExitStatus);
 
 private:
     ttkTensorScalarMapsProcess *m_process;